@@ -157,14 +157,16 @@ int64_t AudioIoCallback::Track::trackId() const
 struct AudioIoCallback::TransportState {
     TransportState(std::weak_ptr<AudacityProject> wOwningProject,
                    const ConstPlayableSequences& playbackSequences,
-                   unsigned numPlaybackChannels, double sampleRate, size_t audioThreadBufferSize)
+                   unsigned numPlaybackChannels, double sampleRate, size_t audioThreadBufferSize,
+                   size_t bufferCapacity)
     {
         if (auto pOwningProject = wOwningProject.lock();
             pOwningProject && numPlaybackChannels > 0) {
             // Setup for realtime playback at the rate of the realtime
             // stream, not the rate of the sample sequence.
             mpRealtimeInitialization.emplace(
-                move(wOwningProject), sampleRate, numPlaybackChannels, audioThreadBufferSize);
+                move(wOwningProject), sampleRate, numPlaybackChannels, audioThreadBufferSize,
+                bufferCapacity);
             // The following adds a new effect processor for each logical sequence.
             for (size_t i = 0, cnt = playbackSequences.size(); i < cnt; ++i) {
                 // An array only of non-null pointers should be given to us
@@ -985,9 +987,10 @@ int AudioIO::StartStream(const TransportSequences& sequences,
     });
 
     mPlaybackBuffers.clear();
-    mScratchBuffers.clear();
-    mScratchPointers.clear();
     mPlaybackMixers.clear();
+    if (mPlaybackPrefetcher) {
+        mPlaybackPrefetcher->Stop();
+    }
     mCaptureBuffers.clear();
     mResample.clear();
     mPlaybackSchedule.mTimeQueue.Clear();
@@ -1077,7 +1080,7 @@ int AudioIO::StartStream(const TransportSequences& sequences,
     }
 
     mpTransportState = std::make_unique<TransportState>(mOwningProject, mPlaybackSequences, mNumPlaybackChannels, mRate,
-                                                        mPlaybackSamplesToCopy);
+                                                        mPlaybackSamplesToCopy, mPlaybackBufferSize);
 
     if (pStartTime) {
         // Calculate the NEW time position
@@ -1291,6 +1294,7 @@ bool AudioIO::AllocateBuffers(
 
                 // Adjust mPlaybackRingBufferSecs correspondingly
                 mPlaybackRingBufferSecs = PlaybackPolicy::Duration { playbackBufferSize / mRate };
+                mPlaybackBufferSize = playbackBufferSize;
 
                 mPlaybackBuffers.resize(0);
                 mProcessingBuffers.resize(0);
@@ -1316,15 +1320,26 @@ bool AudioIO::AllocateBuffers(
                         buffer.reserve(playbackBufferSize);
                     }
 
-                    // Number of scratch buffers depends on device playback channels
-                    if (mNumPlaybackChannels > 0) {
-                        mScratchBuffers.resize(mNumPlaybackChannels * 2 + 1);
-                        mScratchPointers.clear();
-                        for (auto& buffer : mScratchBuffers) {
-                            buffer.Allocate(playbackBufferSize, floatSample);
-                            mScratchPointers.push_back(
-                                reinterpret_cast<float*>(buffer.ptr()));
-                        }
+                    // Keep the same threads from one stream to the next, unless
+                    // the preference changed
+                    using audacity::concurrency::ThreadPool;
+                    const auto threads = AudioIOPlaybackThreads.Read();
+                    const size_t numWorkers = threads < 0
+                                              ? ThreadPool::DefaultNumWorkers()
+                                              : threads;
+                    // If the OS refuses them realtime priority, the workers
+                    // still help, within the deadlines of ProcessPlaybackSlices
+                    if (!mPlaybackPool
+                        || mPlaybackPool->GetConcurrency() != numWorkers + 1) {
+                        mPlaybackPool = std::make_unique<ThreadPool>(
+                            numWorkers, ThreadPool::Priority::Realtime);
+                    }
+
+                    mProcessingBufferOffsets.clear();
+                    size_t offset = 0;
+                    for (const auto& pSequence : mPlaybackSequences) {
+                        mProcessingBufferOffsets.push_back(offset);
+                        offset += pSequence->NChannels();
                     }
                 }
 
@@ -1395,6 +1410,21 @@ bool AudioIO::AllocateBuffers(
                                                      ));
                 }
 
+                if (mPlaybackPrefetcher) {
+                    mPlaybackPrefetcher->Stop();
+                }
+                if (!mPlaybackSequences.empty() && AudioIOPlaybackPrefetch.Read()) {
+                    if (!mPlaybackPrefetcher) {
+                        mPlaybackPrefetcher = std::make_unique<PlaybackPrefetcher>();
+                    }
+                    mPlaybackPrefetcher->Start(
+                        PlaybackPrefetcher::Sequences {
+                        mPlaybackSequences.begin(), mPlaybackSequences.end() });
+                    mPlaybackPrefetcher->Request(policy.PrefetchIntervals(
+                                                     mPlaybackSchedule, mPlaybackSchedule.GetSequenceTime(),
+                                                     mPlaybackPrefetcher->GetLookahead()));
+                }
+
                 const auto timeQueueSize = 1
                                            + (playbackBufferSize + TimeQueueGrainSize - 1)
                                            / TimeQueueGrainSize;
@@ -1474,9 +1504,10 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
 
     mPlaybackBuffers.clear();
     mPlaybackTracks.clear();
-    mScratchBuffers.clear();
-    mScratchPointers.clear();
     mPlaybackMixers.clear();
+    if (mPlaybackPrefetcher) {
+        mPlaybackPrefetcher->Stop();
+    }
     mCaptureBuffers.clear();
     mResample.clear();
     mPlaybackSchedule.mTimeQueue.Clear();
@@ -1632,9 +1663,15 @@ void AudioIO::StopStream()
     // we allocated in StartStream()
     //
     mPlaybackBuffers.clear();
-    mScratchBuffers.clear();
-    mScratchPointers.clear();
     mPlaybackMixers.clear();
+    if (mPlaybackPrefetcher) {
+        mPlaybackPrefetcher->Stop();
+        const auto statistics = mPlaybackPrefetcher->GetStatistics();
+        wxLogDebug("Playback read ahead: %.0f%% of %lld fetches hit, lookahead %.2f s",
+                   100 * statistics.HitRate(),
+                   static_cast<long long>(statistics.hits + statistics.misses),
+                   statistics.lookahead.count());
+    }
     mPlaybackSchedule.mTimeQueue.Clear();
     mPlaybackTracks.clear();
 
@@ -1828,6 +1865,13 @@ double AudioIO::GetBestRate(bool capturing, bool playing, double sampleRate)
     return supportedRate;
 }
 
+PlaybackPrefetcher::Statistics AudioIO::GetPlaybackPrefetchStatistics() const
+{
+    return mPlaybackPrefetcher
+           ? mPlaybackPrefetcher->GetStatistics()
+           : PlaybackPrefetcher::Statistics {};
+}
+
 double AudioIO::GetStreamTime()
 {
     // Sequence time readout for the main thread
@@ -2050,6 +2094,15 @@ bool AudioIO::ProcessPlaybackSlices(
     bool done = false;
     bool progress = false;
 
+    // Workers are late when ordinary threads preempt them, as they may if
+    // they did not get realtime priority; so that the audio thread does not
+    // wait for them much longer than rendering serially would take, they
+    // start nothing after half the duration of what is to be produced
+    using audacity::concurrency::ThreadPool;
+    const auto deadline = ThreadPool::Clock::now()
+                          + std::chrono::duration_cast<ThreadPool::Clock::duration>(
+        std::chrono::duration<double> { 0.5 * available / mRate });
+
     // remember initial processing buffer offsets
     // they may be different depending on latencies
     const auto processingBufferOffsets = stackAllocate(size_t, mProcessingBuffers.size());
@@ -2068,17 +2121,28 @@ bool AudioIO::ProcessPlaybackSlices(
         // consumer side in the PortAudio thread, which reads the time
         // queue after reading the sample queues.  The sample queues use
         // atomic variables, the time queue doesn't.
+        const auto sliceStart = mPlaybackSchedule.mTimeQueue.GetLastTime();
         mPlaybackSchedule.mTimeQueue.Producer(mPlaybackSchedule, slice);
-
-        // mPlaybackMixers correspond one-to-one with mPlaybackSequences
-        size_t iSequence = 0;
-        // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
-        size_t iBuffer = 0;
-        for (auto& mixer : mPlaybackMixers) {
-            // The mixer here isn't actually mixing: it's just doing
-            // resampling, format conversion, and possibly time track
-            // warping
-            if (frames > 0) {
+        if (mPlaybackPrefetcher && toProduce > 0) {
+            std::optional<PlaybackPrefetcher::Loop> loop;
+            if (policy.Looping(mPlaybackSchedule)) {
+                loop = { mPlaybackSchedule.mT0, mPlaybackSchedule.mT1 };
+            }
+            mPlaybackPrefetcher->NoteRead(
+                sliceStart, mPlaybackSchedule.mTimeQueue.GetLastTime(), loop);
+        }
+
+        // The sequences are independent until the master stage, so render
+        // them concurrently; each writes only its own processing buffers
+        if (frames > 0 && !mPlaybackMixers.empty()) {
+            // mPlaybackMixers correspond one-to-one with mPlaybackSequences
+            // (Structured bindings can't be captured by reference)
+            mPlaybackPool->ParallelFor(mPlaybackMixers.size(),
+                                       [&, frames = frames, toProduce = toProduce](size_t iSequence, size_t) {
+                auto& mixer = mPlaybackMixers[iSequence];
+                // The mixer here isn't actually mixing: it's just doing
+                // resampling, format conversion, and possibly time track
+                // warping
                 size_t produced = 0;
 
                 if (toProduce) {
@@ -2089,6 +2153,8 @@ bool AudioIO::ProcessPlaybackSlices(
                 // Copy (non-interleaved) mixer outputs to one or more ring buffers
                 const auto nChannels = mPlaybackSequences[iSequence]->NChannels();
 
+                // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
+                const auto iBuffer = mProcessingBufferOffsets[iSequence];
                 const auto appendPos = mProcessingBuffers[iBuffer].size();
                 for (size_t j = 0; j < nChannels; ++j) {
                     // mPlaybackBuffers correspond many-to-one with mPlaybackSequences
@@ -2109,10 +2175,7 @@ bool AudioIO::ProcessPlaybackSlices(
                         frames - produced,
                         .0f);
                 }
-
-                iBuffer += nChannels;
-                ++iSequence;
-            }
+            }, deadline);
         }
 
         available -= frames;
@@ -2126,33 +2189,37 @@ bool AudioIO::ProcessPlaybackSlices(
                                          frames, available);
     } while (available && !done);
 
+    // Read ahead of where the next slice begins
+    if (mPlaybackPrefetcher) {
+        mPlaybackPrefetcher->Request(policy.PrefetchIntervals(mPlaybackSchedule,
+                                                              mPlaybackSchedule.mTimeQueue.GetLastTime(),
+                                                              mPlaybackPrefetcher->GetLookahead()));
+    }
+
     //stop here if there are no sample sources to process...
     if (mPlaybackSequences.empty()) {
         return progress;
     }
 
     // Do any realtime effect processing for each individual sample source,
-    // after all the little slices have been written.
+    // after all the little slices have been written.  Each sequence has its
+    // own effect states, so this too can be done concurrently; the join
+    // precedes the master stage below.
     if (pScope) {
-        const auto pointers = stackAllocate(float*, mNumPlaybackChannels);
-
-        int bufferIndex = 0;
-        for (const auto& seq : mPlaybackSequences) {
+        mPlaybackPool->ParallelFor(mPlaybackSequences.size(),
+                                   [&](size_t iSequence, size_t) {
+            const auto& seq = mPlaybackSequences[iSequence];
             if (!seq) {
-                continue;//no similar check in convert-to-float part
+                return;//no similar check in convert-to-float part
             }
             const auto channelGroup = seq->FindChannelGroup();
             if (!channelGroup) {
-                continue;
+                return;
             }
 
-            // Are there more output device channels than channels of vt?
-            // Such as when a mono sequence is processed for stereo play?
-            // Then supply some non-null fake input buffers, because the
-            // various ProcessBlock overrides of effects may crash without it.
-            // But it would be good to find the fixes to make this unnecessary.
-            auto scratch = &mScratchPointers[mNumPlaybackChannels + 1];
+            const auto pointers = stackAllocate(float*, mNumPlaybackChannels);
 
+            const auto bufferIndex = mProcessingBufferOffsets[iSequence];
             //skip samples that are already processed
             const auto offset = processingBufferOffsets[bufferIndex];
             //number of newly written samples
@@ -2163,15 +2230,14 @@ bool AudioIO::ProcessPlaybackSlices(
                     pointers[i] = mProcessingBuffers[bufferIndex + i].data() + offset;
                 }
 
+                // Are there more output device channels than channels of vt?
+                // Such as when a mono sequence is processed for stereo play?
+                // Then the effect chain supplies silent inputs for the rest
                 for (unsigned i = seq->NChannels(); i < mNumPlaybackChannels; ++i) {
-                    pointers[i] = *scratch++;
-                    std::fill_n(pointers[i], len, .0f);
+                    pointers[i] = nullptr;
                 }
 
                 const auto discardable = pScope->Process(channelGroup, &pointers[0],
-                                                         mScratchPointers.data(),
-                                                         // The single dummy output buffer:
-                                                         mScratchPointers[mNumPlaybackChannels],
                                                          mNumPlaybackChannels, len);
                 // Check for asynchronous user changes in mute, solo status
                 const auto silenced = SequenceShouldBeSilent(*seq);
@@ -2184,8 +2250,7 @@ bool AudioIO::ProcessPlaybackSlices(
                     }
                 }
             }
-            bufferIndex += seq->NChannels();
-        }
+        }, deadline);
     }
 
     //samples at the beginning could have been discarded
@@ -2216,6 +2281,20 @@ bool AudioIO::ProcessPlaybackSlices(
         buffer.resize(samplesAvailable, 0);
     }
 
+    // Scale into the per-track RingBuffer directly, rather than scaling in
+    // place and copying with Put()
+    const auto putScaled = [](RingBuffer& ringBuffer,
+                              const float* samples, float volume, size_t len) {
+        size_t written = 0;
+        for (const auto& [data, size] : ringBuffer.GetWritableSpans(len)) {
+            std::transform(samples + written, samples + written + size,
+                           reinterpret_cast<float*>(data),
+                           [volume](float sample) { return sample * volume; });
+            written += size;
+        }
+        ringBuffer.CommitWrite(written);
+    };
+
     {
         unsigned bufferIndex = 0;
         for (auto& track :  mPlaybackTracks) {
@@ -2229,16 +2308,13 @@ bool AudioIO::ProcessPlaybackSlices(
             if (numChannels > 1) {
                 for (unsigned n = 0, cnt = std::min(numChannels, mNumPlaybackChannels); n < cnt; ++n) {
                     const float volume = seq->GetChannelVolume(n);
+                    const auto processed = mProcessingBuffers[bufferIndex + n].data();
                     for (unsigned i = 0; i < samplesAvailable; ++i) {
-                        mProcessingBuffers[bufferIndex + n][i] *= volume;
-                        mMasterBuffers[n][i] += mProcessingBuffers[bufferIndex + n][i];
+                        mMasterBuffers[n][i] += processed[i] * volume;
                     }
 
                     //Copy per track data to ring buffers
-                    buffers[n]->Put(
-                        reinterpret_cast<constSamplePtr>(mProcessingBuffers[bufferIndex + n].data()),
-                        floatSample,
-                        samplesAvailable, 0);
+                    putScaled(*buffers[n], processed, volume, samplesAvailable);
                 }
             } else if (numChannels == 1) {
                 float maxVolume = 0.0f;
@@ -2256,16 +2332,10 @@ bool AudioIO::ProcessPlaybackSlices(
                     }
                 }
 
-                for (unsigned i = 0; i < samplesAvailable; ++i) {
-                    mProcessingBuffers[bufferIndex][i] *= maxVolume;
-                }
-
                 for (unsigned n = 0; n < mNumPlaybackChannels; ++n) {
                     //Copy per track data to ring buffers
-                    buffers[n]->Put(
-                        reinterpret_cast<constSamplePtr>(mProcessingBuffers[bufferIndex].data()),
-                        floatSample,
-                        samplesAvailable, 0);
+                    putScaled(*buffers[n], mProcessingBuffers[bufferIndex].data(),
+                              maxVolume, samplesAvailable);
                 }
             }
             bufferIndex += seq->NChannels();
@@ -2290,9 +2360,6 @@ bool AudioIO::ProcessPlaybackSlices(
         masterBufferOffset = pScope->Process(
             RealtimeEffectManager::MasterGroup,
             &pointers[0],
-            mScratchPointers.data(),
-            // The single dummy output buffer:
-            mScratchPointers[mNumPlaybackChannels],
             mNumPlaybackChannels, samplesAvailable);
 
         // wxASSERT(samplesAvailable >= masterBufferOffset); // don't assert on this thread
@@ -2682,38 +2749,28 @@ bool AudioIoCallback::FillOutputBuffers(
     // I would expect us not to need the fast paths, since linearly interpolated volume
     // is very cheap to process.
 
-    // ------ MEMORY ALLOCATION ----------------------
-    // These are small structures.
-    const auto tempBufs = stackAllocate(float*, numPlaybackChannels);
-
-    // And these are larger structures....
-    for (unsigned int c = 0; c < numPlaybackChannels; c++) {
-        tempBufs[c] = stackAllocate(float, framesPerBuffer);
-    }
-    // ------ End of MEMORY ALLOCATION ---------------
-
     auto playbackVolume = GetMixerOutputVol();
     if (mForceFadeOut.load(std::memory_order_relaxed) || IsPaused()) {
         playbackVolume = 0.0;
     }
 
     for (unsigned n = 0; n < numPlaybackChannels; ++n) {
-        decltype(framesPerBuffer) numberOfRetrievedFrames = mPlaybackBuffers[n]->Get(
-            reinterpret_cast<samplePtr>(tempBufs[n]),
-            floatSample,
-            currentlyAvailableFramesAcrossBuffers
-            );
-
-        if (numberOfRetrievedFrames < framesPerBuffer) {
-            // This used to happen normally at the end of non-looping
-            // plays, but it can also be an anomalous case where the
-            // supply from SequenceBufferExchange fails to keep up with the
-            // real-time demand in this thread (see bug 1932). We
-            // must supply something to the sound card, so pad it with
-            // zeroes and not random garbage.
-            memset((void*)&tempBufs[n][numberOfRetrievedFrames], 0,
-                   (framesPerBuffer - numberOfRetrievedFrames) * sizeof(float));
-        }
+        // Read the samples in place, rather than copying them out of the
+        // RingBuffer first
+        const auto spans = mPlaybackBuffers[n]->GetReadableSpans(
+            currentlyAvailableFramesAcrossBuffers);
+        decltype(framesPerBuffer) numberOfRetrievedFrames
+            =spans[0].second + spans[1].second;
+
+        // If numberOfRetrievedFrames < framesPerBuffer:
+        // This used to happen normally at the end of non-looping
+        // plays, but it can also be an anomalous case where the
+        // supply from SequenceBufferExchange fails to keep up with the
+        // real-time demand in this thread (see bug 1932). We
+        // must supply something to the sound card, so pad it with
+        // zeroes and not random garbage -- which is to say, add nothing
+        // to the output beyond the retrieved frames.
+        const auto retrievedFrames = numberOfRetrievedFrames;
 
         // PRL:  More recent rewrites of SequenceBufferExchange should guarantee a
         // padding out of the ring buffers so that equal lengths are
@@ -2742,15 +2799,6 @@ bool AudioIoCallback::FillOutputBuffers(
                 mAudioCallbackInfoQueue.Put({ adcTime, static_cast<int>(numberOfRetrievedFrames) });
             }
 
-            // Output volume emulation: possibly copy meter samples, then
-            // apply volume, then copy to the output buffer
-            if (outputMeterFloats != outputFloats) {
-                for ( unsigned i = 0; i < numberOfRetrievedFrames; ++i) {
-                    outputMeterFloats[numPlaybackChannels * i + n]
-                        +=playbackVolume * tempBufs[n][i];
-                }
-            }
-
             auto oldVolume = mOldPlaybackVolume;
             // if no microfades, jump in volume.
             if (!mbMicroFades) {
@@ -2762,11 +2810,23 @@ bool AudioIoCallback::FillOutputBuffers(
             // framesPerBuffer, which is influenced by the portAudio implementation in
             // opaque ways
             const float deltaVolume = (playbackVolume - oldVolume) / numberOfRetrievedFrames;
-            for (unsigned i = 0; i < numberOfRetrievedFrames; i++) {
-                outputFloats[numPlaybackChannels * i + n]
-                    +=(oldVolume + deltaVolume * i) * tempBufs[n][i];
+
+            // Output volume emulation: possibly copy meter samples, then
+            // apply volume, then copy to the output buffer
+            unsigned i = 0;
+            for (const auto& [data, size] : spans) {
+                const auto samples = reinterpret_cast<const float*>(data);
+                for (size_t j = 0; j < size; ++i, ++j) {
+                    if (outputMeterFloats != outputFloats) {
+                        outputMeterFloats[numPlaybackChannels * i + n]
+                            +=playbackVolume * samples[j];
+                    }
+                    outputFloats[numPlaybackChannels * i + n]
+                        +=(oldVolume + deltaVolume * i) * samples[j];
+                }
             }
         }
+        mPlaybackBuffers[n]->CommitRead(retrievedFrames);
         CallbackCheckCompletion(mCallbackReturn, numberOfRetrievedFrames);
     }
 
@@ -3416,3 +3476,5 @@ bool AudioIO::IsCapturing() const
 }
 
 BoolSetting SoundActivatedRecord{ "/AudioIO/SoundActivatedRecord", false };
+IntSetting AudioIOPlaybackThreads{ "/AudioIO/PlaybackThreads", -1 };
+BoolSetting AudioIOPlaybackPrefetch{ "/AudioIO/PlaybackPrefetch", true };
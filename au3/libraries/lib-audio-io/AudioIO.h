@@ -15,6 +15,7 @@
 
 #include "AudioIOBase.h" // to inherit
 #include "AudioIOSequences.h"
+#include "PlaybackPrefetcher.h" // member variable
 #include "PlaybackSchedule.h" // member variable
 #include "RingBuffer.h"
 #include "LockFreeQueue.h"
@@ -28,6 +29,7 @@
 #include <wx/atomic.h> // member variable
 #include <wx/thread.h>
 
+#include "concurrency/ThreadPool.h" // member variable
 #include "PluginProvider.h" // for PluginID
 #include "Observer.h"
 #include "SampleCount.h"
@@ -250,11 +252,20 @@ public:
     // Old volume is used in playback in linearly interpolating
     // the volume.
     float mOldPlaybackVolume;
-    // Temporary buffers, each as large as the playback buffers
-    std::vector<SampleBuffer> mScratchBuffers;
-    std::vector<float*> mScratchPointers; //!< pointing into mScratchBuffers
+    //! Samples in each of mPlaybackBuffers, the most that realtime effects
+    //! process at once
+    size_t mPlaybackBufferSize{ 0 };
 
     std::vector<std::unique_ptr<Mixer> > mPlaybackMixers;
+    //! Index of the first of mProcessingBuffers for each playback sequence
+    std::vector<size_t> mProcessingBufferOffsets;
+    /*! Renders playback sequences concurrently, up to the master stage;
+     created by the main thread, used by the audio thread */
+    std::unique_ptr<audacity::concurrency::ThreadPool> mPlaybackPool;
+    /*! Reads samples ahead of mPlaybackMixers; created by the main thread
+     for the first playback that reads ahead, and kept for the later ones, so
+     that one thread reads for all; used by the audio thread */
+    std::unique_ptr<PlaybackPrefetcher> mPlaybackPrefetcher;
 
     std::atomic<float> mMixerOutputVol{ 1.0 };
     static int mNextStreamToken;
@@ -546,6 +557,12 @@ public:
      */
     double GetStreamTime();
 
+    /** \brief How well reading ahead kept up with playback
+     *
+     * During playback, or else for the most recent playback
+     */
+    PlaybackPrefetcher::Statistics GetPlaybackPrefetchStatistics() const;
+
     static void AudioThread(std::atomic<bool>& finish);
 
     static void Init();
@@ -625,5 +642,10 @@ private:
 };
 
 AUDIO_IO_API extern BoolSetting SoundActivatedRecord;
+//! How many threads, besides the audio thread, render playback sequences;
+//! negative for a choice based on the number of processors
+AUDIO_IO_API extern IntSetting AudioIOPlaybackThreads;
+//! Whether to read samples on another thread ahead of playback
+AUDIO_IO_API extern BoolSetting AudioIOPlaybackPrefetch;
 
 #endif
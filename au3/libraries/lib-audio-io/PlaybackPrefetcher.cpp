@@ -0,0 +1,228 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file PlaybackPrefetcher.cpp
+
+**********************************************************************/
+#include "PlaybackPrefetcher.h"
+
+#include "WideSampleSequence.h"
+
+#include <algorithm>
+
+namespace {
+using namespace std::chrono_literals;
+using Duration = PlaybackPrefetcher::Duration;
+
+constexpr Duration MinLookahead = 1s;
+constexpr Duration MaxLookahead = 10s;
+//! Lookahead added for each second of latency
+constexpr double LatencyMargin = 20;
+//! Weight of each new measurement of latency, when it is not a new peak
+constexpr double LatencyDecay = 0.1;
+}
+
+double PlaybackPrefetcher::Statistics::HitRate() const
+{
+    const auto total = hits + misses;
+    return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+}
+
+PlaybackPrefetcher::PlaybackPrefetcher()
+    : mStatistics{ 0, 0, MinLookahead, Duration{} }
+    , mThread{[this]{ Run(); }}
+{
+}
+
+PlaybackPrefetcher::~PlaybackPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mStopping = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void PlaybackPrefetcher::Start(Sequences sequences)
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    mSequences = std::move(sequences);
+    ++mGeneration;
+    mPending.clear();
+    mLoaded.clear();
+    mStatistics.hits = mStatistics.misses = 0;
+}
+
+void PlaybackPrefetcher::Stop()
+{
+    Sequences sequences;
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        // Release the sequences after unlocking
+        sequences.swap(mSequences);
+        ++mGeneration;
+        mPending.clear();
+        mLoaded.clear();
+    }
+    mIdleCondition.notify_all();
+}
+
+void PlaybackPrefetcher::Request(Intervals intervals)
+{
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        if (mSequences.empty()) {
+            return;
+        }
+        Retain(intervals);
+        mPending = std::move(intervals);
+    }
+    mCondition.notify_one();
+}
+
+auto PlaybackPrefetcher::GetLookahead() const -> Duration
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return mStatistics.lookahead;
+}
+
+void PlaybackPrefetcher::NoteRead(double t0, double t1, std::optional<Loop> loop)
+{
+    if (t0 == t1) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock{ mMutex };
+    if (mSequences.empty()) {
+        return;
+    }
+    bool hit;
+    if (loop && t1 < t0) {
+        // Wrapped; not a fetch backward over the rest of the loop
+        hit = Uncovered(t0, std::max(t0, loop->end)).empty()
+              && Uncovered(std::min(loop->start, t1), t1).empty();
+    } else {
+        hit = Uncovered(std::min(t0, t1), std::max(t0, t1)).empty();
+    }
+    if (hit) {
+        ++mStatistics.hits;
+    } else {
+        ++mStatistics.misses;
+    }
+}
+
+auto PlaybackPrefetcher::GetStatistics() const -> Statistics
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return mStatistics;
+}
+
+void PlaybackPrefetcher::Wait()
+{
+    std::unique_lock<std::mutex> lock{ mMutex };
+    mIdleCondition.wait(lock, [this]{ return !mBusy && mPending.empty(); });
+}
+
+void PlaybackPrefetcher::Run()
+{
+    std::unique_lock<std::mutex> lock{ mMutex };
+    while (true) {
+        mBusy = false;
+        mIdleCondition.notify_all();
+        mCondition.wait(lock, [this]{ return mStopping || !mPending.empty(); });
+        if (mStopping) {
+            return;
+        }
+        mBusy = true;
+        const auto requests = std::move(mPending);
+        mPending.clear();
+        // Stop() may release the sequences meanwhile
+        const auto sequences = mSequences;
+        const auto generation = mGeneration;
+        for (const auto& [t0, t1] : requests) {
+            for (const auto& [start, end] : Uncovered(t0, t1)) {
+                // A newer request supersedes the rest of this one
+                if (mStopping || !mPending.empty() || mGeneration != generation) {
+                    break;
+                }
+                lock.unlock();
+                const auto begin = std::chrono::steady_clock::now();
+                try {
+                    for (const auto& pSequence : sequences) {
+                        pSequence->Prefetch(start, end);
+                    }
+                }
+                catch (...) {
+                    // Only a guess failed; the mixers report errors
+                }
+                const Duration elapsed = std::chrono::steady_clock::now() - begin;
+                lock.lock();
+
+                if (mGeneration == generation) {
+                    Insert(start, end);
+                }
+                auto& latency = mStatistics.latency;
+                latency = std::max(elapsed,
+                                   latency * (1 - LatencyDecay) + elapsed * LatencyDecay);
+                mStatistics.lookahead = std::clamp(
+                    MinLookahead + latency * LatencyMargin, MinLookahead, MaxLookahead);
+            }
+        }
+    }
+}
+
+void PlaybackPrefetcher::Insert(double t0, double t1)
+{
+    // Find the intervals that overlap or touch the new one, and replace them
+    // with their union
+    const auto first = std::lower_bound(mLoaded.begin(), mLoaded.end(), t0,
+                                        [](const auto& interval, double time){ return interval.second < time; });
+    auto last = first;
+    while (last != mLoaded.end() && last->first <= t1) {
+        t0 = std::min(t0, last->first);
+        t1 = std::max(t1, last->second);
+        ++last;
+    }
+    const auto iter = mLoaded.erase(first, last);
+    mLoaded.emplace(iter, t0, t1);
+}
+
+void PlaybackPrefetcher::Retain(Intervals intervals)
+{
+    std::sort(intervals.begin(), intervals.end());
+    Intervals loaded;
+    loaded.swap(mLoaded);
+    for (const auto& [start, end] : loaded) {
+        for (const auto& [t0, t1] : intervals) {
+            const auto first = std::max(start, t0);
+            const auto last = std::min(end, t1);
+            if (first < last) {
+                Insert(first, last);
+            }
+        }
+    }
+}
+
+auto PlaybackPrefetcher::Uncovered(double t0, double t1) const -> Intervals
+{
+    Intervals result;
+    auto time = t0;
+    for (const auto& [start, end] : mLoaded) {
+        if (start >= t1) {
+            break;
+        }
+        if (end <= time) {
+            continue;
+        }
+        if (start > time) {
+            result.emplace_back(time, start);
+        }
+        time = end;
+    }
+    if (time < t1) {
+        result.emplace_back(time, t1);
+    }
+    return result;
+}
@@ -0,0 +1,136 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file PlaybackPrefetcher.h
+  @brief Reads samples of the playback sequences ahead of the mixers
+
+**********************************************************************/
+#ifndef __AUDACITY_PLAYBACK_PREFETCHER__
+#define __AUDACITY_PLAYBACK_PREFETCHER__
+
+#include "PlaybackSchedule.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class WideSampleSequence;
+
+//! Reads the samples that playback will probably fetch next, on its own thread
+/*!
+ The mixers fetch samples in the AudioIO::SequenceBufferExchange thread.  A
+ block not yet in memory is read from the project file first, and a slow read
+ may drain the ring buffers, so that playback drops out.  This class reads
+ ahead the intervals that the PlaybackPolicy predicts, so that the mixers find
+ the blocks in the sample block cache.
+
+ The lookahead grows with the time that reading has recently taken, so that
+ slower storage is read further ahead.
+
+ The intervals read are remembered only while the policy goes on requesting
+ them, so that those it no longer needs, whose blocks may have left the cache,
+ are read again if playback returns to them.  Looping playback keeps
+ requesting the start of the loop, so that it is not read again each time.
+
+ One thread serves all playbacks, between Start() and Stop().
+
+ All member functions but the constructor and destructor are thread-safe.
+ */
+class AUDIO_IO_API PlaybackPrefetcher final
+{
+public:
+    using Duration = PlaybackPolicy::Duration;
+    using Intervals = PlaybackPolicy::Intervals;
+    using Sequences = std::vector<std::shared_ptr<const WideSampleSequence> >;
+
+    struct Statistics {
+        //! Fetches of the mixers that lay in intervals already read ahead
+        size_t hits{ 0 };
+        size_t misses{ 0 };
+        Duration lookahead{};
+        //! Recent time to read one interval, decaying slowly from its peaks
+        Duration latency{};
+
+        //! @return zero when there were no fetches
+        double HitRate() const;
+    };
+
+    //! Bounds of forward play that begins again at `start` after `end`
+    struct Loop {
+        double start;
+        double end;
+    };
+
+    //! Starts the thread
+    PlaybackPrefetcher();
+    //! Stops the thread, abandoning any pending request
+    ~PlaybackPrefetcher();
+
+    //! Begin serving a playback of the given sequences
+    /*! Forgets the intervals read for any previous playback, and the counts
+     of hits and misses, but not the latency
+     */
+    void Start(Sequences sequences);
+    //! Abandon any pending request, and release the sequences
+    void Stop();
+
+    //! Replace any requested intervals not yet read, and forget those read
+    //! that are not requested again; does not wait
+    /*! Does nothing if not started */
+    void Request(Intervals intervals);
+
+    //! How much real time of playback the next request should cover
+    Duration GetLookahead() const;
+
+    //! Count a fetch by the mixers of track times from t0 to t1, in either
+    //! order
+    /*!
+     @param loop if given, t1 < t0 means that the fetch went from t0 to the
+     end of the loop, then from its start to t1
+     */
+    void NoteRead(double t0, double t1, std::optional<Loop> loop = {});
+
+    Statistics GetStatistics() const;
+
+    //! Wait until all requests are read
+    void Wait();
+
+private:
+    void Run();
+
+    //! Add [t0, t1) to mLoaded, merging it with intervals it meets
+    //! @pre mMutex is locked
+    void Insert(double t0, double t1);
+    //! Remove from mLoaded the times not in any of `intervals`
+    //! @pre mMutex is locked
+    void Retain(Intervals intervals);
+
+    //! Parts of [t0, t1) not in mLoaded, in increasing order
+    //! @pre mMutex is locked
+    Intervals Uncovered(double t0, double t1) const;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::condition_variable mIdleCondition;
+    Intervals mPending;
+    //! Intervals read and not yet passed, disjoint and in increasing order
+    Intervals mLoaded;
+    Statistics mStatistics;
+    //! Empty when not started
+    Sequences mSequences;
+    //! Counts Start() and Stop(), so that reads for an earlier playback are
+    //! not remembered
+    unsigned mGeneration{ 0 };
+    bool mBusy{ false };
+    bool mStopping{ false };
+
+    //! Last member, so that it starts after the others are constructed
+    std::thread mThread;
+};
+
+#endif
@@ -141,6 +141,22 @@ bool PlaybackPolicy::RepositionPlayback(
     return true;
 }
 
+auto PlaybackPolicy::PrefetchIntervals(PlaybackSchedule& schedule,
+                                       double trackTime, Duration lookahead) -> Intervals
+{
+    const auto reversed = schedule.ReversedTime();
+    const auto end = schedule.SolveWarpedLength(trackTime,
+                                                reversed ? -lookahead.count() : lookahead.count());
+    const auto t0 = std::max(std::min(schedule.mT0, schedule.mT1),
+                             std::min(trackTime, end));
+    const auto t1 = std::min(std::max(schedule.mT0, schedule.mT1),
+                             std::max(trackTime, end));
+    if (t0 < t1) {
+        return { { t0, t1 } };
+    }
+    return {};
+}
+
 bool PlaybackPolicy::Looping(const PlaybackSchedule&) const
 {
     return false;
@@ -147,6 +147,23 @@ public:
         size_t available //!< how many more samples may be buffered
         );
 
+    //! Intervals of track time, each (t0, t1) with t0 <= t1
+    using Intervals = std::vector<std::pair<double, double> >;
+
+    //! Which parts of the tracks playback will probably fetch next, most urgent first
+    /*!
+     AudioIO::FillPlayBuffers calls this after each fetch, so that samples may be read
+     from storage before the mixers ask for them.  A wrong guess costs only time.
+
+     Default covers `lookahead` of real time from `trackTime` toward mT1, in
+     either direction, but not past mT0 or mT1.
+
+     @param trackTime where the next fetch will begin
+     @param lookahead how much real time to cover
+     */
+    virtual Intervals PrefetchIntervals(
+        PlaybackSchedule& schedule, double trackTime, Duration lookahead);
+
     //! @section To be removed
 
     virtual bool Looping(const PlaybackSchedule& schedule) const;
@@ -207,6 +207,32 @@ std::pair<samplePtr, size_t> RingBuffer::GetUnflushed(unsigned iBlock)
     }
 }
 
+RingBuffer::Spans RingBuffer::GetWritableSpans(size_t samples)
+{
+    // As in Put(): the acquire makes any reading done in Get() happen-before
+    // the reuse of the space
+    auto start = mStart.load(std::memory_order_acquire);
+    auto end = mWritten;
+    samples = std::min(samples, Free(start, end));
+
+    const auto size0 = std::min(samples, mBufferSize - end);
+    const auto size1 = samples - size0;
+    const auto sampleSize = SAMPLE_SIZE(mFormat);
+    return { {
+        { size0 ? mBuffer.ptr() + end * sampleSize : nullptr, size0 },
+        { size1 ? mBuffer.ptr() : nullptr, size1 },
+    } };
+}
+
+size_t RingBuffer::CommitWrite(size_t samples)
+{
+    auto start = mStart.load(std::memory_order_relaxed);
+    samples = std::min(samples, Free(start, mWritten));
+    mWritten = (mWritten + samples) % mBufferSize;
+    mLastPadding = 0;
+    return samples;
+}
+
 void RingBuffer::Flush()
 {
     // Atomically update the end pointer with release, so the nonatomic writes
@@ -264,6 +290,35 @@ size_t RingBuffer::Get(samplePtr buffer, sampleFormat format,
     return copied;
 }
 
+RingBuffer::ConstSpans RingBuffer::GetReadableSpans(size_t samples) const
+{
+    // Must match the writer's release with acquire for well defined reads of
+    // the buffer
+    auto end = mEnd.load(std::memory_order_acquire);
+    auto start = mStart.load(std::memory_order_relaxed);
+    samples = std::min(samples, Filled(start, end));
+
+    const auto size0 = std::min(samples, mBufferSize - start);
+    const auto size1 = samples - size0;
+    const auto sampleSize = SAMPLE_SIZE(mFormat);
+    return { {
+        { size0 ? mBuffer.ptr() + start * sampleSize : nullptr, size0 },
+        { size1 ? mBuffer.ptr() : nullptr, size1 },
+    } };
+}
+
+size_t RingBuffer::CommitRead(size_t samples)
+{
+    auto end = mEnd.load(std::memory_order_relaxed);  // get away with it here
+    auto start = mStart.load(std::memory_order_relaxed);
+    samples = std::min(samples, Filled(start, end));
+
+    // Unlike Discard(), the samples were read, so release, as in Get()
+    mStart.store((start + samples) % mBufferSize, std::memory_order_release);
+
+    return samples;
+}
+
 size_t RingBuffer::Discard(size_t samplesToDiscard)
 {
     auto end = mEnd.load(std::memory_order_relaxed);  // get away with it here
@@ -12,14 +12,25 @@
 #define __AUDACITY_RING_BUFFER__
 
 #include "SampleFormat.h"
+#include <array>
 #include <atomic>
 
 class RingBuffer final : public NonInterferingBase
 {
 public:
+    //! Contiguous samples in the format of the RingBuffer, and their count
+    using Span = std::pair<samplePtr, size_t>;
+    using ConstSpan = std::pair<constSamplePtr, size_t>;
+    //! A region of the buffer, which wraps around at most once; the second
+    //! span is empty unless the first one reaches the end of the storage
+    using Spans = std::array<Span, 2>;
+    using ConstSpans = std::array<ConstSpan, 2>;
+
     RingBuffer(sampleFormat format, size_t size);
     ~RingBuffer();
 
+    sampleFormat GetFormat() const { return mFormat; }
+
     //
     // For the writer only:
     //
@@ -40,6 +51,19 @@ public:
     //! Get access to written but unflushed data, which is in at most two blocks
     //! Excludes the padding of the most recent Put()
     std::pair<samplePtr, size_t> GetUnflushed(unsigned iBlock);
+    //! Get free space for at most `samples`, to be written directly
+    /*!
+     Lets the producer render into the buffer instead of copying into it with
+     Put().  Nothing counts as written until CommitWrite().
+     The total size may be less than `samples`, as for Put().
+     */
+    Spans GetWritableSpans(size_t samples);
+    //! Like Put() without padding, of samples already written into the
+    //! result of the last GetWritableSpans()
+    /*!
+     @return how many were committed, at most the size of those spans
+     */
+    size_t CommitWrite(size_t samples);
     //! Flush after a sequence of Put (and/or Clear) calls to let consumer see
     void Flush();
 
@@ -51,6 +75,17 @@ public:
     //! Does not apply dithering
     size_t Get(samplePtr buffer, sampleFormat format, size_t samples);
     size_t Discard(size_t samples);
+    //! Get flushed samples, at most `samples`, to be read in place
+    /*!
+     Lets the consumer avoid the copy of Get().  The samples remain
+     owned by the reader until CommitRead().
+     */
+    ConstSpans GetReadableSpans(size_t samples) const;
+    //! Like Get() of samples already read from the last GetReadableSpans()
+    /*!
+     @return how many were released to the writer
+     */
+    size_t CommitRead(size_t samples);
 
 private:
     size_t Filled(size_t start, size_t end) const;
@@ -0,0 +1,162 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PlaybackPrefetcherTests.cpp
+
+**********************************************************************/
+#include "PlaybackPrefetcher.h"
+
+#include "WideSampleSequence.h"
+
+#include <catch2/catch.hpp>
+
+#include <mutex>
+
+namespace {
+//! Records the intervals it is asked to read
+class FakeSequence final : public WideSampleSequence
+{
+public:
+    AudioGraph::ChannelType GetChannelType() const override
+    { return AudioGraph::MonoChannel; }
+    size_t NChannels() const override { return 1; }
+    float GetChannelVolume(int) const override { return 1.0f; }
+    bool DoGet(size_t, size_t, const samplePtr[], sampleFormat, sampleCount,
+               size_t, bool, fillFormat, bool, sampleCount*) const override
+    { return false; }
+    double GetStartTime() const override { return 0; }
+    double GetEndTime() const override { return 100; }
+    double GetRate() const override { return 44100; }
+    sampleFormat WidestEffectiveFormat() const override { return floatSample; }
+    bool HasTrivialEnvelope() const override { return true; }
+    void GetEnvelopeValues(double*, size_t, double, bool) const override {}
+
+    void Prefetch(double t0, double t1) const override
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mRead.emplace_back(t0, t1);
+    }
+
+    PlaybackPrefetcher::Intervals Read() const
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        return mRead;
+    }
+
+private:
+    mutable std::mutex mMutex;
+    mutable PlaybackPrefetcher::Intervals mRead;
+};
+
+using Intervals = PlaybackPrefetcher::Intervals;
+}
+
+TEST_CASE("PlaybackPrefetcher")
+{
+    const auto pSequence = std::make_shared<FakeSequence>();
+    PlaybackPrefetcher prefetcher;
+    prefetcher.Start({ pSequence });
+
+    SECTION("reads the requested intervals")
+    {
+        prefetcher.Request({ { 0, 1 }, { 5, 6 } });
+        prefetcher.Wait();
+        REQUIRE(pSequence->Read() == Intervals{ { 0, 1 }, { 5, 6 } });
+    }
+
+    SECTION("does not read the same samples again")
+    {
+        prefetcher.Request({ { 1, 2 } });
+        prefetcher.Wait();
+        prefetcher.Request({ { 0, 3 } });
+        prefetcher.Wait();
+        REQUIRE(pSequence->Read() == Intervals{ { 1, 2 }, { 0, 1 }, { 2, 3 } });
+    }
+
+    SECTION("remembers any number of adjacent intervals")
+    {
+        for (int ii = 0; ii < 100; ++ii) {
+            prefetcher.Request({ { 0, (ii + 1) * 0.1 } });
+            prefetcher.Wait();
+        }
+        prefetcher.Request({ { 0, 10 } });
+        prefetcher.Wait();
+        REQUIRE(pSequence->Read().size() == 100);
+    }
+
+    SECTION("reads again what is no longer requested")
+    {
+        prefetcher.Request({ { 0, 2 } });
+        prefetcher.Wait();
+        prefetcher.Request({ { 1, 2 } });
+        prefetcher.Wait();
+        // Backwards play
+        prefetcher.Request({ { 1, 1.5 } });
+        prefetcher.Wait();
+        prefetcher.Request({ { 0, 2 } });
+        prefetcher.Wait();
+        REQUIRE(pSequence->Read() == Intervals{ { 0, 2 }, { 0, 1 }, { 1.5, 2 } });
+    }
+
+    SECTION("keeps the start of a loop while playing to its end")
+    {
+        const PlaybackPrefetcher::Loop loop{ 0, 10 };
+        prefetcher.Request({ { 9, 10 }, { 0, 1 } });
+        prefetcher.Wait();
+        prefetcher.NoteRead(9, 9.5, loop);
+        prefetcher.Request({ { 9.5, 10 }, { 0, 1.5 } });
+        prefetcher.Wait();
+        REQUIRE(pSequence->Read() == Intervals{ { 9, 10 }, { 0, 1 }, { 1, 1.5 } });
+
+        // The fetch that wraps is not backwards over the rest of the loop
+        prefetcher.NoteRead(9.5, 0.5, loop);
+        const auto statistics = prefetcher.GetStatistics();
+        REQUIRE(statistics.hits == 2);
+        REQUIRE(statistics.misses == 0);
+    }
+
+    SECTION("serves one playback at a time")
+    {
+        prefetcher.Request({ { 0, 1 } });
+        prefetcher.Wait();
+        prefetcher.NoteRead(0, 1);
+        prefetcher.Stop();
+        prefetcher.Request({ { 2, 3 } });
+        prefetcher.NoteRead(2, 3);
+        prefetcher.Wait();
+        REQUIRE(pSequence->Read() == Intervals{ { 0, 1 } });
+        REQUIRE(prefetcher.GetStatistics().hits == 1);
+
+        prefetcher.Start({ pSequence });
+        REQUIRE(prefetcher.GetStatistics().hits == 0);
+        prefetcher.Request({ { 0, 1 } });
+        prefetcher.Wait();
+        REQUIRE(pSequence->Read() == Intervals{ { 0, 1 }, { 0, 1 } });
+    }
+
+    SECTION("counts fetches within read intervals as hits")
+    {
+        prefetcher.Request({ { 0, 2 } });
+        prefetcher.Wait();
+        prefetcher.NoteRead(0.5, 1.5);
+        // Backwards play
+        prefetcher.NoteRead(2, 1);
+        prefetcher.NoteRead(1.5, 2.5);
+        const auto statistics = prefetcher.GetStatistics();
+        REQUIRE(statistics.hits == 2);
+        REQUIRE(statistics.misses == 1);
+        REQUIRE(statistics.HitRate() == Approx(2.0 / 3));
+    }
+
+    SECTION("keeps its lookahead within bounds")
+    {
+        using namespace std::chrono_literals;
+        prefetcher.Request({ { 0, 1 } });
+        prefetcher.Wait();
+        const auto lookahead = prefetcher.GetLookahead();
+        REQUIRE(lookahead >= 1s);
+        REQUIRE(lookahead <= 10s);
+    }
+}
@@ -0,0 +1,144 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RingBufferTests.cpp
+
+**********************************************************************/
+#include "RingBuffer.h"
+
+#include <catch2/catch.hpp>
+
+#include <numeric>
+#include <vector>
+
+namespace {
+size_t PutBySpans(RingBuffer& ringBuffer, const float* samples, size_t len)
+{
+    size_t written = 0;
+    for (const auto& [data, size] : ringBuffer.GetWritableSpans(len)) {
+        std::copy(samples + written, samples + written + size,
+                  reinterpret_cast<float*>(data));
+        written += size;
+    }
+    return ringBuffer.CommitWrite(written);
+}
+
+size_t GetBySpans(RingBuffer& ringBuffer, float* samples, size_t len)
+{
+    size_t read = 0;
+    for (const auto& [data, size] : ringBuffer.GetReadableSpans(len)) {
+        const auto source = reinterpret_cast<const float*>(data);
+        std::copy(source, source + size, samples + read);
+        read += size;
+    }
+    return ringBuffer.CommitRead(read);
+}
+} // namespace
+
+TEST_CASE("RingBuffer spans match Put and Get")
+{
+    constexpr size_t bufferSize = 100;
+    constexpr size_t blockSize = 32;
+    RingBuffer viaCopy { floatSample, bufferSize };
+    RingBuffer viaSpans { floatSample, bufferSize };
+
+    std::vector<float> input(blockSize);
+    std::vector<float> outputCopy(blockSize), outputSpans(blockSize);
+    float next = 0;
+    // Enough passes to wrap around several times
+    for (int pass = 0; pass < 20; ++pass) {
+        std::iota(input.begin(), input.end(), next);
+        next += blockSize;
+
+        const auto put = viaCopy.Put(
+            reinterpret_cast<constSamplePtr>(input.data()), floatSample,
+            blockSize);
+        REQUIRE(PutBySpans(viaSpans, input.data(), blockSize) == put);
+
+        // Nothing is visible before the flush
+        REQUIRE(viaSpans.GetReadableSpans(blockSize)[0].second
+                == viaCopy.AvailForGet());
+        viaCopy.Flush();
+        viaSpans.Flush();
+        REQUIRE(viaSpans.AvailForGet() == viaCopy.AvailForGet());
+
+        const auto got = viaCopy.Get(
+            reinterpret_cast<samplePtr>(outputCopy.data()), floatSample,
+            blockSize);
+        REQUIRE(GetBySpans(viaSpans, outputSpans.data(), blockSize) == got);
+        REQUIRE(outputCopy == outputSpans);
+    }
+}
+
+TEST_CASE("RingBuffer spans wrap around at most once")
+{
+    RingBuffer ringBuffer { floatSample, 64 };
+    std::vector<float> samples(48);
+    REQUIRE(PutBySpans(ringBuffer, samples.data(), 48) == 48);
+    ringBuffer.Flush();
+    REQUIRE(GetBySpans(ringBuffer, samples.data(), 48) == 48);
+
+    // 16 samples remain before the end of storage
+    const auto writable = ringBuffer.GetWritableSpans(40);
+    REQUIRE(writable[0].second == 16);
+    REQUIRE(writable[1].second == 24);
+    REQUIRE(ringBuffer.CommitWrite(40) == 40);
+    ringBuffer.Flush();
+
+    const auto readable = ringBuffer.GetReadableSpans(100);
+    REQUIRE(readable[0].second == 16);
+    REQUIRE(readable[1].second == 24);
+}
+
+TEST_CASE("RingBuffer callback benchmark", "[benchmark][.]")
+{
+    // The PortAudio callback's side, at a small hardware buffer size
+    constexpr size_t callbackSize = 32;
+    constexpr size_t bufferSize = 44100;
+    RingBuffer ringBuffer { floatSample, bufferSize };
+    std::vector<float> input(callbackSize, 0.5f);
+    std::vector<float> output(callbackSize);
+
+    const auto refill = [&] {
+        while (ringBuffer.AvailForPut() >= callbackSize) {
+            PutBySpans(ringBuffer, input.data(), callbackSize);
+        }
+        ringBuffer.Flush();
+    };
+
+    refill();
+    BENCHMARK("Get")
+    {
+        if (ringBuffer.AvailForGet() < callbackSize) {
+            refill();
+        }
+        ringBuffer.Get(reinterpret_cast<samplePtr>(output.data()), floatSample,
+                       callbackSize);
+        float sum = 0;
+        for (auto sample : output) {
+            sum += sample;
+        }
+        return sum;
+    };
+
+    refill();
+    BENCHMARK("GetReadableSpans")
+    {
+        if (ringBuffer.AvailForGet() < callbackSize) {
+            refill();
+        }
+        float sum = 0;
+        size_t read = 0;
+        for (const auto& [data, size] : ringBuffer.GetReadableSpans(callbackSize)) {
+            const auto samples = reinterpret_cast<const float*>(data);
+            for (size_t i = 0; i < size; ++i) {
+                sum += samples[i];
+            }
+            read += size;
+        }
+        ringBuffer.CommitRead(read);
+        return sum;
+    };
+}
@@ -9,6 +9,7 @@
 
 **********************************************************************/
 #include "BassTrebleBase.h"
+#include "Biquad.h"
 #include "ShuttleAutomation.h"
 
 const EffectParameterMethods& BassTrebleBase::Parameters() const
@@ -53,6 +54,11 @@ EffectType BassTrebleBase::GetType() const
     return EffectTypeProcess;
 }
 
+bool BassTrebleBase::ProcessesTracksIndependently() const
+{
+    return true;
+}
+
 auto BassTrebleBase::RealtimeSupport() const -> RealtimeSince
 {
     return RealtimeSince::After_3_1;
@@ -120,15 +126,27 @@ size_t BassTrebleBase::Instance::RealtimeProcess(
         settings, mSlaves[group].mState, inbuf, outbuf, numSamples);
 }
 
+namespace {
+// Coefficients computed by Coefficients(), normalized so that a0 is 1
+Biquad ShelfSection(
+    double a0, double a1, double a2, double b0, double b1, double b2)
+{
+    Biquad section;
+    section.fNumerCoeffs[Biquad::B0] = b0 / a0;
+    section.fNumerCoeffs[Biquad::B1] = b1 / a0;
+    section.fNumerCoeffs[Biquad::B2] = b2 / a0;
+    section.fDenomCoeffs[Biquad::A1] = a1 / a0;
+    section.fDenomCoeffs[Biquad::A2] = a2 / a0;
+    return section;
+}
+}
+
 size_t BassTrebleBase::Instance::InstanceProcess(
     EffectSettings& settings, BassTrebleState& data, const float* const* inBlock,
     float* const* outBlock, size_t blockLen)
 {
     auto& ms = GetSettings(settings);
 
-    const float* ibuf = inBlock[0];
-    float* obuf = outBlock[0];
-
     // Set value to ensure correct rounding
     double oldBass = DB_TO_LINEAR(ms.mBass);
     double oldTreble = DB_TO_LINEAR(ms.mTreble);
@@ -140,6 +158,9 @@ size_t BassTrebleBase::Instance::InstanceProcess(
         Coefficients(
             data.hzBass, data.slope, ms.mBass, data.samplerate, kBass, data.a0Bass,
             data.a1Bass, data.a2Bass, data.b0Bass, data.b1Bass, data.b2Bass);
+        data.filter.SetSection(0, ShelfSection(
+                                   data.a0Bass, data.a1Bass, data.a2Bass,
+                                   data.b0Bass, data.b1Bass, data.b2Bass));
     }
 
     // Compute coefficients of the high shelf biquand IIR filter
@@ -148,10 +169,15 @@ size_t BassTrebleBase::Instance::InstanceProcess(
             data.hzTreble, data.slope, ms.mTreble, data.samplerate, kTreble,
             data.a0Treble, data.a1Treble, data.a2Treble, data.b0Treble,
             data.b1Treble, data.b2Treble);
+        data.filter.SetSection(1, ShelfSection(
+                                   data.a0Treble, data.a1Treble, data.a2Treble,
+                                   data.b0Treble, data.b1Treble, data.b2Treble));
     }
 
+    data.filter.Process(inBlock, outBlock, blockLen);
+    float* obuf = outBlock[0];
     for (decltype(blockLen) i = 0; i < blockLen; i++) {
-        obuf[i] = DoFilter(data, ibuf[i]) * data.gain;
+        obuf[i] *= data.gain;
     }
 
     return blockLen;
@@ -182,32 +208,6 @@ void BassTrebleBase::Instance::Coefficients(
     }
 }
 
-float BassTrebleBase::Instance::DoFilter(BassTrebleState& data, float in)
-{
-    // Bass filter
-    float out = (data.b0Bass * in + data.b1Bass * data.xn1Bass
-                 + data.b2Bass * data.xn2Bass - data.a1Bass * data.yn1Bass
-                 - data.a2Bass * data.yn2Bass)
-                / data.a0Bass;
-    data.xn2Bass = data.xn1Bass;
-    data.xn1Bass = in;
-    data.yn2Bass = data.yn1Bass;
-    data.yn1Bass = out;
-
-    // Treble filter
-    in = out;
-    out = (data.b0Treble * in + data.b1Treble * data.xn1Treble
-           + data.b2Treble * data.xn2Treble - data.a1Treble * data.yn1Treble
-           - data.a2Treble * data.yn2Treble)
-          / data.a0Treble;
-    data.xn2Treble = data.xn1Treble;
-    data.xn1Treble = in;
-    data.yn2Treble = data.yn1Treble;
-    data.yn1Treble = out;
-
-    return out;
-}
-
 void BassTrebleBase::Instance::InstanceInit(
     EffectSettings& settings, BassTrebleState& data, float sampleRate)
 {
@@ -232,15 +232,8 @@ void BassTrebleBase::Instance::InstanceInit(
     data.b1Treble = 0;
     data.b2Treble = 0;
 
-    data.xn1Bass = 0;
-    data.xn2Bass = 0;
-    data.yn1Bass = 0;
-    data.yn2Bass = 0;
-
-    data.xn1Treble = 0;
-    data.xn2Treble = 0;
-    data.yn1Treble = 0;
-    data.yn2Treble = 0;
+    const Biquad shelves[2];
+    data.filter = BiquadCascade{ shelves, 2, 1 };
 
     data.bass = -1;
     data.treble = -1;
@@ -10,6 +10,7 @@
 **********************************************************************/
 #pragma once
 
+#include "BiquadCascade.h"
 #include "PerTrackEffect.h"
 #include "SettingsVisitor.h"
 
@@ -30,8 +31,8 @@ public:
     double slope, hzBass, hzTreble;
     double a0Bass, a1Bass, a2Bass, b0Bass, b1Bass, b2Bass;
     double a0Treble, a1Treble, a2Treble, b0Treble, b1Treble, b2Treble;
-    double xn1Bass, xn2Bass, yn1Bass, yn2Bass;
-    double xn1Treble, xn2Treble, yn1Treble, yn2Treble;
+    //! The bass shelf, then the treble shelf
+    BiquadCascade filter;
 };
 
 struct BassTrebleSettings
@@ -64,6 +65,7 @@ public:
     // EffectDefinitionInterface implementation
 
     EffectType GetType() const override;
+    bool ProcessesTracksIndependently() const override;
     RealtimeSince RealtimeSupport() const override;
 
     // Effect Implementation
@@ -106,8 +108,6 @@ public:
             double hz, double slope, double gain, double samplerate, int type, double& a0, double& a1, double& a2, double& b0, double& b1,
             double& b2);
 
-        static float DoFilter(BassTrebleState& data, float in);
-
         BassTrebleState mState;
         std::vector<BassTrebleBase::Instance> mSlaves;
     };
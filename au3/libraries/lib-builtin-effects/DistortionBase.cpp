@@ -119,6 +119,11 @@ EffectType DistortionBase::GetType() const
     return EffectTypeProcess;
 }
 
+bool DistortionBase::ProcessesTracksIndependently() const
+{
+    return true;
+}
+
 auto DistortionBase::RealtimeSupport() const -> RealtimeSince
 {
     return RealtimeSince::After_3_1;
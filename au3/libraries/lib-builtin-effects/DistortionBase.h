@@ -80,6 +80,7 @@ public:
     // EffectDefinitionInterface implementation
 
     EffectType GetType() const override;
+    bool ProcessesTracksIndependently() const override;
     RealtimeSince RealtimeSupport() const override;
     RegistryPaths GetFactoryPresets() const override;
     OptionalMessage
@@ -53,6 +53,11 @@ EffectType EchoBase::GetType() const
     return EffectTypeProcess;
 }
 
+bool EchoBase::ProcessesTracksIndependently() const
+{
+    return true;
+}
+
 bool EchoBase::Instance::ProcessInitialize(
     EffectSettings& settings, double sampleRate, ChannelNames)
 {
@@ -43,6 +43,7 @@ public:
     // EffectDefinitionInterface implementation
 
     EffectType GetType() const override;
+    bool ProcessesTracksIndependently() const override;
 
     struct BUILTIN_EFFECTS_API Instance : public PerTrackEffect::Instance, public EffectInstanceWithBlockSize
     {
@@ -324,15 +324,8 @@ bool EqualizationBase::Process(EffectInstance&, EffectSettings&)
             auto iter0 = pTempTrack->Channels().begin();
 
             for (const auto pChannel : track->Channels()) {
-                constexpr auto windowSize = EqualizationFilter::windowSize;
                 const auto& M = mParameters.mM;
-
-                wxASSERT(M - 1 < windowSize);
-                size_t L = windowSize - (M - 1); // Process L samples at a go
-                auto idealBlockLen = pChannel->GetMaxBlockSize() * 4;
-                if (idealBlockLen % L != 0) {
-                    idealBlockLen += (L - (idealBlockLen % L));
-                }
+                const auto idealBlockLen = pChannel->GetMaxBlockSize() * 4;
                 auto pNewChannel = *iter0++;
                 Task task { M, idealBlockLen, *pNewChannel };
                 bGoodResult = ProcessOne(task, count, *pChannel, start, len);
@@ -364,51 +357,25 @@ bool EqualizationBase::ProcessOne(
     Task& task, int count, const WaveChannel& t, sampleCount start,
     sampleCount len)
 {
-    constexpr auto windowSize = EqualizationFilter::windowSize;
-
     const auto& M = mParameters.mM;
-
-    wxASSERT(M - 1 < windowSize);
-    size_t L = windowSize - (M - 1); // Process L samples at a go
     auto s = start;
 
     auto& buffer = task.buffer;
-    auto& thisWindow = task.thisWindow;
-    auto& lastWindow = task.lastWindow;
+    auto& convolver = task.convolver;
+    convolver.SetImpulseResponse(
+        mParameters.mImpulse.data(), mParameters.mImpulse.size());
 
     auto originalLen = len;
 
     TrackProgress(count, 0.);
     bool bLoopSuccess = true;
-    size_t wcopy = 0;
 
     while (len != 0)
     {
         auto block = limitSampleBufferSize(task.idealBlockLen, len);
 
         t.GetFloats(buffer.get(), s, block);
-
-        for (size_t i = 0; i < block;
-             i += L) { // go through block in lumps of length L
-            wcopy = std::min<size_t>(L, block - i);
-            for (size_t j = 0; j < wcopy; j++) {
-                thisWindow[j] = buffer[i + j]; // copy the L (or remaining) samples
-            }
-            for (auto j = wcopy; j < windowSize; j++) {
-                thisWindow[j] = 0; // this includes the padding
-            }
-            mParameters.Filter(windowSize, thisWindow);
-
-            // Overlap - Add
-            for (size_t j = 0; (j < M - 1) && (j < wcopy); j++) {
-                buffer[i + j] = thisWindow[j] + lastWindow[L + j];
-            }
-            for (size_t j = M - 1; j < wcopy; j++) {
-                buffer[i + j] = thisWindow[j];
-            }
-
-            std::swap(thisWindow, lastWindow);
-        } // next i, lump of this block
+        convolver.Process(buffer.get(), buffer.get(), block);
 
         task.AccumulateSamples((samplePtr)buffer.get(), block);
         len -= block;
@@ -422,26 +389,15 @@ bool EqualizationBase::ProcessOne(
     }
 
     if (bLoopSuccess) {
-        // M-1 samples of 'tail' left in lastWindow, get them now
-        if (wcopy < (M - 1)) {
-            // Still have some overlap left to process
-            // (note that lastWindow and thisWindow have been exchanged at this
-            // point
-            //  so that 'thisWindow' is really the window prior to 'lastWindow')
-            size_t j = 0;
-            for (; j < M - 1 - wcopy; j++) {
-                buffer[j] = lastWindow[wcopy + j] + thisWindow[L + wcopy + j];
-            }
-            // And fill in the remainder after the overlap
-            for (; j < M - 1; j++) {
-                buffer[j] = lastWindow[wcopy + j];
-            }
-        } else {
-            for (size_t j = 0; j < M - 1; j++) {
-                buffer[j] = lastWindow[wcopy + j];
-            }
+        // Flush the latency and the M-1 samples of 'tail' with silence
+        auto remaining = convolver.Latency() + M - 1;
+        while (remaining > 0) {
+            const auto block = std::min(remaining, task.idealBlockLen);
+            std::fill(buffer.get(), buffer.get() + block, 0.0f);
+            convolver.Process(buffer.get(), buffer.get(), block);
+            task.AccumulateSamples((samplePtr)buffer.get(), block);
+            remaining -= block;
         }
-        task.AccumulateSamples((samplePtr)buffer.get(), M - 1);
     }
     return bLoopSuccess;
 }
@@ -5,6 +5,7 @@
 
 #include "EqualizationCurvesList.h"
 #include "EqualizationFilter.h"
+#include "PartitionedConvolver.h"
 #include "SampleFormat.h"
 #include "StatefulEffect.h"
 #include "WaveTrack.h"
@@ -56,12 +57,12 @@ protected:
     struct Task
     {
         Task(size_t M, size_t idealBlockLen, WaveChannel& channel)
-            : buffer{idealBlockLen}
+            : convolver{M}
+            , buffer{idealBlockLen}
             , idealBlockLen{idealBlockLen}
             , output{channel}
-            , leftTailRemaining{(M - 1) / 2}
+            , leftTailRemaining{(M - 1) / 2 + convolver.Latency()}
         {
-            memset(lastWindow, 0, windowSize * sizeof(float));
         }
 
         void AccumulateSamples(constSamplePtr buffer, size_t len)
@@ -73,21 +74,16 @@ protected:
             output.Append(buffer, floatSample, len);
         }
 
-        static constexpr auto windowSize = EqualizationFilter::windowSize;
-        Floats window1 { windowSize };
-        Floats window2 { windowSize };
+        PartitionedConvolver convolver;
 
         Floats buffer;
         const size_t idealBlockLen;
 
-        // These pointers are swapped after each FFT window
-        float* thisWindow { window1.get() };
-        float* lastWindow { window2.get() };
-
         // a new WaveChannel to hold all of the output,
         // including 'tails' each end
         WaveChannel& output;
 
+        // Samples of latency, and of the left tail, to discard
         size_t leftTailRemaining;
     };
 
@@ -81,6 +81,11 @@ EffectType PhaserBase::GetType() const
     return EffectTypeProcess;
 }
 
+bool PhaserBase::ProcessesTracksIndependently() const
+{
+    return true;
+}
+
 auto PhaserBase::RealtimeSupport() const -> RealtimeSince
 {
     return RealtimeSince::After_3_1;
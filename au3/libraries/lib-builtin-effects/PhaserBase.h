@@ -83,6 +83,7 @@ public:
     // EffectDefinitionInterface implementation
 
     EffectType GetType() const override;
+    bool ProcessesTracksIndependently() const override;
     RealtimeSince RealtimeSupport() const override;
 
 protected:
@@ -121,22 +121,23 @@ EffectType ScienFilterBase::GetType() const
     return EffectTypeProcess;
 }
 
+// Both channels of a stereo track are filtered together, in the lanes of
+// BiquadCascade
 unsigned ScienFilterBase::GetAudioInCount() const
 {
-    return 1;
+    return 2;
 }
 
 unsigned ScienFilterBase::GetAudioOutCount() const
 {
-    return 1;
+    return 2;
 }
 
 bool ScienFilterBase::ProcessInitialize(
     EffectSettings&, double, ChannelNames chanMap)
 {
-    for (int iPair = 0; iPair < (mOrder + 1) / 2; iPair++) {
-        mpBiquad[iPair].Reset();
-    }
+    mCascade = BiquadCascade{
+        mpBiquad.get(), size_t((mOrder + 1) / 2), GetAudioInCount() };
     return true;
 }
 
@@ -144,12 +145,7 @@ size_t ScienFilterBase::ProcessBlock(
     EffectSettings&, const float* const* inBlock, float* const* outBlock,
     size_t blockLen)
 {
-    const float* ibuf = inBlock[0];
-    for (int iPair = 0; iPair < (mOrder + 1) / 2; iPair++) {
-        mpBiquad[iPair].Process(ibuf, outBlock[0], blockLen);
-        ibuf = outBlock[0];
-    }
-
+    mCascade.Process(inBlock, outBlock, blockLen);
     return blockLen;
 }
 
@@ -12,6 +12,7 @@ Vaughan Johnson (Preview)
 #pragma once
 
 #include "Biquad.h"
+#include "BiquadCascade.h"
 #include "ShuttleAutomation.h"
 #include "StatefulPerTrackEffect.h"
 #include <cfloat> // for FLT_MAX
@@ -65,6 +66,7 @@ protected:
     int mOrder;
     int mOrderIndex;
     ArrayOf<Biquad> mpBiquad;
+    BiquadCascade mCascade;
 
     double mdBMax;
     double mdBMin;
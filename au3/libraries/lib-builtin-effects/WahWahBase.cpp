@@ -70,6 +70,11 @@ EffectType WahWahBase::GetType() const
     return EffectTypeProcess;
 }
 
+bool WahWahBase::ProcessesTracksIndependently() const
+{
+    return true;
+}
+
 auto WahWahBase::RealtimeSupport() const -> RealtimeSince
 {
     return RealtimeSince::After_3_1;
@@ -72,6 +72,7 @@ public:
     // EffectDefinitionInterface implementation
 
     EffectType GetType() const override;
+    bool ProcessesTracksIndependently() const override;
     RealtimeSince RealtimeSupport() const override;
 
     // Effect implementation
@@ -54,6 +54,22 @@ std::vector<std::string> ListAttachedDatabases()
 
     return attachedDBs;
 }
+
+//! Whether the sampleblocks table of the schema has the codec column of
+//! compressed blocks, which projects of older versions lack
+bool HasBlockCodecs(const sqlite::Connection& db, const std::string& schema)
+{
+    auto statement = db.CreateStatement(
+        "SELECT 1 FROM pragma_table_info('sampleblocks', ?) WHERE name = 'codec'");
+
+    if (!statement) {
+        return false;
+    }
+
+    const auto result = statement->Prepare(schema).Run();
+
+    return result.IsOk() && result.HasRows();
+}
 } // namespace
 
 RemoteProjectSnapshot::RemoteProjectSnapshot(
@@ -259,14 +275,33 @@ void RemoteProjectSnapshot::SetupBlocksCopy(
         return;
     }
 
+    // Compressed blocks must keep their codec, so the snapshot needs the
+    // column if the source has it
+    std::string columns
+        ="blockid, sampleformat, summin, summax, sumrms, summary256, summary64k, samples";
+    {
+        auto db = CloudProjectsDatabase::Get().GetConnection();
+
+        if (HasBlockCodecs(*db, dbName)) {
+            if (!HasBlockCodecs(*db, mSnapshotDBName)) {
+                // Failure is reported by the copy
+                db->Execute(
+                    "ALTER TABLE " + mSnapshotDBName
+                    + ".sampleblocks ADD COLUMN codec INTEGER");
+            }
+
+            columns += ", codec";
+        }
+    }
+
     mCopyBlocksFuture = std::async(
         std::launch::async,
-        [this, dbName = dbName, blocks = std::move(blocks)]()
+        [this, dbName = dbName, blocks = std::move(blocks), columns = std::move(columns)]()
     {
         const auto queryString
             ="INSERT INTO " + mSnapshotDBName
-              + ".sampleblocks "
-                "SELECT * FROM "
+              + ".sampleblocks (" + columns + ") "
+                "SELECT " + columns + " FROM "
               + dbName
               + ".sampleblocks WHERE blockid IN (SELECT block_id FROM block_hashes WHERE hash = ?)";
 
@@ -575,10 +610,12 @@ void RemoteProjectSnapshot::OnBlockDownloaded(
         return;
     }
 
+    // Downloaded samples are never compressed, unlike those they may replace
     auto blockStatement = db->CreateStatement(
         "INSERT INTO " + mSnapshotDBName
         + ".sampleblocks (blockid, sampleformat, summin, summax, sumrms, summary256, summary64k, samples) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8) "
-          "ON CONFLICT(blockid) DO UPDATE SET sampleformat = ?2, summin = ?3, summax = ?4, sumrms = ?5, summary256 = ?6, summary64k = ?7, samples = ?8");
+          "ON CONFLICT(blockid) DO UPDATE SET sampleformat = ?2, summin = ?3, summax = ?4, sumrms = ?5, summary256 = ?6, summary64k = ?7, samples = ?8"
+        + std::string(HasBlockCodecs(*db, mSnapshotDBName) ? ", codec = NULL" : ""));
 
     if (!blockStatement) {
         OnFailure(
@@ -0,0 +1,238 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: ThreadPool.cpp
+ */
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#include <climits>
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#include <pthread.h>
+#include <sched.h>
+#else
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#endif
+
+namespace audacity::concurrency {
+//! Posting wakes a waiting thread without any lock that a thread of lower
+//! priority might hold
+class ThreadPool::Semaphore final
+{
+public:
+#if defined(_WIN32)
+    Semaphore() : mHandle { CreateSemaphore(nullptr, 0, LONG_MAX, nullptr) } {}
+    ~Semaphore() { CloseHandle(mHandle); }
+    void Post() noexcept { ReleaseSemaphore(mHandle, 1, nullptr); }
+    void Wait() noexcept { WaitForSingleObject(mHandle, INFINITE); }
+
+private:
+    HANDLE mHandle;
+#elif defined(__APPLE__)
+    // Unnamed POSIX semaphores are not implemented on macOS
+    Semaphore() : mSemaphore { dispatch_semaphore_create(0) } {}
+    ~Semaphore() { dispatch_release(mSemaphore); }
+    void Post() noexcept { dispatch_semaphore_signal(mSemaphore); }
+    void Wait() noexcept
+    {
+        dispatch_semaphore_wait(mSemaphore, DISPATCH_TIME_FOREVER);
+    }
+
+private:
+    dispatch_semaphore_t mSemaphore;
+#else
+    Semaphore() { sem_init(&mSemaphore, 0, 0); }
+    ~Semaphore() { sem_destroy(&mSemaphore); }
+    void Post() noexcept { sem_post(&mSemaphore); }
+    void Wait() noexcept
+    {
+        while (sem_wait(&mSemaphore) != 0 && errno == EINTR) {
+        }
+    }
+
+private:
+    sem_t mSemaphore;
+#endif
+};
+
+namespace {
+//! @return whether the OS granted it
+bool RaisePriorityOfThisThread()
+{
+#if defined(_WIN32)
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    // Leave the highest priority to the callback of the audio device.
+    // Unprivileged processes may be refused, as usually on Linux.
+    sched_param param {};
+    param.sched_priority = std::max(sched_get_priority_min(SCHED_FIFO),
+                                    sched_get_priority_max(SCHED_FIFO) - 1);
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+}
+}
+
+ThreadPool::ThreadPool(size_t numWorkers, Priority priority)
+    : mConcurrency { numWorkers + 1 }
+    , mShares { std::make_unique<Share[]>(numWorkers + 1) }
+    , mWake { std::make_unique<Semaphore[]>(numWorkers) }
+{
+    mThreads.reserve(numWorkers);
+    for (size_t participant = 1; participant <= numWorkers; ++participant) {
+        mThreads.emplace_back([this, participant, priority] {
+            WorkerLoop(participant, priority);
+        });
+    }
+
+    // Wait for the workers to learn their priorities
+    std::unique_lock<std::mutex> lock { mMutex };
+    mStarted.wait(lock, [this] { return mStartedWorkers == mThreads.size(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    mStop.store(true, std::memory_order_release);
+    for (size_t worker = 0; worker < mThreads.size(); ++worker) {
+        mWake[worker].Post();
+    }
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::DefaultNumWorkers()
+{
+    const size_t hardware = std::thread::hardware_concurrency();
+    return hardware > 1 ? hardware - 1 : 0;
+}
+
+size_t ThreadPool::GetConcurrency() const noexcept
+{
+    return mConcurrency;
+}
+
+bool ThreadPool::HasPriority() const noexcept
+{
+    // Not changed after construction
+    return mHasPriority;
+}
+
+void ThreadPool::Run(size_t count, Task task, const void* context,
+                     Clock::time_point deadline)
+{
+    if (count == 0) {
+        return;
+    }
+
+    if (mThreads.empty() || count == 1) {
+        for (size_t index = 0; index < count; ++index) {
+            task(context, index, 0);
+        }
+        return;
+    }
+
+    // Deal out contiguous shares; opening mRun publishes them to workers
+    for (size_t participant = 0; participant < mConcurrency; ++participant) {
+        auto& share = mShares[participant];
+        share.next.store(count * participant / mConcurrency,
+                         std::memory_order_relaxed);
+        share.end = count * (participant + 1) / mConcurrency;
+    }
+    mTask = task;
+    mContext = context;
+    mDeadline = deadline;
+    mFailed.store(false, std::memory_order_relaxed);
+    mException = nullptr;
+
+    mRun.store(Open, std::memory_order_release);
+    for (size_t worker = 0; worker < mThreads.size(); ++worker) {
+        mWake[worker].Post();
+    }
+
+    Participate(0);
+
+    // Every item is claimed now.  Workers that did not yet join may no longer;
+    // wait for those that did to finish their last items.
+    auto run = mRun.fetch_and(ActiveMask, std::memory_order_acquire);
+    while ((run & ActiveMask) != 0) {
+        std::this_thread::yield();
+        run = mRun.load(std::memory_order_acquire);
+    }
+
+    if (mFailed.load(std::memory_order_relaxed)) {
+        std::rethrow_exception(std::exchange(mException, nullptr));
+    }
+}
+
+void ThreadPool::Participate(size_t participant) noexcept
+{
+    const bool hasDeadline
+        =participant != 0 && mDeadline != Clock::time_point::max();
+    // Own share first, then steal from the others in round robin order
+    for (size_t offset = 0; offset < mConcurrency; ++offset) {
+        auto& share = mShares[(participant + offset) % mConcurrency];
+        while (true) {
+            if (hasDeadline && Clock::now() >= mDeadline) {
+                return;
+            }
+            const auto index = share.next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= share.end) {
+                break;
+            }
+            try {
+                mTask(mContext, index, participant);
+            }
+            catch (...) {
+                if (!mFailed.exchange(true, std::memory_order_relaxed)) {
+                    mException = std::current_exception();
+                }
+            }
+        }
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t participant, Priority priority)
+{
+    const bool hasPriority
+        =priority == Priority::Normal || RaisePriorityOfThisThread();
+    {
+        std::lock_guard<std::mutex> lock { mMutex };
+        mHasPriority = mHasPriority && hasPriority;
+        ++mStartedWorkers;
+    }
+    mStarted.notify_all();
+
+    auto& wake = mWake[participant - 1];
+    while (true) {
+        wake.Wait();
+        if (mStop.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        // Join unless the caller already closed the run; the posts of a
+        // run may be consumed during the next one, which is as good
+        auto run = mRun.load(std::memory_order_relaxed);
+        bool joined = false;
+        while ((run & Open) != 0 && !joined) {
+            joined = mRun.compare_exchange_weak(run, run + 1,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed);
+        }
+        if (!joined) {
+            continue;
+        }
+
+        Participate(participant);
+
+        mRun.fetch_sub(1, std::memory_order_release);
+    }
+}
+} // namespace audacity::concurrency
@@ -0,0 +1,130 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: ThreadPool.h
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace audacity::concurrency {
+//! A fixed set of threads that cooperate with the calling thread on ranges of
+//! independent work items
+/*!
+ Each participant starts on its own contiguous share of the range and, once
+ that is exhausted, steals the remaining items of the other shares, so that a
+ few expensive items do not leave the other threads idle.
+
+ ParallelFor neither allocates, locks, nor returns before every item was
+ processed, so it can be used from the audio worker thread: the workers are
+ woken by semaphores, and the caller spins until the last of them leaves.  The
+ threads persist for the lifetime of the pool.
+ */
+class CONCURRENCY_API ThreadPool final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Priority {
+        Normal,
+        //! For a caller that must not wait on threads of lower priority, as
+        //! in audio processing; the OS may refuse it, see HasPriority()
+        Realtime,
+    };
+
+    //! @param numWorkers threads in addition to the caller of ParallelFor;
+    //! with 0, ParallelFor runs everything on the calling thread
+    explicit ThreadPool(size_t numWorkers, Priority priority = Priority::Normal);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //! One less than the hardware concurrency, because the caller takes part
+    static size_t DefaultNumWorkers();
+
+    //! Number of participants in ParallelFor, including the calling thread
+    size_t GetConcurrency() const noexcept;
+
+    //! Whether every worker thread got the priority given to the constructor
+    bool HasPriority() const noexcept;
+
+    //! Call `fn(index, participant)` for each index in [0, count)
+    /*!
+     `participant` is in [0, GetConcurrency()), 0 being the calling thread.
+     Concurrent calls of `fn` never share a participant number, so it may
+     select per-participant scratch storage.
+
+     If `fn` throws, the remaining items are still processed, and the first
+     exception is rethrown once all participants have finished.
+
+     @param deadline after it, workers start no more items and leave the rest
+     to the calling thread; so that workers which wake late, as threads
+     without realtime priority may, can't make the caller wait much longer
+     than rendering serially would
+
+     @pre no other ParallelFor is in progress on this pool
+     */
+    template<typename Fn> void ParallelFor(size_t count, const Fn& fn,
+                                           Clock::time_point deadline = Clock::time_point::max())
+    {
+        Run(count, [](const void* context, size_t index, size_t participant) {
+            (*static_cast<const Fn*>(context))(index, participant);
+        }, &fn, deadline);
+    }
+
+private:
+    using Task = void (*)(const void* context, size_t index, size_t participant);
+
+    // Padded so that participants claiming items don't contend on cache lines
+    struct alignas(64) Share final
+    {
+        std::atomic<size_t> next { 0 };
+        size_t end { 0 };
+    };
+
+    class Semaphore;
+
+    void Run(size_t count, Task task, const void* context,
+             Clock::time_point deadline);
+    void Participate(size_t participant) noexcept;
+    void WorkerLoop(size_t participant, Priority priority);
+
+    // Bits of mRun: workers may join the current ParallelFor while it is open,
+    // and the count of those that did is below
+    static constexpr uint64_t Open = uint64_t { 1 } << 32;
+    static constexpr uint64_t ActiveMask = Open - 1;
+
+    const size_t mConcurrency;
+    std::unique_ptr<Share[]> mShares;
+    //! One for each worker, posted once by each ParallelFor
+    std::unique_ptr<Semaphore[]> mWake;
+    std::vector<std::thread> mThreads;
+
+    // Only for the construction
+    std::mutex mMutex;
+    std::condition_variable mStarted;
+    size_t mStartedWorkers { 0 };
+    bool mHasPriority { true };
+
+    std::atomic<uint64_t> mRun { 0 };
+    std::atomic<bool> mStop { false };
+
+    // Written by the caller of ParallelFor while no worker is active
+    Task mTask { nullptr };
+    const void* mContext { nullptr };
+    Clock::time_point mDeadline;
+    //! Set by the first participant that catches an exception
+    std::atomic<bool> mFailed { false };
+    std::exception_ptr mException;
+};
+} // namespace audacity::concurrency
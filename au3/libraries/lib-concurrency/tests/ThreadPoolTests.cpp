@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileName: ThreadPoolTests.cpp
+ */
+
+#include "concurrency/ThreadPool.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+using namespace audacity::concurrency;
+
+TEST_CASE("ThreadPool visits every index exactly once")
+{
+    for (size_t numWorkers : { 0, 1, 3, 7 }) {
+        ThreadPool pool { numWorkers };
+        REQUIRE(pool.GetConcurrency() == numWorkers + 1);
+        for (size_t count : { 0, 1, 2, 5, 100, 1000 }) {
+            std::vector<std::atomic<int> > visits(count);
+            std::vector<std::atomic<int> > busy(pool.GetConcurrency());
+            std::atomic<bool> overlapped { false };
+            pool.ParallelFor(count, [&](size_t index, size_t participant) {
+                if (busy[participant]++ != 0) {
+                    overlapped = true;
+                }
+                ++visits[index];
+                --busy[participant];
+            });
+            REQUIRE(!overlapped);
+            for (auto& visit : visits) {
+                REQUIRE(visit == 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("ThreadPool rethrows after finishing all items")
+{
+    ThreadPool pool { 3 };
+    std::atomic<size_t> visited { 0 };
+    REQUIRE_THROWS_AS(
+        pool.ParallelFor(64, [&](size_t index, size_t) {
+        ++visited;
+        if (index == 10) {
+            throw std::runtime_error { "failure" };
+        }
+    }),
+        std::runtime_error);
+    REQUIRE(visited == 64);
+
+    // The pool remains usable
+    visited = 0;
+    pool.ParallelFor(64, [&](size_t, size_t) { ++visited; });
+    REQUIRE(visited == 64);
+}
+
+TEST_CASE("ThreadPool leaves the items to the caller after the deadline")
+{
+    ThreadPool pool { 3 };
+    std::vector<size_t> participants(64, 1);
+    pool.ParallelFor(participants.size(), [&](size_t index, size_t participant) {
+        participants[index] = participant;
+    }, ThreadPool::Clock::now());
+    for (auto participant : participants) {
+        REQUIRE(participant == 0);
+    }
+}
+
+TEST_CASE("ThreadPool runs many times in a row")
+{
+    // Workers may be woken for one run while the next is already open
+    ThreadPool pool { 3 };
+    std::atomic<size_t> visited { 0 };
+    for (size_t run = 0; run < 10000; ++run) {
+        pool.ParallelFor(run % 5, [&](size_t, size_t) { ++visited; });
+    }
+    REQUIRE(visited == 10000 / 5 * (0 + 1 + 2 + 3 + 4));
+}
+
+namespace {
+//! Stand-in for a track's mixer and realtime effects: deterministic, CPU-bound
+void RenderTrack(std::vector<float>& buffer, size_t track, size_t block)
+{
+    auto phase = 0.001 * (track + 1) * (block + 1);
+    for (auto& sample : buffer) {
+        for (int effect = 0; effect < 8; ++effect) {
+            phase = std::sin(phase + 0.01 * effect);
+        }
+        sample = static_cast<float>(phase);
+    }
+}
+
+size_t CountUnderruns(ThreadPool& pool, size_t numTracks)
+{
+    using namespace std::chrono;
+    constexpr auto rate = 44100.0;
+    constexpr size_t blockSize = 1024;
+    constexpr size_t numBlocks = 100;
+    const auto deadline = duration<double> { blockSize / rate };
+
+    std::vector<std::vector<float> > buffers(
+        numTracks, std::vector<float>(blockSize));
+    std::vector<float> master(blockSize);
+    size_t underruns = 0;
+    for (size_t block = 0; block < numBlocks; ++block) {
+        const auto start = steady_clock::now();
+        pool.ParallelFor(numTracks, [&](size_t track, size_t) {
+            RenderTrack(buffers[track], track, block);
+        });
+        // Master stage, after the join, in a fixed order
+        std::fill(master.begin(), master.end(), 0.0f);
+        for (const auto& buffer : buffers) {
+            std::transform(buffer.begin(), buffer.end(), master.begin(),
+                           master.begin(), std::plus<float>());
+        }
+        if (steady_clock::now() - start > deadline) {
+            ++underruns;
+        }
+    }
+    return underruns;
+}
+} // namespace
+
+TEST_CASE("ThreadPool playback stress", "[stress][.]")
+{
+    for (size_t numTracks : { 8, 16, 32, 64, 128 }) {
+        ThreadPool serial { 0 };
+        ThreadPool parallel { ThreadPool::DefaultNumWorkers() };
+        std::cout << numTracks << " tracks: "
+                  << CountUnderruns(serial, numTracks) << " underruns serially, "
+                  << CountUnderruns(parallel, numTracks) << " with "
+                  << parallel.GetConcurrency() << " threads\n";
+    }
+}
+
+TEST_CASE("ThreadPool of realtime priority works whether or not granted")
+{
+    REQUIRE(ThreadPool { 3 }.HasPriority());
+
+    ThreadPool pool { 3, ThreadPool::Priority::Realtime };
+    std::atomic<size_t> visited { 0 };
+    pool.ParallelFor(64, [&](size_t, size_t) { ++visited; });
+    REQUIRE(visited == 64);
+}
@@ -27,6 +27,12 @@
 #include "WaveTrack.h"
 #include "WaveTrackSink.h"
 #include "WideSampleSource.h"
+#include "concurrency/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
 
 PerTrackEffect::Instance::~Instance() = default;
 
@@ -48,6 +54,11 @@ bool PerTrackEffect::Instance::ProcessFinalize() noexcept
 
 PerTrackEffect::~PerTrackEffect() = default;
 
+bool PerTrackEffect::ProcessesTracksIndependently() const
+{
+    return false;
+}
+
 bool PerTrackEffect::Process(
     EffectInstance& instance, EffectSettings& settings) const
 {
@@ -94,6 +105,16 @@ bool PerTrackEffect::DoProcess(TrackList& outputs,
         return false;
     }
 
+    if (isProcessor && ProcessesTracksIndependently()) {
+        std::vector<WaveTrack*> tracks;
+        for (const auto pTrack : outputs.Selected<WaveTrack>()) {
+            tracks.push_back(pTrack);
+        }
+        if (tracks.size() > 1) {
+            return DoProcessConcurrently(tracks, numAudioIn, numAudioOut, settings);
+        }
+    }
+
     // Instances that can be reused in each loop pass
     std::vector<std::shared_ptr<EffectInstance> > recycledInstances{
         // First one is the given one; any others pushed onto here are
@@ -344,6 +365,159 @@ bool PerTrackEffect::DoProcess(TrackList& outputs,
     return bGoodResult;
 }
 
+bool PerTrackEffect::DoProcessConcurrently(
+    const std::vector<WaveTrack*>& tracks, unsigned numAudioIn,
+    unsigned numAudioOut, const EffectSettings& settings)
+{
+    using namespace audacity::concurrency;
+    const bool multichannel = numAudioIn > 1;
+
+    // Find all bounds first, so that the total work is known for progress
+    struct Job {
+        WaveTrack* pTrack;
+        sampleCount start;
+        sampleCount len;
+    };
+    std::vector<Job> jobs;
+    double total = 0;
+    for (const auto pTrack : tracks) {
+        sampleCount start = 0;
+        sampleCount len = 0;
+        GetBounds(*pTrack, &start, &len);
+        if (len > 0 && numAudioIn < 1) {
+            return false;
+        }
+        jobs.push_back({ pTrack, start, len });
+        total += len.as_double() * (multichannel ? 1 : pTrack->NChannels());
+    }
+
+    // Samples consumed by all workers, and whether they should give up
+    std::atomic<long long> done{ 0 };
+    std::atomic<bool> stop{ false };
+
+    // Like the visitor in DoProcess, for processors only, and with nothing
+    // shared with other tracks but the read-only arguments
+    const auto processTrack = [&](const Job& job) {
+        auto& wt = *job.pTrack;
+        const auto pInstance
+            =std::dynamic_pointer_cast<EffectInstanceEx>(MakeInstance());
+        if (!pInstance) {
+            return false;
+        }
+        std::vector<std::shared_ptr<EffectInstance> > recycledInstances{
+            pInstance
+        };
+        auto mySettings = settings;
+
+        const auto max = wt.GetMaxBlockSize() * 2;
+        const auto blockSize = pInstance->SetBlockSize(max);
+        if (blockSize == 0) {
+            return false;
+        }
+        const auto bufferSize
+            =((max + (blockSize - 1)) / blockSize) * blockSize;
+        if (bufferSize == 0) {
+            return false;
+        }
+        Buffers inBuffers{ std::max(1u, numAudioIn), blockSize,
+                           std::max<size_t>(1, bufferSize / blockSize) };
+        Buffers outBuffers{ numAudioOut, blockSize,
+                            (bufferSize / blockSize) + 1 };
+        for (size_t i = 2; i < numAudioIn; i++) {
+            inBuffers.ClearBuffer(i, bufferSize);
+        }
+
+        ChannelName map[3];
+        int iChannel = 0;
+        for (const auto pChannel : wt.Channels()) {
+            const int channel = (multichannel ? -1 : iChannel++);
+            const auto numChannels
+                =MakeChannelMap(wt.NChannels(), channel, map);
+            WaveChannel* pRight{};
+            if (multichannel && numChannels == 2) {
+                // TODO: more-than-two-channels
+                pRight = (*wt.Channels().rbegin()).get();
+            }
+
+            inBuffers.Rewind();
+            if (!pRight && numAudioIn > 1) {
+                inBuffers.ClearBuffer(1, bufferSize);
+            }
+
+            const auto pollUser = [&done, &stop, last = job.start](
+                sampleCount inPos) mutable {
+                done += (inPos - last).as_long_long();
+                last = inPos;
+                return !stop;
+            };
+            WideSampleSequence* pSeq = pChannel.get();
+            if (pRight) {
+                pSeq = &wt;
+            }
+            WideSampleSource source{
+                *pSeq, size_t(pRight ? 2 : 1), job.start, job.len, pollUser };
+            WaveTrackSink sink{ *pChannel, pRight, nullptr, job.start, true,
+                                pInstance->NeedsDither() ? widestSampleFormat : narrowestSampleFormat
+            };
+            const auto factory
+                =[this, &recycledInstances, counter = 0]() mutable {
+                auto index = counter++;
+                if (index < recycledInstances.size()) {
+                    return recycledInstances[index];
+                } else {
+                    return recycledInstances.emplace_back(MakeInstance());
+                }
+            };
+            if (!ProcessTrack(channel, factory, mySettings, source, sink,
+                              {}, wt.GetRate(), wt, inBuffers, outBuffers)) {
+                return false;
+            }
+            sink.Flush(outBuffers);
+            if (!sink.IsOk()) {
+                return false;
+            }
+            if (multichannel) {
+                break;
+            }
+        }
+        return true;
+    };
+
+    // The calling thread only reports progress, because that may involve
+    // the user interface; a helper thread takes its place in the pool
+    ThreadPool pool{ std::min(ThreadPool::DefaultNumWorkers(), jobs.size() - 1) };
+    std::vector<char> results(jobs.size(), 0);
+    auto finished = std::async(std::launch::async, [&]{
+        pool.ParallelFor(jobs.size(), [&](size_t index, size_t) {
+            if (stop) {
+                return;
+            }
+            try {
+                results[index] = processTrack(jobs[index]);
+            }
+            catch (...) {
+                stop = true;
+                throw;
+            }
+            if (!results[index]) {
+                stop = true;
+            }
+        });
+    });
+    using namespace std::chrono_literals;
+    while (finished.wait_for(50ms) != std::future_status::ready) {
+        if (!stop && total > 0 && TotalProgress(done / total)) {
+            stop = true;
+        }
+    }
+    // Rethrows any exception from the workers
+    finished.get();
+
+    return !stop
+           && std::all_of(results.begin(), results.end(),
+                          [](char result) { return result != 0; });
+}
+
 bool PerTrackEffect::ProcessTrack(int channel, const Factory& factory,
                                   EffectSettings& settings,
                                   AudioGraph::Source& upstream, AudioGraph::Sink& sink,
@@ -21,6 +21,7 @@
 #include "SampleCount.h"
 #include <functional>
 #include <memory>
+#include <vector>
 
 class EffectOutputTracks;
 class SampleTrack;
@@ -57,6 +58,15 @@ public:
         const PerTrackEffect& mProcessor;
     };
 
+    //! Whether instances made by MakeInstance() may process different tracks
+    //! at the same time
+    /*!
+     Default implementation returns false.  Override to return true only if
+     instances share no mutable state with the effect or with each other, and
+     do not depend on mSampleCnt.  Consulted only for EffectTypeProcess.
+     */
+    virtual bool ProcessesTracksIndependently() const;
+
 protected:
     // non-virtual
     bool Process(EffectInstance& instance, EffectSettings& settings) const;
@@ -73,6 +83,10 @@ private:
     using Buffers = AudioGraph::Buffers;
 
     bool DoProcess(TrackList& outputs, Instance& instance, EffectSettings& settings);
+    //! Process each of several tracks with its own instance, on worker
+    //! threads, while this thread reports their combined progress
+    bool DoProcessConcurrently(const std::vector<WaveTrack*>& tracks, unsigned numAudioIn, unsigned numAudioOut,
+                               const EffectSettings& settings);
     using Factory = std::function<std::shared_ptr<EffectInstance>()>;
     /*!
      Previous contents of inBuffers and outBuffers are ignored
@@ -0,0 +1,317 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file PartitionedConvolver.cpp
+
+**********************************************************************/
+#include "PartitionedConvolver.h"
+
+#include "RealFFTf.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+size_t NextPowerOfTwo(size_t n)
+{
+    size_t result = 1;
+    while (result < n) {
+        result *= 2;
+    }
+    return result;
+}
+
+//! Reorder the result of RealFFTf to the order InverseRealFFTf expects:
+//! DC and Fs/2 first, then real and imaginary parts of each bin
+void ToNaturalOrder(const FFTParam& fft, const float* buffer, float* spectrum)
+{
+    spectrum[0] = buffer[0];
+    spectrum[1] = buffer[1];
+    for (size_t ii = 1; ii < fft.Points; ++ii) {
+        const auto kk = fft.BitReversed[ii];
+        spectrum[2 * ii] = buffer[kk];
+        spectrum[2 * ii + 1] = buffer[kk + 1];
+    }
+}
+
+//! Add the product of two spectra in natural order to a third
+void MultiplyAdd(
+    const float* x, const float* h, float* y, size_t points)
+{
+    // DC and Fs/2 are real
+    y[0] += x[0] * h[0];
+    y[1] += x[1] * h[1];
+    for (size_t ii = 2; ii < 2 * points; ii += 2) {
+        const auto xr = x[ii], xi = x[ii + 1];
+        const auto hr = h[ii], hi = h[ii + 1];
+        y[ii] += xr * hr - xi * hi;
+        y[ii + 1] += xr * hi + xi * hr;
+    }
+}
+}
+
+//! Overlap-save convolution with a run of equal partitions of the response
+struct PartitionedConvolver::Stage
+{
+    Stage(size_t offset, size_t length, size_t hop, size_t partitionLength,
+          size_t nPartitions, size_t fftSize)
+        : offset{offset}, length{length}, hop{hop}
+        , partitionLength{partitionLength}, nPartitions{nPartitions}
+        , fftSize{fftSize}
+        , hFFT{GetFFT(fftSize)}
+        , input(fftSize)
+        , output(hop)
+        , history(nPartitions * fftSize)
+        , filter(nPartitions * fftSize)
+        , pending(nPartitions * fftSize)
+        , buffer(fftSize)
+        , pendingBuffer(fftSize)
+    {
+        // Valid output needs the partition and the hop to fit in the FFT;
+        // and delayed spectra line up with partitions only if they are equal
+        assert(partitionLength + hop - 1 <= fftSize);
+        assert(nPartitions == 1 || partitionLength == hop);
+    }
+
+    //! Transform the part of the response for this stage into `spectra`
+    void SetImpulseResponse(
+        const float* impulse, size_t impulseLength, std::vector<float>& spectra)
+    {
+        for (size_t iPartition = 0; iPartition < nPartitions; ++iPartition) {
+            const auto begin = std::min(
+                impulseLength, offset + iPartition * partitionLength);
+            const auto end = std::min(
+                { impulseLength, offset + length,
+                  offset + (iPartition + 1) * partitionLength });
+            std::fill(buffer.begin(), buffer.end(), 0.0f);
+            std::copy(impulse + begin, impulse + end, buffer.begin());
+            RealFFTf(buffer.data(), hFFT.get());
+            ToNaturalOrder(*hFFT, buffer.data(),
+                           spectra.data() + iPartition * fftSize);
+        }
+    }
+
+    void Reset()
+    {
+        std::fill(input.begin(), input.end(), 0.0f);
+        std::fill(output.begin(), output.end(), 0.0f);
+        std::fill(history.begin(), history.end(), 0.0f);
+        position = 0;
+        primed = false;
+        if (hasPending) {
+            filter.swap(pending);
+            hasPending = false;
+        }
+    }
+
+    //! Add output to `out` while taking input
+    void Process(const float* in, float* out, size_t len)
+    {
+        while (len > 0) {
+            const auto count = std::min(len, hop - position);
+            std::copy(in, in + count,
+                      input.begin() + (fftSize - hop + position));
+            const auto pOutput = output.data() + position;
+            for (size_t ii = 0; ii < count; ++ii) {
+                out[ii] += pOutput[ii];
+            }
+            in += count;
+            out += count;
+            len -= count;
+            position += count;
+            if (position == hop) {
+                ComputeBlock();
+                position = 0;
+            }
+        }
+    }
+
+    //! Sum products of delayed input spectra with the partitions, into
+    //! `result`, and invert that
+    void Convolve(
+        const std::vector<float>& partitions, std::vector<float>& result)
+    {
+        std::fill(result.begin(), result.end(), 0.0f);
+        for (size_t iPartition = 0; iPartition < nPartitions; ++iPartition) {
+            const auto iSpectrum = (newest + nPartitions - iPartition) % nPartitions;
+            MultiplyAdd(history.data() + iSpectrum * fftSize,
+                        partitions.data() + iPartition * fftSize,
+                        result.data(), hFFT->Points);
+        }
+        InverseRealFFTf(result.data(), hFFT.get());
+    }
+
+    //! Sample `ii` of the time domain result of InverseRealFFTf
+    float TimeSample(const std::vector<float>& result, size_t ii) const
+    {
+        return result[hFFT->BitReversed[ii / 2] + (ii % 2)];
+    }
+
+    void ComputeBlock()
+    {
+        // Transform the newest frame into the frequency domain delay line
+        newest = (newest + 1) % nPartitions;
+        std::copy(input.begin(), input.end(), buffer.begin());
+        RealFFTf(buffer.data(), hFFT.get());
+        ToNaturalOrder(*hFFT, buffer.data(), history.data() + newest * fftSize);
+
+        // Only the last hop samples of the circular convolution are free of
+        // wrap-around
+        const auto first = fftSize - hop;
+        Convolve(filter, buffer);
+        if (hasPending) {
+            Convolve(pending, pendingBuffer);
+            // Raised cosine fade from old to new coefficients
+            for (size_t ii = 0; ii < hop; ++ii) {
+                const auto fade
+                    =0.5f - 0.5f * std::cos(M_PI * (ii + 0.5) / hop);
+                output[ii] = TimeSample(buffer, first + ii) * (1.0f - fade)
+                             + TimeSample(pendingBuffer, first + ii) * fade;
+            }
+            filter.swap(pending);
+            hasPending = false;
+        } else {
+            for (size_t ii = 0; ii < hop; ++ii) {
+                output[ii] = TimeSample(buffer, first + ii);
+            }
+        }
+        primed = true;
+
+        // Keep the input that the next frame overlaps
+        std::copy(input.begin() + hop, input.end(), input.begin());
+    }
+
+    //! First tap of the response computed by this stage
+    const size_t offset;
+    //! Number of taps computed by this stage, at most
+    const size_t length;
+    //! Samples taken between computations, and the latency of this stage
+    const size_t hop;
+    const size_t partitionLength;
+    const size_t nPartitions;
+    const size_t fftSize;
+    const HFFT hFFT;
+
+    //! The last fftSize samples of input; new ones go after fftSize - hop
+    std::vector<float> input;
+    //! Results of the last computation, given out while input accumulates
+    std::vector<float> output;
+    //! Spectra of the last nPartitions frames, in a ring
+    std::vector<float> history;
+    //! Spectra of the partitions, in natural order
+    std::vector<float> filter;
+    //! Spectra of partitions to crossfade to at the next computation
+    std::vector<float> pending;
+    std::vector<float> buffer;
+    std::vector<float> pendingBuffer;
+    size_t newest{ 0 };
+    size_t position{ 0 };
+    bool hasPending{ false };
+    //! Whether output was computed since construction or Reset
+    bool primed{ false };
+};
+
+PartitionedConvolver::PartitionedConvolver(size_t maxLength, size_t maxLatency)
+{
+    assert(maxLength > 0);
+    if (maxLatency == 0) {
+        // One partition; choose the FFT size that does least work per sample
+        // of output, estimated as fftSize * log2(fftSize) / hop
+        size_t bestSize = 0;
+        double bestCost = 0;
+        for (auto fftSize = NextPowerOfTwo(2 * maxLength);
+             fftSize <= std::max<size_t>(32768, 2 * NextPowerOfTwo(maxLength));
+             fftSize *= 2) {
+            const auto hop = fftSize - maxLength + 1;
+            const auto cost = fftSize * std::log2(fftSize) / hop;
+            if (bestSize == 0 || cost < bestCost) {
+                bestSize = fftSize;
+                bestCost = cost;
+            }
+        }
+        mStages.push_back(std::make_unique<Stage>(
+                              0, maxLength, bestSize - maxLength + 1, maxLength, 1, bestSize));
+    } else {
+        size_t block = MinBlockSize;
+        while (block * 2 <= std::min(maxLatency, MaxBlockSize)) {
+            block *= 2;
+        }
+        const auto latency = block;
+        // Partitions of the shortest blocks, before later groups can take
+        // over
+        constexpr size_t GroupSize = 3;
+        size_t offset = 0;
+        while (offset < maxLength) {
+            // A group with blocks of n samples delivers results n samples
+            // late, which is on time for the taps starting n - latency later
+            // than those of the first group
+            const auto nextBlock = 4 * block;
+            auto end = nextBlock - latency;
+            if (end >= maxLength || block >= MaxBlockSize
+                || (offset == 0 && maxLength <= (GroupSize + 1) * block)) {
+                // The last group, taking all remaining taps
+                end = maxLength;
+            }
+            const auto nPartitions = (end - offset + block - 1) / block;
+            mStages.push_back(std::make_unique<Stage>(
+                                  offset, end - offset, block, block, nPartitions, 2 * block));
+            assert(offset + latency == block || offset == 0);
+            offset = end;
+            block = nextBlock;
+        }
+    }
+
+    size_t maxHop = 0;
+    for (const auto& pStage : mStages) {
+        maxHop = std::max(maxHop, pStage->hop);
+    }
+    mInput.resize(std::min<size_t>(maxHop, 4096));
+}
+
+PartitionedConvolver::~PartitionedConvolver() = default;
+
+size_t PartitionedConvolver::Latency() const
+{
+    return mStages.front()->hop;
+}
+
+void PartitionedConvolver::SetImpulseResponse(
+    const float* impulse, size_t length)
+{
+    assert(length <= mStages.back()->offset + mStages.back()->length);
+    for (const auto& pStage : mStages) {
+        auto& stage = *pStage;
+        if (stage.primed) {
+            stage.SetImpulseResponse(impulse, length, stage.pending);
+            stage.hasPending = true;
+        } else {
+            stage.SetImpulseResponse(impulse, length, stage.filter);
+            stage.hasPending = false;
+        }
+    }
+}
+
+void PartitionedConvolver::Reset()
+{
+    for (const auto& pStage : mStages) {
+        pStage->Reset();
+    }
+}
+
+void PartitionedConvolver::Process(const float* in, float* out, size_t len)
+{
+    while (len > 0) {
+        const auto count = std::min(len, mInput.size());
+        std::copy(in, in + count, mInput.begin());
+        std::fill(out, out + count, 0.0f);
+        for (const auto& pStage : mStages) {
+            pStage->Process(mInput.data(), out, count);
+        }
+        in += count;
+        out += count;
+        len -= count;
+    }
+}
@@ -0,0 +1,82 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file PartitionedConvolver.h
+  @brief Convolution of a stream with a finite impulse response, by FFT of
+  partitions of the response
+
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+//! Convolves a stream of samples with a finite impulse response, by
+//! overlap-save of partitions of the response
+/*!
+ The block sizes are chosen from the longest response and the latency that
+ can be tolerated.
+
+ With no latency requirement, the whole response is one partition, and the
+ FFT size is the one that costs least per sample for that length.
+
+ Otherwise the leading taps are split into partitions no longer than the
+ latency, and the following taps into groups of partitions each four times
+ as long as those of the group before.  Each group starts exactly as late
+ as its longer blocks allow, so that its results are due when they are
+ needed.  Work per sample then grows with the logarithm of the length of the
+ response, not in proportion to it.
+
+ A change of the response crossfades each group from old to new coefficients
+ over one of its blocks, so that updates during playback don't click.
+ */
+class FFT_API PartitionedConvolver final
+{
+public:
+    //! Shortest block, and so the least latency, when latency is limited
+    static constexpr size_t MinBlockSize = 32;
+    //! Blocks of groups grow no longer than this
+    static constexpr size_t MaxBlockSize = 8192;
+
+    /*!
+     @param maxLength the longest impulse response that will be given
+     @param maxLatency delay of output that can be tolerated, in samples; 0
+     if any delay will do
+     @pre `maxLength > 0`
+     */
+    explicit PartitionedConvolver(size_t maxLength, size_t maxLatency = 0);
+    ~PartitionedConvolver();
+
+    //! Output lags input by this many samples
+    /*! At most maxLatency given to the constructor, unless that is less than
+     MinBlockSize */
+    size_t Latency() const;
+
+    //! Replace the impulse response; until the first call, output is silent
+    /*!
+     If input was processed since construction or Reset(), the change
+     crossfades as each group of partitions next computes its output.
+     Allocates nothing; may be called between calls to Process() on the same
+     thread.
+     @pre `length <= maxLength` given to the constructor
+     */
+    void SetImpulseResponse(const float* impulse, size_t length);
+
+    //! Forget past input, keeping the impulse response
+    void Reset();
+
+    //! Write the convolution of input with the impulse response, delayed by
+    //! Latency()
+    /*! Allocates nothing.  `out` may be the same as `in` */
+    void Process(const float* in, float* out, size_t len);
+
+private:
+    struct Stage;
+
+    std::vector<std::unique_ptr<Stage> > mStages;
+    //! Holds input while stages add into output that may overwrite it
+    std::vector<float> mInput;
+};
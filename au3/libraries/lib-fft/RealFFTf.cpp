@@ -38,22 +38,135 @@
 
 #include "RealFFTf.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include <stdlib.h>
 #include <math.h>
 
 #include <wx/thread.h>
 
+#include "pffft.h"
+
 #ifndef M_PI
 #define     M_PI        3.14159265358979323846  /* pi */
 #endif
 
+void PffftSetupDeleter::operator()(PFFFT_Setup* p) const
+{
+    pffft_destroy_setup(p);
+}
+
+namespace {
+std::atomic<FFTBackend> defaultBackend{ FFTBackend::Pffft };
+
+bool PffftSupports(size_t fftlen)
+{
+    // pffft requires real transforms to be a multiple of 2 * SIMD_SZ^2
+    const size_t simdSize = pffft_simd_size();
+    const size_t quantum = 2 * simdSize * simdSize;
+    return fftlen >= quantum && fftlen % quantum == 0
+           && fftlen <= size_t(std::numeric_limits<int>::max());
+}
+
+FFTBackend EffectiveBackend(size_t fftlen, FFTBackend backend)
+{
+    return backend == FFTBackend::Pffft && PffftSupports(fftlen)
+           ? FFTBackend::Pffft : FFTBackend::Scalar;
+}
+
+HFFT InitializePffft(size_t fftlen)
+{
+    HFFT h{ safenew FFTParam };
+    h->Points = fftlen / 2;
+    h->Backend = FFTBackend::Pffft;
+    h->PffftSetup.reset(pffft_new_setup(static_cast<int>(fftlen), PFFFT_REAL));
+    if (!h->PffftSetup) {
+        return nullptr;
+    }
+
+    // pffft produces ordered output, interleaving (real, imaginary) pairs, and
+    // with the Fs/2 bin in place of the imaginary part of the DC bin -- that is
+    // the same layout as the scalar code, except for the bit reversal.
+    h->BitReversed.reinit(h->Points);
+    for (size_t i = 0; i < h->Points; i++) {
+        h->BitReversed[i] = static_cast<int>(2 * i);
+    }
+
+    return h;
+}
+
+//! Per-thread scratch for pffft, so that shared FFTParam stays read-only
+class PffftScratch
+{
+public:
+    ~PffftScratch()
+    {
+        pffft_aligned_free(mWork);
+        pffft_aligned_free(mUnaligned);
+    }
+
+    fft_type* Work(size_t size) { return Reserve(mWork, mWorkSize, size); }
+
+    fft_type* Unaligned(size_t size)
+    {
+        return Reserve(mUnaligned, mUnalignedSize, size);
+    }
+
+private:
+    static fft_type* Reserve(fft_type*& buffer, size_t& capacity, size_t size)
+    {
+        if (capacity < size) {
+            pffft_aligned_free(buffer);
+            buffer = static_cast<fft_type*>(
+                pffft_aligned_malloc(size * sizeof(fft_type)));
+            capacity = buffer ? size : 0;
+        }
+        return buffer;
+    }
+
+    fft_type* mWork = nullptr;
+    size_t mWorkSize = 0;
+    fft_type* mUnaligned = nullptr;
+    size_t mUnalignedSize = 0;
+};
+
+void PffftTransform(
+    fft_type* buffer, const FFTParam* h, pffft_direction_t direction)
+{
+    static thread_local PffftScratch scratch;
+    const auto fftlen = h->Points * 2;
+    const auto work = scratch.Work(fftlen);
+
+    // pffft wants SIMD-aligned buffers; most callers' allocations already are
+    constexpr auto alignment = 16;
+    if (reinterpret_cast<uintptr_t>(buffer) % alignment == 0) {
+        pffft_transform_ordered(
+            h->PffftSetup.get(), buffer, buffer, work, direction);
+    } else {
+        const auto aligned = scratch.Unaligned(fftlen);
+        std::copy(buffer, buffer + fftlen, aligned);
+        pffft_transform_ordered(
+            h->PffftSetup.get(), aligned, aligned, work, direction);
+        std::copy(aligned, aligned + fftlen, buffer);
+    }
+}
+}
+
 /*
 *  Initialize the Sine table and Twiddle pointers (bit-reversed pointers)
 *  for the FFT routine.
 */
-HFFT InitializeFFT(size_t fftlen)
+HFFT InitializeFFT(size_t fftlen, FFTBackend backend)
 {
+    if (backend == FFTBackend::Pffft) {
+        if (auto h = InitializePffft(fftlen)) {
+            return h;
+        }
+    }
+
     int temp;
     HFFT h{ safenew FFTParam };
 
@@ -93,30 +206,48 @@ enum : size_t {
 static std::vector< std::unique_ptr<FFTParam> > hFFTArray(MAX_HFFT);
 wxCriticalSection getFFTMutex;
 
+FFTBackend GetDefaultFFTBackend()
+{
+    return defaultBackend.load(std::memory_order_relaxed);
+}
+
+void SetDefaultFFTBackend(FFTBackend backend)
+{
+    defaultBackend.store(backend, std::memory_order_relaxed);
+}
+
 /* Get a handle to the FFT tables of the desired length */
 /* This version keeps common tables rather than allocating a NEW table every time */
 HFFT GetFFT(size_t fftlen)
+{
+    return GetFFT(fftlen, GetDefaultFFTBackend());
+}
+
+HFFT GetFFT(size_t fftlen, FFTBackend backend)
 {
     // To do:  smarter policy about when to retain in the pool and when to
     // allocate a unique instance.
 
+    backend = EffectiveBackend(fftlen, backend);
+
     wxCriticalSectionLocker locker{ getFFTMutex };
 
     size_t h = 0;
     auto n = fftlen / 2;
     auto size = hFFTArray.size();
     for (;
-         (h < size) && hFFTArray[h] && (n != hFFTArray[h]->Points);
+         (h < size) && hFFTArray[h]
+         && (n != hFFTArray[h]->Points || backend != hFFTArray[h]->Backend);
          h++) {
     }
     if (h < size) {
         if (hFFTArray[h] == NULL) {
-            hFFTArray[h].reset(InitializeFFT(fftlen).release());
+            hFFTArray[h].reset(InitializeFFT(fftlen, backend).release());
         }
         return HFFT{ hFFTArray[h].get() };
     } else {
         // All buffers used, so fall back to allocating a NEW set of tables
-        return InitializeFFT(fftlen);
+        return InitializeFFT(fftlen, backend);
     }
 }
 
@@ -155,6 +286,11 @@ void FFTDeleter::operator()(FFTParam* hFFT) const
 */
 void RealFFTf(fft_type* buffer, const FFTParam* h)
 {
+    if (h->PffftSetup) {
+        PffftTransform(buffer, h, PFFFT_FORWARD);
+        return;
+    }
+
     fft_type* A, * B;
     const fft_type* sptr;
     const fft_type* endptr1, * endptr2;
@@ -256,6 +392,17 @@ void RealFFTf(fft_type* buffer, const FFTParam* h)
 */
 void InverseRealFFTf(fft_type* buffer, const FFTParam* h)
 {
+    if (h->PffftSetup) {
+        PffftTransform(buffer, h, PFFFT_BACKWARD);
+        // pffft does not scale; match the scalar code, which divides by N
+        const auto fftlen = h->Points * 2;
+        const auto scale = fft_type(1) / fftlen;
+        for (size_t i = 0; i < fftlen; ++i) {
+            buffer[i] *= scale;
+        }
+        return;
+    }
+
     fft_type* A, * B;
     const fft_type* sptr;
     const fft_type* endptr1, * endptr2;
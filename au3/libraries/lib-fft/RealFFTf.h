@@ -3,11 +3,35 @@
 
 #include "MemoryX.h"
 
+// Opaque type from pffft.h, which must not leak into this header (see
+// lib-fft/CMakeLists.txt)
+struct PFFFT_Setup;
+
 using fft_type = float;
+
+//! Selects the implementation that performs RealFFTf and InverseRealFFTf
+enum class FFTBackend {
+    //! Portable radix-2 code of this file; supports every power of two
+    Scalar,
+    //! The bundled pffft, vectorized with SSE or NEON where available;
+    //! falls back to Scalar for sizes that pffft can't handle
+    Pffft,
+};
+
+struct FFT_API PffftSetupDeleter {
+    void operator ()(PFFFT_Setup* p) const;
+};
+
 struct FFTParam {
+    //! Where to find the real and imaginary parts of the i-th bin in a
+    //! transformed buffer.  The layout of the buffer depends on the backend,
+    //! so always read it through this table, never by assuming bit reversal.
     ArrayOf<int> BitReversed;
     ArrayOf<fft_type> SinTable;
     size_t Points;
+    FFTBackend Backend = FFTBackend::Scalar;
+    //! Non-null if and only if Backend is FFTBackend::Pffft
+    std::unique_ptr<PFFFT_Setup, PffftSetupDeleter> PffftSetup;
 };
 
 struct FFT_API FFTDeleter {
@@ -18,7 +42,15 @@ using HFFT = std::unique_ptr<
     FFTParam, FFTDeleter
     >;
 
+//! Uses the backend last given to SetDefaultFFTBackend
 FFT_API HFFT GetFFT(size_t);
+FFT_API HFFT GetFFT(size_t, FFTBackend);
+
+//! Backend used by GetFFT(size_t); FFTBackend::Pffft unless changed
+FFT_API FFTBackend GetDefaultFFTBackend();
+//! Handles obtained before the call keep their backend
+FFT_API void SetDefaultFFTBackend(FFTBackend);
+
 FFT_API void RealFFTf(fft_type*, const FFTParam*);
 FFT_API void InverseRealFFTf(fft_type*, const FFTParam*);
 FFT_API void ReorderToTime(const FFTParam* hFFT, const fft_type* buffer, fft_type* TimeOut);
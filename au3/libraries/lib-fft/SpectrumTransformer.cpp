@@ -12,6 +12,7 @@ Edward Hui
 
 #include <algorithm>
 #include "FFT.h"
+#include "concurrency/ThreadPool.h"
 
 SpectrumTransformer::SpectrumTransformer(bool needsOutput,
                                          eWindowFunctions inWindowType,
@@ -25,7 +26,6 @@ SpectrumTransformer::SpectrumTransformer(bool needsOutput,
     , mLeadingPadding{leadingPadding}
     , mTrailingPadding{trailingPadding}
     , hFFT{GetFFT(mWindowSize)}
-    , mFFTBuffer(mWindowSize)
     , mInWaveBuffer(mWindowSize)
     , mOutOverlapBuffer(mWindowSize)
     , mNeedsOutput{needsOutput}
@@ -83,6 +83,27 @@ SpectrumTransformer::SpectrumTransformer(bool needsOutput,
     for (size_t ii = 0; ii < mWindowSize; ++ii) {
         *pWindow++ /= denom;
     }
+
+    mBatch.emplace_back(mWindowSize);
+}
+
+SpectrumTransformer::BatchItem::BatchItem(size_t windowSize)
+    : mRealFFTs(windowSize / 2)
+    , mImagFFTs(windowSize / 2)
+    , mBuffer(windowSize)
+{
+}
+
+void SpectrumTransformer::SetBatching(
+    size_t batchSize, audacity::concurrency::ThreadPool* pPool)
+{
+    assert(batchSize > 0);
+    mBatch.clear();
+    for (size_t ii = 0; ii < batchSize; ++ii) {
+        mBatch.emplace_back(mWindowSize);
+    }
+    mInWaveBuffer.resize(mWindowSize + (batchSize - 1) * mStepSize);
+    mpPool = batchSize > 1 ? pPool : nullptr;
 }
 
 auto SpectrumTransformer::NewWindow(size_t windowSize)
@@ -118,7 +139,7 @@ bool SpectrumTransformer::Start(size_t queueLength)
     {
         float* pFill;
         pFill = mInWaveBuffer.data();
-        std::fill(pFill, pFill + mWindowSize, 0.0f);
+        std::fill(pFill, pFill + mInWaveBuffer.size(), 0.0f);
         pFill = mOutOverlapBuffer.data();
         std::fill(pFill, pFill + mWindowSize, 0.0f);
     }
@@ -140,6 +161,7 @@ bool SpectrumTransformer::Start(size_t queueLength)
     }
 
     mInSampleCount = 0;
+    mBatchCount = 0;
 
     return true;
 }
@@ -151,9 +173,12 @@ bool SpectrumTransformer::ProcessSamples(const WindowProcessor& processor,
         mInSampleCount += len;
     }
     bool success = true;
+    // Windows pending in the batch count as steps already taken
     while (success && len
-           && mOutStepCount * static_cast<int>(mStepSize) < mInSampleCount) {
-        auto avail = std::min(len, mWindowSize - mInWavePos);
+           && (mOutStepCount + mBatchCount) * static_cast<int>(mStepSize)
+           < mInSampleCount) {
+        const auto windowEnd = mWindowSize + mBatchCount * mStepSize;
+        auto avail = std::min(len, windowEnd - mInWavePos);
         if (buffer) {
             memmove(&mInWaveBuffer[mInWavePos], buffer, avail * sizeof(float));
         } else {
@@ -165,23 +190,91 @@ bool SpectrumTransformer::ProcessSamples(const WindowProcessor& processor,
         len -= avail;
         mInWavePos += avail;
 
-        if (mInWavePos == mWindowSize) {
-            FillFirstWindow();
+        if (mInWavePos == windowEnd && ++mBatchCount == mBatch.size()) {
+            success = ProcessBatch(processor);
+        }
+    }
 
-            // invoke derived method
-            if ((success = processor(*this)), success) {
-                OutputStep();
-            }
+    if (success && mBatchCount > 0) {
+        success = ProcessBatch(processor);
+    }
 
-            ++mOutStepCount;
-            RotateWindows();
+    return success;
+}
 
-            // Shift input.
-            memmove(mInWaveBuffer.data(), &mInWaveBuffer[mStepSize],
-                    (mWindowSize - mStepSize) * sizeof(float));
-            mInWavePos -= mStepSize;
+template<typename Function>
+void SpectrumTransformer::ForEachInBatch(
+    size_t count, const Function& function)
+{
+    if (mpPool && count > 1) {
+        mpPool->ParallelFor(count, [&](size_t ii, size_t) { function(ii); });
+    } else {
+        for (size_t ii = 0; ii < count; ++ii) {
+            function(ii);
         }
     }
+}
+
+bool SpectrumTransformer::ProcessBatch(const WindowProcessor& processor)
+{
+    const auto count = mBatchCount;
+    mBatchCount = 0;
+
+    // The forward transforms of the windows don't depend on each other
+    ForEachInBatch(count, [this](size_t ii) {
+        TransformWindow(&mInWaveBuffer[ii * mStepSize], mBatch[ii]);
+    });
+
+    // But the processor may look at earlier windows, so it visits them in
+    // order, each becoming the newest of the queue in turn
+    bool success = true;
+    size_t processed = 0;
+    while (success && processed < count) {
+        auto& item = mBatch[processed++];
+        auto& newest = Newest();
+        newest.mRealFFTs.swap(item.mRealFFTs);
+        newest.mImagFFTs.swap(item.mImagFFTs);
+
+        // invoke derived method
+        success = processor(*this);
+
+        item.mOverlapAdd = success && mNeedsOutput && QueueIsFull();
+        item.mOutput = mOutStepCount >= 0;
+        if (item.mOverlapAdd) {
+            // The latest window is overwritten after rotation; take its
+            // coefficients for the inverse transform
+            auto& latest = Latest();
+            item.mRealFFTs.swap(latest.mRealFFTs);
+            item.mImagFFTs.swap(latest.mImagFFTs);
+        }
+
+        ++mOutStepCount;
+        RotateWindows();
+    }
+
+    if (mNeedsOutput) {
+        ForEachInBatch(processed, [this](size_t ii) {
+            if (mBatch[ii].mOverlapAdd) {
+                InverseTransform(mBatch[ii]);
+            }
+        });
+        // Overlap-add is a running sum, so it must go in order
+        for (size_t ii = 0; ii < processed; ++ii) {
+            if (mBatch[ii].mOverlapAdd) {
+                OverlapAdd(mBatch[ii]);
+            }
+        }
+    }
+
+    // Shift input, keeping what overlaps the next window.  After failure,
+    // forget the input of windows not processed.
+    const auto consumed = processed * mStepSize;
+    memmove(mInWaveBuffer.data(), &mInWaveBuffer[consumed],
+            (mInWavePos - consumed) * sizeof(float));
+    mInWavePos -= consumed;
+    if (!success) {
+        mInWavePos = mWindowSize - mStepSize;
+    }
 
     return success;
 }
@@ -197,11 +290,15 @@ void SpectrumTransformer::ResizeQueue(size_t queueLength)
     }
 }
 
-void SpectrumTransformer::FillFirstWindow()
+void SpectrumTransformer::TransformWindow(
+    const float* wave, BatchItem& item) const
 {
+    auto& fftBuffer = item.mBuffer;
+
     // Transform samples to frequency domain, windowed as needed
     {
-        auto pFFTBuffer = mFFTBuffer.data(), pInWaveBuffer = mInWaveBuffer.data();
+        auto pFFTBuffer = fftBuffer.data();
+        auto pInWaveBuffer = wave;
         if (mInWindow.size() > 0) {
             auto pInWindow = mInWindow.data();
             for (size_t ii = 0; ii < mWindowSize; ++ii) {
@@ -211,27 +308,25 @@ void SpectrumTransformer::FillFirstWindow()
             memmove(pFFTBuffer, pInWaveBuffer, mWindowSize * sizeof(float));
         }
     }
-    RealFFTf(mFFTBuffer.data(), hFFT.get());
-
-    auto& record = Nth(0);
+    RealFFTf(fftBuffer.data(), hFFT.get());
 
     // Store real and imaginary parts for later inverse FFT
     {
-        float* pReal = &record.mRealFFTs[1];
-        float* pImag = &record.mImagFFTs[1];
+        float* pReal = &item.mRealFFTs[1];
+        float* pImag = &item.mImagFFTs[1];
         int* pBitReversed = &hFFT->BitReversed[1];
         const auto last = mSpectrumSize - 1;
         for (size_t ii = 1; ii < last; ++ii) {
             const int kk = *pBitReversed++;
-            *pReal++ = mFFTBuffer[kk];
-            *pImag++ = mFFTBuffer[kk + 1];
+            *pReal++ = fftBuffer[kk];
+            *pImag++ = fftBuffer[kk + 1];
         }
         // DC and Fs/2 bins need to be handled specially
-        const float dc = mFFTBuffer[0];
-        record.mRealFFTs[0] = dc;
+        const float dc = fftBuffer[0];
+        item.mRealFFTs[0] = dc;
 
-        const float nyquist = mFFTBuffer[1];
-        record.mImagFFTs[0] = nyquist; // For Fs/2, not really imaginary
+        const float nyquist = fftBuffer[1];
+        item.mImagFFTs[0] = nyquist; // For Fs/2, not really imaginary
     }
 }
 
@@ -279,59 +374,58 @@ size_t SpectrumTransformer::CurrentQueueSize() const
     }
 }
 
-// Formerly part of EffectNoiseReduction::Worker::ReduceNoise()
-void SpectrumTransformer::OutputStep()
+void SpectrumTransformer::InverseTransform(BatchItem& item) const
 {
-    if (!mNeedsOutput) {
-        return;
+    auto& fftBuffer = item.mBuffer;
+    const float* pReal = &item.mRealFFTs[1];
+    const float* pImag = &item.mImagFFTs[1];
+    float* pBuffer = &fftBuffer[2];
+    auto nn = mSpectrumSize - 2;
+    for (; nn--;) {
+        *pBuffer++ = *pReal++;
+        *pBuffer++ = *pImag++;
     }
-    if (QueueIsFull()) {
-        const auto last = mSpectrumSize - 1;
-        Window& record = **mQueue.rbegin();
-
-        const float* pReal = &record.mRealFFTs[1];
-        const float* pImag = &record.mImagFFTs[1];
-        float* pBuffer = &mFFTBuffer[2];
-        auto nn = mSpectrumSize - 2;
-        for (; nn--;) {
-            *pBuffer++ = *pReal++;
-            *pBuffer++ = *pImag++;
-        }
-        mFFTBuffer[0] = record.mRealFFTs[0];
-        // The Fs/2 component is stored as the imaginary part of the DC component
-        mFFTBuffer[1] = record.mImagFFTs[0];
-
-        // Invert the FFT into the output buffer
-        InverseRealFFTf(mFFTBuffer.data(), hFFT.get());
-
-        // Overlap-add
-        if (mOutWindow.size() > 0) {
-            auto pOut = mOutOverlapBuffer.data();
-            auto pWindow = mOutWindow.data();
-            auto pBitReversed = &hFFT->BitReversed[0];
-            for (size_t jj = 0; jj < last; ++jj) {
-                auto kk = *pBitReversed++;
-                *pOut++ += mFFTBuffer[kk] * (*pWindow++);
-                *pOut++ += mFFTBuffer[kk + 1] * (*pWindow++);
-            }
-        } else {
-            auto pOut = mOutOverlapBuffer.data();
-            auto pBitReversed = &hFFT->BitReversed[0];
-            for (size_t jj = 0; jj < last; ++jj) {
-                auto kk = *pBitReversed++;
-                *pOut++ += mFFTBuffer[kk];
-                *pOut++ += mFFTBuffer[kk + 1];
-            }
+    fftBuffer[0] = item.mRealFFTs[0];
+    // The Fs/2 component is stored as the imaginary part of the DC component
+    fftBuffer[1] = item.mImagFFTs[0];
+
+    // Invert the FFT into the output buffer
+    InverseRealFFTf(fftBuffer.data(), hFFT.get());
+}
+
+// Formerly part of EffectNoiseReduction::Worker::ReduceNoise()
+void SpectrumTransformer::OverlapAdd(const BatchItem& item)
+{
+    const auto last = mSpectrumSize - 1;
+    const auto& fftBuffer = item.mBuffer;
+
+    // Overlap-add
+    if (mOutWindow.size() > 0) {
+        auto pOut = mOutOverlapBuffer.data();
+        auto pWindow = mOutWindow.data();
+        auto pBitReversed = &hFFT->BitReversed[0];
+        for (size_t jj = 0; jj < last; ++jj) {
+            auto kk = *pBitReversed++;
+            *pOut++ += fftBuffer[kk] * (*pWindow++);
+            *pOut++ += fftBuffer[kk + 1] * (*pWindow++);
         }
-        auto buffer = mOutOverlapBuffer.data();
-        if (mOutStepCount >= 0) {
-            // Output the first portion of the overlap buffer, they're done
-            DoOutput(buffer, mStepSize);
+    } else {
+        auto pOut = mOutOverlapBuffer.data();
+        auto pBitReversed = &hFFT->BitReversed[0];
+        for (size_t jj = 0; jj < last; ++jj) {
+            auto kk = *pBitReversed++;
+            *pOut++ += fftBuffer[kk];
+            *pOut++ += fftBuffer[kk + 1];
         }
-        // Shift the remainder over.
-        memmove(buffer, buffer + mStepSize, sizeof(float) * (mWindowSize - mStepSize));
-        std::fill(buffer + mWindowSize - mStepSize, buffer + mWindowSize, 0.0f);
     }
+    auto buffer = mOutOverlapBuffer.data();
+    if (item.mOutput) {
+        // Output the first portion of the overlap buffer, they're done
+        DoOutput(buffer, mStepSize);
+    }
+    // Shift the remainder over.
+    memmove(buffer, buffer + mStepSize, sizeof(float) * (mWindowSize - mStepSize));
+    std::fill(buffer + mWindowSize - mStepSize, buffer + mWindowSize, 0.0f);
 }
 
 bool SpectrumTransformer::QueueIsFull() const
@@ -21,6 +21,10 @@ Paul Licameli
 
 enum eWindowFunctions : int;
 
+namespace audacity::concurrency {
+class ThreadPool;
+}
+
 /*!
  @brief A class that transforms a portion of a wave track (preserving duration)
  by applying Fourier transform, then modifying coefficients, then inverse
@@ -64,6 +68,24 @@ public:
 
     bool NeedsOutput() const { return mNeedsOutput; }
 
+    //! Windows per batch that keep the threads of a pool busy while
+    //! deferring little output
+    static constexpr size_t DefaultBatchSize = 64;
+
+    //! Transform up to `batchSize` windows at once, sharing the forward and
+    //! inverse FFTs among the threads of `pPool`
+    /*!
+     The window processor is still called for one window at a time, in order,
+     and overlap-add is still done in order, so the output is identical to
+     that without batching; only calls to DoOutput() are deferred, at most to
+     the end of the ProcessSamples() call.  Call before Start().
+     @param pPool if null, the calling thread does all the work; else it must
+     outlive processing, and may be shared with other transformers that do not
+     process at the same time
+     @pre `batchSize > 0`
+     */
+    void SetBatching(size_t batchSize, audacity::concurrency::ThreadPool* pPool);
+
     //! Call once before a sequence of calls to ProcessSamples; Invokes DoStart
     /*! @return success */
     bool Start(size_t queueLength);
@@ -143,10 +165,28 @@ public:
     Window& Latest() { return **mQueue.rbegin(); }
 
 private:
+    //! A window on its way through the forward FFT, the processor, and the
+    //! inverse FFT
+    struct BatchItem {
+        explicit BatchItem(size_t windowSize);
+
+        FloatVector mRealFFTs;
+        FloatVector mImagFFTs;
+        //! Scratch for the forward FFT, then result of the inverse FFT
+        FloatVector mBuffer;
+        //! Whether the processor passed it on to overlap-add
+        bool mOverlapAdd{ false };
+        //! Whether overlap-add then completes a step of output
+        bool mOutput{ false };
+    };
+
     void ResizeQueue(size_t queueLength);
-    void FillFirstWindow();
+    template<typename Function> void ForEachInBatch(size_t count, const Function& function);
+    bool ProcessBatch(const WindowProcessor& processor);
+    void TransformWindow(const float* wave, BatchItem& item) const;
     void RotateWindows();
-    void OutputStep();
+    void InverseTransform(BatchItem& item) const;
+    void OverlapAdd(const BatchItem& item);
 
 protected:
     const size_t mWindowSize;
@@ -166,9 +206,15 @@ private:
     sampleCount mOutStepCount = 0; //!< sometimes negative
     size_t mInWavePos = 0;
 
-    //! These have size mWindowSize:
-    FloatVector mFFTBuffer;
+    //! Windows of the current batch, in order of input
+    std::vector<BatchItem> mBatch;
+    //! How many windows of mInWaveBuffer are complete and not yet processed
+    size_t mBatchCount = 0;
+    audacity::concurrency::ThreadPool* mpPool{};
+
+    //! This has room for the overlapping windows of one batch:
     FloatVector mInWaveBuffer;
+    //! These have size mWindowSize:
     FloatVector mOutOverlapBuffer;
     //! These have size mWindowSize, or 0 for rectangular window:
     FloatVector mInWindow;
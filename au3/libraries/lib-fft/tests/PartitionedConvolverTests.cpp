@@ -0,0 +1,160 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  PartitionedConvolverTests.cpp
+
+**********************************************************************/
+#include "PartitionedConvolver.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+std::vector<float> MakeSignal(size_t size, double frequency)
+{
+    std::vector<float> signal(size);
+    for (size_t ii = 0; ii < size; ++ii) {
+        signal[ii] = std::sin(frequency * ii) * std::cos(0.0011 * ii)
+                     + 0.3 * std::sin(2.1 * ii);
+    }
+    return signal;
+}
+
+//! A decaying response, with something in each of its taps
+std::vector<float> MakeImpulse(size_t length, double frequency)
+{
+    std::vector<float> impulse(length);
+    for (size_t ii = 0; ii < length; ++ii) {
+        impulse[ii] = std::exp(-3.0 * ii / length) * std::cos(frequency * ii);
+    }
+    return impulse;
+}
+
+//! The convolution, delayed by `latency`
+std::vector<float> Convolve(
+    const std::vector<float>& signal, const std::vector<float>& impulse,
+    size_t latency)
+{
+    std::vector<float> result(signal.size());
+    for (size_t ii = latency; ii < signal.size(); ++ii) {
+        const auto nn = ii - latency;
+        double sum = 0;
+        for (size_t kk = 0; kk < impulse.size() && kk <= nn; ++kk) {
+            sum += impulse[kk] * signal[nn - kk];
+        }
+        result[ii] = sum;
+    }
+    return result;
+}
+
+void ProcessInChunks(
+    PartitionedConvolver& convolver, const float* in, float* out,
+    size_t len, size_t chunk)
+{
+    for (size_t start = 0; start < len; start += chunk) {
+        convolver.Process(in + start, out + start,
+                          std::min(chunk, len - start));
+    }
+}
+}
+
+TEST_CASE("PartitionedConvolver matches direct convolution",
+          "[PartitionedConvolver]")
+{
+    const auto signal = MakeSignal(40000, 0.03);
+    for (const size_t length : { 1, 31, 100, 1000, 4001, 9000 }) {
+        const auto impulse = MakeImpulse(length, 0.2);
+        for (const size_t maxLatency : { 0, 1, 64, 100, 1024 }) {
+            PartitionedConvolver convolver{ length, maxLatency };
+            if (maxLatency > 0) {
+                CHECK(convolver.Latency()
+                      <= std::max(maxLatency, PartitionedConvolver::MinBlockSize));
+            }
+            convolver.SetImpulseResponse(impulse.data(), impulse.size());
+            const auto expected
+                =Convolve(signal, impulse, convolver.Latency());
+            for (const size_t chunk : { 17, 512, 40000 }) {
+                convolver.Reset();
+                std::vector<float> actual(signal.size());
+                ProcessInChunks(convolver, signal.data(), actual.data(),
+                                signal.size(), chunk);
+                for (size_t ii = 0; ii < signal.size(); ++ii) {
+                    REQUIRE(actual[ii]
+                            == Approx(expected[ii]).margin(2e-4 * std::sqrt(length)));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("PartitionedConvolver processes in place", "[PartitionedConvolver]")
+{
+    const auto signal = MakeSignal(10000, 0.01);
+    const auto impulse = MakeImpulse(700, 0.5);
+    PartitionedConvolver convolver{ impulse.size(), 128 };
+    convolver.SetImpulseResponse(impulse.data(), impulse.size());
+    std::vector<float> expected(signal.size());
+    convolver.Process(signal.data(), expected.data(), signal.size());
+    convolver.Reset();
+    auto actual = signal;
+    ProcessInChunks(convolver, actual.data(), actual.data(), actual.size(), 100);
+    CHECK(actual == expected);
+}
+
+TEST_CASE("PartitionedConvolver crossfades a new response",
+          "[PartitionedConvolver]")
+{
+    // A steady tone, and two responses passing it with different gains
+    const size_t length = 3000;
+    std::vector<float> signal(48000);
+    for (size_t ii = 0; ii < signal.size(); ++ii) {
+        signal[ii] = std::sin(0.01 * ii);
+    }
+    std::vector<float> quiet(length), loud(length);
+    quiet[0] = 0.25f;
+    loud[length - 1] = 1.0f;
+
+    PartitionedConvolver convolver{ length, 64 };
+    convolver.SetImpulseResponse(quiet.data(), quiet.size());
+    std::vector<float> output(signal.size());
+    const size_t change = 20000;
+    convolver.Process(signal.data(), output.data(), change);
+    convolver.SetImpulseResponse(loud.data(), loud.size());
+    convolver.Process(signal.data() + change, output.data() + change,
+                      signal.size() - change);
+
+    // The tone varies by at most 0.01 per sample; a switch without a fade
+    // would jump by much more
+    for (size_t ii = change + 1; ii < output.size(); ++ii) {
+        REQUIRE(std::abs(output[ii] - output[ii - 1]) < 0.02f);
+    }
+
+    // And the new response is fully in effect afterwards
+    const auto latency = convolver.Latency();
+    for (size_t ii = change + 20000; ii < output.size(); ++ii) {
+        REQUIRE(output[ii]
+                == Approx(signal[ii - latency - (length - 1)]).margin(1e-4));
+    }
+}
+
+TEST_CASE("PartitionedConvolver benchmark", "[benchmark][.]")
+{
+    const auto signal = MakeSignal(48000 * 10, 0.03);
+    const auto impulse = MakeImpulse(8191, 0.2);
+    std::vector<float> output(signal.size());
+    for (const size_t maxLatency : { 0, 64, 512 }) {
+        PartitionedConvolver convolver{ impulse.size(), maxLatency };
+        convolver.SetImpulseResponse(impulse.data(), impulse.size());
+        BENCHMARK("8191 taps, latency " + std::to_string(convolver.Latency()))
+        {
+            ProcessInChunks(convolver, signal.data(), output.data(),
+                            signal.size(), 512);
+            return output.back();
+        };
+    }
+}
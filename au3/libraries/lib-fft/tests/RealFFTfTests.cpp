@@ -0,0 +1,120 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  RealFFTfTests.cpp
+
+**********************************************************************/
+#include "RealFFTf.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<fft_type> MakeSignal(size_t size)
+{
+    std::vector<fft_type> signal(size);
+    for (size_t i = 0; i < size; ++i) {
+        signal[i] = std::sin(0.37 * i) + 0.25 * std::cos(0.011 * i);
+    }
+    return signal;
+}
+
+//! Spectrum as interleaved (real, imaginary), DC first, Fs/2 last
+std::vector<fft_type> Transform(const std::vector<fft_type>& signal, FFTBackend backend)
+{
+    const auto hFFT = GetFFT(signal.size(), backend);
+    auto buffer = signal;
+    RealFFTf(buffer.data(), hFFT.get());
+    std::vector<fft_type> spectrum(signal.size() + 2);
+    spectrum[0] = buffer[0];
+    spectrum[signal.size()] = buffer[1];
+    for (size_t i = 1; i < hFFT->Points; ++i) {
+        spectrum[2 * i] = buffer[hFFT->BitReversed[i]];
+        spectrum[2 * i + 1] = buffer[hFFT->BitReversed[i] + 1];
+    }
+    return spectrum;
+}
+
+std::vector<fft_type> RoundTrip(const std::vector<fft_type>& signal, FFTBackend backend)
+{
+    const auto hFFT = GetFFT(signal.size(), backend);
+    auto buffer = signal;
+    RealFFTf(buffer.data(), hFFT.get());
+    std::vector<fft_type> ordered(signal.size());
+    ordered[0] = buffer[0];
+    ordered[1] = buffer[1];
+    for (size_t i = 1; i < hFFT->Points; ++i) {
+        ordered[2 * i] = buffer[hFFT->BitReversed[i]];
+        ordered[2 * i + 1] = buffer[hFFT->BitReversed[i] + 1];
+    }
+    InverseRealFFTf(ordered.data(), hFFT.get());
+    std::vector<fft_type> output(signal.size());
+    ReorderToTime(hFFT.get(), ordered.data(), output.data());
+    return output;
+}
+
+fft_type MaxAbsDifference(const std::vector<fft_type>& a, const std::vector<fft_type>& b)
+{
+    fft_type result = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        result = std::max(result, std::abs(a[i] - b[i]));
+    }
+    return result;
+}
+} // namespace
+
+TEST_CASE("RealFFTf backends agree")
+{
+    for (size_t size = 8; size <= 65536; size *= 2) {
+        const auto signal = MakeSignal(size);
+        const auto scalar = Transform(signal, FFTBackend::Scalar);
+        const auto pffft = Transform(signal, FFTBackend::Pffft);
+        const auto peak = std::abs(*std::max_element(
+                                       scalar.begin(), scalar.end(),
+                                       [](fft_type a, fft_type b) { return std::abs(a) < std::abs(b); }));
+        // Single precision error grows with log2 of the size
+        REQUIRE(MaxAbsDifference(scalar, pffft) <= peak * 1e-5f);
+    }
+}
+
+TEST_CASE("InverseRealFFTf inverts RealFFTf")
+{
+    for (auto backend : { FFTBackend::Scalar, FFTBackend::Pffft }) {
+        for (size_t size = 8; size <= 65536; size *= 2) {
+            const auto signal = MakeSignal(size);
+            REQUIRE(MaxAbsDifference(signal, RoundTrip(signal, backend)) < 1e-4f);
+        }
+    }
+}
+
+TEST_CASE("GetFFT falls back to scalar for small sizes")
+{
+    REQUIRE(GetFFT(8, FFTBackend::Pffft)->Backend == FFTBackend::Scalar);
+    REQUIRE(GetFFT(8, FFTBackend::Pffft)->PffftSetup == nullptr);
+}
+
+TEST_CASE("RealFFTf benchmark", "[benchmark][.]")
+{
+    for (size_t size = 256; size <= 65536; size *= 2) {
+        const auto signal = MakeSignal(size);
+        for (auto backend : { FFTBackend::Scalar, FFTBackend::Pffft }) {
+            const auto hFFT = GetFFT(size, backend);
+            auto buffer = signal;
+            const auto name = std::string { backend == FFTBackend::Scalar ? "scalar " : "pffft " }
+                              + std::to_string(size);
+            BENCHMARK(name.c_str())
+            {
+                std::copy(signal.begin(), signal.end(), buffer.begin());
+                RealFFTf(buffer.data(), hFFT.get());
+                InverseRealFFTf(buffer.data(), hFFT.get());
+                return buffer[0];
+            };
+        }
+    }
+}
@@ -0,0 +1,273 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SpectrumTransformerTests.cpp
+
+**********************************************************************/
+#include "SpectrumTransformer.h"
+#include "FFT.h"
+#include "concurrency/ThreadPool.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+using audacity::concurrency::ThreadPool;
+
+class CollectingTransformer final : public SpectrumTransformer
+{
+public:
+    CollectingTransformer(
+        bool leadingPadding, bool trailingPadding, size_t batchSize,
+        ThreadPool* pPool)
+        : SpectrumTransformer{ true, eWinFuncHann, eWinFuncHann, 1024, 4,
+                               leadingPadding, trailingPadding }
+    {
+        SetBatching(batchSize, pPool);
+    }
+
+    void DoOutput(const float* outBuffer, size_t stepSize) override
+    {
+        mOutput.insert(mOutput.end(), outBuffer, outBuffer + stepSize);
+    }
+
+    std::vector<float> mOutput;
+};
+
+//! Attenuates each coefficient of the newest window by how much it exceeds
+//! the same coefficient of the window before, so that results depend on the
+//! order of windows in the queue
+bool Process(SpectrumTransformer& transformer)
+{
+    if (transformer.CurrentQueueSize() < 2) {
+        return true;
+    }
+    auto& newest = transformer.Newest();
+    const auto& previous = transformer.Nth(1);
+    for (size_t ii = 0; ii < newest.mRealFFTs.size(); ++ii) {
+        const auto before = std::abs(previous.mRealFFTs[ii]) + 1e-3f;
+        const auto gain = std::min(1.0f, before / (std::abs(newest.mRealFFTs[ii]) + 1e-3f));
+        newest.mRealFFTs[ii] *= gain;
+        newest.mImagFFTs[ii] *= gain;
+    }
+    return true;
+}
+
+//! Gates bands as noise reduction does:  windows carry their power spectra
+//! and gains, the gains of the middle window of the queue are decided from
+//! the whole queue, then spread to the older and newer windows, and the
+//! oldest window has its gains applied just before it leaves the queue
+class GatingTransformer final : public SpectrumTransformer
+{
+public:
+    static constexpr size_t QueueLength = 5;
+    static constexpr size_t Center = QueueLength / 2;
+    static constexpr float Attenuation = 0.1f;
+    static constexpr float Decay = 0.7f;
+
+    GatingTransformer(size_t batchSize, ThreadPool* pPool)
+        : SpectrumTransformer{ true, eWinFuncHann, eWinFuncHann, 1024, 4, true, true }
+    {
+        SetBatching(batchSize, pPool);
+    }
+
+    struct GatingWindow : Window {
+        explicit GatingWindow(size_t windowSize)
+            : Window{ windowSize }
+            , mPower(windowSize / 2)
+            , mGains(windowSize / 2)
+        {
+        }
+
+        FloatVector mPower;
+        FloatVector mGains;
+    };
+
+    GatingWindow& NthWindow(int nn) { return static_cast<GatingWindow&>(Nth(nn)); }
+
+    std::unique_ptr<Window> NewWindow(size_t windowSize) override
+    {
+        return std::make_unique<GatingWindow>(windowSize);
+    }
+
+    bool DoStart() override
+    {
+        for (size_t ii = 0; ii < TotalQueueSize(); ++ii) {
+            auto& window = NthWindow(ii);
+            std::fill(window.mPower.begin(), window.mPower.end(), 0.0f);
+            std::fill(window.mGains.begin(), window.mGains.end(), Attenuation);
+        }
+        return true;
+    }
+
+    void DoOutput(const float* outBuffer, size_t stepSize) override
+    {
+        mOutput.insert(mOutput.end(), outBuffer, outBuffer + stepSize);
+    }
+
+    static bool Process(SpectrumTransformer& base)
+    {
+        auto& transformer = static_cast<GatingTransformer&>(base);
+        auto& newest = transformer.NthWindow(0);
+        for (size_t jj = 0; jj < newest.mPower.size(); ++jj) {
+            const auto re = newest.mRealFFTs[jj], im = newest.mImagFFTs[jj];
+            newest.mPower[jj] = re * re + im * im;
+        }
+        if (transformer.CurrentQueueSize() <= Center) {
+            return true;
+        }
+
+        const auto size = transformer.CurrentQueueSize();
+        auto& center = transformer.NthWindow(Center);
+        for (size_t jj = 0; jj < center.mGains.size(); ++jj) {
+            auto least = center.mPower[jj];
+            for (size_t ii = 0; ii < size; ++ii) {
+                least = std::min(least, transformer.NthWindow(ii).mPower[jj]);
+            }
+            center.mGains[jj] = least > 1e-2f ? 1.0f : Attenuation;
+        }
+        // Release into older windows, attack into newer ones
+        for (size_t ii = Center + 1; ii < size; ++ii) {
+            auto& gains = transformer.NthWindow(ii).mGains;
+            const auto& newer = transformer.NthWindow(ii - 1).mGains;
+            for (size_t jj = 0; jj < gains.size(); ++jj) {
+                gains[jj] = std::max(gains[jj], newer[jj] * Decay);
+            }
+        }
+        for (size_t ii = Center; ii-- > 0;) {
+            auto& gains = transformer.NthWindow(ii).mGains;
+            const auto& older = transformer.NthWindow(ii + 1).mGains;
+            for (size_t jj = 0; jj < gains.size(); ++jj) {
+                gains[jj] = std::max(Attenuation, older[jj] * Decay);
+            }
+        }
+
+        if (transformer.QueueIsFull()) {
+            auto& oldest = transformer.NthWindow(QueueLength - 1);
+            for (size_t jj = 0; jj < oldest.mGains.size(); ++jj) {
+                oldest.mRealFFTs[jj] *= oldest.mGains[jj];
+                oldest.mImagFFTs[jj] *= oldest.mGains[jj];
+            }
+        }
+        return true;
+    }
+
+    std::vector<float> mOutput;
+};
+
+std::vector<float> MakeSignal(size_t size)
+{
+    std::vector<float> signal(size);
+    for (size_t ii = 0; ii < size; ++ii) {
+        signal[ii] = std::sin(0.05 * ii) * std::sin(0.0007 * ii)
+                     + 0.2 * std::sin(1.3 * ii);
+    }
+    return signal;
+}
+
+std::vector<float> Transform(
+    const std::vector<float>& signal, size_t chunk, bool leadingPadding,
+    bool trailingPadding, size_t batchSize, ThreadPool* pPool)
+{
+    CollectingTransformer transformer{
+        leadingPadding, trailingPadding, batchSize, pPool };
+    REQUIRE(transformer.Start(3));
+    for (size_t start = 0; start < signal.size(); start += chunk) {
+        const auto len = std::min(chunk, signal.size() - start);
+        REQUIRE(transformer.ProcessSamples(Process, signal.data() + start, len));
+    }
+    REQUIRE(transformer.Finish(Process));
+    return transformer.mOutput;
+}
+}
+
+TEST_CASE("SpectrumTransformer in batches matches one window at a time",
+          "[SpectrumTransformer]")
+{
+    const auto signal = MakeSignal(50000);
+    // All the transformers share one pool in turn
+    ThreadPool pool{ 3 };
+    for (const bool leadingPadding : { false, true }) {
+        for (const bool trailingPadding : { false, true }) {
+            const auto expected = Transform(
+                signal, 4096, leadingPadding, trailingPadding, 1, nullptr);
+            REQUIRE(!expected.empty());
+            for (const size_t chunk : { 100, 4096, 50000 }) {
+                for (const size_t batchSize : { 2, 7, 64 }) {
+                    for (const auto pPool : { static_cast<ThreadPool*>(nullptr), &pool }) {
+                        const auto actual = Transform(
+                            signal, chunk, leadingPadding, trailingPadding,
+                            batchSize, pPool);
+                        // Not just close:  the same arithmetic in the same order
+                        REQUIRE(actual == expected);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("SpectrumTransformer in batches matches for processors that change older windows",
+          "[SpectrumTransformer]")
+{
+    const auto signal = MakeSignal(50000);
+    ThreadPool pool{ 3 };
+    const auto gate = [&](size_t batchSize, ThreadPool* pPool) {
+        GatingTransformer transformer{ batchSize, pPool };
+        REQUIRE(transformer.Start(GatingTransformer::QueueLength));
+        for (size_t start = 0; start < signal.size(); start += 4096) {
+            const auto len = std::min<size_t>(4096, signal.size() - start);
+            REQUIRE(transformer.ProcessSamples(
+                GatingTransformer::Process, signal.data() + start, len));
+        }
+        REQUIRE(transformer.Finish(GatingTransformer::Process));
+        return transformer.mOutput;
+    };
+    const auto expected = gate(1, nullptr);
+    REQUIRE(!expected.empty());
+    for (const size_t batchSize : { 3, 64 }) {
+        for (const auto pPool : { static_cast<ThreadPool*>(nullptr), &pool }) {
+            REQUIRE(gate(batchSize, pPool) == expected);
+        }
+    }
+}
+
+TEST_CASE("SpectrumTransformer stops a batch where the processor fails",
+          "[SpectrumTransformer]")
+{
+    const auto signal = MakeSignal(20000);
+    ThreadPool pool{ 2 };
+    const auto run = [&](size_t batchSize) {
+        CollectingTransformer transformer{ true, true, batchSize, &pool };
+        int calls = 0;
+        const auto failing = [&calls](SpectrumTransformer& transformer) {
+            return ++calls < 10 && Process(transformer);
+        };
+        REQUIRE(transformer.Start(3));
+        CHECK(!transformer.ProcessSamples(failing, signal.data(), signal.size()));
+        return std::make_pair(calls, transformer.mOutput);
+    };
+    const auto expected = run(1);
+    CHECK(run(16) == expected);
+}
+
+TEST_CASE("SpectrumTransformer batch benchmark", "[benchmark][.]")
+{
+    const auto signal = MakeSignal(48000 * 60);
+    BENCHMARK("one window at a time")
+    {
+        return Transform(signal, 65536, true, true, 1, nullptr).size();
+    };
+    ThreadPool pool{ ThreadPool::DefaultNumWorkers() };
+    BENCHMARK("batches of DefaultBatchSize")
+    {
+        return Transform(signal, 65536, true, true,
+                         SpectrumTransformer::DefaultBatchSize, &pool)
+               .size();
+    };
+}
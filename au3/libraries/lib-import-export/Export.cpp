@@ -19,6 +19,7 @@
 
 #include "BasicUI.h"
 #include "ExportPluginRegistry.h"
+#include "LazyIngest.h"
 #include "Mix.h"
 #include "Project.h"
 #include "WaveTrack.h"
@@ -83,6 +84,13 @@ ExportTaskBuilder& ExportTaskBuilder::SetTags(const Tags* tags) noexcept
 
 ExportTask ExportTaskBuilder::Build(AudacityProject& project)
 {
+    // Imported audio may still be read from the file to be overwritten
+    if (!LazyIngest::Get().Release(mFileName.GetFullPath())) {
+        throw ExportException(
+                  XO("Cannot export to %s, because some imported audio could not yet be copied from it into the project.")
+                  .Format(mFileName.GetFullPath()).Translation());
+    }
+
     //File rename stuff should be moved out to somewhere else...
     auto filename = mFileName;
 
@@ -0,0 +1,298 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ExportBatch.cpp
+
+**********************************************************************/
+#include "ExportBatch.h"
+
+#include <algorithm>
+#include <cassert>
+
+class ExportBatch::JobDelegate final : public ExportProcessorDelegate
+{
+public:
+    explicit JobDelegate(const ExportBatch& batch)
+        : mBatch{batch}
+    {}
+
+    bool IsCancelled() const override
+    {
+        return mBatch.IsCancelled();
+    }
+
+    bool IsStopped() const override
+    {
+        return mBatch.IsStopped();
+    }
+
+    void SetStatusString(const TranslatableString& str) override
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mStatus = str;
+    }
+
+    void OnProgress(double progress) override
+    {
+        mProgress.store(progress, std::memory_order_relaxed);
+    }
+
+    double GetProgress() const
+    {
+        return std::clamp(mProgress.load(std::memory_order_relaxed), 0.0, 1.0);
+    }
+
+    TranslatableString GetStatus() const
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        return mStatus;
+    }
+
+private:
+    const ExportBatch& mBatch;
+    std::atomic<double> mProgress{ 0 };
+    mutable std::mutex mMutex;
+    TranslatableString mStatus;
+};
+
+size_t ExportBatch::Limits::DefaultMaxJobs()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ExportBatch::ExportBatch()
+    : ExportBatch{Limits {}}
+{
+}
+
+ExportBatch::ExportBatch(Limits limits)
+    : mLimits{limits}
+{
+    assert(mLimits.maxJobs > 0);
+    assert(mLimits.maxSources > 0);
+}
+
+ExportBatch::~ExportBatch()
+{
+    Cancel();
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mExiting = true;
+    }
+    mReady.notify_all();
+    // Workers still run the jobs already built, which then see the
+    // cancellation and clean up their files
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void ExportBatch::Add(Factory factory, SourceKey source)
+{
+    assert(mWorkers.empty());
+    Job job;
+    job.factory = std::move(factory);
+    job.source = std::move(source);
+    job.delegate = std::make_unique<JobDelegate>(*this);
+    mJobs.push_back(std::move(job));
+}
+
+size_t ExportBatch::GetJobCount() const
+{
+    return mJobs.size();
+}
+
+bool ExportBatch::Poll(std::chrono::milliseconds timeout)
+{
+    if (mWorkers.empty()) {
+        const auto nWorkers = std::min(mLimits.maxJobs, mJobs.size());
+        for (size_t ii = 0; ii < nWorkers; ++ii) {
+            mWorkers.emplace_back([this]{ Run(); });
+        }
+    }
+
+    while (true) {
+        std::optional<size_t> index;
+        {
+            std::lock_guard<std::mutex> lock{ mMutex };
+            index = NextJob();
+            if (!index) {
+                break;
+            }
+            auto& job = mJobs[*index];
+            job.started = true;
+            ++mRunning;
+            if (job.source.empty()) {
+                ++mUnshared;
+            } else {
+                ++mSources[job.source];
+            }
+        }
+        // Build outside of the lock; this may take a while
+        Start(*index);
+    }
+
+    std::unique_lock<std::mutex> lock{ mMutex };
+    if (mRunning > 0) {
+        const auto finished = mFinishedCount;
+        mFinished.wait_for(lock, timeout,
+                           [&]{ return mFinishedCount != finished; });
+    }
+    return mRunning > 0 || NextJob().has_value();
+}
+
+void ExportBatch::Cancel()
+{
+    if (!mStopped) {
+        mCancelled = true;
+    }
+}
+
+void ExportBatch::Stop()
+{
+    if (!mCancelled) {
+        mStopped = true;
+    }
+}
+
+bool ExportBatch::IsCancelled() const
+{
+    return mCancelled;
+}
+
+bool ExportBatch::IsStopped() const
+{
+    return mStopped;
+}
+
+double ExportBatch::GetProgress() const
+{
+    if (mJobs.empty()) {
+        return 1.0;
+    }
+    double sum = 0;
+    std::lock_guard<std::mutex> lock{ mMutex };
+    for (const auto& job : mJobs) {
+        if (job.finished) {
+            sum += 1.0;
+        } else if (job.started) {
+            sum += job.delegate->GetProgress();
+        }
+    }
+    return sum / mJobs.size();
+}
+
+size_t ExportBatch::GetFinishedCount() const
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return mFinishedCount;
+}
+
+TranslatableString ExportBatch::GetStatus() const
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    for (const auto& job : mJobs) {
+        if (job.started && !job.finished) {
+            return job.delegate->GetStatus();
+        }
+    }
+    return {};
+}
+
+auto ExportBatch::GetOutcome(size_t index) const -> const Outcome&
+{
+    assert(index < mJobs.size());
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return mJobs[index].outcome;
+}
+
+std::optional<size_t> ExportBatch::NextJob() const
+{
+    if (mHalted || mCancelled || mStopped || mRunning >= mLimits.maxJobs) {
+        return {};
+    }
+    const auto begin = mJobs.begin(), end = mJobs.end();
+    // Prefer a job reading what is read already, which costs no more storage
+    // bandwidth, and finds the blocks decoded by the other jobs
+    auto found = std::find_if(begin, end, [this](const Job& job) {
+        return !job.started && !job.source.empty()
+               && mSources.count(job.source) > 0;
+    });
+    if (found == end && mSources.size() + mUnshared < mLimits.maxSources) {
+        found = std::find_if(begin, end,
+                             [](const Job& job) { return !job.started; });
+    }
+    if (found == end) {
+        return {};
+    }
+    return std::distance(begin, found);
+}
+
+void ExportBatch::Start(size_t index)
+{
+    auto& job = mJobs[index];
+    try {
+        job.task = job.factory();
+    }
+    catch (...) {
+        Finish(index, ExportResult::Error, std::current_exception());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mQueue.push_back(index);
+    }
+    mReady.notify_one();
+}
+
+void ExportBatch::Finish(
+    size_t index, ExportResult result, std::exception_ptr exception)
+{
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        auto& job = mJobs[index];
+        job.outcome = { result, exception };
+        job.finished = true;
+        --mRunning;
+        if (job.source.empty()) {
+            --mUnshared;
+        } else if (--mSources[job.source] == 0) {
+            mSources.erase(job.source);
+        }
+        ++mFinishedCount;
+        if (result == ExportResult::Error) {
+            mHalted = true;
+        }
+    }
+    mFinished.notify_all();
+}
+
+void ExportBatch::Run()
+{
+    while (true) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock{ mMutex };
+            mReady.wait(lock, [this]{ return mExiting || !mQueue.empty(); });
+            if (mQueue.empty()) {
+                return;
+            }
+            index = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        auto& job = mJobs[index];
+        auto future = job.task.get_future();
+        job.task(*job.delegate);
+        // Release the processor, closing its files, before reporting
+        job.task = {};
+        try {
+            Finish(index, future.get(), nullptr);
+        }
+        catch (...) {
+            Finish(index, ExportResult::Error, std::current_exception());
+        }
+    }
+}
@@ -0,0 +1,154 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ExportBatch.h
+  @brief Runs independent export tasks concurrently
+
+**********************************************************************/
+#pragma once
+
+#include "ExportPlugin.h"
+#include "ExportTypes.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//! Schedules export jobs, such as the files of "export multiple", on a fixed
+//! set of worker threads
+/*!
+ Each job is built in the thread that calls Poll(), only when there is room
+ to run it, so that a factory may change selection state before it builds its
+ task with ExportTaskBuilder, and so that only the running jobs hold open
+ files and mixers.
+
+ Concurrency is bounded by the number of jobs, for the processors, and by the
+ number of distinct sources read at once, for the storage.  Jobs with the
+ same source key, such as one track exported in several formats, are started
+ together, so that the blocks one of them decodes are found in the sample
+ block cache by the others.
+
+ After a job fails, no other job starts; those running run to their end.
+ Cancel() and Stop() are passed to the running jobs through their
+ ExportProcessorDelegate and also keep the remaining jobs from starting.
+ */
+class IMPORT_EXPORT_API ExportBatch final
+{
+public:
+    //! Builds the task of one job; called by Poll()
+    using Factory = std::function<ExportTask()>;
+    //! Identifies what a job reads, such as a track and a time range; jobs
+    //! with an empty key share nothing
+    using SourceKey = std::string;
+
+    struct IMPORT_EXPORT_API Limits final {
+        //! The hardware concurrency, at least 1
+        static size_t DefaultMaxJobs();
+
+        //! Jobs running at once
+        size_t maxJobs{ DefaultMaxJobs() };
+        //! Distinct sources read at once, however many jobs share each one
+        size_t maxSources{ 4 };
+    };
+
+    struct Outcome final {
+        //! Empty if the job did not start
+        std::optional<ExportResult> result;
+        //! What the factory or the task threw, if anything; the result is
+        //! then ExportResult::Error
+        std::exception_ptr exception;
+    };
+
+    ExportBatch();
+    explicit ExportBatch(Limits limits);
+    ExportBatch(const ExportBatch&) = delete;
+    ExportBatch& operator=(const ExportBatch&) = delete;
+    //! Cancels the running jobs and waits for them
+    ~ExportBatch();
+
+    //! @pre Poll() was not yet called
+    void Add(Factory factory, SourceKey source = {});
+
+    size_t GetJobCount() const;
+
+    //! Start the jobs that the limits allow, then wait for one to finish
+    /*!
+     To be called repeatedly from one thread, typically the main thread,
+     which can update the user interface in between.
+
+     @return whether any job is still running or can start
+     */
+    bool Poll(std::chrono::milliseconds timeout);
+
+    //! Cancel the running jobs and start no others
+    void Cancel();
+    //! Stop the running jobs, keeping what they exported, and start no others
+    void Stop();
+
+    bool IsCancelled() const;
+    bool IsStopped() const;
+
+    //! Fraction of all jobs done, counting the progress of those running
+    double GetProgress() const;
+    size_t GetFinishedCount() const;
+    //! Status string of the earliest running job
+    TranslatableString GetStatus() const;
+
+    //! @pre `index < GetJobCount()`
+    const Outcome& GetOutcome(size_t index) const;
+
+private:
+    class JobDelegate;
+    struct Job {
+        Factory factory;
+        SourceKey source;
+        ExportTask task;
+        std::unique_ptr<JobDelegate> delegate;
+        Outcome outcome;
+        bool started{ false };
+        bool finished{ false };
+    };
+
+    //! Find a job that may start now
+    /*! @pre mMutex is locked */
+    std::optional<size_t> NextJob() const;
+    void Start(size_t index);
+    void Finish(size_t index, ExportResult result, std::exception_ptr exception);
+    void Run();
+
+    const Limits mLimits;
+    std::vector<Job> mJobs;
+
+    mutable std::mutex mMutex;
+    //! Wakes the workers
+    std::condition_variable mReady;
+    //! Wakes Poll()
+    std::condition_variable mFinished;
+    //! Jobs built and waiting for a worker
+    std::deque<size_t> mQueue;
+    //! Started jobs not yet finished, for each source read
+    std::unordered_map<SourceKey, size_t> mSources;
+    //! Started jobs not yet finished, that have an empty source key
+    size_t mUnshared{ 0 };
+    size_t mRunning{ 0 };
+    size_t mFinishedCount{ 0 };
+    //! Set after a failure, to start no more jobs
+    bool mHalted{ false };
+    bool mExiting{ false };
+    std::atomic<bool> mCancelled{ false };
+    std::atomic<bool> mStopped{ false };
+
+    std::vector<std::thread> mWorkers;
+};
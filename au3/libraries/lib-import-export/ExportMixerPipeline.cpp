@@ -0,0 +1,167 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ExportMixerPipeline.cpp
+
+**********************************************************************/
+#include "ExportMixerPipeline.h"
+
+#include "Mix.h"
+
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace {
+ExportMixerPipeline::Source MixerSource(
+    Mixer& mixer, unsigned numChannels, bool interleaved, sampleFormat format)
+{
+    return [&mixer, numChannels, interleaved, format](
+        samplePtr const* buffers, double& time) -> size_t
+    {
+        const auto samples = mixer.Process();
+        time = mixer.MixGetCurrentTime();
+        if (interleaved) {
+            memcpy(buffers[0], mixer.GetBuffer(),
+                   samples * numChannels * SAMPLE_SIZE(format));
+        } else {
+            for (unsigned ii = 0; ii < numChannels; ++ii) {
+                memcpy(buffers[ii], mixer.GetBuffer(ii),
+                       samples * SAMPLE_SIZE(format));
+            }
+        }
+        return samples;
+    };
+}
+}
+
+template<typename Predicate>
+void ExportMixerPipeline::Wait(const Predicate& predicate)
+{
+    if (predicate()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock{ mMutex };
+    // Sequential consistency orders this increment and the predicate with
+    // the store and the load of mSleepers in Notify(), so that either the
+    // predicate sees the change, or Notify() sees the sleeper
+    ++mSleepers;
+    mCondition.wait(lock, predicate);
+    --mSleepers;
+}
+
+void ExportMixerPipeline::Notify()
+{
+    if (mSleepers.load() > 0) {
+        // Lock, so that a sleeper can't miss the notification between testing
+        // the predicate and waiting
+        { std::lock_guard<std::mutex> lock{ mMutex }; }
+        mCondition.notify_all();
+    }
+}
+
+ExportMixerPipeline::ExportMixerPipeline(
+    Source source, size_t nBuffers, size_t bufferSize, sampleFormat format,
+    size_t depth)
+    : mSource{std::move(source)}
+    , mBlocks(depth)
+{
+    assert(depth > 0);
+    for (auto& block : mBlocks) {
+        for (size_t ii = 0; ii < nBuffers; ++ii) {
+            block.buffers.emplace_back(bufferSize, format);
+            block.pointers.push_back(block.buffers.back().ptr());
+        }
+    }
+    // Start only when the blocks are allocated
+    mThread = std::thread{ [this]{ Run(); } };
+}
+
+ExportMixerPipeline::ExportMixerPipeline(
+    Mixer& mixer, unsigned numChannels, bool interleaved, sampleFormat format,
+    size_t depth)
+    : ExportMixerPipeline{
+        MixerSource(mixer, numChannels, interleaved, format),
+        interleaved ? 1 : numChannels,
+        (interleaved ? numChannels : 1) * mixer.BufferSize(), format, depth }
+{
+}
+
+ExportMixerPipeline::~ExportMixerPipeline()
+{
+    mStopping.store(true);
+    Notify();
+    mThread.join();
+}
+
+size_t ExportMixerPipeline::Process()
+{
+    if (mHolding) {
+        // Give the block back to the producer
+        mHolding = false;
+        mRead.store(mRead.load(std::memory_order_relaxed) + 1);
+        Notify();
+    }
+
+    const auto read = mRead.load(std::memory_order_relaxed);
+    Wait([&]{ return mWritten.load() > read || mFinished.load(); });
+    // If the producer finished, then this load sees its last block
+    if (mWritten.load() > read) {
+        mpCurrent = &mBlocks[read % mBlocks.size()];
+        mHolding = true;
+        mTime = mpCurrent->time;
+        return mpCurrent->samples;
+    }
+
+    // Report the failure once, after all blocks mixed before it
+    if (auto pException = std::exchange(mException, nullptr)) {
+        std::rethrow_exception(pException);
+    }
+    return 0;
+}
+
+constSamplePtr ExportMixerPipeline::GetBuffer() const
+{
+    return GetBuffer(0);
+}
+
+constSamplePtr ExportMixerPipeline::GetBuffer(int channel) const
+{
+    assert(mHolding);
+    assert(channel >= 0 && channel < mpCurrent->pointers.size());
+    return mpCurrent->pointers[channel];
+}
+
+double ExportMixerPipeline::MixGetCurrentTime() const
+{
+    return mTime;
+}
+
+void ExportMixerPipeline::Run()
+{
+    try {
+        while (true) {
+            const auto written = mWritten.load(std::memory_order_relaxed);
+            Wait([&]{
+                return mStopping.load() || written - mRead.load() < mBlocks.size();
+            });
+            if (mStopping.load()) {
+                break;
+            }
+            auto& block = mBlocks[written % mBlocks.size()];
+            block.samples = mSource(block.pointers.data(), block.time);
+            if (block.samples == 0) {
+                break;
+            }
+            mWritten.store(written + 1);
+            Notify();
+        }
+    }
+    catch (...) {
+        mException = std::current_exception();
+    }
+    mFinished.store(true);
+    Notify();
+}
@@ -0,0 +1,127 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ExportMixerPipeline.h
+  @brief Mixes on a thread of its own, some blocks ahead of an encoder
+
+**********************************************************************/
+#pragma once
+
+#include "SampleFormat.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Mixer;
+
+//! Decouples mixing from encoding in ExportProcessor::Process
+/*!
+ A producer thread runs the mixer and copies each result into one block of a
+ bounded ring.  The encoding thread takes the blocks in order through an
+ interface like that of Mixer, so that mixing of the next blocks overlaps the
+ encoding of this one.
+
+ The ring indices are atomic; a mutex is taken only to sleep while the ring is
+ full or empty, and to wake the other side.
+
+ An exception from the mixer is rethrown by Process() in the encoding thread,
+ after the blocks mixed before it.  Destroying the pipeline early, as when the
+ export is cancelled, stops the producer.
+ */
+class IMPORT_EXPORT_API ExportMixerPipeline final
+{
+public:
+    //! Blocks mixed ahead of the one being encoded, at most
+    static constexpr size_t DefaultDepth = 8;
+
+    //! Fills buffers, and sets the time of the end of the samples
+    /*!
+     @return the number of samples in each buffer, or 0 when there are no
+     more
+     */
+    using Source = std::function<size_t(samplePtr const* buffers, double& time)>;
+
+    /*!
+     @param bufferSize capacity of each buffer, in samples
+     @pre `depth > 0`
+     */
+    ExportMixerPipeline(Source source, size_t nBuffers, size_t bufferSize, sampleFormat format, size_t depth = DefaultDepth);
+
+    //! Takes blocks from a mixer, which must outlive the pipeline
+    /*!
+     @param numChannels, interleaved, format as given to the mixer
+     */
+    ExportMixerPipeline(Mixer& mixer, unsigned numChannels, bool interleaved, sampleFormat format, size_t depth = DefaultDepth);
+
+    ExportMixerPipeline(const ExportMixerPipeline&) = delete;
+    ExportMixerPipeline& operator=(const ExportMixerPipeline&) = delete;
+
+    //! Stops the producer, abandoning blocks not yet taken
+    ~ExportMixerPipeline();
+
+    //! Wait for the next block, releasing the previous one
+    /*!
+     @return number of samples in each buffer of the block, or 0 when there
+     are no more
+     */
+    size_t Process();
+
+    //! The first buffer of the block that Process() took; the interleaved one
+    //! if the mixer interleaves
+    /*! The block may be modified until the next Process() */
+    constSamplePtr GetBuffer() const;
+
+    //! One of the buffers of the block that Process() took
+    constSamplePtr GetBuffer(int channel) const;
+
+    //! Mixer time at the end of the block that Process() took
+    double MixGetCurrentTime() const;
+
+private:
+    struct Block {
+        std::vector<SampleBuffer> buffers;
+        std::vector<samplePtr> pointers;
+        size_t samples{ 0 };
+        double time{ 0 };
+    };
+
+    void Run();
+
+    //! Sleep until the predicate holds
+    template<typename Predicate> void Wait(const Predicate& predicate);
+    //! Wake the other thread, if it sleeps
+    void Notify();
+
+    const Source mSource;
+    std::vector<Block> mBlocks;
+
+    //! Blocks completed by the producer
+    std::atomic<size_t> mWritten{ 0 };
+    //! Blocks released by the consumer
+    std::atomic<size_t> mRead{ 0 };
+    //! Set by the producer after its last block, or on failure
+    std::atomic<bool> mFinished{ false };
+    std::atomic<bool> mStopping{ false };
+    //! Written before mFinished
+    std::exception_ptr mException;
+
+    //! The block held by the consumer; meaningful when mHolding
+    const Block* mpCurrent{ nullptr };
+    bool mHolding{ false };
+    double mTime{ 0 };
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    //! Threads in Wait(); when there are none, Notify() takes no lock
+    std::atomic<int> mSleepers{ 0 };
+
+    //! Started when the blocks are allocated
+    std::thread mThread;
+};
@@ -15,6 +15,7 @@
 #include "Mix.h"
 #include "WaveTrack.h"
 #include "MixAndRender.h"
+#include "ExportMixerPipeline.h"
 #include "ExportUtils.h"
 #include "ExportPlugin.h"
 #include "StretchingSequence.h"
@@ -47,19 +48,18 @@ std::unique_ptr<Mixer> ExportPluginHelpers::CreateMixer(
 }
 
 namespace {
-double EvalExportProgress(Mixer& mixer, double t0, double t1)
+double EvalExportProgress(double time, double t0, double t1)
 {
     const auto duration = t1 - t0;
     if (duration > 0) {
-        return std::clamp(mixer.MixGetCurrentTime() - t0, .0, duration) / duration;
+        return std::clamp(time - t0, .0, duration) / duration;
     }
     return .0;
 }
-}
 
-ExportResult ExportPluginHelpers::UpdateProgress(ExportProcessorDelegate& delegate, Mixer& mixer, double t0, double t1)
+ExportResult UpdateProgressAt(ExportProcessorDelegate& delegate, double time, double t0, double t1)
 {
-    delegate.OnProgress(EvalExportProgress(mixer, t0, t1));
+    delegate.OnProgress(EvalExportProgress(time, t0, t1));
     if (delegate.IsStopped()) {
         return ExportResult::Stopped;
     }
@@ -68,3 +68,14 @@ ExportResult ExportPluginHelpers::UpdateProgress(ExportProcessorDelegate& delega
     }
     return ExportResult::Success;
 }
+}
+
+ExportResult ExportPluginHelpers::UpdateProgress(ExportProcessorDelegate& delegate, Mixer& mixer, double t0, double t1)
+{
+    return UpdateProgressAt(delegate, mixer.MixGetCurrentTime(), t0, t1);
+}
+
+ExportResult ExportPluginHelpers::UpdateProgress(ExportProcessorDelegate& delegate, const ExportMixerPipeline& pipeline, double t0, double t1)
+{
+    return UpdateProgressAt(delegate, pipeline.MixGetCurrentTime(), t0, t1);
+}
@@ -21,6 +21,7 @@
 class TrackList;
 class WaveTrack;
 class Mixer;
+class ExportMixerPipeline;
 
 namespace MixerOptions {
 class Downmix;
@@ -38,6 +39,9 @@ public:
     ///Typically used inside each export iteration.
     static ExportResult UpdateProgress(ExportProcessorDelegate& delegate, Mixer& mixer, double t0, double t1);
 
+    ///\brief Like the above, for the block that the pipeline gave to the encoder
+    static ExportResult UpdateProgress(ExportProcessorDelegate& delegate, const ExportMixerPipeline& pipeline, double t0, double t1);
+
     template<typename T>
     static T GetParameterValue(const ExportProcessor::Parameters& parameters, int id, T defaultValue = T())
     {
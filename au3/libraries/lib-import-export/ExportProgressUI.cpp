@@ -11,12 +11,28 @@
 #include "ExportProgressUI.h"
 
 #include "Export.h"
+#include "ExportBatch.h"
 #include "ExportPlugin.h"
 #include "Internat.h"
 #include "BasicUI.h"
 #include "FileException.h"
 
 namespace {
+BasicUI::ProgressResult PollDialog(
+    std::unique_ptr<BasicUI::ProgressDialog>& progressDialog,
+    const TranslatableString& status, double progress)
+{
+    constexpr long long ProgressSteps = 1000ul;
+
+    if (!progressDialog) {
+        progressDialog = BasicUI::MakeProgress(XO("Export"), status);
+    } else {
+        progressDialog->SetMessage(status);
+    }
+
+    return progressDialog->Poll(progress * ProgressSteps, ProgressSteps);
+}
+
 class DialogExportProgressDelegate : public ExportProcessorDelegate
 {
     std::atomic<bool> mCancelled { false };
@@ -50,15 +66,7 @@ public:
 
     void UpdateUI()
     {
-        constexpr long long ProgressSteps = 1000ul;
-
-        if (!mProgressDialog) {
-            mProgressDialog = BasicUI::MakeProgress(XO("Export"), mStatus);
-        } else {
-            mProgressDialog->SetMessage(mStatus);
-        }
-
-        const auto result = mProgressDialog->Poll(mProgress * ProgressSteps, ProgressSteps);
+        const auto result = PollDialog(mProgressDialog, mStatus, mProgress);
 
         if (result == BasicUI::ProgressResult::Cancelled) {
             if (!mStopped) {
@@ -96,3 +104,40 @@ ExportResult ExportProgressUI::Show(ExportTask exportTask)
 
     return result;
 }
+
+ExportResult ExportProgressUI::Show(ExportBatch& batch)
+{
+    std::unique_ptr<BasicUI::ProgressDialog> progressDialog;
+    while (batch.Poll(std::chrono::milliseconds(50))) {
+        const auto result
+            =PollDialog(progressDialog, batch.GetStatus(), batch.GetProgress());
+        if (result == BasicUI::ProgressResult::Cancelled) {
+            batch.Cancel();
+        } else if (result == BasicUI::ProgressResult::Stopped) {
+            batch.Stop();
+        }
+    }
+    progressDialog.reset();
+
+    auto result = ExportResult::Success;
+    for (size_t ii = 0; ii < batch.GetJobCount(); ++ii) {
+        const auto& outcome = batch.GetOutcome(ii);
+        if (outcome.exception) {
+            ExceptionWrappedCall([&]{ std::rethrow_exception(outcome.exception); });
+        }
+        if (outcome.result == ExportResult::Error) {
+            result = ExportResult::Error;
+        }
+    }
+    if (result == ExportResult::Error) {
+        BasicUI::ShowErrorDialog(
+            {}, XO("Export error"),
+            XO("Export completed with error."), {},
+            BasicUI::ErrorDialogOptions { BasicUI::ErrorDialogType::ModalError });
+    } else if (batch.IsCancelled()) {
+        result = ExportResult::Cancelled;
+    } else if (batch.IsStopped()) {
+        result = ExportResult::Stopped;
+    }
+    return result;
+}
@@ -18,12 +18,22 @@
 #include "ExportPlugin.h"
 #include "wxFileNameWrapper.h"
 
+class ExportBatch;
 class ExportProcessorDelegate;
 class Exporter;
 
 namespace ExportProgressUI {
 IMPORT_EXPORT_API ExportResult Show(ExportTask exportTask);
 
+//! Runs all jobs of the batch under one progress dialog
+/*!
+ Errors of the jobs are reported after all have finished, as Show does for
+ one task.  Outcomes of the single jobs remain available from the batch.
+ @return Error if any job failed, else Cancelled or Stopped if the user did
+ so, else Success
+ */
+IMPORT_EXPORT_API ExportResult Show(ExportBatch& batch);
+
 template<typename Callable>
 void ExceptionWrappedCall(Callable callable)
 {
@@ -0,0 +1,232 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ImportPipeline.cpp
+
+**********************************************************************/
+#include "ImportPipeline.h"
+
+#include "Dither.h"
+#include "MemoryX.h"
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace {
+struct Chunk final {
+    size_t index{ 0 };
+    size_t frames{ 0 };
+    std::vector<std::shared_ptr<SampleBlock> > blocks;
+    bool ready{ false };
+};
+
+//! State shared by the decoding threads and the consumer, guarded by mutex
+struct Shared final {
+    std::mutex mutex;
+    //! Wakes the consumer
+    std::condition_variable decoded;
+    //! Wakes the decoders
+    std::condition_variable consumed;
+    std::vector<Chunk> ring;
+    size_t nextClaim{ 0 };
+    size_t nextConsume{ 0 };
+    //! Chunks at and past this one are not read
+    size_t end{ std::numeric_limits<size_t>::max() };
+    std::exception_ptr exception;
+    size_t failedChunk{ 0 };
+    bool stopping{ false };
+};
+}
+
+ImportPipeline::Reader::~Reader() = default;
+
+size_t ImportPipeline::DefaultNumReaders(sampleCount numChunks)
+{
+    // More readers than this only compete for the storage
+    constexpr size_t MaxReaders = 8;
+    const size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+    const auto readers = std::min(hardware, MaxReaders);
+    if (numChunks < sampleCount{ readers }) {
+        return std::max<size_t>(1, numChunks.as_size_t());
+    }
+    return readers;
+}
+
+ImportPipeline::ImportPipeline(
+    ReaderFactory readerFactory, BlockBuilder builder, Options options)
+    : mReaderFactory{std::move(readerFactory)}
+    , mBuilder{std::move(builder)}
+    , mOptions{options}
+{
+    assert(mOptions.numChannels > 0);
+    assert(mOptions.chunkFrames > 0);
+    assert(mOptions.numReaders > 0);
+    // Widening needs no dither
+    assert(mOptions.storedFormat >= mOptions.readFormat);
+}
+
+ImportPipeline::~ImportPipeline() = default;
+
+sampleCount ImportPipeline::Run(const Consumer& consumer)
+{
+    std::vector<std::unique_ptr<Reader> > readers;
+    while (readers.size() < mOptions.numReaders) {
+        auto pReader = mReaderFactory();
+        if (!pReader) {
+            break;
+        }
+        readers.push_back(std::move(pReader));
+    }
+    assert(!readers.empty());
+    if (readers.empty()) {
+        return 0;
+    }
+
+    const auto numChannels = mOptions.numChannels;
+    const auto chunkFrames = mOptions.chunkFrames;
+    const auto readFormat = mOptions.readFormat;
+    const auto storedFormat = mOptions.storedFormat;
+    // A single reader reads on to the end, however long the file turns out
+    const bool bounded = readers.size() > 1;
+    const auto totalFrames = mOptions.totalFrames;
+
+    Shared shared;
+    shared.ring.resize(
+        mOptions.depth > 0 ? std::max(mOptions.depth, readers.size())
+        : 2 * readers.size());
+    const auto depth = shared.ring.size();
+    if (bounded) {
+        shared.end
+            =((totalFrames + chunkFrames - 1) / chunkFrames).as_size_t();
+    }
+
+    const auto decode = [&](Reader& reader) {
+        // Readers start at the beginning of the file
+        sampleCount position = 0;
+        SampleBuffer interleaved(chunkFrames * numChannels, readFormat);
+        SampleBuffer channel(chunkFrames, storedFormat);
+
+        std::unique_lock<std::mutex> lock{ shared.mutex };
+        while (true) {
+            shared.consumed.wait(lock, [&]{
+                return shared.stopping || shared.nextClaim >= shared.end
+                       || shared.nextClaim < shared.nextConsume + depth;
+            });
+            if (shared.stopping || shared.nextClaim >= shared.end) {
+                return;
+            }
+            const auto index = shared.nextClaim++;
+            lock.unlock();
+
+            Chunk chunk;
+            chunk.index = index;
+            try {
+                const sampleCount start = sampleCount{ index } *chunkFrames;
+                if (position != start) {
+                    reader.Seek(start);
+                }
+                auto toRead = chunkFrames;
+                if (bounded) {
+                    toRead = limitSampleBufferSize(toRead, totalFrames - start);
+                }
+                chunk.frames = std::min(toRead,
+                                        reader.Read(interleaved.ptr(), toRead));
+                position = start + chunk.frames;
+
+                if (chunk.frames > 0) {
+                    chunk.blocks.resize(numChannels);
+                    for (unsigned ii = 0; ii < numChannels; ++ii) {
+                        // Split and widen in one pass
+                        CopySamples(
+                            interleaved.ptr() + ii * SAMPLE_SIZE(readFormat),
+                            readFormat, channel.ptr(), storedFormat, chunk.frames,
+                            DitherType::none, numChannels);
+                        chunk.blocks[ii]
+                            =mBuilder(ii, start, channel.ptr(), chunk.frames);
+                    }
+                }
+            }
+            catch (...) {
+                lock.lock();
+                if (!shared.exception || index < shared.failedChunk) {
+                    shared.exception = std::current_exception();
+                    shared.failedChunk = index;
+                }
+                shared.end = std::min(shared.end, index);
+                shared.decoded.notify_all();
+                shared.consumed.notify_all();
+                return;
+            }
+
+            lock.lock();
+            if (chunk.frames < chunkFrames) {
+                // The end of the file, or of what can be read of it
+                shared.end = std::min(shared.end, index + 1);
+                shared.consumed.notify_all();
+            }
+            chunk.ready = true;
+            shared.ring[index % depth] = std::move(chunk);
+            shared.decoded.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    auto cleanup = finally([&]{
+        {
+            std::lock_guard<std::mutex> lock{ shared.mutex };
+            shared.stopping = true;
+        }
+        shared.consumed.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    });
+    for (auto& pReader : readers) {
+        threads.emplace_back([&decode, &reader = *pReader]{ decode(reader); });
+    }
+
+    sampleCount framesConsumed = 0;
+    while (true) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock{ shared.mutex };
+            const auto index = shared.nextConsume;
+            auto& slot = shared.ring[index % depth];
+            const auto failed = [&]{
+                return shared.exception && shared.failedChunk == index;
+            };
+            shared.decoded.wait(lock, [&]{
+                return (slot.ready && slot.index == index) || failed()
+                       || index >= shared.end;
+            });
+            if (slot.ready && slot.index == index) {
+                chunk = std::move(slot);
+                slot = {};
+                ++shared.nextConsume;
+            } else if (failed()) {
+                // Report the failure after all chunks before it
+                std::rethrow_exception(shared.exception);
+            } else {
+                break;
+            }
+        }
+        shared.consumed.notify_all();
+
+        if (chunk.frames == 0) {
+            break;
+        }
+        framesConsumed += chunk.frames;
+        if (!consumer(chunk.blocks, chunk.frames)) {
+            break;
+        }
+    }
+
+    return framesConsumed;
+}
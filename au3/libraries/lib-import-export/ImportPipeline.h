@@ -0,0 +1,112 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file ImportPipeline.h
+  @brief Decodes a file on several threads into sample blocks
+
+**********************************************************************/
+#pragma once
+
+#include "SampleCount.h"
+#include "SampleFormat.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+class SampleBlock;
+
+//! Overlaps decoding, channel splitting and block building of an import
+/*!
+ The file is divided into chunks of a fixed number of frames, each of which
+ becomes one sample block per channel.  Decoding threads, each with a reader
+ of its own, claim the chunks in order, so that together they read adjacent
+ ranges of the file.  Each thread decodes its chunk, splits the channels,
+ converting them to the stored format, and builds the blocks, which the block
+ factory then summarizes and inserts on its own threads.  The thread that
+ calls Run() receives the blocks in order and appends them to the tracks.
+
+ A bounded number of chunks is decoded ahead of the one being appended.
+
+ An exception from a reader or from building a block is rethrown by Run(),
+ after the chunks before it were consumed.
+ */
+class IMPORT_EXPORT_API ImportPipeline final
+{
+public:
+    //! Reads interleaved frames from one position in a file
+    class IMPORT_EXPORT_API Reader
+    {
+    public:
+        virtual ~Reader();
+
+        //! Move to a frame of the file; called only before reading elsewhere
+        //! than after the previous read
+        virtual void Seek(sampleCount frame) = 0;
+        //! @return number of frames read, less than `frames` only at the end
+        virtual size_t Read(samplePtr buffer, size_t frames) = 0;
+    };
+
+    //! @return a reader at the start of the file, or null if no more can be
+    //! opened
+    using ReaderFactory = std::function<std::unique_ptr<Reader>()>;
+
+    //! Makes a block of one channel, from samples in the stored format;
+    //! called on the decoding threads
+    /*!
+     @param start the frame of the file where the samples start
+     */
+    using BlockBuilder = std::function<std::shared_ptr<SampleBlock>(
+                                           unsigned channel, sampleCount start, constSamplePtr samples, size_t frames)>;
+
+    //! Takes the blocks of one chunk, one for each channel, in order
+    /*!
+     @return false to stop the import
+     */
+    using Consumer = std::function<bool(
+                                       const std::vector<std::shared_ptr<SampleBlock> >& blocks, size_t frames)>;
+
+    struct Options final {
+        unsigned numChannels{ 1 };
+        //! Format delivered by the readers
+        sampleFormat readFormat{ floatSample };
+        //! Format of the blocks, at least as wide as the read format
+        sampleFormat storedFormat{ floatSample };
+        //! Frames in each chunk, and so in each block
+        size_t chunkFrames{ 0 };
+        //! Number of frames in the file, used when there is more than one
+        //! reader; with one reader, the chunks are read until the end
+        sampleCount totalFrames{ 0 };
+        //! Decoding threads, each with its own reader; the readers must be
+        //! able to seek when there is more than one
+        size_t numReaders{ 1 };
+        //! Chunks decoded ahead of the one consumed, at most; 0 for twice
+        //! the number of readers
+        size_t depth{ 0 };
+    };
+
+    //! Number of decoding threads that a file of this many chunks can use
+    static size_t DefaultNumReaders(sampleCount numChunks);
+
+    ImportPipeline(ReaderFactory readerFactory, BlockBuilder builder, Options options);
+    ImportPipeline(const ImportPipeline&) = delete;
+    ImportPipeline& operator=(const ImportPipeline&) = delete;
+    ~ImportPipeline();
+
+    //! Decode the file, passing each chunk to the consumer
+    /*!
+     Opens the readers on this thread; if fewer than `numReaders` can be
+     opened, decodes with those that can.
+
+     @pre the factory makes at least one reader
+     @return frames consumed
+     */
+    sampleCount Run(const Consumer& consumer);
+
+private:
+    const ReaderFactory mReaderFactory;
+    const BlockBuilder mBuilder;
+    const Options mOptions;
+};
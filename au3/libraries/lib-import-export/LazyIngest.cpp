@@ -0,0 +1,744 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file LazyIngest.cpp
+
+**********************************************************************/
+#include "LazyIngest.h"
+
+#include "BasicUI.h"
+#include "Dither.h"
+#include "FileException.h"
+#include "Prefs.h"
+#include "XMLWriter.h"
+
+#include <wx/filename.h>
+#include <wx/log.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <set>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+BoolSetting LazyImport{ L"/FileFormats/LazyImport", true };
+
+namespace {
+constexpr auto AliasFile_attr = "aliasfile";
+constexpr auto AliasStart_attr = "aliasstart";
+constexpr auto AliasLen_attr = "aliaslen";
+constexpr auto AliasChannel_attr = "aliaschannel";
+
+constexpr size_t SummaryFactor = 256;
+
+//! Ingestion should not take time from playback or from the user interface
+void LowerPriorityOfThisThread()
+{
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+    // Niceness is per thread on Linux
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+//! Negative, as are the ids of silent blocks, but distinct from those, which
+//! are minus their lengths
+SampleBlockID NewPseudoID()
+{
+    static std::atomic<SampleBlockID> next{ -(SampleBlockID { 1 } << 40) };
+    return next--;
+}
+
+//! Combine frames of a summary of 256 samples per frame into frames of
+//! `factor` samples
+/*!
+ @param count number of samples summarized
+ */
+void Combine(const std::vector<float>& summary, size_t count, size_t factor,
+             float* dest, size_t frameoffset, size_t numframes)
+{
+    const auto group = factor / SummaryFactor;
+    const auto frames = summary.size() / 3;
+    for (size_t ii = 0; ii < numframes; ++ii, dest += 3) {
+        const auto first = (frameoffset + ii) * group;
+        if (first >= frames) {
+            std::fill(dest, dest + 3, 0.0f);
+            continue;
+        }
+        const auto last = std::min(first + group, frames);
+        float min = summary[3 * first];
+        float max = summary[3 * first + 1];
+        double sumsq = 0;
+        size_t samples = 0;
+        for (auto jj = first; jj < last; ++jj) {
+            min = std::min(min, summary[3 * jj]);
+            max = std::max(max, summary[3 * jj + 1]);
+            // Only the last frame may be partial
+            const auto n = std::min(SummaryFactor, count - jj * SummaryFactor);
+            const double rms = summary[3 * jj + 2];
+            sumsq += rms * rms * n;
+            samples += n;
+        }
+        dest[0] = min;
+        dest[1] = max;
+        dest[2] = static_cast<float>(std::sqrt(sumsq / samples));
+    }
+}
+
+bool SamePath(const FilePath& path1, const FilePath& path2)
+{
+    return wxFileName{ path1 }.SameAs(wxFileName{ path2 });
+}
+
+//! Every source not yet destroyed
+struct Sources final {
+    std::mutex mutex;
+    std::vector<const LazyIngest::Source*> sources;
+};
+
+Sources& GetSources()
+{
+    static Sources sources;
+    return sources;
+}
+}
+
+//! Reads from the source until ingested, then forwards to a block of the
+//! factory
+class LazyIngest::Block final : public SampleBlock
+{
+public:
+    Block(std::shared_ptr<Source> pSource, SampleBlockFactoryPtr pFactory, sampleFormat format, sampleCount start, size_t frames,
+          unsigned channel)
+        : mpFactory{std::move(pFactory)}
+        , mFormat{format}
+        , mStart{start}
+        , mFrames{frames}
+        , mChannel{channel}
+        , mPseudoID{NewPseudoID()}
+        , mpSource{std::move(pSource)}
+    {
+        assert(mFormat >= mpSource->GetFormat());
+        assert(mChannel < mpSource->GetNumChannels());
+    }
+
+    ~Block() override = default;
+
+    //! Copy into a block of the factory, unless done already
+    /*!
+     @param interleaved all channels of this block's frames of the source
+     */
+    void Ingest(const Source& source, constSamplePtr interleaved)
+    {
+        std::lock_guard<std::mutex> ingestLock{ mIngestMutex };
+        if (IsIngested()) {
+            return;
+        }
+        SampleBuffer samples(mFrames, mFormat);
+        CopySamples(
+            interleaved + mChannel * SAMPLE_SIZE(source.GetFormat()),
+            source.GetFormat(), samples.ptr(), mFormat, mFrames,
+            DitherType::none, source.GetNumChannels());
+        // Not to be undone by the rollback of an edit in progress
+        auto pBlock = mpFactory->CreateDurable(samples.ptr(), mFrames, mFormat);
+
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mpBlock = std::move(pBlock);
+        // Maybe close the file
+        mpSource.reset();
+        mpSummary.reset();
+    }
+
+    bool IsIngested() const
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        return mpBlock != nullptr;
+    }
+
+    void CloseLock() noexcept override
+    {
+        if (const auto pBlock = GetIngested()) {
+            pBlock->CloseLock();
+        }
+    }
+
+    SampleBlockID GetBlockID() const override
+    {
+        if (const auto pBlock = GetIngested()) {
+            return pBlock->GetBlockID();
+        }
+        return mPseudoID;
+    }
+
+    BlockSampleView GetFloatSampleView(bool mayThrow) override
+    {
+        std::shared_ptr<Source> pSource;
+        if (const auto pBlock = GetIngested(&pSource)) {
+            return pBlock->GetFloatSampleView(mayThrow);
+        }
+        auto samples = std::make_shared<std::vector<float> >(mFrames);
+        try {
+            Read(*pSource, reinterpret_cast<samplePtr>(samples->data()),
+                 floatSample, 0, mFrames);
+        }
+        catch (...) {
+            if (mayThrow) {
+                throw;
+            }
+            std::fill(samples->begin(), samples->end(), 0.0f);
+        }
+        return samples;
+    }
+
+    sampleFormat GetSampleFormat() const override { return mFormat; }
+
+    size_t GetSampleCount() const override { return mFrames; }
+
+    bool GetSummary256(
+        float* dest, size_t frameoffset, size_t numframes) override
+    {
+        if (const auto pBlock = GetIngested()) {
+            return pBlock->GetSummary256(dest, frameoffset, numframes);
+        }
+        return GetSummary(SummaryFactor, dest, frameoffset, numframes);
+    }
+
+    bool GetSummary64k(
+        float* dest, size_t frameoffset, size_t numframes) override
+    {
+        if (const auto pBlock = GetIngested()) {
+            return pBlock->GetSummary64k(dest, frameoffset, numframes);
+        }
+        return GetSummary(64 * 1024, dest, frameoffset, numframes);
+    }
+
+    bool GetSummary(size_t factor,
+                    float* dest, size_t frameoffset, size_t numframes) override
+    {
+        std::shared_ptr<Source> pSource;
+        if (const auto pBlock = GetIngested(&pSource)) {
+            return pBlock->GetSummary(factor, dest, frameoffset, numframes);
+        }
+        if (factor < SummaryFactor) {
+            // Computed from the samples
+            return SampleBlock::GetSummary(factor, dest, frameoffset, numframes);
+        }
+        try {
+            Combine(*GetSourceSummary(*pSource), mFrames, factor,
+                    dest, frameoffset, numframes);
+            return true;
+        }
+        catch (...) {
+            std::fill(dest, dest + 3 * numframes, 0.0f);
+            return false;
+        }
+    }
+
+    size_t GetSpaceUsage() const override
+    {
+        if (const auto pBlock = GetIngested()) {
+            return pBlock->GetSpaceUsage();
+        }
+        // Nothing is in the project yet
+        return 0;
+    }
+
+    void SaveXML(XMLWriter& xmlFile) override
+    {
+        std::shared_ptr<Source> pSource;
+        if (const auto pBlock = GetIngested(&pSource)) {
+            return pBlock->SaveXML(xmlFile);
+        }
+        xmlFile.WriteAttr(AliasFile_attr, pSource->GetPath());
+        xmlFile.WriteAttr(AliasStart_attr, mStart.as_long_long());
+        xmlFile.WriteAttr(AliasLen_attr, mFrames);
+        xmlFile.WriteAttr(AliasChannel_attr, static_cast<int>(mChannel));
+    }
+
+protected:
+    size_t DoGetSamples(samplePtr dest, sampleFormat destformat,
+                        size_t sampleoffset, size_t numsamples) override
+    {
+        std::shared_ptr<Source> pSource;
+        if (const auto pBlock = GetIngested(&pSource)) {
+            return pBlock->GetSamples(dest, destformat, sampleoffset, numsamples);
+        }
+        return Read(*pSource, dest, destformat, sampleoffset, numsamples);
+    }
+
+    MinMaxRMS DoGetMinMaxRMS(size_t start, size_t len) override
+    {
+        std::shared_ptr<Source> pSource;
+        if (const auto pBlock = GetIngested(&pSource)) {
+            return pBlock->GetMinMaxRMS(start, len);
+        }
+        if (start >= mFrames || len == 0) {
+            return {};
+        }
+        len = std::min(len, mFrames - start);
+        std::vector<float> samples(len);
+        Read(*pSource, reinterpret_cast<samplePtr>(samples.data()),
+             floatSample, start, len);
+        MinMaxRMS result;
+        result.min = *std::min_element(samples.begin(), samples.end());
+        result.max = *std::max_element(samples.begin(), samples.end());
+        double sumsq = 0;
+        for (const auto sample : samples) {
+            sumsq += double(sample) * sample;
+        }
+        result.RMS = static_cast<float>(std::sqrt(sumsq / len));
+        return result;
+    }
+
+    MinMaxRMS DoGetMinMaxRMS() const override
+    {
+        std::shared_ptr<Source> pSource;
+        if (const auto pBlock = GetIngested(&pSource)) {
+            return pBlock->GetMinMaxRMS();
+        }
+        const auto pSummary = GetSourceSummary(*pSource);
+        float totals[3];
+        // One frame of all
+        Combine(*pSummary, mFrames, pSummary->size() / 3 * SummaryFactor,
+                totals, 0, 1);
+        return { totals[0], totals[1], totals[2] };
+    }
+
+private:
+    //! @return the block of the factory, if ingested; else null, and the
+    //! source, if `ppSource` is not null
+    SampleBlockPtr GetIngested(std::shared_ptr<Source>* ppSource = nullptr) const
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        if (!mpBlock && ppSource) {
+            *ppSource = mpSource;
+        }
+        return mpBlock;
+    }
+
+    //! Read samples of this block's channel from the source, padding with
+    //! zeroes past the end of the block
+    size_t Read(Source& source, samplePtr dest, sampleFormat destformat,
+                size_t sampleoffset, size_t numsamples) const
+    {
+        const auto count = sampleoffset < mFrames
+                           ? std::min(numsamples, mFrames - sampleoffset) : 0;
+        if (count > 0) {
+            SampleBuffer interleaved(
+                count * source.GetNumChannels(), source.GetFormat());
+            if (source.Read(mStart + sampleoffset, interleaved.ptr(), count)
+                < count) {
+                // The file was changed since the import
+                throw FileException{
+                          FileException::Cause::Read, source.GetPath() };
+            }
+            CopySamples(
+                interleaved.ptr() + mChannel * SAMPLE_SIZE(source.GetFormat()),
+                source.GetFormat(), dest, destformat, count,
+                DitherType::none, source.GetNumChannels());
+        }
+        ClearSamples(dest, destformat, count, numsamples - count);
+        return numsamples;
+    }
+
+    //! Summary of 256 samples per frame, computed from the source when first
+    //! needed
+    std::shared_ptr<const std::vector<float> >
+    GetSourceSummary(Source& source) const
+    {
+        {
+            std::lock_guard<std::mutex> lock{ mMutex };
+            if (mpSummary) {
+                return mpSummary;
+            }
+        }
+
+        std::vector<float> samples(mFrames);
+        Read(source, reinterpret_cast<samplePtr>(samples.data()),
+             floatSample, 0, mFrames);
+        const auto frames = (mFrames + SummaryFactor - 1) / SummaryFactor;
+        auto pSummary = std::make_shared<std::vector<float> >(3 * frames);
+        auto dest = pSummary->data();
+        for (size_t first = 0; first < mFrames; first += SummaryFactor, dest += 3) {
+            const auto last = std::min(first + SummaryFactor, mFrames);
+            float min = samples[first];
+            float max = samples[first];
+            double sumsq = 0;
+            for (auto jj = first; jj < last; ++jj) {
+                min = std::min(min, samples[jj]);
+                max = std::max(max, samples[jj]);
+                sumsq += double(samples[jj]) * samples[jj];
+            }
+            dest[0] = min;
+            dest[1] = max;
+            dest[2] = static_cast<float>(std::sqrt(sumsq / (last - first)));
+        }
+
+        std::lock_guard<std::mutex> lock{ mMutex };
+        if (!mpBlock) {
+            mpSummary = pSummary;
+        }
+        return pSummary;
+    }
+
+    const SampleBlockFactoryPtr mpFactory;
+    const sampleFormat mFormat;
+    const sampleCount mStart;
+    const size_t mFrames;
+    const unsigned mChannel;
+    const SampleBlockID mPseudoID;
+
+    //! Serializes ingestion, which takes long
+    std::mutex mIngestMutex;
+    //! Guards the members below, for a short time
+    mutable std::mutex mMutex;
+    //! Until ingested
+    std::shared_ptr<Source> mpSource;
+    mutable std::shared_ptr<const std::vector<float> > mpSummary;
+    //! Once ingested
+    SampleBlockPtr mpBlock;
+};
+
+LazyIngest::Source::Source(FilePath path,
+                           ImportPipeline::ReaderFactory readerFactory, unsigned numChannels, sampleFormat format)
+    : mPath{std::move(path)}
+    , mNumChannels{numChannels}
+    , mFormat{format}
+    , mReaderFactory{std::move(readerFactory)}
+{
+    mForeground.pReader = mReaderFactory();
+    assert(mForeground.pReader);
+    assert(mNumChannels > 0);
+
+    auto& sources = GetSources();
+    std::lock_guard<std::mutex> lock{ sources.mutex };
+    sources.sources.push_back(this);
+}
+
+LazyIngest::Source::~Source()
+{
+    auto& sources = GetSources();
+    std::lock_guard<std::mutex> lock{ sources.mutex };
+    auto& vector = sources.sources;
+    vector.erase(std::find(vector.begin(), vector.end(), this));
+}
+
+size_t LazyIngest::Source::Read(
+    sampleCount start, samplePtr buffer, size_t frames)
+{
+    std::lock_guard<std::mutex> lock{ mForeground.mutex };
+    return Read(mForeground, start, buffer, frames);
+}
+
+size_t LazyIngest::Source::ReadInBackground(
+    sampleCount start, samplePtr buffer, size_t frames)
+{
+    {
+        std::lock_guard<std::mutex> lock{ mBackground.mutex };
+        if (!mBackground.pReader && !mNoBackground) {
+            mBackground.pReader = mReaderFactory();
+            mNoBackground = !mBackground.pReader;
+        }
+        if (mBackground.pReader) {
+            return Read(mBackground, start, buffer, frames);
+        }
+    }
+    // Share the one reader after all
+    return Read(start, buffer, frames);
+}
+
+size_t LazyIngest::Source::Read(
+    Cursor& cursor, sampleCount start, samplePtr buffer, size_t frames)
+{
+    // Unknown until the read succeeds
+    if (std::exchange(cursor.position, -1) != start) {
+        cursor.pReader->Seek(start);
+    }
+    const auto read = cursor.pReader->Read(buffer, frames);
+    cursor.position = start + read;
+    return read;
+}
+
+bool LazyIngest::IsReading(const FilePath& path)
+{
+    auto& sources = GetSources();
+    std::lock_guard<std::mutex> lock{ sources.mutex };
+    return std::any_of(sources.sources.begin(), sources.sources.end(),
+                       [&](const Source* pSource){ return SamePath(pSource->GetPath(), path); });
+}
+
+LazyIngest& LazyIngest::Get()
+{
+    static LazyIngest instance;
+    return instance;
+}
+
+LazyIngest::LazyIngest() = default;
+
+LazyIngest::~LazyIngest()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mStopping = true;
+    }
+    mQueued.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+std::vector<SampleBlockPtr> LazyIngest::MakeBlocks(
+    const std::shared_ptr<Source>& pSource, const SampleBlockFactoryPtr& pFactory, sampleFormat storedFormat, sampleCount start,
+    size_t frames)
+{
+    std::vector<SampleBlockPtr> result;
+    Job job{ pSource, pFactory.get(), start, frames, {} };
+    for (unsigned channel = 0; channel < pSource->GetNumChannels(); ++channel) {
+        auto pBlock = std::make_shared<Block>(
+            pSource, pFactory, storedFormat, start, frames, channel);
+        job.blocks.push_back(pBlock);
+        result.push_back(std::move(pBlock));
+    }
+    Enqueue(std::move(job));
+    return result;
+}
+
+SampleBlockPtr LazyIngest::MakeBlock(
+    const std::shared_ptr<Source>& pSource, const SampleBlockFactoryPtr& pFactory, sampleFormat storedFormat, sampleCount start,
+    size_t frames, unsigned channel)
+{
+    auto pBlock = std::make_shared<Block>(
+        pSource, pFactory, storedFormat, start, frames, channel);
+    Enqueue({ pSource, pFactory.get(), start, frames, { pBlock } });
+    return pBlock;
+}
+
+bool LazyIngest::Finish(const SampleBlockFactory& factory)
+{
+    const auto jobs
+        =TakeJobs([&](const Job& job){ return job.pFactory == &factory; });
+    bool result = true;
+    for (const auto& job : jobs) {
+        if (!Ingest(job)) {
+            result = false;
+        }
+    }
+    return result;
+}
+
+bool LazyIngest::Release(const FilePath& path)
+{
+    {
+        // Destroy the jobs, and with them maybe the sources, before the test
+        const auto jobs = TakeJobs([&](const Job& job){
+            return SamePath(job.pSource->GetPath(), path);
+        });
+        for (const auto& job : jobs) {
+            Ingest(job);
+        }
+    }
+    // Blocks that failed before go on reading from the file
+    return !IsReading(path);
+}
+
+void LazyIngest::Cancel(const SampleBlockFactory& factory)
+{
+    TakeJobs([&](const Job& job){ return job.pFactory == &factory; });
+}
+
+bool LazyIngest::IsPending(const SampleBlockFactory& factory)
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return (mpWorking && mpWorking->pFactory == &factory)
+           || std::any_of(mJobs.begin(), mJobs.end(),
+                          [&](const Job& job){ return job.pFactory == &factory; });
+}
+
+void LazyIngest::Enqueue(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mJobs.push_back(std::move(job));
+        if (!mThread.joinable()) {
+            mThread = std::thread{ [this]{ Work(); } };
+        }
+    }
+    mQueued.notify_one();
+}
+
+template<typename Predicate>
+auto LazyIngest::TakeJobs(const Predicate& predicate) -> std::deque<Job>
+{
+    std::deque<Job> jobs;
+    std::unique_lock<std::mutex> lock{ mMutex };
+    const auto end = std::stable_partition(mJobs.begin(), mJobs.end(),
+                                           [&](const Job& job){ return !predicate(job); });
+    std::move(end, mJobs.end(), std::back_inserter(jobs));
+    mJobs.erase(end, mJobs.end());
+    mDone.wait(lock, [&]{ return !mpWorking || !predicate(*mpWorking); });
+    return jobs;
+}
+
+void LazyIngest::Work()
+{
+    LowerPriorityOfThisThread();
+    std::unique_lock<std::mutex> lock{ mMutex };
+    while (true) {
+        mQueued.wait(lock, [this]{ return mStopping || !mJobs.empty(); });
+        if (mStopping) {
+            return;
+        }
+        const auto job = std::move(mJobs.front());
+        mJobs.pop_front();
+        mpWorking = &job;
+        lock.unlock();
+
+        // A block that fails goes on reading from the file.  Blocks that
+        // were released meanwhile are destroyed here, while Cancel() still
+        // waits for this job
+        Ingest(job);
+
+        lock.lock();
+        mpWorking = nullptr;
+        mDone.notify_all();
+    }
+}
+
+bool LazyIngest::Ingest(const Job& job)
+{
+    std::vector<std::shared_ptr<Block> > blocks;
+    for (const auto& wpBlock : job.blocks) {
+        if (auto pBlock = wpBlock.lock(); pBlock && !pBlock->IsIngested()) {
+            blocks.push_back(std::move(pBlock));
+        }
+    }
+    if (blocks.empty()) {
+        return true;
+    }
+
+    auto& source = *job.pSource;
+    try {
+        SampleBuffer interleaved(
+            job.frames * source.GetNumChannels(), source.GetFormat());
+        if (source.ReadInBackground(job.start, interleaved.ptr(), job.frames)
+            < job.frames) {
+            return false;
+        }
+        for (const auto& pBlock : blocks) {
+            pBlock->Ingest(source, interleaved.ptr());
+        }
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
+
+namespace {
+//! Blocks restored from one document share the reopened files
+std::shared_ptr<LazyIngest::Source> FindSource(
+    const FilePath& path, sampleFormat format)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<FilePath, sampleFormat>,
+                    std::weak_ptr<LazyIngest::Source> > sources;
+    std::lock_guard<std::mutex> lock{ mutex };
+    auto& wpSource = sources[{ path, format }];
+    auto pSource = wpSource.lock();
+    if (!pSource) {
+        pSource = LazyIngest::SourceFactory::Call(path, format);
+        wpSource = pSource;
+    }
+    return pSource;
+}
+
+//! Tell the user, once the document is loaded, of all files that were missing
+void ReportMissing(const FilePath& path)
+{
+    static std::mutex mutex;
+    static std::set<FilePath> missing;
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        if (!missing.insert(path).second) {
+            return;
+        }
+        if (missing.size() > 1) {
+            // Reported with the first
+            return;
+        }
+    }
+    BasicUI::CallAfter([]{
+        std::set<FilePath> paths;
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            paths.swap(missing);
+        }
+        wxString list;
+        for (const auto& path : paths) {
+            list += wxT("\n") + path;
+        }
+        BasicUI::ShowMessageBox(
+            XO("These audio files, imported but not yet copied into the project, are missing; their audio was replaced with silence:\n%s")
+            .Format(list),
+            BasicUI::MessageBoxOptions {}
+            .Caption(XO("Files Missing"))
+            .IconStyle(BasicUI::Icon::Warning));
+    });
+}
+
+SampleBlockFactory::AliasFactory::Scope scope {
+    [](const SampleBlockFactoryPtr& pFactory, sampleFormat srcformat,
+       const AttributesList& attrs) -> SampleBlockPtr
+    {
+        FilePath path;
+        long long start = -1;
+        long long frames = 0;
+        int channel = -1;
+        for (auto& [attr, value] : attrs) {
+            if (attr == AliasFile_attr) {
+                path = value.ToWString();
+            } else if (attr == AliasStart_attr) {
+                value.TryGet(start);
+            } else if (attr == AliasLen_attr) {
+                value.TryGet(frames);
+            } else if (attr == AliasChannel_attr) {
+                value.TryGet(channel);
+            }
+        }
+        if (path.empty()) {
+            return nullptr;
+        }
+        if (start < 0 || frames <= 0 || channel < 0) {
+            // Let the sequence report the error
+            return nullptr;
+        }
+
+        const auto pSource = FindSource(path, srcformat);
+        if (!pSource || static_cast<unsigned>(channel) >= pSource->GetNumChannels()
+            || srcformat < pSource->GetFormat()) {
+            wxLogWarning(wxT("Audio file %s is missing; restoring silence"), path);
+            ReportMissing(path);
+            return pFactory->CreateSilent(frames, srcformat);
+        }
+        return LazyIngest::Get().MakeBlock(
+            pSource, pFactory, srcformat, start, frames, channel);
+    }
+};
+}
@@ -0,0 +1,174 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file LazyIngest.h
+  @brief Sample blocks that read from an imported file until a background
+  thread copies them into the project
+
+**********************************************************************/
+#pragma once
+
+#include "FileNames.h"
+#include "GlobalVariable.h"
+#include "ImportPipeline.h"
+#include "SampleBlock.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class BoolSetting;
+
+//! Whether imports that can read the file at any position make the tracks
+//! at once, and copy the audio into the project afterward
+extern IMPORT_EXPORT_API BoolSetting LazyImport;
+
+//! Copies audio of imported files into the project, on a thread of low
+//! priority, after the tracks that refer to it already exist
+/*!
+ Until its turn comes, each block reads samples and computes summaries from
+ the file.  Then it makes a block of the project's factory and forwards all to
+ that block.  That block is stored outside of any transaction, so that
+ rollback of an edit in progress meanwhile can't lose it.
+
+ A block not yet copied saves a reference to the file, so that an autosaved
+ document can be recovered; the file is reopened by the SourceFactory hook.
+ Finish() copies the rest before a save that must not depend on the file, and
+ Release() before the file is overwritten.
+ */
+class IMPORT_EXPORT_API LazyIngest final
+{
+public:
+    //! An imported file, that any thread may read
+    class IMPORT_EXPORT_API Source final
+    {
+    public:
+        /*!
+         @param readerFactory called at once, and again for the reader of the
+         background thread
+         @param format of the frames that the readers deliver
+         @pre `readerFactory` returns non-null the first time
+         */
+        Source(FilePath path, ImportPipeline::ReaderFactory readerFactory, unsigned numChannels, sampleFormat format);
+        ~Source();
+
+        const FilePath& GetPath() const { return mPath; }
+        unsigned GetNumChannels() const { return mNumChannels; }
+        sampleFormat GetFormat() const { return mFormat; }
+
+        //! Read interleaved frames of all channels
+        /*!
+         @return number of frames read, less than `frames` only at the end
+         */
+        size_t Read(sampleCount start, samplePtr buffer, size_t frames);
+
+        //! Like Read(), but with a reader of its own, so that the thread of
+        //! low priority that copies the blocks never makes other threads wait
+        size_t ReadInBackground(sampleCount start, samplePtr buffer, size_t frames);
+
+    private:
+        struct Cursor {
+            std::mutex mutex;
+            std::unique_ptr<ImportPipeline::Reader> pReader;
+            sampleCount position{ 0 };
+        };
+        //! @pre `cursor.mutex` is locked and `cursor.pReader` is not null
+        static size_t Read(Cursor& cursor, sampleCount start, samplePtr buffer, size_t frames);
+
+        const FilePath mPath;
+        const unsigned mNumChannels;
+        const sampleFormat mFormat;
+        const ImportPipeline::ReaderFactory mReaderFactory;
+        Cursor mForeground;
+        //! Opened when first needed
+        Cursor mBackground;
+        //! Whether the background reader could not be opened
+        bool mNoBackground{ false };
+    };
+
+    //! Opens a file again for blocks restored from a document; it may return
+    //! null
+    /*!
+     @param format in which the blocks were stored; the source may deliver no
+     wider format
+     */
+    struct IMPORT_EXPORT_API SourceFactory : GlobalHook<SourceFactory,
+                                                        std::shared_ptr<Source>(const FilePath& path, sampleFormat format)
+                                                        > {};
+
+    //! Whether any block still reads from the file
+    static bool IsReading(const FilePath& path);
+
+    static LazyIngest& Get();
+
+    //! Blocks of frames of the source, one for each channel, to be copied
+    //! later into blocks of the factory
+    /*!
+     @pre `storedFormat` is at least as wide as the format of the source
+     */
+    std::vector<SampleBlockPtr> MakeBlocks(
+        const std::shared_ptr<Source>& pSource, const SampleBlockFactoryPtr& pFactory, sampleFormat storedFormat, sampleCount start,
+        size_t frames);
+
+    //! Block of frames of one channel of the source, as restored from a
+    //! document
+    SampleBlockPtr MakeBlock(
+        const std::shared_ptr<Source>& pSource, const SampleBlockFactoryPtr& pFactory, sampleFormat storedFormat, sampleCount start,
+        size_t frames, unsigned channel);
+
+    //! Copy now, on this thread, every block for the factory not yet copied
+    /*!
+     @return false if some could not be, as when the file is gone; they go on
+     reading from it
+     */
+    bool Finish(const SampleBlockFactory& factory);
+
+    //! Copy now, on this thread, every block that reads from the file, so
+    //! that it may be overwritten
+    /*!
+     @return false if some block still reads from the file
+     */
+    bool Release(const FilePath& path);
+
+    //! Copy no more blocks for the factory, waiting for any being copied
+    void Cancel(const SampleBlockFactory& factory);
+
+    //! Whether some blocks for the factory are not yet copied
+    bool IsPending(const SampleBlockFactory& factory);
+
+    class Block;
+
+private:
+    //! Blocks of the same frames of a source
+    struct Job final {
+        std::shared_ptr<Source> pSource;
+        const SampleBlockFactory* pFactory{};
+        sampleCount start{ 0 };
+        size_t frames{ 0 };
+        std::vector<std::weak_ptr<Block> > blocks;
+    };
+
+    LazyIngest();
+    ~LazyIngest();
+
+    void Enqueue(Job job);
+    //! Takes the queued jobs that satisfy the predicate, and waits until the
+    //! worker is done with any such job
+    template<typename Predicate>
+    std::deque<Job> TakeJobs(const Predicate& predicate);
+    void Work();
+    //! @return whether all the blocks were copied
+    static bool Ingest(const Job& job);
+
+    std::mutex mMutex;
+    std::condition_variable mQueued;
+    std::condition_variable mDone;
+    std::deque<Job> mJobs;
+    //! Job that the worker does, if any
+    const Job* mpWorking{};
+    bool mStopping{ false };
+    std::thread mThread;
+};
@@ -0,0 +1,145 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ExportBatchTests.cpp
+
+**********************************************************************/
+#include "ExportBatch.h"
+
+#include <catch2/catch.hpp>
+
+#include <map>
+#include <stdexcept>
+
+using namespace std::chrono_literals;
+
+namespace {
+//! Counts the jobs running at once, overall and for each source
+struct Tracker
+{
+    ExportBatch::Factory Job(const std::string& source)
+    {
+        return [this, source]{
+            return ExportTask{ [this, source](ExportProcessorDelegate& delegate) {
+                    Enter(source);
+                    for (int ii = 1; ii <= 4 && !delegate.IsCancelled(); ++ii) {
+                        std::this_thread::sleep_for(2ms);
+                        delegate.OnProgress(ii / 4.0);
+                    }
+                    Leave(source);
+                    return delegate.IsCancelled()
+                           ? ExportResult::Cancelled : ExportResult::Success;
+                } };
+        };
+    }
+
+    void Enter(const std::string& source)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        maxRunning = std::max(maxRunning, ++running);
+        if (++sources[source] == 1) {
+            maxSources = std::max(maxSources, ++activeSources);
+        }
+    }
+
+    void Leave(const std::string& source)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        --running;
+        if (--sources[source] == 0) {
+            --activeSources;
+        }
+    }
+
+    std::mutex mutex;
+    std::map<std::string, size_t> sources;
+    size_t running{ 0 };
+    size_t maxRunning{ 0 };
+    size_t activeSources{ 0 };
+    size_t maxSources{ 0 };
+};
+
+void RunToEnd(ExportBatch& batch)
+{
+    while (batch.Poll(10ms)) {
+    }
+}
+}
+
+TEST_CASE("ExportBatch runs all jobs within the limits", "[ExportBatch]")
+{
+    Tracker tracker;
+    ExportBatch batch{ ExportBatch::Limits { 3, 2 } };
+    for (const auto source : { "a", "b", "c", "d" }) {
+        for (int format = 0; format < 3; ++format) {
+            batch.Add(tracker.Job(source), source);
+        }
+    }
+    RunToEnd(batch);
+
+    CHECK(batch.GetFinishedCount() == batch.GetJobCount());
+    CHECK(batch.GetProgress() == 1.0);
+    for (size_t ii = 0; ii < batch.GetJobCount(); ++ii) {
+        CHECK(batch.GetOutcome(ii).result == ExportResult::Success);
+    }
+    CHECK(tracker.maxRunning <= 3);
+    CHECK(tracker.maxSources <= 2);
+}
+
+TEST_CASE("ExportBatch starts jobs of one source together", "[ExportBatch]")
+{
+    Tracker tracker;
+    ExportBatch batch{ ExportBatch::Limits { 3, 1 } };
+    // Interleaved, but the three jobs of a source still run together
+    for (int format = 0; format < 3; ++format) {
+        for (const auto source : { "a", "b" }) {
+            batch.Add(tracker.Job(source), source);
+        }
+    }
+    RunToEnd(batch);
+
+    CHECK(tracker.maxSources == 1);
+    CHECK(tracker.maxRunning == 3);
+}
+
+TEST_CASE("ExportBatch starts no more jobs after a failure", "[ExportBatch]")
+{
+    Tracker tracker;
+    ExportBatch batch{ ExportBatch::Limits { 1, 1 } };
+    batch.Add(tracker.Job("a"));
+    batch.Add([]() -> ExportTask { throw std::runtime_error{ "no plugin" }; });
+    batch.Add(tracker.Job("b"));
+    RunToEnd(batch);
+
+    CHECK(batch.GetOutcome(0).result == ExportResult::Success);
+    CHECK(batch.GetOutcome(1).result == ExportResult::Error);
+    CHECK_THROWS_AS(std::rethrow_exception(batch.GetOutcome(1).exception),
+                    std::runtime_error);
+    CHECK(!batch.GetOutcome(2).result.has_value());
+}
+
+TEST_CASE("ExportBatch passes cancellation to the running jobs",
+          "[ExportBatch]")
+{
+    ExportBatch batch{ ExportBatch::Limits { 2, 2 } };
+    for (int ii = 0; ii < 4; ++ii) {
+        batch.Add([]{
+            return ExportTask{ [](ExportProcessorDelegate& delegate) {
+                    while (!delegate.IsCancelled()) {
+                        std::this_thread::sleep_for(1ms);
+                    }
+                    return ExportResult::Cancelled;
+                } };
+        });
+    }
+    CHECK(batch.Poll(1ms));
+    batch.Cancel();
+    RunToEnd(batch);
+
+    CHECK(batch.GetOutcome(0).result == ExportResult::Cancelled);
+    CHECK(batch.GetOutcome(1).result == ExportResult::Cancelled);
+    CHECK(!batch.GetOutcome(2).result.has_value());
+    CHECK(!batch.GetOutcome(3).result.has_value());
+}
@@ -0,0 +1,89 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ExportMixerPipelineTests.cpp
+
+**********************************************************************/
+#include "ExportMixerPipeline.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+//! Counts up from zero in blocks of decreasing size, in two channels
+ExportMixerPipeline::Source MakeSource(size_t& produced, size_t total)
+{
+    return [&produced, total](samplePtr const* buffers, double& time) {
+        const auto samples = std::min<size_t>(100 - produced % 7, total - produced);
+        for (size_t ii = 0; ii < samples; ++ii) {
+            reinterpret_cast<float*>(buffers[0])[ii] = produced + ii;
+            reinterpret_cast<float*>(buffers[1])[ii] = -float(produced + ii);
+        }
+        produced += samples;
+        time = produced;
+        return samples;
+    };
+}
+}
+
+TEST_CASE("ExportMixerPipeline delivers all blocks in order",
+          "[ExportMixerPipeline]")
+{
+    const size_t total = 100000;
+    for (const size_t depth : { 1, 2, 8 }) {
+        size_t produced = 0;
+        ExportMixerPipeline pipeline{
+            MakeSource(produced, total), 2, 100, floatSample, depth };
+        size_t consumed = 0;
+        while (const auto samples = pipeline.Process()) {
+            const auto left = reinterpret_cast<const float*>(pipeline.GetBuffer());
+            const auto right = reinterpret_cast<const float*>(pipeline.GetBuffer(1));
+            for (size_t ii = 0; ii < samples; ++ii) {
+                REQUIRE(left[ii] == consumed + ii);
+                REQUIRE(right[ii] == -float(consumed + ii));
+            }
+            consumed += samples;
+            REQUIRE(pipeline.MixGetCurrentTime() == consumed);
+        }
+        CHECK(consumed == total);
+        CHECK(pipeline.Process() == 0);
+    }
+}
+
+TEST_CASE("ExportMixerPipeline rethrows after the blocks before the failure",
+          "[ExportMixerPipeline]")
+{
+    size_t blocks = 0;
+    ExportMixerPipeline pipeline{
+        [&blocks](samplePtr const*, double&) -> size_t {
+            if (++blocks > 5) {
+                throw std::runtime_error{ "read failed" };
+            }
+            return 10;
+        }, 1, 10, floatSample };
+    for (int ii = 0; ii < 5; ++ii) {
+        CHECK(pipeline.Process() == 10);
+    }
+    CHECK_THROWS_AS(pipeline.Process(), std::runtime_error);
+    CHECK(pipeline.Process() == 0);
+}
+
+TEST_CASE("ExportMixerPipeline stops the producer when destroyed early",
+          "[ExportMixerPipeline]")
+{
+    size_t produced = 0;
+    {
+        ExportMixerPipeline pipeline{
+            [&produced](samplePtr const*, double&) -> size_t {
+                ++produced;
+                return 1;
+            }, 1, 1, floatSample, 4 };
+        CHECK(pipeline.Process() == 1);
+    }
+    // The producer can't run further ahead than the ring
+    CHECK(produced <= 1 + 4);
+}
@@ -0,0 +1,155 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ImportPipelineTests.cpp
+
+**********************************************************************/
+#include "ImportPipeline.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+constexpr unsigned NumChannels = 3;
+
+short SampleAt(long long frame, unsigned channel)
+{
+    return (frame * NumChannels + channel) % 30000;
+}
+
+//! Reads 16 bit samples computed from their position
+class TestReader final : public ImportPipeline::Reader
+{
+public:
+    TestReader(long long totalFrames, long long failAt)
+        : mTotalFrames{totalFrames}, mFailAt{failAt}
+    {}
+
+    void Seek(sampleCount frame) override
+    {
+        mPosition = frame.as_long_long();
+    }
+
+    size_t Read(samplePtr buffer, size_t frames) override
+    {
+        if (mPosition + (long long)frames > mFailAt) {
+            throw std::runtime_error{ "bad sector" };
+        }
+        const auto read = std::min<long long>(frames, mTotalFrames - mPosition);
+        const auto samples = reinterpret_cast<short*>(buffer);
+        for (long long ii = 0; ii < read; ++ii) {
+            for (unsigned channel = 0; channel < NumChannels; ++channel) {
+                samples[ii * NumChannels + channel] = SampleAt(mPosition + ii, channel);
+            }
+        }
+        mPosition += read;
+        return read;
+    }
+
+private:
+    const long long mTotalFrames;
+    const long long mFailAt;
+    long long mPosition{ 0 };
+};
+
+struct Fixture
+{
+    ImportPipeline Make(size_t numReaders, long long totalFrames,
+                        long long failAt = std::numeric_limits<long long>::max())
+    {
+        ImportPipeline::Options options;
+        options.numChannels = NumChannels;
+        options.readFormat = int16Sample;
+        options.storedFormat = floatSample;
+        options.chunkFrames = ChunkFrames;
+        options.totalFrames = totalFrames;
+        options.numReaders = numReaders;
+        return ImportPipeline{
+            [=]{ return std::make_unique<TestReader>(totalFrames, failAt); },
+            [this](unsigned channel, sampleCount start, constSamplePtr samples, size_t frames)
+            {
+                // Check the splitting and widening on the decoding thread
+                const auto floats = reinterpret_cast<const float*>(samples);
+                for (size_t ii = 0; ii < frames; ++ii) {
+                    if (floats[ii]
+                        != SampleAt(start.as_long_long() + ii, channel) / 32768.0f) {
+                        mismatches++;
+                    }
+                }
+                built++;
+                return std::shared_ptr<SampleBlock>{};
+            },
+            options };
+    }
+
+    ImportPipeline::Consumer Consumer()
+    {
+        return [this](const auto& blocks, size_t frames) {
+            CHECK(blocks.size() == NumChannels);
+            // Only the last chunk may be short
+            CHECK(!lastWasShort);
+            lastWasShort = frames < ChunkFrames;
+            ++consumed;
+            return true;
+        };
+    }
+
+    static constexpr size_t ChunkFrames = 1000;
+    std::atomic<int> mismatches{ 0 };
+    std::atomic<int> built{ 0 };
+    int consumed{ 0 };
+    bool lastWasShort{ false };
+};
+}
+
+TEST_CASE("ImportPipeline delivers all chunks in order", "[ImportPipeline]")
+{
+    const long long totalFrames = 123456;
+    for (const size_t numReaders : { 1, 2, 5 }) {
+        Fixture fixture;
+        auto pipeline = fixture.Make(numReaders, totalFrames);
+        CHECK(pipeline.Run(fixture.Consumer()) == totalFrames);
+        CHECK(fixture.mismatches == 0);
+        CHECK(fixture.consumed == 124);
+        CHECK(fixture.built == 124 * NumChannels);
+    }
+}
+
+TEST_CASE("ImportPipeline with one reader reads to the end of the file",
+          "[ImportPipeline]")
+{
+    // The file ends with a full chunk; an empty read then ends the import
+    Fixture fixture;
+    auto pipeline = fixture.Make(1, 5000);
+    CHECK(pipeline.Run(fixture.Consumer()) == 5000);
+    CHECK(fixture.consumed == 5);
+    CHECK(!fixture.lastWasShort);
+}
+
+TEST_CASE("ImportPipeline rethrows after the chunks before the failure",
+          "[ImportPipeline]")
+{
+    for (const size_t numReaders : { 1, 4 }) {
+        Fixture fixture;
+        auto pipeline = fixture.Make(numReaders, 100000, 42500);
+        CHECK_THROWS_AS(pipeline.Run(fixture.Consumer()), std::runtime_error);
+        CHECK(fixture.consumed == 42);
+    }
+}
+
+TEST_CASE("ImportPipeline stops when the consumer says so", "[ImportPipeline]")
+{
+    Fixture fixture;
+    auto pipeline = fixture.Make(3, 100000);
+    int consumed = 0;
+    const auto frames = pipeline.Run([&](const auto&, size_t) {
+        return ++consumed < 10;
+    });
+    CHECK(consumed == 10);
+    CHECK(frames == 10 * Fixture::ChunkFrames);
+}
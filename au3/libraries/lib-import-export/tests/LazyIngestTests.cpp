@@ -0,0 +1,346 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  LazyIngestTests.cpp
+
+**********************************************************************/
+#include "LazyIngest.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+constexpr unsigned NumChannels = 2;
+constexpr long long TotalFrames = 10000;
+constexpr size_t BlockFrames = 1000;
+
+short SampleAt(long long frame, unsigned channel)
+{
+    return ((frame * 7 + channel * 1000) % 2000) - 1000;
+}
+
+float FloatAt(long long frame, unsigned channel)
+{
+    return SampleAt(frame, channel) / 32768.0f;
+}
+
+//! Reads 16 bit samples computed from their position, counting the reads
+class TestReader final : public ImportPipeline::Reader
+{
+public:
+    explicit TestReader(std::atomic<int>& reads)
+        : mReads{reads}
+    {}
+
+    void Seek(sampleCount frame) override
+    {
+        mPosition = frame.as_long_long();
+    }
+
+    size_t Read(samplePtr buffer, size_t frames) override
+    {
+        ++mReads;
+        const auto read = std::min<long long>(frames, TotalFrames - mPosition);
+        const auto samples = reinterpret_cast<short*>(buffer);
+        for (long long ii = 0; ii < read; ++ii) {
+            for (unsigned channel = 0; channel < NumChannels; ++channel) {
+                samples[ii * NumChannels + channel]
+                    =SampleAt(mPosition + ii, channel);
+            }
+        }
+        mPosition += read;
+        return read;
+    }
+
+private:
+    std::atomic<int>& mReads;
+    long long mPosition{ 0 };
+};
+
+//! Keeps float samples in memory
+class TestBlock final : public SampleBlock
+{
+public:
+    TestBlock(SampleBlockID id, constSamplePtr src, size_t count)
+        : mID{id}
+        , mSamples(reinterpret_cast<const float*>(src),
+                   reinterpret_cast<const float*>(src) + count)
+    {}
+
+    void CloseLock() noexcept override {}
+    SampleBlockID GetBlockID() const override { return mID; }
+    BlockSampleView GetFloatSampleView(bool) override
+    {
+        return std::make_shared<std::vector<float> >(mSamples);
+    }
+
+    sampleFormat GetSampleFormat() const override { return floatSample; }
+    size_t GetSampleCount() const override { return mSamples.size(); }
+    bool GetSummary256(float* dest, size_t frameoffset, size_t numframes) override
+    {
+        return SampleBlock::GetSummary(256, dest, frameoffset, numframes);
+    }
+
+    bool GetSummary64k(float* dest, size_t frameoffset, size_t numframes) override
+    {
+        return SampleBlock::GetSummary(64 * 1024, dest, frameoffset, numframes);
+    }
+
+    size_t GetSpaceUsage() const override { return mSamples.size() * sizeof(float); }
+    void SaveXML(XMLWriter&) override {}
+
+protected:
+    size_t DoGetSamples(samplePtr dest, sampleFormat, size_t sampleoffset, size_t numsamples) override
+    {
+        std::copy(mSamples.begin() + sampleoffset,
+                  mSamples.begin() + sampleoffset + numsamples,
+                  reinterpret_cast<float*>(dest));
+        return numsamples;
+    }
+
+    MinMaxRMS DoGetMinMaxRMS(size_t, size_t) override { return {}; }
+    MinMaxRMS DoGetMinMaxRMS() const override { return {}; }
+
+private:
+    const SampleBlockID mID;
+    const std::vector<float> mSamples;
+};
+
+class TestFactory final : public SampleBlockFactory
+{
+public:
+    SampleBlockIDs GetActiveBlockIDs() override { return {}; }
+
+    std::atomic<int> created{ 0 };
+    std::atomic<bool> refuse{ false };
+
+protected:
+    SampleBlockPtr DoCreate(constSamplePtr src, size_t numsamples, sampleFormat srcformat) override
+    {
+        if (refuse || srcformat != floatSample) {
+            throw std::runtime_error{ "full" };
+        }
+        return std::make_shared<TestBlock>(++created, src, numsamples);
+    }
+
+    SampleBlockPtr DoCreateSilent(size_t, sampleFormat) override { return nullptr; }
+    SampleBlockPtr DoCreateFromXML(sampleFormat, const AttributesList&) override { return nullptr; }
+    SampleBlockPtr DoCreateFromId(sampleFormat, SampleBlockID) override { return nullptr; }
+};
+
+struct Fixture
+{
+    Fixture()
+        : pSource{MakeSource(L"test.wav")}
+    {}
+
+    std::shared_ptr<LazyIngest::Source> MakeSource(const FilePath& path)
+    {
+        return std::make_shared<LazyIngest::Source>(
+            path, [this]{
+            ++opened;
+            return std::make_unique<TestReader>(reads);
+        }, NumChannels, int16Sample);
+    }
+
+    ~Fixture()
+    {
+        LazyIngest::Get().Cancel(*pFactory);
+    }
+
+    //! Blocks of all of the file, by channel
+    std::vector<std::vector<SampleBlockPtr> > Import()
+    {
+        std::vector<std::vector<SampleBlockPtr> > result(NumChannels);
+        for (long long start = 0; start < TotalFrames; start += BlockFrames) {
+            auto blocks = LazyIngest::Get().MakeBlocks(
+                pSource, pFactory, floatSample, start, BlockFrames);
+            REQUIRE(blocks.size() == NumChannels);
+            for (unsigned channel = 0; channel < NumChannels; ++channel) {
+                result[channel].push_back(std::move(blocks[channel]));
+            }
+        }
+        return result;
+    }
+
+    static void CheckSamples(
+        const std::vector<std::vector<SampleBlockPtr> >& blocks)
+    {
+        for (unsigned channel = 0; channel < NumChannels; ++channel) {
+            long long start = 0;
+            for (const auto& pBlock : blocks[channel]) {
+                std::vector<float> samples(BlockFrames);
+                pBlock->GetSamples(reinterpret_cast<samplePtr>(samples.data()),
+                                   floatSample, 0, BlockFrames);
+                for (size_t ii = 0; ii < BlockFrames; ++ii) {
+                    REQUIRE(samples[ii] == FloatAt(start + ii, channel));
+                }
+                start += BlockFrames;
+            }
+        }
+    }
+
+    std::atomic<int> reads{ 0 };
+    std::atomic<int> opened{ 0 };
+    const std::shared_ptr<TestFactory> pFactory
+        =std::make_shared<TestFactory>();
+    std::shared_ptr<LazyIngest::Source> pSource;
+};
+}
+
+TEST_CASE("LazyIngest blocks read from the file until ingested",
+          "[LazyIngest]")
+{
+    Fixture fixture;
+    fixture.pFactory->refuse = true;
+    auto blocks = fixture.Import();
+    // Blocks that fail to be copied go on reading from the file
+    LazyIngest::Get().Finish(*fixture.pFactory);
+    CHECK(!LazyIngest::Get().IsPending(*fixture.pFactory));
+
+    Fixture::CheckSamples(blocks);
+    CHECK(fixture.pFactory->created == 0);
+
+    const auto& pBlock = blocks[1][3];
+    CHECK(pBlock->GetBlockID() < 0);
+    CHECK(pBlock->GetBlockID() != blocks[0][3]->GetBlockID());
+    CHECK(pBlock->GetSpaceUsage() == 0);
+
+    // Summaries are computed from the file
+    const auto summarize = [](long long start, size_t count, float* dest) {
+        float min = FloatAt(start, 1);
+        float max = min;
+        double sumsq = 0;
+        for (size_t ii = 0; ii < count; ++ii) {
+            const auto sample = FloatAt(start + ii, 1);
+            min = std::min(min, sample);
+            max = std::max(max, sample);
+            sumsq += double(sample) * sample;
+        }
+        dest[0] = min;
+        dest[1] = max;
+        dest[2] = std::sqrt(sumsq / count);
+    };
+    const long long start = 3 * BlockFrames;
+
+    float expected[3];
+    float summary[3];
+    summarize(start + 256, 256, expected);
+    REQUIRE(pBlock->GetSummary256(summary, 1, 1));
+    CHECK(summary[0] == expected[0]);
+    CHECK(summary[1] == expected[1]);
+    CHECK(summary[2] == Approx(expected[2]));
+
+    // The last frame is partial
+    summarize(start + 768, BlockFrames - 768, expected);
+    REQUIRE(pBlock->GetSummary256(summary, 3, 1));
+    CHECK(summary[2] == Approx(expected[2]));
+
+    summarize(start, BlockFrames, expected);
+    const auto totals = pBlock->GetMinMaxRMS();
+    CHECK(totals.min == expected[0]);
+    CHECK(totals.max == expected[1]);
+    CHECK(totals.RMS == Approx(expected[2]));
+    REQUIRE(pBlock->GetSummary64k(summary, 0, 1));
+    CHECK(summary[2] == Approx(expected[2]));
+}
+
+TEST_CASE("LazyIngest::Finish copies the blocks into the factory",
+          "[LazyIngest]")
+{
+    Fixture fixture;
+    auto blocks = fixture.Import();
+    REQUIRE(LazyIngest::Get().Finish(*fixture.pFactory));
+    CHECK(!LazyIngest::Get().IsPending(*fixture.pFactory));
+    CHECK(fixture.pFactory->created == NumChannels * TotalFrames / BlockFrames);
+
+    // Now the blocks forward to those of the factory
+    const auto reads = fixture.reads.load();
+    Fixture::CheckSamples(blocks);
+    CHECK(fixture.reads == reads);
+    CHECK(blocks[0][0]->GetBlockID() > 0);
+    CHECK(blocks[0][0]->GetSpaceUsage() == BlockFrames * sizeof(float));
+}
+
+TEST_CASE("LazyIngest copies the blocks in the background", "[LazyIngest]")
+{
+    Fixture fixture;
+    auto blocks = fixture.Import();
+    using namespace std::chrono;
+    const auto deadline = steady_clock::now() + seconds{ 10 };
+    while (LazyIngest::Get().IsPending(*fixture.pFactory)
+           && steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(milliseconds{ 1 });
+    }
+    REQUIRE(!LazyIngest::Get().IsPending(*fixture.pFactory));
+    CHECK(fixture.pFactory->created == NumChannels * TotalFrames / BlockFrames);
+    // Each chunk was read once for both channels
+    CHECK(fixture.reads == TotalFrames / BlockFrames);
+    // The background thread read with a reader of its own
+    CHECK(fixture.opened == 2);
+    Fixture::CheckSamples(blocks);
+}
+
+TEST_CASE("LazyIngest::Release copies the blocks that read from the file",
+          "[LazyIngest]")
+{
+    Fixture fixture;
+
+    SECTION("so that the file may be overwritten")
+    {
+        auto blocks = fixture.Import();
+        fixture.pSource.reset();
+        REQUIRE(LazyIngest::Get().Release(L"test.wav"));
+        CHECK(!LazyIngest::IsReading(L"test.wav"));
+        CHECK(fixture.pFactory->created == NumChannels * TotalFrames / BlockFrames);
+        Fixture::CheckSamples(blocks);
+    }
+
+    SECTION("unless they cannot be copied")
+    {
+        fixture.pFactory->refuse = true;
+        auto blocks = fixture.Import();
+        fixture.pSource.reset();
+        REQUIRE(!LazyIngest::Get().Release(L"test.wav"));
+        CHECK(LazyIngest::IsReading(L"test.wav"));
+        Fixture::CheckSamples(blocks);
+    }
+}
+
+TEST_CASE("LazyIngest reopens files in the format of the stored blocks",
+          "[LazyIngest]")
+{
+    Fixture fixture;
+    auto requested = int16Sample;
+    LazyIngest::SourceFactory::Scope scope{
+        [&](const FilePath& path, sampleFormat format) {
+            requested = format;
+            return fixture.MakeSource(path);
+        } };
+
+    constexpr long long start = 3 * BlockFrames;
+    const AttributesList attrs {
+        { "aliasfile", XMLAttributeValueView { std::string_view { "recovered.wav" } } },
+        { "aliasstart", XMLAttributeValueView { start } },
+        { "aliaslen", XMLAttributeValueView { static_cast<long long>(BlockFrames) } },
+        { "aliaschannel", XMLAttributeValueView { 1 } },
+    };
+    const auto pBlock = SampleBlockFactory::AliasFactory::Call(
+        fixture.pFactory, floatSample, attrs);
+    REQUIRE(pBlock);
+    CHECK(requested == floatSample);
+
+    std::vector<float> samples(BlockFrames);
+    pBlock->GetSamples(reinterpret_cast<samplePtr>(samples.data()),
+                       floatSample, 0, BlockFrames);
+    for (size_t ii = 0; ii < BlockFrames; ++ii) {
+        REQUIRE(samples[ii] == FloatAt(start + ii, 1));
+    }
+}
@@ -0,0 +1,175 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file BiquadCascade.cpp
+
+**********************************************************************/
+#include "BiquadCascade.h"
+
+#include "Biquad.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) \
+    || (defined(__i386__) && defined(__SSE2__)) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BIQUAD_CASCADE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define BIQUAD_CASCADE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+// Samples of a pair of channels, interleaved, in double
+constexpr size_t ChunkSize = 256;
+
+// Two double lanes, one for each channel of a pair
+
+#if defined(BIQUAD_CASCADE_SSE2)
+using Pair = __m128d;
+inline Pair Load(const double* p) { return _mm_loadu_pd(p); }
+inline void Store(double* p, Pair x) { _mm_storeu_pd(p, x); }
+inline Pair Broadcast(double x) { return _mm_set1_pd(x); }
+inline Pair Add(Pair x, Pair y) { return _mm_add_pd(x, y); }
+inline Pair Sub(Pair x, Pair y) { return _mm_sub_pd(x, y); }
+inline Pair Mul(Pair x, Pair y) { return _mm_mul_pd(x, y); }
+#elif defined(BIQUAD_CASCADE_NEON)
+using Pair = float64x2_t;
+inline Pair Load(const double* p) { return vld1q_f64(p); }
+inline void Store(double* p, Pair x) { vst1q_f64(p, x); }
+inline Pair Broadcast(double x) { return vdupq_n_f64(x); }
+inline Pair Add(Pair x, Pair y) { return vaddq_f64(x, y); }
+inline Pair Sub(Pair x, Pair y) { return vsubq_f64(x, y); }
+inline Pair Mul(Pair x, Pair y) { return vmulq_f64(x, y); }
+#else
+struct Pair {
+    double lanes[2];
+};
+inline Pair Load(const double* p) { return { { p[0], p[1] } }; }
+inline void Store(double* p, Pair x) { p[0] = x.lanes[0]; p[1] = x.lanes[1]; }
+inline Pair Broadcast(double x) { return { { x, x } }; }
+inline Pair Add(Pair x, Pair y)
+{ return { { x.lanes[0] + y.lanes[0], x.lanes[1] + y.lanes[1] } }; }
+inline Pair Sub(Pair x, Pair y)
+{ return { { x.lanes[0] - y.lanes[0], x.lanes[1] - y.lanes[1] } }; }
+inline Pair Mul(Pair x, Pair y)
+{ return { { x.lanes[0] * y.lanes[0], x.lanes[1] * y.lanes[1] } }; }
+#endif
+
+// Apply N consecutive sections to interleaved samples of a pair of channels,
+// in place.  Successive sections of one sample are independent of the
+// previous sample's later sections, so the processor overlaps their work.
+template<size_t N, typename Coefficients>
+void ApplySections(const Coefficients* sections, double* state,
+                   double* buffer, size_t len)
+{
+    Pair b0[N], b1[N], b2[N], a1[N], a2[N], s1[N], s2[N];
+    for (size_t k = 0; k < N; ++k) {
+        b0[k] = Broadcast(sections[k].b0);
+        b1[k] = Broadcast(sections[k].b1);
+        b2[k] = Broadcast(sections[k].b2);
+        a1[k] = Broadcast(sections[k].a1);
+        a2[k] = Broadcast(sections[k].a2);
+        s1[k] = Load(state + 4 * k);
+        s2[k] = Load(state + 4 * k + 2);
+    }
+    for (size_t i = 0; i < len; ++i) {
+        auto x = Load(buffer + 2 * i);
+        for (size_t k = 0; k < N; ++k) {
+            // Transposed direct form II
+            const auto y = Add(Mul(b0[k], x), s1[k]);
+            s1[k] = Sub(Add(Mul(b1[k], x), s2[k]), Mul(a1[k], y));
+            s2[k] = Sub(Mul(b2[k], x), Mul(a2[k], y));
+            x = y;
+        }
+        Store(buffer + 2 * i, x);
+    }
+    for (size_t k = 0; k < N; ++k) {
+        Store(state + 4 * k, s1[k]);
+        Store(state + 4 * k + 2, s2[k]);
+    }
+}
+}
+
+BiquadCascade::BiquadCascade(
+    const Biquad* sections, size_t nSections, size_t nChannels)
+    : mSections(nSections)
+    , mState(((nChannels + 1) / 2) * nSections * 4)
+    , mChannels{nChannels}
+{
+    for (size_t iSection = 0; iSection < nSections; ++iSection) {
+        SetSection(iSection, sections[iSection]);
+    }
+}
+
+void BiquadCascade::SetSection(size_t iSection, const Biquad& section)
+{
+    mSections[iSection] = {
+        section.fNumerCoeffs[Biquad::B0],
+        section.fNumerCoeffs[Biquad::B1],
+        section.fNumerCoeffs[Biquad::B2],
+        section.fDenomCoeffs[Biquad::A1],
+        section.fDenomCoeffs[Biquad::A2],
+    };
+}
+
+void BiquadCascade::Reset()
+{
+    std::fill(mState.begin(), mState.end(), 0.0);
+}
+
+void BiquadCascade::Process(
+    const float* const* in, float* const* out, size_t len)
+{
+    const auto nSections = mSections.size();
+    alignas(16) double buffer[2 * ChunkSize];
+    for (size_t iChannel = 0; iChannel < mChannels; iChannel += 2) {
+        // An odd channel out is paired with silence
+        const bool paired = iChannel + 1 < mChannels;
+        const auto state = mState.data() + (iChannel / 2) * nSections * 4;
+        for (size_t start = 0; start < len; start += ChunkSize) {
+            const auto count = std::min(ChunkSize, len - start);
+            const auto in0 = in[iChannel] + start;
+            const auto in1 = paired ? in[iChannel + 1] + start : nullptr;
+            for (size_t i = 0; i < count; ++i) {
+                buffer[2 * i] = in0[i];
+                buffer[2 * i + 1] = paired ? in1[i] : 0.0f;
+            }
+
+            for (size_t iSection = 0; iSection < nSections;
+                 iSection += MaxFused) {
+                const auto sections = mSections.data() + iSection;
+                const auto sectionState = state + 4 * iSection;
+                switch (std::min(MaxFused, nSections - iSection)) {
+                case 1:
+                    ApplySections<1>(sections, sectionState, buffer, count);
+                    break;
+                case 2:
+                    ApplySections<2>(sections, sectionState, buffer, count);
+                    break;
+                case 3:
+                    ApplySections<3>(sections, sectionState, buffer, count);
+                    break;
+                default:
+                    ApplySections<MaxFused>(
+                        sections, sectionState, buffer, count);
+                    break;
+                }
+            }
+
+            const auto out0 = out[iChannel] + start;
+            for (size_t i = 0; i < count; ++i) {
+                out0[i] = buffer[2 * i];
+            }
+            if (paired) {
+                const auto out1 = out[iChannel + 1] + start;
+                for (size_t i = 0; i < count; ++i) {
+                    out1[i] = buffer[2 * i + 1];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,63 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file BiquadCascade.h
+  @brief Applies a chain of biquad sections to several channels at once
+
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct Biquad;
+
+//! A cascade of biquad filters, with its own state for each channel
+/*!
+ Each section is evaluated in transposed direct form II with double
+ accumulators, and the signal stays in double from the first section to the
+ last.  So the cascade is at least as accurate as a chain of
+ Biquad::Process() calls, which round to float after every section.
+
+ Channels are processed in pairs, in the two double lanes of a vector
+ register where the processor has them (SSE2 or NEON), so that a stereo
+ track costs about as much as a mono one.  Up to MaxFused sections are
+ applied in one pass over the samples, their states held in registers.
+ */
+class MATH_API BiquadCascade final
+{
+public:
+    //! Sections applied in one pass over the samples
+    static constexpr size_t MaxFused = 4;
+
+    BiquadCascade() = default;
+
+    //! Copies the coefficients of the sections, ignoring their state
+    BiquadCascade(const Biquad* sections, size_t nSections, size_t nChannels);
+
+    size_t NSections() const { return mSections.size(); }
+    size_t NChannels() const { return mChannels; }
+
+    //! Replace the coefficients of one section, keeping the state of all
+    /*! @pre `iSection < NSections()` */
+    void SetSection(size_t iSection, const Biquad& section);
+
+    //! Clear the state of all channels
+    void Reset();
+
+    //! Filter `len` samples of each of NChannels() channels
+    /*! `out` may be the same as `in` */
+    void Process(const float* const* in, float* const* out, size_t len);
+
+private:
+    struct Coefficients {
+        double b0, b1, b2, a1, a2;
+    };
+
+    std::vector<Coefficients> mSections;
+    //! For each pair of channels, for each section, s1 then s2 of both lanes
+    std::vector<double> mState;
+    size_t mChannels{ 0 };
+};
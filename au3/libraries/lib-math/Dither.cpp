@@ -35,6 +35,7 @@ and get deterministic behaviour.
 *//*******************************************************************/
 
 #include "Dither.h"
+#include "SampleConversion.h"
 
 #include "Internat.h"
 #include "Prefs.h"
@@ -44,6 +45,7 @@ and get deterministic behaviour.
 // (Note: this file should be included first)
 #include "float_cast.h"
 
+#include <algorithm>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
@@ -69,122 +71,141 @@ struct State {
     float mBuffer[8 /* = BUF_SIZE */];
 } mState;
 
-using Ditherer = float (*)(State&, float);
-
-// This is supposed to produce white noise and no dc
-static inline float DITHER_NOISE()
-{
-    return rand() / (float)RAND_MAX - 0.5f;
-}
-
 // Defines for sample conversion
 constexpr auto CONVERT_DIV16 = float(1 << 15);
 constexpr auto CONVERT_DIV24 = float(1 << 23);
 
-// Dereference sample pointer and convert to float sample
-static inline float FROM_INT16(const short* ptr)
-{
-    return *ptr / CONVERT_DIV16;
-}
-
-static inline float FROM_INT24(const int* ptr)
-{
-    return *ptr / CONVERT_DIV24;
-}
+// Samples are converted in blocks small enough to stay in the L1 cache;
+// a multiple of the number of lanes of the noise generator
+constexpr size_t BLOCK_SIZE = 256;
+static_assert(BLOCK_SIZE % SampleConversion::NoiseGenerator::Lanes == 0);
 
-// For float, we internally allow values greater than 1.0, which
-// would blow up the dithering to int values.  FROM_FLOAT is
-// only used to dither to int, so clip here.
-static inline float FROM_FLOAT(const float* ptr)
-{
-    return *((float*)(ptr)) > 1.0
-           ? 1.0
-           : *((float*)(ptr)) < -1.0
-           ? -1.0
-           : *((float*)(ptr));
-}
+// Each thread has its own generator, so that concurrent exports
+// neither contend nor corrupt each other's state
+static thread_local SampleConversion::NoiseGenerator sNoiseGenerator;
 
-// Store float sample 'sample' into pointer 'ptr', clip it, if necessary
-template<typename dst_type>
-static inline void IMPLEMENT_STORE(
-    dst_type* ptr, float sample, dst_type min_bound, dst_type max_bound)
+// Return a contiguous view of possibly interleaved samples
+template<typename T>
+static inline const T* Gather(const SampleConversion::Kernels& kernels,
+                              const T* src, size_t stride, T* block, size_t len)
 {
-    int x = lrintf(sample);
-    if (x > max_bound) {
-        *ptr = max_bound;
-    } else if (x < (min_bound)) {
-        *ptr = min_bound;
+    static_assert(sizeof(T) == sizeof(short) || sizeof(T) == sizeof(int));
+    if (stride == 1) {
+        return src;
+    }
+    if constexpr (sizeof(T) == sizeof(short)) {
+        kernels.Gather16(reinterpret_cast<const short*>(src), stride,
+                         reinterpret_cast<short*>(block), len);
     } else {
-        *ptr = static_cast<dst_type>(x);
+        kernels.Gather32(reinterpret_cast<const int*>(src), stride,
+                         reinterpret_cast<int*>(block), len);
     }
+    return block;
 }
 
-// Dither single float 'sample' and store it in pointer 'dst', using 'dither' as algorithm
-static inline void DITHER_TO_INT16(Ditherer dither, State& state,
-                                   short* dst, float sample)
+// Not vectorized: without scatter stores, a vector loop would have to
+// read and rewrite the samples of the other channels in between, racing
+// with whoever fills them
+template<typename T>
+static inline void Scatter(const T* block, T* dst, size_t stride, size_t len)
 {
-    IMPLEMENT_STORE<short>(dst,
-                           dither(state, sample * CONVERT_DIV16),
-                           short(-32768), short(32767));
-}
-
-// Dither single float 'sample' and store it in pointer 'dst', using 'dither' as algorithm
-static inline void DITHER_TO_INT24(Ditherer dither, State& state,
-                                   int* dst, float sample)
-{
-    IMPLEMENT_STORE<int>(dst,
-                         dither(state, sample * CONVERT_DIV24), -8388608, 8388607);
+    for (size_t i = 0; i < len; ++i) {
+        dst[i * stride] = block[i];
+    }
 }
 
-// Implement one single dither step
-
-// Implement a dithering loop
-template<typename srcType, typename dstType>
-static inline void DITHER_LOOP(Ditherer dither, State& state,
-                               void (*store)(Ditherer, State&, dstType*, float),
-                               float (*load)(const srcType*),
-                               samplePtr dst, sampleFormat dstFormat, size_t dstStride,
-                               constSamplePtr src, sampleFormat srcFormat, size_t srcStride, size_t len)
+// Apply a kernel for contiguous buffers to possibly interleaved ones
+template<typename Src, typename Dst, typename Kernel>
+static void Blockwise(const SampleConversion::Kernels& kernels,
+                      const Src* src, size_t srcStride,
+                      Dst* dst, size_t dstStride, size_t len,
+                      const Kernel& kernel)
 {
-    char* d;
-    const char* s;
-    unsigned int ii;
-    for (d = (char*)dst, s = (char*)src, ii = 0;
-         ii < len;
-         ii++, d += SAMPLE_SIZE(dstFormat) * dstStride,
-         s += SAMPLE_SIZE(srcFormat) * srcStride) {
-        store(dither, state, reinterpret_cast<dstType*>(d), load(reinterpret_cast<const srcType*>(s)));
+    if (srcStride == 1 && dstStride == 1) {
+        kernel(src, dst, len);
+        return;
+    }
+    Src srcBlock[BLOCK_SIZE];
+    Dst dstBlock[BLOCK_SIZE];
+    while (len > 0) {
+        const auto n = std::min(len, BLOCK_SIZE);
+        const auto d = dstStride == 1 ? dst : dstBlock;
+        kernel(Gather(kernels, src, srcStride, srcBlock, n), d, n);
+        if (dstStride != 1) {
+            Scatter(dstBlock, dst, dstStride, n);
+        }
+        src += n * srcStride;
+        dst += n * dstStride;
+        len -= n;
     }
 }
 
+static inline float ShapedDither(State& state, float sample, float noise);
+
 // Implement a dither. There are only 3 cases where we must dither,
 // in all other cases, no dithering is necessary.
-static inline void DITHER(Ditherer dither, State& state,
-                          samplePtr dst, sampleFormat dstFormat, size_t dstStride,
-                          constSamplePtr src, sampleFormat srcFormat, size_t srcStride, size_t len)
+// 'load' converts a block to floats scaled to the destination range,
+// the noise is added, then 'store' rounds and clips.
+template<typename Src, typename Dst, typename Load, typename Store>
+static void DITHER(DitherType ditherType, State& state,
+                   const SampleConversion::Kernels& kernels,
+                   Dst* dst, size_t dstStride,
+                   const Src* src, size_t srcStride, size_t len,
+                   const Load& load, const Store& store)
 {
-    if (srcFormat == int24Sample && dstFormat == int16Sample) {
-        DITHER_LOOP<int, short>(dither, state,
-                                DITHER_TO_INT16, FROM_INT24, dst,
-                                int16Sample, dstStride, src, int24Sample, srcStride, len);
-    } else if (srcFormat == floatSample && dstFormat == int16Sample) {
-        DITHER_LOOP<float, short>(dither, state,
-                                  DITHER_TO_INT16, FROM_FLOAT, dst,
-                                  int16Sample, dstStride, src, floatSample, srcStride, len);
-    } else if (srcFormat == floatSample && dstFormat == int24Sample) {
-        DITHER_LOOP<float, int>(dither, state,
-                                DITHER_TO_INT24, FROM_FLOAT, dst,
-                                int24Sample, dstStride, src, floatSample, srcStride, len);
-    } else {
-        wxASSERT(false);
+    Src srcBlock[BLOCK_SIZE];
+    Dst dstBlock[BLOCK_SIZE];
+    float scaled[BLOCK_SIZE];
+    // White noise with no dc; twice the block for the shaped dither
+    float noise[2 * BLOCK_SIZE];
+    constexpr auto lanes = SampleConversion::NoiseGenerator::Lanes;
+    while (len > 0) {
+        const auto n = std::min(len, BLOCK_SIZE);
+        load(Gather(kernels, src, srcStride, srcBlock, n), scaled, n);
+        switch (ditherType) {
+        case DitherType::none:
+            break;
+        case DitherType::rectangle:
+            // Apply one-step noise
+            kernels.FillNoise(sNoiseGenerator, noise, (n + lanes - 1) / lanes * lanes);
+            for (size_t i = 0; i < n; ++i) {
+                scaled[i] -= noise[i];
+            }
+            break;
+        case DitherType::triangle:
+            // High pass filtered noise
+            kernels.FillNoise(sNoiseGenerator, noise, (n + lanes - 1) / lanes * lanes);
+            scaled[0] += noise[0] - state.mTriangleState;
+            for (size_t i = 1; i < n; ++i) {
+                scaled[i] += noise[i] - noise[i - 1];
+            }
+            state.mTriangleState = noise[n - 1];
+            break;
+        case DitherType::shaped: {
+            // The noise is generated ahead, but the error feedback
+            // makes the filter itself inherently sequential
+            const auto rounded = (n + lanes - 1) / lanes * lanes;
+            kernels.FillNoise(sNoiseGenerator, noise, 2 * rounded);
+            for (size_t i = 0; i < n; ++i) {
+                scaled[i] = ShapedDither(
+                    state, scaled[i], noise[i] + noise[rounded + i]);
+            }
+            break;
+        }
+        default:
+            wxASSERT(false); // unknown dither algorithm
+        }
+        const auto d = dstStride == 1 ? dst : dstBlock;
+        store(scaled, d, n);
+        if (dstStride != 1) {
+            Scatter(dstBlock, dst, dstStride, n);
+        }
+        src += n * srcStride;
+        dst += n * dstStride;
+        len -= n;
     }
 }
 
-static inline float NoDither(State&, float sample);
-static inline float RectangleDither(State&, float sample);
-static inline float TriangleDither(State& state, float sample);
-static inline float ShapedDither(State& state, float sample);
-
 Dither::Dither()
 {
     // On startup, initialize dither by resetting values
@@ -199,7 +220,7 @@ void Dither::Reset()
 }
 
 // This only decides if we must dither at all, the dithers
-// are all implemented using macros.
+// are implemented by DITHER above.
 //
 // "source" and "dest" can contain either interleaved or non-interleaved
 // samples.  They do not have to be the same...one can be interleaved while
@@ -271,18 +292,17 @@ void Dither::Apply(enum DitherType ditherType,
     } else if (destFormat == floatSample) {
         // No need to dither, just convert samples to float.
         // No clipping should be necessary.
+        const auto& kernels = SampleConversion::GetKernels();
         auto d = (float*)dest;
 
         if (sourceFormat == int16Sample) {
-            auto s = (const short*)source;
-            for (i = 0; i < len; i++, d += destStride, s += sourceStride) {
-                *d = FROM_INT16(s);
-            }
+            Blockwise(kernels, (const short*)source, sourceStride,
+                      d, destStride, len,
+                      kernels.Int16ToFloat);
         } else if (sourceFormat == int24Sample) {
-            auto s = (const int*)source;
-            for (i = 0; i < len; i++, d += destStride, s += sourceStride) {
-                *d = FROM_INT24(s);
-            }
+            Blockwise(kernels, (const int*)source, sourceStride,
+                      d, destStride, len,
+                      kernels.Int24ToFloat);
         } else {
             wxASSERT(false); // source format unknown
         }
@@ -295,56 +315,45 @@ void Dither::Apply(enum DitherType ditherType,
         }
     } else {
         // We must do dithering
-        switch (ditherType) {
-        case DitherType::none:
-            DITHER(NoDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::rectangle:
-            DITHER(RectangleDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::triangle:
-            Reset(); // reset dither filter for this NEW conversion
-            DITHER(TriangleDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::shaped:
+        if (ditherType == DitherType::triangle
+            || ditherType == DitherType::shaped) {
             Reset(); // reset dither filter for this NEW conversion
-            DITHER(ShapedDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        default:
-            wxASSERT(false); // unknown dither algorithm
+        }
+        const auto& kernels = SampleConversion::GetKernels();
+        // For float, we internally allow values greater than 1.0, which
+        // would blow up the dithering to int values, so clip when loading
+        const auto loadFloat = [&](float scale) {
+            return [&kernels, scale](const float* s, float* d, size_t n) {
+                kernels.ClipAndScale(s, d, n, scale);
+            };
+        };
+        if (sourceFormat == int24Sample && destFormat == int16Sample) {
+            DITHER(ditherType, mState, kernels,
+                   (short*)dest, destStride, (const int*)source, sourceStride, len,
+                   [&kernels](const int* s, float* d, size_t n) {
+                kernels.Int24ToFloat(s, d, n);
+                kernels.ClipAndScale(d, d, n, CONVERT_DIV16);
+            }, kernels.RoundToInt16);
+        } else if (sourceFormat == floatSample && destFormat == int16Sample) {
+            DITHER(ditherType, mState, kernels,
+                   (short*)dest, destStride, (const float*)source, sourceStride, len,
+                   loadFloat(CONVERT_DIV16), kernels.RoundToInt16);
+        } else if (sourceFormat == floatSample && destFormat == int24Sample) {
+            DITHER(ditherType, mState, kernels,
+                   (int*)dest, destStride, (const float*)source, sourceStride, len,
+                   loadFloat(CONVERT_DIV24), kernels.RoundToInt24);
+        } else {
+            wxASSERT(false);
         }
     }
 }
 
 // Dither implementations
 
-// No dither, just return sample
-inline float NoDither(State&, float sample)
-{
-    return sample;
-}
-
-// Rectangle dithering, apply one-step noise
-inline float RectangleDither(State&, float sample)
-{
-    return sample - DITHER_NOISE();
-}
-
-// Triangle dither - high pass filtered
-inline float TriangleDither(State& state, float sample)
-{
-    float r = DITHER_NOISE();
-    float result = sample + r - state.mTriangleState;
-    state.mTriangleState = r;
-
-    return result;
-}
-
 // Shaped dither
-inline float ShapedDither(State& state, float sample)
+// 'r' is triangular dither, +-1 LSB, flat psd
+inline float ShapedDither(State& state, float sample, float r)
 {
-    // Generate triangular dither, +-1 LSB, flat psd
-    float r = DITHER_NOISE() + DITHER_NOISE();
     if (sample != sample) { // test for NaN
         sample = 0; // and do the best we can with it
     }
@@ -9,13 +9,62 @@ Max Maisel
 ***********************************************************************/
 
 #include "EBUR128.h"
+#include <algorithm>
 #include <cstring>
 
-EBUR128::EBUR128(double rate, size_t channels)
+namespace {
+/// Samples of each channel weighted at once by ProcessSamples()
+constexpr size_t ChunkSize = 1024;
+
+/// ITU-R BS.1770-4 Annex 2: the phases of the 48 tap interpolation filter
+/// for four times oversampling, each applied to the last 12 samples, the
+/// newest last
+constexpr size_t TruePeakTaps = 12;
+constexpr float TruePeakCoefficients[4][TruePeakTaps] = {
+    { -0.0083007812500f, 0.0148925781250f, -0.0266113281250f,
+      0.0476074218750f, -0.1022949218750f, 0.9721679687500f,
+      0.1373291015625f, -0.0594482421875f, 0.0332031250000f,
+      -0.0196533203125f, 0.0109863281250f, 0.0017089843750f },
+    { -0.0189208984375f, 0.0330810546875f, -0.0582275390625f,
+      0.1015625000000f, -0.2003173828125f, 0.7797851562500f,
+      0.4650878906250f, -0.1665039062500f, 0.0891113281250f,
+      -0.0517578125000f, 0.0292968750000f, -0.0291748046875f },
+    { -0.0291748046875f, 0.0292968750000f, -0.0517578125000f,
+      0.0891113281250f, -0.1665039062500f, 0.4650878906250f,
+      0.7797851562500f, -0.2003173828125f, 0.1015625000000f,
+      -0.0582275390625f, 0.0330810546875f, -0.0189208984375f },
+    { 0.0017089843750f, 0.0109863281250f, -0.0196533203125f,
+      0.0332031250000f, -0.0594482421875f, 0.1373291015625f,
+      0.9721679687500f, -0.1022949218750f, 0.0476074218750f,
+      -0.0266113281250f, 0.0148925781250f, -0.0083007812500f },
+};
+
+/// LUFS is defined as -0.691 dB + 10*log10(sum(channels))
+constexpr double LoudnessScale = 0.8529037031;
+
+/// Sum with independent accumulators, rather than one long chain of additions
+double Sum(const double* values, size_t len)
+{
+    double sums[4] {};
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        for (size_t k = 0; k < 4; ++k) {
+            sums[k] += values[i + k];
+        }
+    }
+    for (; i < len; ++i) {
+        sums[0] += values[i];
+    }
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+}
+
+EBUR128::EBUR128(double rate, size_t channels, bool truePeak)
     : mChannelCount{channels}
     , mRate{rate}
     , mBlockSize(ceil(0.4 * mRate))  // 400 ms blocks
     , mBlockOverlap(ceil(0.1 * mRate))  // 100 ms overlap
+    , mMeasureTruePeak{truePeak}
 {
     mLoudnessHist.reinit(HIST_BIN_COUNT, false);
     mBlockRingBuffer.reinit(mBlockSize);
@@ -29,6 +78,15 @@ EBUR128::EBUR128(double rate, size_t channels)
         mWeightingFilter[channel][0].Reset();
         mWeightingFilter[channel][1].Reset();
     }
+
+    const auto weighting = CalcWeightingFilter(mRate);
+    mWeighting = BiquadCascade{ weighting.get(), 2, mChannelCount };
+    mWeighted.reinit(mChannelCount, ChunkSize);
+    if (mMeasureTruePeak) {
+        mTruePeakHistory.reinit(mChannelCount, TruePeakTaps - 1, true);
+        mTruePeakInput.reinit(TruePeakTaps - 1 + ChunkSize);
+        mTruePeakOutput.reinit(ChunkSize);
+    }
 }
 
 // fs: sample rate
@@ -96,20 +154,125 @@ void EBUR128::ProcessSampleFromChannel(float x_in, size_t channel) const
 
 void EBUR128::NextSample()
 {
+    mSegmentPower += mBlockRingBuffer[mBlockRingPos];
+    ++mSegmentLength;
     ++mBlockRingPos;
     ++mBlockRingSize;
+    ++mSampleCount;
+    EndRun();
+}
+
+void EBUR128::ProcessSamples(const float* const* channels, size_t len)
+{
+    std::vector<const float*> in(mChannelCount);
+    std::vector<float*> weighted(mChannelCount);
+    for (size_t channel = 0; channel < mChannelCount; ++channel) {
+        weighted[channel] = mWeighted[channel].get();
+    }
+    for (size_t start = 0; start < len; start += ChunkSize) {
+        const auto count = std::min(ChunkSize, len - start);
+        for (size_t channel = 0; channel < mChannelCount; ++channel) {
+            in[channel] = channels[channel] + start;
+        }
+        mWeighting.Process(in.data(), weighted.data(), count);
+        if (mMeasureTruePeak) {
+            MeasureTruePeak(in.data(), count);
+        }
+
+        // Fill the ring in runs that stop where NextSample() would check
+        // for a complete block
+        for (size_t i = 0; i < count;) {
+            const auto run = std::min({ count - i,
+                                        mBlockOverlap - mBlockRingPos % mBlockOverlap,
+                                        mBlockSize - mBlockRingPos });
+            const auto powers = mBlockRingBuffer.get() + mBlockRingPos;
+            std::fill(powers, powers + run, 0.0);
+            for (size_t channel = 0; channel < mChannelCount; ++channel) {
+                // Add the power of all channels, as ProcessSampleFromChannel
+                const auto samples = weighted[channel] + i;
+                for (size_t j = 0; j < run; ++j) {
+                    powers[j] += double(samples[j]) * samples[j];
+                }
+            }
+            mSegmentPower += Sum(powers, run);
+            mSegmentLength += run;
+            mBlockRingPos += run;
+            mBlockRingSize += run;
+            mSampleCount += run;
+            i += run;
+            EndRun();
+        }
+    }
+}
 
-    if (mBlockRingPos % mBlockOverlap == 0) {
+void EBUR128::EndRun()
+{
+    const bool blockBoundary = mBlockRingPos % mBlockOverlap == 0;
+    if (blockBoundary) {
         // A new full block of samples was submitted.
         if (mBlockRingSize >= mBlockSize) {
             AddBlockToHistogram(mBlockSize);
         }
     }
+    if (blockBoundary || mBlockRingPos == mBlockSize) {
+        mSegments.emplace_back(mSegmentPower, mSegmentLength);
+        mSegmentPower = 0;
+        mSegmentLength = 0;
+        // Keep just enough segments for ShortTermLoudness()
+        const size_t shortTermSize = ceil(3 * mRate);
+        size_t total = 0;
+        for (const auto& segment : mSegments) {
+            total += segment.second;
+        }
+        while (total - mSegments.front().second >= shortTermSize) {
+            total -= mSegments.front().second;
+            mSegments.erase(mSegments.begin());
+        }
+    }
     // Close the ring.
     if (mBlockRingPos == mBlockSize) {
         mBlockRingPos = 0;
     }
-    ++mSampleCount;
+}
+
+void EBUR128::MeasureTruePeak(const float* const* channels, size_t len)
+{
+    constexpr auto historySize = TruePeakTaps - 1;
+    const auto input = mTruePeakInput.get();
+    const auto output = mTruePeakOutput.get();
+    constexpr size_t PeakLanes = 8;
+    float peaks[PeakLanes] {};
+    for (size_t channel = 0; channel < mChannelCount; ++channel) {
+        const auto history = mTruePeakHistory[channel].get();
+        std::copy(history, history + historySize, input);
+        std::copy(channels[channel], channels[channel] + len,
+                  input + historySize);
+        for (const auto& coefficients : TruePeakCoefficients) {
+            // One tap at a time, over all samples, which vectorizes
+            std::fill(output, output + len, 0.0f);
+            for (size_t tap = 0; tap < TruePeakTaps; ++tap) {
+                const auto coefficient = coefficients[tap];
+                const auto x = input + tap;
+                for (size_t i = 0; i < len; ++i) {
+                    output[i] += coefficient * x[i];
+                }
+            }
+            // Lanes of maxima, which vectorize, unlike one running maximum
+            size_t i = 0;
+            for (; i + PeakLanes <= len; i += PeakLanes) {
+                for (size_t k = 0; k < PeakLanes; ++k) {
+                    peaks[k] = std::max(peaks[k], std::abs(output[i + k]));
+                }
+            }
+            for (; i < len; ++i) {
+                peaks[0] = std::max(peaks[0], std::abs(output[i]));
+            }
+        }
+        std::copy(input + len, input + len + historySize, history);
+    }
+    for (const auto peak : peaks) {
+        mTruePeak = std::max<double>(mTruePeak, peak);
+    }
 }
 
 double EBUR128::IntegrativeLoudness()
@@ -142,7 +305,33 @@ double EBUR128::IntegrativeLoudness()
         return 0;
     }
     // LUFS is defined as -0.691 dB + 10*log10(sum(channels))
-    return 0.8529037031 * sum_v / sum_c;
+    return LoudnessScale * sum_v / sum_c;
+}
+
+double EBUR128::MomentaryLoudness() const
+{
+    return RecentLoudness(mBlockSize);
+}
+
+double EBUR128::ShortTermLoudness() const
+{
+    return RecentLoudness(ceil(3 * mRate));
+}
+
+double EBUR128::RecentLoudness(size_t len) const
+{
+    // Readouts change only at block boundaries, ten times a second
+    double power = 0;
+    size_t count = 0;
+    for (auto iter = mSegments.rbegin();
+         iter != mSegments.rend() && count < len; ++iter) {
+        power += iter->first;
+        count += iter->second;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    return LoudnessScale * power / count;
 }
 
 void
@@ -171,10 +360,7 @@ void EBUR128::AddBlockToHistogram(size_t validLen)
     mBlockRingSize = mBlockSize;
 
     size_t idx;
-    double blockVal = 0;
-    for (size_t i = 0; i < validLen; ++i) {
-        blockVal += mBlockRingBuffer[i];
-    }
+    double blockVal = Sum(mBlockRingBuffer.get(), validLen);
 
     // Histogram values are simplified log10() immediate values
     // without -0.691 + 10*(...) to safe computing power. This is
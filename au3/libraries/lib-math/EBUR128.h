@@ -12,16 +12,27 @@ Max Maisel
 #define __EBUR128_H__
 
 #include "Biquad.h"
+#include "BiquadCascade.h"
 #include <memory>
 #include "SampleFormat.h"
 
 #include <cmath>
+#include <utility>
+#include <vector>
 
 /// \brief Implements EBU-R128 loudness measurement.
+/*!
+ Samples may be given one at a time, with ProcessSampleFromChannel() and
+ NextSample(), or a block of all channels at once, with ProcessSamples(),
+ which is much faster.  Do not mix the two on one object.
+ */
 class MATH_API EBUR128
 {
 public:
-    EBUR128(double rate, size_t channels);
+    /*!
+     @param truePeak whether ProcessSamples() also measures TruePeak()
+     */
+    EBUR128(double rate, size_t channels, bool truePeak = false);
     EBUR128(const EBUR128&) = delete;
     EBUR128(EBUR128&&) = delete;
     ~EBUR128() = default;
@@ -29,13 +40,32 @@ public:
     static ArrayOf<Biquad> CalcWeightingFilter(double fs);
     void ProcessSampleFromChannel(float x_in, size_t channel) const;
     void NextSample();
+
+    //! Process `len` samples of each channel
+    void ProcessSamples(const float* const* channels, size_t len);
+
     double IntegrativeLoudness();
+    //! Loudness of the last 400 ms, in the units of IntegrativeLoudness()
+    double MomentaryLoudness() const;
+    //! Loudness of the last 3 s, in the units of IntegrativeLoudness()
+    double ShortTermLoudness() const;
     inline double IntegrativeLoudnessToLUFS(double loudness)
     { return 10 * log10(loudness); }
 
+    //! Greatest absolute value of any channel, oversampled four times
+    /*! Zero unless constructed with `truePeak`; measured by ProcessSamples()
+     only */
+    double TruePeak() const { return mTruePeak; }
+    static double TruePeakToDBTP(double peak) { return 20 * log10(peak); }
+
 private:
     void HistogramSums(size_t start_idx, double& sum_v, long int& sum_c) const;
     void AddBlockToHistogram(size_t validLen);
+    //! Called when mBlockRingPos has advanced, maybe to a boundary
+    void EndRun();
+    //! Loudness of the most recent segments covering `len` samples
+    double RecentLoudness(size_t len) const;
+    void MeasureTruePeak(const float* const* channels, size_t len);
 
     static constexpr size_t HIST_BIN_COUNT = 65536;
     /// EBU R128 absolute threshold
@@ -55,6 +85,25 @@ private:
     /// CHANNEL = LEFT/RIGHT (0/1) and
     /// FILTER  = HSF/HPF    (0/1)
     ArrayOf<ArrayOf<Biquad> > mWeightingFilter;
+
+    //! The same filters for ProcessSamples(), all channels at once
+    BiquadCascade mWeighting;
+    //! Weighted samples of each channel, for ProcessSamples()
+    FloatBuffers mWeighted;
+
+    //! Sum of powers and length of each period between two block
+    //! boundaries, the oldest first, for MomentaryLoudness() and
+    //! ShortTermLoudness()
+    std::vector<std::pair<double, size_t> > mSegments;
+    double mSegmentPower{ 0 };
+    size_t mSegmentLength{ 0 };
+
+    const bool mMeasureTruePeak;
+    //! Last samples of each channel, for the oversampling filter
+    FloatBuffers mTruePeakHistory;
+    Floats mTruePeakInput;
+    Floats mTruePeakOutput;
+    double mTruePeak{ 0 };
 };
 
 #endif
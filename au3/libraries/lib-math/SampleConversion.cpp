@@ -0,0 +1,563 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleConversion.cpp
+
+**********************************************************************/
+#include "SampleConversion.h"
+
+// Erik de Castro Lopo's header file that
+// makes sure that we have lrint and lrintf
+// (Note: this file should be included first)
+#include "float_cast.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) \
+    || (defined(__i386__) && defined(__SSE2__)) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAMPLE_CONVERSION_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SAMPLE_CONVERSION_AVX2
+#define SAMPLE_CONVERSION_TARGET_AVX2
+#elif defined(__GNUC__)
+#define SAMPLE_CONVERSION_AVX2
+#define SAMPLE_CONVERSION_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SAMPLE_CONVERSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace SampleConversion {
+namespace {
+constexpr float Int16Scale = 1.0f / (1 << 15);
+constexpr float Int24Scale = 1.0f / (1 << 23);
+constexpr int Int24Min = -8388608;
+constexpr int Int24Max = 8388607;
+// Noise is made from the 24 high bits of each generator lane
+constexpr float NoiseScale = 1.0f / (1 << 24);
+
+void ScalarInt16ToFloat(const short* src, float* dst, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] = src[i] * Int16Scale;
+    }
+}
+
+void ScalarInt24ToFloat(const int* src, float* dst, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] = src[i] * Int24Scale;
+    }
+}
+
+void ScalarClipAndScale(const float* src, float* dst, size_t len, float scale)
+{
+    for (size_t i = 0; i < len; ++i) {
+        const auto sample = src[i];
+        dst[i] = (sample > 1.0f ? 1.0f
+                  : sample < -1.0f ? -1.0f
+                  : sample) * scale;
+    }
+}
+
+void ScalarRoundToInt16(const float* src, short* dst, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        const int x = lrintf(src[i]);
+        dst[i] = static_cast<short>(std::clamp(x, -32768, 32767));
+    }
+}
+
+void ScalarRoundToInt24(const float* src, int* dst, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        const int x = lrintf(src[i]);
+        dst[i] = std::clamp(x, Int24Min, Int24Max);
+    }
+}
+
+void ScalarFillNoise(NoiseGenerator& generator, float* dst, size_t len)
+{
+    for (size_t i = 0; i < len; i += NoiseGenerator::Lanes) {
+        for (size_t lane = 0; lane < NoiseGenerator::Lanes; ++lane) {
+            auto x = generator.state[lane];
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            generator.state[lane] = x;
+            dst[i + lane] = static_cast<int>(x >> 8) * NoiseScale - 0.5f;
+        }
+    }
+}
+
+void ScalarGather16(const short* src, size_t stride, short* dst, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] = src[i * stride];
+    }
+}
+
+void ScalarGather32(const int* src, size_t stride, int* dst, size_t len)
+{
+    // Float samples come here too, so copy bits rather than ints
+    for (size_t i = 0; i < len; ++i) {
+        std::memcpy(dst + i, src + i * stride, sizeof(int));
+    }
+}
+
+#ifdef SAMPLE_CONVERSION_SSE2
+void Sse2Int16ToFloat(const short* src, float* dst, size_t len)
+{
+    const auto scale = _mm_set1_ps(Int16Scale);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // Sign extend by placing the samples in the high halves
+        const auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        const auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    ScalarInt16ToFloat(src + i, dst + i, len - i);
+}
+
+void Sse2Int24ToFloat(const int* src, float* dst, size_t len)
+{
+    const auto scale = _mm_set1_ps(Int24Scale);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+    ScalarInt24ToFloat(src + i, dst + i, len - i);
+}
+
+void Sse2ClipAndScale(const float* src, float* dst, size_t len, float scale)
+{
+    const auto vscale = _mm_set1_ps(scale);
+    const auto one = _mm_set1_ps(1.0f);
+    const auto minusOne = _mm_set1_ps(-1.0f);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        // Operand order matters: minps and maxps return the second operand
+        // when either is NaN, so NaN passes through as in the scalar code
+        const auto x = _mm_loadu_ps(src + i);
+        const auto clipped = _mm_max_ps(minusOne, _mm_min_ps(one, x));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(clipped, vscale));
+    }
+    ScalarClipAndScale(src + i, dst + i, len - i, scale);
+}
+
+void Sse2RoundToInt16(const float* src, short* dst, size_t len)
+{
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        // cvtps2dq rounds to nearest even, like lrintf; packssdw saturates
+        const auto lo = _mm_cvtps_epi32(_mm_loadu_ps(src + i));
+        const auto hi = _mm_cvtps_epi32(_mm_loadu_ps(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packs_epi32(lo, hi));
+    }
+    ScalarRoundToInt16(src + i, dst + i, len - i);
+}
+
+void Sse2RoundToInt24(const float* src, int* dst, size_t len)
+{
+    // SSE2 has no 32 bit integer min and max, so select with masks
+    const auto min = _mm_set1_epi32(Int24Min);
+    const auto max = _mm_set1_epi32(Int24Max);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        auto x = _mm_cvtps_epi32(_mm_loadu_ps(src + i));
+        const auto above = _mm_cmpgt_epi32(x, max);
+        x = _mm_or_si128(_mm_and_si128(above, max), _mm_andnot_si128(above, x));
+        const auto below = _mm_cmplt_epi32(x, min);
+        x = _mm_or_si128(_mm_and_si128(below, min), _mm_andnot_si128(below, x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), x);
+    }
+    ScalarRoundToInt24(src + i, dst + i, len - i);
+}
+
+inline __m128 Sse2NextNoise(__m128i& x)
+{
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    return _mm_sub_ps(
+        _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)),
+                   _mm_set1_ps(NoiseScale)),
+        _mm_set1_ps(0.5f));
+}
+
+void Sse2FillNoise(NoiseGenerator& generator, float* dst, size_t len)
+{
+    auto lo = _mm_load_si128(reinterpret_cast<const __m128i*>(generator.state));
+    auto hi
+        =_mm_load_si128(reinterpret_cast<const __m128i*>(generator.state + 4));
+    for (size_t i = 0; i < len; i += NoiseGenerator::Lanes) {
+        _mm_storeu_ps(dst + i, Sse2NextNoise(lo));
+        _mm_storeu_ps(dst + i + 4, Sse2NextNoise(hi));
+    }
+    _mm_store_si128(reinterpret_cast<__m128i*>(generator.state), lo);
+    _mm_store_si128(reinterpret_cast<__m128i*>(generator.state + 4), hi);
+}
+
+// The vector loops of the gathers stop one frame early: their last load
+// would otherwise read past the end of the buffer for the last channel
+void Sse2Gather16(const short* src, size_t stride, short* dst, size_t len)
+{
+    if (stride != 2) {
+        ScalarGather16(src, stride, dst, len);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 8 < len; i += 8) {
+        const auto a
+            =_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        const auto b
+            =_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 8));
+        // Sign extend the even samples to 32 bits; packing them back
+        // then cannot saturate
+        const auto lo = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        const auto hi = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packs_epi32(lo, hi));
+    }
+    ScalarGather16(src + 2 * i, stride, dst + i, len - i);
+}
+
+void Sse2Gather32(const int* src, size_t stride, int* dst, size_t len)
+{
+    if (stride != 2) {
+        ScalarGather32(src, stride, dst, len);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 4 < len; i += 4) {
+        const auto a
+            =_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        const auto b
+            =_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 4));
+        // Integer shuffles, so that float NaNs keep their bits
+        const auto even = _mm_unpacklo_epi64(
+            _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0)),
+            _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), even);
+    }
+    ScalarGather32(src + 2 * i, stride, dst + i, len - i);
+}
+#endif
+
+#ifdef SAMPLE_CONVERSION_AVX2
+SAMPLE_CONVERSION_TARGET_AVX2
+void Avx2Int16ToFloat(const short* src, float* dst, size_t len)
+{
+    const auto scale = _mm256_set1_ps(Int16Scale);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const auto x = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    ScalarInt16ToFloat(src + i, dst + i, len - i);
+}
+
+SAMPLE_CONVERSION_TARGET_AVX2
+void Avx2Int24ToFloat(const int* src, float* dst, size_t len)
+{
+    const auto scale = _mm256_set1_ps(Int24Scale);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const auto x
+            =_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    ScalarInt24ToFloat(src + i, dst + i, len - i);
+}
+
+SAMPLE_CONVERSION_TARGET_AVX2
+void Avx2ClipAndScale(const float* src, float* dst, size_t len, float scale)
+{
+    const auto vscale = _mm256_set1_ps(scale);
+    const auto one = _mm256_set1_ps(1.0f);
+    const auto minusOne = _mm256_set1_ps(-1.0f);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        // See Sse2ClipAndScale about the operand order
+        const auto x = _mm256_loadu_ps(src + i);
+        const auto clipped = _mm256_max_ps(minusOne, _mm256_min_ps(one, x));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(clipped, vscale));
+    }
+    ScalarClipAndScale(src + i, dst + i, len - i, scale);
+}
+
+SAMPLE_CONVERSION_TARGET_AVX2
+void Avx2RoundToInt16(const float* src, short* dst, size_t len)
+{
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const auto lo = _mm256_cvtps_epi32(_mm256_loadu_ps(src + i));
+        const auto hi = _mm256_cvtps_epi32(_mm256_loadu_ps(src + i + 8));
+        // packssdw works within 128 bit lanes; restore the order afterwards
+        const auto packed = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    ScalarRoundToInt16(src + i, dst + i, len - i);
+}
+
+SAMPLE_CONVERSION_TARGET_AVX2
+void Avx2RoundToInt24(const float* src, int* dst, size_t len)
+{
+    const auto min = _mm256_set1_epi32(Int24Min);
+    const auto max = _mm256_set1_epi32(Int24Max);
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const auto x = _mm256_cvtps_epi32(_mm256_loadu_ps(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_max_epi32(min, _mm256_min_epi32(max, x)));
+    }
+    ScalarRoundToInt24(src + i, dst + i, len - i);
+}
+
+SAMPLE_CONVERSION_TARGET_AVX2
+void Avx2FillNoise(NoiseGenerator& generator, float* dst, size_t len)
+{
+    const auto scale = _mm256_set1_ps(NoiseScale);
+    const auto half = _mm256_set1_ps(0.5f);
+    auto x
+        =_mm256_load_si256(reinterpret_cast<const __m256i*>(generator.state));
+    for (size_t i = 0; i < len; i += NoiseGenerator::Lanes) {
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+        x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+        const auto noise = _mm256_sub_ps(
+            _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), scale),
+            half);
+        _mm256_storeu_ps(dst + i, noise);
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(generator.state), x);
+}
+
+bool HasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // The processor and the operating system must both support AVX
+    __cpuid(info, 1);
+    constexpr int osxsave = 1 << 27, avx = 1 << 28;
+    if ((info[2] & (osxsave | avx)) != (osxsave | avx)
+        || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#ifdef SAMPLE_CONVERSION_NEON
+void NeonInt16ToFloat(const short* src, float* dst, size_t len)
+{
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const auto x = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_n_f32(
+                      vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), Int16Scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(
+                      vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), Int16Scale));
+    }
+    ScalarInt16ToFloat(src + i, dst + i, len - i);
+}
+
+void NeonInt24ToFloat(const int* src, float* dst, size_t len)
+{
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        vst1q_f32(dst + i,
+                  vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), Int24Scale));
+    }
+    ScalarInt24ToFloat(src + i, dst + i, len - i);
+}
+
+void NeonClipAndScale(const float* src, float* dst, size_t len, float scale)
+{
+    const auto one = vdupq_n_f32(1.0f);
+    const auto minusOne = vdupq_n_f32(-1.0f);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        // fmin and fmax propagate NaN, as the scalar code does
+        const auto x = vld1q_f32(src + i);
+        const auto clipped = vmaxq_f32(minusOne, vminq_f32(one, x));
+        vst1q_f32(dst + i, vmulq_n_f32(clipped, scale));
+    }
+    ScalarClipAndScale(src + i, dst + i, len - i, scale);
+}
+
+void NeonRoundToInt16(const float* src, short* dst, size_t len)
+{
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const auto lo = vcvtnq_s32_f32(vld1q_f32(src + i));
+        const auto hi = vcvtnq_s32_f32(vld1q_f32(src + i + 4));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+    ScalarRoundToInt16(src + i, dst + i, len - i);
+}
+
+void NeonRoundToInt24(const float* src, int* dst, size_t len)
+{
+    const auto min = vdupq_n_s32(Int24Min);
+    const auto max = vdupq_n_s32(Int24Max);
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        const auto x = vcvtnq_s32_f32(vld1q_f32(src + i));
+        vst1q_s32(dst + i, vmaxq_s32(min, vminq_s32(max, x)));
+    }
+    ScalarRoundToInt24(src + i, dst + i, len - i);
+}
+
+inline float32x4_t NeonNextNoise(uint32x4_t& x)
+{
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    x = veorq_u32(x, vshlq_n_u32(x, 5));
+    return vsubq_f32(
+        vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(x, 8)), NoiseScale),
+        vdupq_n_f32(0.5f));
+}
+
+void NeonFillNoise(NoiseGenerator& generator, float* dst, size_t len)
+{
+    auto lo = vld1q_u32(generator.state);
+    auto hi = vld1q_u32(generator.state + 4);
+    for (size_t i = 0; i < len; i += NoiseGenerator::Lanes) {
+        vst1q_f32(dst + i, NeonNextNoise(lo));
+        vst1q_f32(dst + i + 4, NeonNextNoise(hi));
+    }
+    vst1q_u32(generator.state, lo);
+    vst1q_u32(generator.state + 4, hi);
+}
+
+// As for SSE2, the vector loops stop one frame early
+void NeonGather16(const short* src, size_t stride, short* dst, size_t len)
+{
+    if (stride != 2) {
+        ScalarGather16(src, stride, dst, len);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 8 < len; i += 8) {
+        vst1q_s16(dst + i, vld2q_s16(src + 2 * i).val[0]);
+    }
+    ScalarGather16(src + 2 * i, stride, dst + i, len - i);
+}
+
+void NeonGather32(const int* src, size_t stride, int* dst, size_t len)
+{
+    if (stride != 2) {
+        ScalarGather32(src, stride, dst, len);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 4 < len; i += 4) {
+        vst1q_s32(dst + i, vld2q_s32(src + 2 * i).val[0]);
+    }
+    ScalarGather32(src + 2 * i, stride, dst + i, len - i);
+}
+#endif
+
+const Kernels scalarKernels {
+    "scalar",
+    ScalarInt16ToFloat, ScalarInt24ToFloat, ScalarClipAndScale,
+    ScalarRoundToInt16, ScalarRoundToInt24, ScalarFillNoise,
+    ScalarGather16, ScalarGather32,
+};
+
+#ifdef SAMPLE_CONVERSION_SSE2
+const Kernels sse2Kernels {
+    "sse2",
+    Sse2Int16ToFloat, Sse2Int24ToFloat, Sse2ClipAndScale,
+    Sse2RoundToInt16, Sse2RoundToInt24, Sse2FillNoise,
+    Sse2Gather16, Sse2Gather32,
+};
+#endif
+
+#ifdef SAMPLE_CONVERSION_AVX2
+const Kernels avx2Kernels {
+    "avx2",
+    Avx2Int16ToFloat, Avx2Int24ToFloat, Avx2ClipAndScale,
+    Avx2RoundToInt16, Avx2RoundToInt24, Avx2FillNoise,
+    Sse2Gather16, Sse2Gather32,
+};
+#endif
+
+#ifdef SAMPLE_CONVERSION_NEON
+const Kernels neonKernels {
+    "neon",
+    NeonInt16ToFloat, NeonInt24ToFloat, NeonClipAndScale,
+    NeonRoundToInt16, NeonRoundToInt24, NeonFillNoise,
+    NeonGather16, NeonGather32,
+};
+#endif
+} // namespace
+
+NoiseGenerator::NoiseGenerator(uint32_t seed)
+{
+    // Decorrelate the lanes with a splitmix style hash of the seed;
+    // xorshift must not start from zero
+    for (size_t lane = 0; lane < Lanes; ++lane) {
+        uint32_t x = seed + static_cast<uint32_t>(lane + 1) * 0x9E3779B9u;
+        x = (x ^ (x >> 16)) * 0x85EBCA6Bu;
+        x = (x ^ (x >> 13)) * 0xC2B2AE35u;
+        x ^= x >> 16;
+        state[lane] = x ? x : 1;
+    }
+}
+
+const Kernels& ScalarKernels()
+{
+    return scalarKernels;
+}
+
+size_t AvailableKernels(const Kernels* result[4])
+{
+    size_t count = 0;
+    result[count++] = &scalarKernels;
+#ifdef SAMPLE_CONVERSION_SSE2
+    result[count++] = &sse2Kernels;
+#endif
+#ifdef SAMPLE_CONVERSION_AVX2
+    if (HasAvx2()) {
+        result[count++] = &avx2Kernels;
+    }
+#endif
+#ifdef SAMPLE_CONVERSION_NEON
+    result[count++] = &neonKernels;
+#endif
+    return count;
+}
+
+const Kernels& GetKernels()
+{
+    static const Kernels& kernels = []() -> const Kernels& {
+        const Kernels* available[4];
+        return *available[AvailableKernels(available) - 1];
+    }();
+    return kernels;
+}
+} // namespace SampleConversion
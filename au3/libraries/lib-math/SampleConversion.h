@@ -0,0 +1,74 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleConversion.h
+  @brief Vectorized kernels for sample format conversion and dither
+
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//! Low level kernels used by Dither::Apply
+/*!
+ The conversions work on contiguous buffers; the gathers make contiguous
+ copies of interleaved channels for them.
+
+ Conversions reproduce exactly the results of the scalar code that
+ preceded them: integer to float is an exact scaling, float to integer
+ rounds to nearest (ties to even, as lrintf does in the default rounding
+ mode) then clips.  NaN converts as the processor's own float to integer
+ conversion does, like lrintf.
+ */
+namespace SampleConversion {
+
+//! Generator of uniform dither noise
+/*!
+ Eight independent xorshift32 lanes, advanced together, so that every
+ kernel set produces the same sequence whatever its vector width
+ */
+struct MATH_API NoiseGenerator {
+    static constexpr size_t Lanes = 8;
+
+    explicit NoiseGenerator(uint32_t seed = 0x9E3779B9u);
+
+    alignas(32) uint32_t state[Lanes];
+};
+
+struct Kernels {
+    //! Human readable name of the instruction set, for tests and benchmarks
+    const char* name;
+
+    //! dst[i] = src[i] / 2^15
+    void (*Int16ToFloat)(const short* src, float* dst, size_t len);
+    //! dst[i] = src[i] / 2^23
+    void (*Int24ToFloat)(const int* src, float* dst, size_t len);
+    //! dst[i] = clamp(src[i], -1, 1) * scale; NaN passes through
+    void (*ClipAndScale)(const float* src, float* dst, size_t len, float scale);
+    //! Round scaled samples to nearest and clip to the 16 bit range
+    void (*RoundToInt16)(const float* src, short* dst, size_t len);
+    //! Round scaled samples to nearest and clip to the 24 bit range
+    void (*RoundToInt24)(const float* src, int* dst, size_t len);
+    //! Fill with noise uniformly distributed in [-0.5, 0.5)
+    /*! @pre `len` is a multiple of NoiseGenerator::Lanes */
+    void (*FillNoise)(NoiseGenerator& generator, float* dst, size_t len);
+    //! dst[i] = src[i * stride] for 16 bit samples
+    /*! Vectorized for stereo, a stride of 2; other strides copy one by one */
+    void (*Gather16)(const short* src, size_t stride, short* dst, size_t len);
+    //! dst[i] = src[i * stride] for 32 bit samples, int or float, bit exact
+    void (*Gather32)(const int* src, size_t stride, int* dst, size_t len);
+};
+
+//! Portable implementation, the reference for the others
+MATH_API const Kernels& ScalarKernels();
+
+//! The fastest kernels supported by the processor, chosen on first use
+MATH_API const Kernels& GetKernels();
+
+//! All kernel sets usable on this processor, the scalar ones first
+/*! @return the number of entries written to `result`, at most 4 */
+MATH_API size_t AvailableKernels(const Kernels* result[4]);
+} // namespace SampleConversion
@@ -0,0 +1,62 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  BiquadCascadeBenchmark.cpp
+
+  Run with the "[benchmark]" tag
+
+**********************************************************************/
+#include "Biquad.h"
+#include "BiquadCascade.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+// A typical effect processing block
+constexpr size_t blockSize = 4096;
+} // namespace
+
+TEST_CASE("BiquadCascade benchmark", "[benchmark][.]")
+{
+    // The steepest filter that the Filter Curve... Classic Filters effect offers
+    const int order = Biquad::MAX_Order;
+    const size_t nSections = (order + 1) / 2;
+    auto sections = Biquad::CalcButterworthFilter(
+        order, 22050, 1000, Biquad::kLowPass);
+
+    std::vector<float> left(blockSize), right(blockSize);
+    for (size_t i = 0; i < blockSize; ++i) {
+        left[i] = std::sin(0.05f * i);
+        right[i] = std::cos(0.07f * i);
+    }
+
+    BENCHMARK("Biquad sections, stereo")
+    {
+        for (auto channel : { &left, &right }) {
+            for (size_t i = 0; i < nSections; ++i) {
+                sections[i].Process(channel->data(), channel->data(), blockSize);
+            }
+        }
+        return left[0];
+    };
+
+    BiquadCascade stereo{ sections.get(), nSections, 2 };
+    float* channels[] { left.data(), right.data() };
+    BENCHMARK("BiquadCascade, stereo")
+    {
+        stereo.Process(channels, channels, blockSize);
+        return left[0];
+    };
+
+    BiquadCascade mono{ sections.get(), nSections, 1 };
+    BENCHMARK("BiquadCascade, mono")
+    {
+        mono.Process(channels, channels, blockSize);
+        return left[0];
+    };
+}
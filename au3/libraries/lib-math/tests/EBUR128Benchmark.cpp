@@ -0,0 +1,56 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  EBUR128Benchmark.cpp
+
+  Run with the "[benchmark]" tag
+
+**********************************************************************/
+#include "EBUR128.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+constexpr double rate = 44100;
+// One minute of stereo
+constexpr size_t length = 60 * 44100;
+// A typical effect processing block
+constexpr size_t blockSize = 4096;
+} // namespace
+
+TEST_CASE("EBUR128 benchmark", "[benchmark][.]")
+{
+    std::vector<float> left(length), right(length);
+    for (size_t i = 0; i < length; ++i) {
+        left[i] = 0.5f * std::sin(0.05f * i);
+        right[i] = 0.5f * std::cos(0.07f * i);
+    }
+
+    BENCHMARK("Sample by sample")
+    {
+        EBUR128 meter{ rate, 2 };
+        for (size_t i = 0; i < length; ++i) {
+            meter.ProcessSampleFromChannel(left[i], 0);
+            meter.ProcessSampleFromChannel(right[i], 1);
+            meter.NextSample();
+        }
+        return meter.IntegrativeLoudness();
+    };
+
+    for (const auto truePeak : { false, true }) {
+        BENCHMARK(truePeak ? "Blocks, with true peak" : "Blocks")
+        {
+            EBUR128 meter{ rate, 2, truePeak };
+            for (size_t start = 0; start < length; start += blockSize) {
+                const float* channels[] { left.data() + start, right.data() + start };
+                meter.ProcessSamples(channels, std::min(blockSize, length - start));
+            }
+            return meter.IntegrativeLoudness();
+        };
+    }
+}
@@ -0,0 +1,110 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  EBUR128Tests.cpp
+
+**********************************************************************/
+#include "EBUR128.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+constexpr double Rate = 48000;
+constexpr double Pi = 3.14159265358979323846;
+
+std::vector<float> Sine(size_t len, double frequency, double amplitude,
+                        double phase = 0)
+{
+    std::vector<float> result(len);
+    for (size_t i = 0; i < len; ++i) {
+        result[i] = amplitude * std::sin(2 * Pi * frequency * i / Rate + phase);
+    }
+    return result;
+}
+
+double LUFS(EBUR128& meter, double loudness)
+{
+    return meter.IntegrativeLoudnessToLUFS(loudness);
+}
+}
+
+TEST_CASE("EBUR128")
+{
+    // Ten seconds of a 1 kHz tone at -20 dBFS:  the loudness of a full scale
+    // tone in one channel is -3.01 LUFS
+    const size_t len = 10 * Rate;
+    const auto left = Sine(len, 1000, 0.1);
+    const auto right = Sine(len, 1000, 0.1);
+
+    SECTION("measures a tone")
+    {
+        EBUR128 meter{ Rate, 1 };
+        const float* channels[] { left.data() };
+        meter.ProcessSamples(channels, len);
+        REQUIRE(LUFS(meter, meter.IntegrativeLoudness()) == Approx(-23.01).margin(0.05));
+        REQUIRE(LUFS(meter, meter.MomentaryLoudness()) == Approx(-23.01).margin(0.05));
+        REQUIRE(LUFS(meter, meter.ShortTermLoudness()) == Approx(-23.01).margin(0.05));
+    }
+
+    SECTION("agrees with the sample by sample interface")
+    {
+        // Varying loudness, so that gating matters
+        auto louder = Sine(len, 440, 0.5);
+        for (size_t i = 0; i < len / 3; ++i) {
+            louder[i] *= 0.01f;
+        }
+        EBUR128 bySample{ Rate, 2 };
+        for (size_t i = 0; i < len; ++i) {
+            bySample.ProcessSampleFromChannel(louder[i], 0);
+            bySample.ProcessSampleFromChannel(right[i], 1);
+            bySample.NextSample();
+        }
+
+        EBUR128 byBlock{ Rate, 2 };
+        // Odd sized blocks, not aligned with the gating blocks
+        for (size_t start = 0; start < len; start += 4999) {
+            const float* channels[] { louder.data() + start, right.data() + start };
+            byBlock.ProcessSamples(channels, std::min<size_t>(4999, len - start));
+        }
+
+        REQUIRE(byBlock.IntegrativeLoudness()
+                == Approx(bySample.IntegrativeLoudness()).epsilon(1e-4));
+        REQUIRE(byBlock.MomentaryLoudness()
+                == Approx(bySample.MomentaryLoudness()).epsilon(1e-4));
+        REQUIRE(byBlock.ShortTermLoudness()
+                == Approx(bySample.ShortTermLoudness()).epsilon(1e-4));
+    }
+
+    SECTION("reads out the last 400 ms and the last 3 s")
+    {
+        // Loud, then for the last second, 20 dB quieter
+        auto tone = Sine(len, 1000, 1.0);
+        for (size_t i = len - Rate; i < len; ++i) {
+            tone[i] *= 0.1f;
+        }
+        EBUR128 meter{ Rate, 1 };
+        const float* channels[] { tone.data() };
+        meter.ProcessSamples(channels, len);
+        REQUIRE(LUFS(meter, meter.MomentaryLoudness()) == Approx(-23.01).margin(0.05));
+        // Two seconds loud, one quiet
+        const auto shortTerm = 10 * std::log10((2 + 0.01) / 3) - 3.01;
+        REQUIRE(LUFS(meter, meter.ShortTermLoudness()) == Approx(shortTerm).margin(0.05));
+    }
+
+    SECTION("finds peaks between samples")
+    {
+        // At a quarter of the rate, with this phase, every sample misses the
+        // peak by 3 dB
+        const auto tone = Sine(Rate, Rate / 4, 0.5, Pi / 4);
+        EBUR128 meter{ Rate, 2, true };
+        const float* channels[] { tone.data(), left.data() };
+        meter.ProcessSamples(channels, Rate);
+        REQUIRE(meter.TruePeak() == Approx(0.5).margin(0.01));
+        REQUIRE(EBUR128::TruePeakToDBTP(meter.TruePeak()) == Approx(-6.02).margin(0.2));
+    }
+}
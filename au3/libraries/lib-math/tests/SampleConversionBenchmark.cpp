@@ -0,0 +1,107 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleConversionBenchmark.cpp
+
+  Run with the "[benchmark]" tag
+
+**********************************************************************/
+#include "Dither.h"
+#include "SampleConversion.h"
+#include "SampleFormat.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+// A typical export or playback block
+constexpr size_t blockSize = 4096;
+
+std::vector<float> MakeSignal(size_t size)
+{
+    std::vector<float> signal(size);
+    for (size_t i = 0; i < size; ++i) {
+        signal[i] = 1.1f * std::sin(0.05f * i);
+    }
+    return signal;
+}
+} // namespace
+
+TEST_CASE("SampleConversion kernels benchmark", "[benchmark][.]")
+{
+    const auto signal = MakeSignal(blockSize);
+    std::vector<float> scaled(blockSize);
+    std::vector<short> int16s(blockSize);
+    std::vector<int> int24s(blockSize);
+    const SampleConversion::Kernels* available[4];
+    const auto count = SampleConversion::AvailableKernels(available);
+    for (size_t k = 0; k < count; ++k) {
+        const auto& kernels = *available[k];
+        const std::string name = kernels.name;
+        BENCHMARK(name + " float to int16")
+        {
+            kernels.ClipAndScale(signal.data(), scaled.data(), blockSize, 32768);
+            kernels.RoundToInt16(scaled.data(), int16s.data(), blockSize);
+            return int16s[0];
+        };
+        BENCHMARK(name + " float to int24")
+        {
+            kernels.ClipAndScale(signal.data(), scaled.data(), blockSize, 8388608);
+            kernels.RoundToInt24(scaled.data(), int24s.data(), blockSize);
+            return int24s[0];
+        };
+        BENCHMARK(name + " int16 to float")
+        {
+            kernels.Int16ToFloat(int16s.data(), scaled.data(), blockSize);
+            return scaled[0];
+        };
+        std::vector<int> stereo(2 * blockSize);
+        BENCHMARK(name + " gather stereo int24")
+        {
+            kernels.Gather32(stereo.data() + 1, 2, int24s.data(), blockSize);
+            return int24s[0];
+        };
+        SampleConversion::NoiseGenerator generator;
+        BENCHMARK(name + " noise")
+        {
+            kernels.FillNoise(generator, scaled.data(), blockSize);
+            return scaled[0];
+        };
+    }
+}
+
+TEST_CASE("CopySamples benchmark", "[benchmark][.]")
+{
+    // Interleaving stereo, as export does
+    const auto signal = MakeSignal(blockSize);
+    std::vector<short> interleaved(2 * blockSize);
+    const std::pair<DitherType, const char*> dithers[] = {
+        { DitherType::none, "none" },
+        { DitherType::rectangle, "rectangle" },
+        { DitherType::triangle, "triangle" },
+        { DitherType::shaped, "shaped" },
+    };
+    for (const auto& [type, name] : dithers) {
+        BENCHMARK(std::string { "float to interleaved int16, dither " } + name)
+        {
+            for (unsigned channel = 0; channel < 2; ++channel) {
+                CopySamples(reinterpret_cast<constSamplePtr>(signal.data()), floatSample,
+                            reinterpret_cast<samplePtr>(interleaved.data() + channel),
+                            int16Sample, blockSize, type, 1, 2);
+            }
+            return interleaved[0];
+        };
+    }
+    std::vector<float> deinterleaved(blockSize);
+    BENCHMARK("interleaved int16 to float")
+    {
+        SamplesToFloats(reinterpret_cast<constSamplePtr>(interleaved.data()), int16Sample,
+                        deinterleaved.data(), blockSize, 2, 1);
+        return deinterleaved[0];
+    };
+}
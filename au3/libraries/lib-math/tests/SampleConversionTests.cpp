@@ -0,0 +1,222 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleConversionTests.cpp
+
+**********************************************************************/
+#include "Dither.h"
+#include "SampleConversion.h"
+#include "SampleFormat.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+std::vector<const SampleConversion::Kernels*> AllKernels()
+{
+    const SampleConversion::Kernels* kernels[4];
+    const auto count = SampleConversion::AvailableKernels(kernels);
+    return { kernels, kernels + count };
+}
+
+//! Samples slightly beyond full scale, with rounding ties and extremes
+std::vector<float> MakeFloats(size_t size)
+{
+    std::mt19937 engine { 42 };
+    std::uniform_real_distribution<float> distribution { -1.25f, 1.25f };
+    std::vector<float> samples(size);
+    for (auto& sample : samples) {
+        sample = distribution(engine);
+    }
+    const float special[] = {
+        1.0f, -1.0f, 0.0f, -0.0f, 0.5f / 32768, 1.5f / 32768, -2.5f / 32768,
+        32767.5f / 32768, -32768.5f / 32768, 1e30f, -1e30f,
+    };
+    std::copy(std::begin(special), std::end(special), samples.begin());
+    return samples;
+}
+
+//! What Dither::Apply did sample by sample before it was vectorized
+template<typename Int>
+Int Reference(float sample, float scale, int min, int max)
+{
+    const auto clipped = sample > 1.0f ? 1.0f : sample < -1.0f ? -1.0f : sample;
+    return static_cast<Int>(std::clamp<int>(lrintf(clipped * scale), min, max));
+}
+} // namespace
+
+TEST_CASE("SampleConversion kernels agree with the scalar ones")
+{
+    const auto& scalar = SampleConversion::ScalarKernels();
+    // Odd length, to exercise the tails
+    constexpr size_t size = 1031;
+    const auto floats = MakeFloats(size);
+    std::vector<short> int16s(size);
+    std::vector<int> int24s(size);
+    for (size_t i = 0; i < size; ++i) {
+        int16s[i] = Reference<short>(floats[i], 32768, -32768, 32767);
+        int24s[i] = Reference<int>(floats[i], 8388608, -8388608, 8388607);
+    }
+
+    for (const auto kernels : AllKernels()) {
+        SECTION(kernels->name)
+        {
+            std::vector<float> expected(size), actual(size);
+
+            scalar.Int16ToFloat(int16s.data(), expected.data(), size);
+            kernels->Int16ToFloat(int16s.data(), actual.data(), size);
+            REQUIRE(actual == expected);
+
+            scalar.Int24ToFloat(int24s.data(), expected.data(), size);
+            kernels->Int24ToFloat(int24s.data(), actual.data(), size);
+            REQUIRE(actual == expected);
+
+            scalar.ClipAndScale(floats.data(), expected.data(), size, 32768);
+            kernels->ClipAndScale(floats.data(), actual.data(), size, 32768);
+            REQUIRE(actual == expected);
+
+            std::vector<short> rounded16(size);
+            kernels->RoundToInt16(actual.data(), rounded16.data(), size);
+            REQUIRE(rounded16 == int16s);
+
+            std::vector<int> rounded24(size);
+            kernels->ClipAndScale(floats.data(), actual.data(), size, 8388608);
+            kernels->RoundToInt24(actual.data(), rounded24.data(), size);
+            REQUIRE(rounded24 == int24s);
+
+            constexpr auto noiseSize = 8 * SampleConversion::NoiseGenerator::Lanes;
+            SampleConversion::NoiseGenerator scalarGenerator, generator;
+            std::vector<float> expectedNoise(noiseSize), noise(noiseSize);
+            for (auto repeat = 0; repeat < 3; ++repeat) {
+                scalar.FillNoise(scalarGenerator, expectedNoise.data(), noiseSize);
+                kernels->FillNoise(generator, noise.data(), noiseSize);
+                REQUIRE(noise == expectedNoise);
+            }
+            REQUIRE(std::all_of(noise.begin(), noise.end(), [](float x) {
+                return x >= -0.5f && x < 0.5f;
+            }));
+        }
+    }
+}
+
+TEST_CASE("SampleConversion gathers agree with the scalar ones")
+{
+    for (const auto kernels : AllKernels()) {
+        SECTION(kernels->name)
+        {
+            for (size_t stride = 1; stride <= 3; ++stride) {
+                for (size_t len = 1; len <= 41; ++len) {
+                    // Gather the last channel from a buffer of exactly the
+                    // size needed, so that overreads are caught by sanitizers
+                    const auto size = len * stride;
+                    std::vector<short> int16s(size);
+                    std::vector<int> int32s(size);
+                    for (size_t i = 0; i < size; ++i) {
+                        int16s[i] = static_cast<short>(i * 2741 - 32768);
+                        // Includes signalling NaN patterns, kept bit exact
+                        int32s[i] = static_cast<int>(0x7F800001u + i * 0x01234567u);
+                    }
+                    const auto offset = stride - 1;
+
+                    std::vector<short> expected16(len), actual16(len);
+                    std::vector<int> expected32(len), actual32(len);
+                    for (size_t i = 0; i < len; ++i) {
+                        expected16[i] = int16s[i * stride + offset];
+                        expected32[i] = int32s[i * stride + offset];
+                    }
+                    kernels->Gather16(int16s.data() + offset, stride,
+                                      actual16.data(), len);
+                    kernels->Gather32(int32s.data() + offset, stride,
+                                      actual32.data(), len);
+                    REQUIRE(actual16 == expected16);
+                    REQUIRE(actual32 == expected32);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("CopySamples without dither is exact")
+{
+    constexpr size_t frames = 1000;
+    constexpr unsigned channels = 3;
+    const auto floats = MakeFloats(frames * channels);
+
+    SECTION("float to interleaved int16")
+    {
+        std::vector<short> interleaved(frames * channels);
+        for (unsigned channel = 0; channel < channels; ++channel) {
+            CopySamples(reinterpret_cast<constSamplePtr>(floats.data() + channel * frames),
+                        floatSample,
+                        reinterpret_cast<samplePtr>(interleaved.data() + channel),
+                        int16Sample, frames, DitherType::none, 1, channels);
+        }
+        for (size_t i = 0; i < frames * channels; ++i) {
+            const auto channel = i % channels, frame = i / channels;
+            REQUIRE(interleaved[i]
+                    == Reference<short>(floats[channel * frames + frame], 32768, -32768, 32767));
+        }
+    }
+
+    SECTION("interleaved float to int24")
+    {
+        std::vector<int> deinterleaved(frames);
+        CopySamples(reinterpret_cast<constSamplePtr>(floats.data() + 1), floatSample,
+                    reinterpret_cast<samplePtr>(deinterleaved.data()), int24Sample,
+                    frames, DitherType::none, channels, 1);
+        for (size_t i = 0; i < frames; ++i) {
+            REQUIRE(deinterleaved[i]
+                    == Reference<int>(floats[i * channels + 1], 8388608, -8388608, 8388607));
+        }
+    }
+
+    SECTION("int24 to int16 and back to float")
+    {
+        std::vector<int> int24s(frames);
+        for (size_t i = 0; i < frames; ++i) {
+            int24s[i] = static_cast<int>(i * 16777) - 8388608;
+        }
+        std::vector<short> int16s(frames);
+        CopySamples(reinterpret_cast<constSamplePtr>(int24s.data()), int24Sample,
+                    reinterpret_cast<samplePtr>(int16s.data()), int16Sample,
+                    frames, DitherType::none);
+        std::vector<float> floats(frames);
+        SamplesToFloats(reinterpret_cast<constSamplePtr>(int16s.data()), int16Sample,
+                        floats.data(), frames);
+        for (size_t i = 0; i < frames; ++i) {
+            REQUIRE(int16s[i] == std::clamp<int>(lrintf(int24s[i] / 256.0f), -32768, 32767));
+            REQUIRE(floats[i] == int16s[i] / 32768.0f);
+        }
+    }
+}
+
+TEST_CASE("Dither stays within its noise amplitude")
+{
+    constexpr size_t size = 2000;
+    std::vector<float> floats(size);
+    for (size_t i = 0; i < size; ++i) {
+        floats[i] = 0.5f * std::sin(0.01f * i);
+    }
+    const auto [type, amplitude] = GENERATE(
+        std::make_pair(DitherType::rectangle, 1),
+        std::make_pair(DitherType::triangle, 1),
+        std::make_pair(DitherType::shaped, 32));
+    std::vector<short> dithered(size);
+    CopySamples(reinterpret_cast<constSamplePtr>(floats.data()), floatSample,
+                reinterpret_cast<samplePtr>(dithered.data()), int16Sample, size, type);
+    auto differences = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const auto exact = std::lrint(floats[i] * 32768);
+        REQUIRE(std::abs(dithered[i] - exact) <= amplitude);
+        differences += dithered[i] != exact;
+    }
+    // Noise was actually added
+    REQUIRE(differences > 0);
+}
@@ -29,6 +29,7 @@ a draggable point type.
 
 #include "Envelope.h"
 
+#include <algorithm>
 #include <float.h>
 #include <math.h>
 
@@ -960,6 +961,19 @@ void Envelope::BinarySearchForTime(int& Lo, int& Hi, double t) const noexcept
     Lo = -1;
     Hi = mEnv.size();
 
+    // When zoomed far out, t may have moved on over many points:  gallop ahead
+    // from the guess, in doubling strides, then bisect only the last stride
+    if (mSearchGuess >= 0 && mSearchGuess < Hi
+        && t >= mEnv[mSearchGuess].GetT()) {
+        Lo = mSearchGuess;
+        int stride = 1;
+        while (Lo + stride < Hi && t >= mEnv[Lo + stride].GetT()) {
+            Lo += stride;
+            stride *= 2;
+        }
+        Hi = std::min(Hi, Lo + stride);
+    }
+
     // Invariants:  Lo is not less than -1, Hi not more than size
     while (Hi > (Lo + 1)) {
         int mid = (Lo + Hi) / 2;
@@ -1022,6 +1036,41 @@ void Envelope::GetValues(double* buffer, int bufferLen,
     GetValuesRelative(buffer, bufferLen, t0, tstep);
 }
 
+// Fill with an arithmetic progression.  Each value is computed independently
+// of the others, so the loop vectorizes, and roundoff does not accumulate.
+static void FillLinearRamp(double* buffer, int len, double start, double step)
+{
+    for (int ii = 0; ii < len; ++ii) {
+        buffer[ii] = start + ii * step;
+    }
+}
+
+// Fill with a geometric progression.  Lanes of consecutive values each advance
+// by the same stride, so the loop vectorizes, and roundoff accumulates over
+// only len / Lanes multiplications.
+static void FillExponentialRamp(
+    double* buffer, int len, double start, double ratio)
+{
+    constexpr int Lanes = 8;
+    double lanes[Lanes];
+    lanes[0] = start;
+    for (int jj = 1; jj < Lanes; ++jj) {
+        lanes[jj] = lanes[jj - 1] * ratio;
+    }
+    const auto stride = pow(ratio, Lanes);
+
+    int ii = 0;
+    for (; ii + Lanes <= len; ii += Lanes) {
+        for (int jj = 0; jj < Lanes; ++jj) {
+            buffer[ii + jj] = lanes[jj];
+            lanes[jj] *= stride;
+        }
+    }
+    for (int jj = 0; ii < len; ++ii, ++jj) {
+        buffer[ii] = lanes[jj];
+    }
+}
+
 void Envelope::GetValuesRelative
     (double* buffer, int bufferLen, double t0, double tstep, bool leftLimit)
 const noexcept
@@ -1032,106 +1081,127 @@ const noexcept
     const auto epsilon = tstep / 2;
     int len = mEnv.size();
 
-    double t = t0;
+    // IF empty envelope THEN default value
+    if (len <= 0) {
+        std::fill(buffer, buffer + std::max(0, bufferLen), mDefaultValue);
+        return;
+    }
+
     double increment = 0;
-    if (len > 1 && t <= mEnv[0].GetT() && mEnv[0].GetT() == mEnv[1].GetT()) {
+    if (len > 1 && t0 <= mEnv[0].GetT() && mEnv[0].GetT() == mEnv[1].GetT()) {
         increment = leftLimit ? -epsilon : epsilon;
     }
 
-    double tprev, vprev, tnext = 0, vnext, vstep = 0;
-
-    for (int b = 0; b < bufferLen; b++) {
-        // Get easiest cases out the way first...
-        // IF empty envelope THEN default value
-        if (len <= 0) {
-            buffer[b] = mDefaultValue;
-            t += tstep;
-            continue;
+    // Rather than test each sample time, the buffer is filled in runs of
+    // samples that are all before the envelope, all after it, or all in one
+    // point-to-point interval.  Sample times are computed from the index, not
+    // accumulated, so that the ends of runs can be found directly.
+    const auto tFirst = mEnv[0].GetT();
+    const auto tLast = mEnv[len - 1].GetT();
+    const auto timeAt = [&](int b) { return t0 + b * tstep; };
+    const auto isBefore = [&](int b) {
+        const auto tplus = timeAt(b) + increment;
+        return leftLimit ? tplus <= tFirst : tplus < tFirst;
+    };
+    const auto isAfter = [&](int b) {
+        const auto tplus = timeAt(b) + increment;
+        return leftLimit ? tplus > tLast : tplus >= tLast;
+    };
+    // Given that sample b belongs to a run, find the first sample after it for
+    // which inRun fails.  Times never decrease, so that sample is estimated
+    // from the time tEnd where the run stops, then corrected for roundoff.
+    const auto endOfRun = [&](int b, double tEnd, const auto& inRun) {
+        int end = bufferLen;
+        if (tstep > 0) {
+            end = static_cast<int>(std::clamp<double>(
+                ceil((tEnd - increment - t0) / tstep), b + 1, bufferLen));
         }
+        while (end > b + 1 && !inRun(end - 1)) {
+            --end;
+        }
+        while (end < bufferLen && inRun(end)) {
+            ++end;
+        }
+        return end;
+    };
 
-        auto tplus = t + increment;
-
+    for (int b = 0; b < bufferLen;) {
         // IF before envelope THEN first value
-        if (leftLimit ? tplus <= mEnv[0].GetT() : tplus < mEnv[0].GetT()) {
-            buffer[b] = mEnv[0].GetVal();
-            t += tstep;
+        if (isBefore(b)) {
+            const auto end = endOfRun(b, tFirst, isBefore);
+            std::fill(buffer + b, buffer + end, mEnv[0].GetVal());
+            b = end;
             continue;
         }
-        // IF after envelope THEN last value
-        if (leftLimit
-            ? tplus > mEnv[len - 1].GetT() : tplus >= mEnv[len - 1].GetT()) {
-            buffer[b] = mEnv[len - 1].GetVal();
-            t += tstep;
-            continue;
+        // IF after envelope THEN last value, for the rest of the buffer
+        if (isAfter(b)) {
+            std::fill(buffer + b, buffer + bufferLen, mEnv[len - 1].GetVal());
+            break;
         }
 
-        // be careful to get the correct limit even in case epsilon == 0
-        if (b == 0
-            || (leftLimit ? tplus > tnext : tplus >= tnext)) {
-            // We're beyond our tnext, so find the next one.
-            // Don't just increment lo or hi because we might
-            // be zoomed far out and that could be a large number of
-            // points to move over.  That's why we binary search.
-
-            int lo, hi;
-            if (leftLimit) {
-                BinarySearchForTime_LeftLimit(lo, hi, tplus);
-            } else {
-                BinarySearchForTime(lo, hi, tplus);
-            }
-
-            // mEnv[0] is before tplus because of eliminations above, therefore lo >= 0
-            // mEnv[len - 1] is after tplus, therefore hi <= len - 1
-            wxASSERT(lo >= 0 && hi <= len - 1);
-
-            tprev = mEnv[lo].GetT();
-            tnext = mEnv[hi].GetT();
-
-            if (hi + 1 < len && tnext == mEnv[ hi + 1 ].GetT()) {
-                // There is a discontinuity after this point-to-point interval.
-                // Usually will stop evaluating in this interval when time is slightly
-                // before tNext, then use the right limit.
-                // This is the right intent
-                // in case small roundoff errors cause a sample time to be a little
-                // before the envelope point time.
-                // Less commonly we want a left limit, so we continue evaluating in
-                // this interval until shortly after the discontinuity.
-                increment = leftLimit ? -epsilon : epsilon;
-            } else {
-                increment = 0;
-            }
-
-            vprev = GetInterpolationStartValueAtPoint(lo);
-            vnext = GetInterpolationStartValueAtPoint(hi);
+        // Find the interval containing this time.  The search remembers where
+        // it was, so the next interval, in this call or the next, is found
+        // quickly.
+        const auto t = timeAt(b);
+        const auto tplus = t + increment;
+        int lo, hi;
+        if (leftLimit) {
+            BinarySearchForTime_LeftLimit(lo, hi, tplus);
+        } else {
+            BinarySearchForTime(lo, hi, tplus);
+        }
 
-            // Interpolate, either linear or log depending on mDB.
-            double dt = (tnext - tprev);
-            double to = t - tprev;
-            double v;
-            if (dt > 0.0) {
-                v = (vprev * (dt - to) + vnext * to) / dt;
-                vstep = (vnext - vprev) * tstep / dt;
-            } else {
-                v = vnext;
-                vstep = 0.0;
-            }
+        // mEnv[0] is before tplus because of eliminations above, therefore lo >= 0
+        // mEnv[len - 1] is after tplus, therefore hi <= len - 1
+        wxASSERT(lo >= 0 && hi <= len - 1);
+
+        const auto tprev = mEnv[lo].GetT();
+        const auto tnext = mEnv[hi].GetT();
+
+        if (hi + 1 < len && tnext == mEnv[ hi + 1 ].GetT()) {
+            // There is a discontinuity after this point-to-point interval.
+            // Usually will stop evaluating in this interval when time is slightly
+            // before tNext, then use the right limit.
+            // This is the right intent
+            // in case small roundoff errors cause a sample time to be a little
+            // before the envelope point time.
+            // Less commonly we want a left limit, so we continue evaluating in
+            // this interval until shortly after the discontinuity.
+            increment = leftLimit ? -epsilon : epsilon;
+        } else {
+            increment = 0;
+        }
 
-            // An adjustment if logarithmic scale.
-            if (mDB) {
-                v = pow(10.0, v);
-                vstep = pow(10.0, vstep);
-            }
+        const auto vprev = GetInterpolationStartValueAtPoint(lo);
+        const auto vnext = GetInterpolationStartValueAtPoint(hi);
 
-            buffer[b] = v;
+        // Interpolate, either linear or log depending on mDB.
+        double dt = (tnext - tprev);
+        double to = t - tprev;
+        double v, vstep;
+        if (dt > 0.0) {
+            v = (vprev * (dt - to) + vnext * to) / dt;
+            vstep = (vnext - vprev) * tstep / dt;
         } else {
-            if (mDB) {
-                buffer[b] = buffer[b - 1] * vstep;
-            } else {
-                buffer[b] = buffer[b - 1] + vstep;
-            }
+            v = vnext;
+            vstep = 0.0;
         }
 
-        t += tstep;
+        // be careful to get the correct limit even in case epsilon == 0
+        const auto inInterval = [&](int bb) {
+            const auto tplus = timeAt(bb) + increment;
+            return leftLimit ? tplus <= tnext : tplus < tnext;
+        };
+        const auto end = endOfRun(b, tnext, inInterval);
+
+        // An adjustment if logarithmic scale.
+        if (mDB) {
+            FillExponentialRamp(
+                buffer + b, end - b, pow(10.0, v), pow(10.0, vstep));
+        } else {
+            FillLinearRamp(buffer + b, end - b, v, vstep);
+        }
+        b = end;
     }
 }
 
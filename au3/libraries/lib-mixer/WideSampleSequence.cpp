@@ -22,6 +22,10 @@ double WideSampleSequence::LongSamplesToTime(sampleCount pos) const
     return pos.as_double() / GetRate();
 }
 
+void WideSampleSequence::Prefetch(double, double) const
+{
+}
+
 double WideSampleSequence::SnapToSample(double t) const
 {
     return LongSamplesToTime(TimeToLongSamples(t));
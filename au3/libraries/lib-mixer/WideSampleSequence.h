@@ -122,6 +122,14 @@ public:
      */
     virtual void GetEnvelopeValues(
         double* buffer, size_t bufferLen, double t0, bool backwards) const = 0;
+
+    //! Load into memory what fetches of the time interval would read, so that
+    //! they need not wait for storage later
+    /*!
+     May block; meant for a thread other than the one that fetches.
+     Default does nothing.
+     */
+    virtual void Prefetch(double t0, double t1) const;
 };
 
 #endif
@@ -0,0 +1,115 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  EnvelopeTests.cpp
+
+**********************************************************************/
+#include "Envelope.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+constexpr double Rate = 44100;
+constexpr double SampleDur = 1 / Rate;
+constexpr size_t BlockSize = 512;
+
+//! Points at the given spacing, with values cycling between 0.1 and 1.7
+void AddPoints(Envelope& envelope, int count, double spacing)
+{
+    for (int ii = 0; ii < count; ++ii) {
+        envelope.Insert(ii * spacing, 0.1 + (ii % 17) * 0.1);
+    }
+}
+
+//! Evaluate in consecutive blocks, as a mixer does
+std::vector<double> Evaluate(const Envelope& envelope, double t0, size_t count)
+{
+    std::vector<double> result(count);
+    for (size_t start = 0; start < count; start += BlockSize) {
+        const auto len = std::min(BlockSize, count - start);
+        envelope.GetValues(result.data() + start, len,
+                           t0 + start * SampleDur, SampleDur);
+    }
+    return result;
+}
+
+//! Block evaluation must agree with evaluation one sample at a time
+void RequireAgreement(const Envelope& envelope, double t0, size_t count)
+{
+    const auto values = Evaluate(envelope, t0, count);
+    for (size_t ii = 0; ii < count; ++ii) {
+        const auto expected
+            =envelope.GetValue(t0 + ii * SampleDur, SampleDur);
+        REQUIRE(values[ii] == Approx(expected).epsilon(1e-9));
+    }
+}
+}
+
+TEST_CASE("Envelope::GetValues")
+{
+    SECTION("interpolates linearly")
+    {
+        Envelope envelope{ false, 0, 2, 1 };
+        AddPoints(envelope, 100, 0.01);
+        RequireAgreement(envelope, -0.1, 60000);
+        const auto values = Evaluate(envelope, 0.005, 1);
+        REQUIRE(values[0] == Approx(0.15));
+    }
+
+    SECTION("interpolates exponentially")
+    {
+        Envelope envelope{ true, 0.01, 2, 1 };
+        AddPoints(envelope, 100, 0.01);
+        RequireAgreement(envelope, -0.1, 60000);
+        const auto values = Evaluate(envelope, 0.005, 1);
+        REQUIRE(values[0] == Approx(sqrt(0.1 * 0.2)));
+    }
+
+    SECTION("steps at discontinuities")
+    {
+        Envelope envelope{ false, 0, 2, 1 };
+        envelope.Insert(0.0, 0.5);
+        envelope.Insert(0.5, 0.5);
+        envelope.Insert(0.5, 1.5);
+        envelope.Insert(1.0, 1.5);
+        RequireAgreement(envelope, 0, 44100);
+        const auto values = Evaluate(envelope, 0, 44100);
+        REQUIRE(values[22049] == Approx(0.5));
+        REQUIRE(values[22050] == Approx(1.5));
+    }
+
+    SECTION("skips many points between samples")
+    {
+        Envelope envelope{ false, 0, 2, 1 };
+        AddPoints(envelope, 10000, SampleDur / 7);
+        RequireAgreement(envelope, 0, 2000);
+    }
+
+    SECTION("uses the default value when empty")
+    {
+        Envelope envelope{ false, 0, 2, 0.75 };
+        for (const auto value : Evaluate(envelope, 0, 1000)) {
+            REQUIRE(value == 0.75);
+        }
+    }
+}
+
+TEST_CASE("Envelope::GetValues benchmark", "[benchmark][.]")
+{
+    // Gain automation with many points, played through in blocks
+    for (const auto exponential : { false, true }) {
+        Envelope envelope{ exponential, 0.01, 2, 1 };
+        AddPoints(envelope, 10000, 0.01);
+        const auto count = static_cast<size_t>(100 * Rate);
+        BENCHMARK(exponential ? "10000 exponential points"
+                  : "10000 linear points")
+        {
+            return Evaluate(envelope, 0, count);
+        };
+    }
+}
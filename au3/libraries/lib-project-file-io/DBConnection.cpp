@@ -15,12 +15,17 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #include <wx/string.h>
 
+#include <algorithm>
+
 #include "AudacityLogger.h"
 #include "BasicUI.h"
+#include "DisplayDataStore.h"
 #include "FileNames.h"
 #include "Internat.h"
+#include "Prefs.h"
 #include "Project.h"
 #include "FileException.h"
+#include "SampleBlockWriter.h"
 #include "wxFileNameWrapper.h"
 #include "SentryHelper.h"
 
@@ -33,6 +38,8 @@ static const char* PageSizeConfig
     ="PRAGMA <schema>.page_size = " xstr(AUDACITY_PROJECT_PAGE_SIZE) ";"
                                                                      "VACUUM;";
 
+IntSetting ProjectFileMmapSize{ L"/ProjectFileIO/MmapSize", 256 };
+
 // Configuration to provide "safe" connections
 static const char* SafeConfig
     ="PRAGMA <schema>.busy_timeout = 5000;"
@@ -58,6 +65,7 @@ DBConnection::DBConnection(
 {
     mDB = nullptr;
     mCheckpointDB = nullptr;
+    mBlockWriterDB = nullptr;
     mBypass = false;
 }
 
@@ -147,6 +155,11 @@ int DBConnection::Open(const FilePath fileName)
     mCheckpointActive = false;
     rc = OpenStepByStep(fileName);
     if (rc != SQLITE_OK) {
+        if (mBlockWriterDB) {
+            sqlite3_close(mBlockWriterDB);
+            mBlockWriterDB = nullptr;
+        }
+
         if (mCheckpointDB) {
             sqlite3_close(mCheckpointDB);
             mCheckpointDB = nullptr;
@@ -194,6 +207,8 @@ int DBConnection::OpenStepByStep(const FilePath fileName)
         return rc;
     }
 
+    SetMmapSize();
+
     rc = sqlite3_open(name, &mCheckpointDB);
     if (rc != SQLITE_OK) {
         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
@@ -218,6 +233,31 @@ int DBConnection::OpenStepByStep(const FilePath fileName)
 
     // Install our checkpoint hook
     sqlite3_wal_hook(mDB, CheckpointHook, this);
+
+    if (AsyncBlockCommits.Read()) {
+        rc = sqlite3_open(name, &mBlockWriterDB);
+        if (rc != SQLITE_OK) {
+            ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+            ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::OpenStepByStep::open_block_writer");
+
+            wxLogMessage("Failed to open block writer connection to %s: %d, %s\n",
+                         fileName,
+                         rc,
+                         sqlite3_errstr(rc));
+            return rc;
+        }
+
+        rc = ModeConfig(mBlockWriterDB, "main", SafeConfig);
+        if (rc != SQLITE_OK) {
+            SetDBError(XO("Failed to set safe mode on block writer connection to %s").Format(fileName));
+            return rc;
+        }
+
+        mpBlockWriter = std::make_unique<SampleBlockWriter>(mDB, mBlockWriterDB, mTransactionMutex,
+                                                            [this](int rc, const std::string& message){
+            SetDBError(XO("Failed to insert sample blocks"), Verbatim(message), rc);
+        });
+    }
     return rc;
 }
 
@@ -231,6 +271,14 @@ bool DBConnection::Close()
         return true;
     }
 
+    // Insert all pending sample blocks, and stop the thread doing that,
+    // while the statements are still valid
+    if (mpBlockWriter) {
+        FlushBlockWriter();
+        mpBlockWriter.reset();
+    }
+    mpDisplayDataStore.reset();
+
     // Uninstall our checkpoint hook so that no additional checkpoints
     // are sent our way.  (Though this shouldn't really happen.)
     sqlite3_wal_hook(mDB, nullptr, nullptr);
@@ -292,6 +340,21 @@ bool DBConnection::Close()
 
     // Not much we can do if the closes fail, so just report the error
 
+    // Close the block writer connection, after the writer stopped
+    if (mBlockWriterDB) {
+        rc = sqlite3_close(mBlockWriterDB);
+        if (rc != SQLITE_OK) {
+            ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+            ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::Close::close_block_writer");
+
+            wxLogMessage("Failed to close block writer connection for %s\n"
+                         "\tError: %s\n",
+                         sqlite3_db_filename(mBlockWriterDB, nullptr),
+                         sqlite3_errmsg(mBlockWriterDB));
+        }
+        mBlockWriterDB = nullptr;
+    }
+
     // Close the checkpoint connection
     rc = sqlite3_close(mCheckpointDB);
     if (rc != SQLITE_OK) {
@@ -371,6 +434,14 @@ int DBConnection::SetPageSize(const char* schema)
     return ModeConfig(mDB, schema, PageSizeConfig);
 }
 
+int DBConnection::SetMmapSize(const char* schema)
+{
+    const auto config = "PRAGMA <schema>.mmap_size = "
+                        + std::to_string(std::max(0, ProjectFileMmapSize.Read()) * (1LL << 20))
+                        + ";";
+    return ModeConfig(mDB, schema, config.c_str());
+}
+
 int DBConnection::ModeConfig(sqlite3* db, const char* schema, const char* config)
 {
     // Ensure attached DB connection gets configured
@@ -399,6 +470,184 @@ int DBConnection::ModeConfig(sqlite3* db, const char* schema, const char* config
     return rc;
 }
 
+// CREATE SQL summarypyramids
+// Summaries at the distance scales between and below those of sampleblocks,
+// as encoded by SampleBlockSummary::EncodeLevel(), coarsest first so that
+// reading one does not page through the finer ones.
+//
+// Older versions ignore this table.  It is added to their projects only when
+// the first summaries are stored.  Rows are optional:  what is missing is
+// computed when needed.
+const char* const DBConnection::SummaryPyramidsSchema
+    ="CREATE TABLE IF NOT EXISTS <schema>.summarypyramids"
+     "("
+     "  blockid              INTEGER PRIMARY KEY,"
+     "  summary16k           BLOB,"
+     "  summary4k            BLOB,"
+     "  summary1k            BLOB,"
+     "  summary64            BLOB,"
+     "  summary16            BLOB"
+     ");";
+
+// CREATE SQL displaycache
+// Data computed for display, as by WaveDataCache, keyed by hashes of what
+// it was computed from, and managed by DisplayDataStore.  Like
+// summarypyramids, older versions ignore it, and it is added to their projects
+// when the first data are stored.
+const char* const DBConnection::DisplayCacheSchema
+    ="CREATE TABLE IF NOT EXISTS <schema>.displaycache"
+     "("
+     "  key                  INTEGER PRIMARY KEY,"
+     "  used                 INTEGER,"
+     "  data                 BLOB"
+     ");";
+
+bool DBConnection::HasTable(std::atomic<int>& known, const char* name)
+{
+    auto result = known.load();
+    if (result < 0) {
+        sqlite3_stmt* stmt = nullptr;
+        result = sqlite3_prepare_v2(mDB,
+                                    "SELECT 1 FROM sqlite_master"
+                                    "  WHERE type = 'table' AND name = ?1;",
+                                    -1, &stmt, nullptr) == SQLITE_OK
+                 && sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC) == SQLITE_OK
+                 && sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+        // Don't overwrite what AddTable() found meanwhile
+        auto expected = -1;
+        if (!known.compare_exchange_strong(expected, result)) {
+            result = expected;
+        }
+    }
+    return result > 0;
+}
+
+bool DBConnection::AddTable(std::atomic<int>& known, const char* schema)
+{
+    if (known.load() > 0) {
+        return true;
+    }
+    // Don't wait, not even for this thread's own transaction scope, which
+    // might roll the table back
+    std::unique_lock<std::recursive_mutex> lock{ mTransactionMutex, std::try_to_lock };
+    if (!lock || !sqlite3_get_autocommit(mDB)) {
+        return false;
+    }
+    wxString sql{ schema };
+    sql.Replace("<schema>", "main");
+    if (sqlite3_exec(mDB, sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+        // Perhaps read-only; try again next time
+        return false;
+    }
+    known.store(1);
+    return true;
+}
+
+bool DBConnection::HasSummaryPyramids()
+{
+    return HasTable(mHasSummaryPyramids, "summarypyramids");
+}
+
+bool DBConnection::EnableSummaryPyramids()
+{
+    return AddTable(mHasSummaryPyramids, SummaryPyramidsSchema);
+}
+
+bool DBConnection::HasDisplayCache()
+{
+    return HasTable(mHasDisplayCache, "displaycache");
+}
+
+bool DBConnection::HasBlockCodecs()
+{
+    auto result = mHasBlockCodecs.load();
+    if (result < 0) {
+        sqlite3_stmt* stmt = nullptr;
+        result = sqlite3_prepare_v2(mDB,
+                                    "SELECT 1 FROM pragma_table_info('sampleblocks', 'main')"
+                                    "  WHERE name = 'codec';",
+                                    -1, &stmt, nullptr) == SQLITE_OK
+                 && sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+        // Don't overwrite what EnableBlockCodecs() found meanwhile
+        auto expected = -1;
+        if (!mHasBlockCodecs.compare_exchange_strong(expected, result)) {
+            result = expected;
+        }
+    }
+    return result > 0;
+}
+
+bool DBConnection::EnableBlockCodecs()
+{
+    if (HasBlockCodecs()) {
+        return true;
+    }
+    // Don't wait, not even for this thread's own transaction scope
+    std::unique_lock<std::recursive_mutex> lock{ mTransactionMutex, std::try_to_lock };
+    if (!lock || !sqlite3_get_autocommit(mDB)) {
+        return false;
+    }
+    // As ProjectFileIO describes the column
+    if (sqlite3_exec(mDB, "ALTER TABLE main.sampleblocks ADD COLUMN codec INTEGER;",
+                     nullptr, nullptr, nullptr) != SQLITE_OK) {
+        // Perhaps read-only, or another thread was reading the table; try
+        // again for the next block
+        return false;
+    }
+    mHasBlockCodecs.store(1);
+    return true;
+}
+
+SampleBlockWriter* DBConnection::GetBlockWriter()
+{
+    return mpBlockWriter.get();
+}
+
+bool DBConnection::FlushBlockWriter()
+{
+    return !mpBlockWriter || mpBlockWriter->Flush();
+}
+
+DisplayDataStore* DBConnection::GetDisplayDataStore(bool create)
+{
+    if (const auto pStore = mpDisplayDataStore.load(std::memory_order_acquire)) {
+        return pStore;
+    }
+    // Not at opening, because older projects get the table only when the
+    // first data are stored
+    if (!create && !HasDisplayCache()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock{ mDisplayDataStoreMutex };
+    if (mpDisplayDataStoreOwner) {
+        return mpDisplayDataStoreOwner.get();
+    }
+    const auto megabytes = DisplayDataStoreSize.Read();
+    if (megabytes <= 0 || !AddTable(mHasDisplayCache, DisplayCacheSchema)) {
+        return nullptr;
+    }
+    auto pStore = std::make_unique<DisplayDataStore>(
+        mDB, static_cast<size_t>(megabytes) * 1024 * 1024);
+    if (!pStore->IsValid()) {
+        return nullptr;
+    }
+    mpDisplayDataStoreOwner = std::move(pStore);
+    mpDisplayDataStore.store(mpDisplayDataStoreOwner.get(), std::memory_order_release);
+    return mpDisplayDataStoreOwner.get();
+}
+
+std::unique_lock<std::recursive_mutex> DBConnection::LockTransactions()
+{
+    return std::unique_lock<std::recursive_mutex>{ mTransactionMutex };
+}
+
+std::unique_lock<std::mutex> DBConnection::LockInsertions()
+{
+    return std::unique_lock<std::mutex>{ mInsertMutex };
+}
+
 sqlite3* DBConnection::DB()
 {
     wxASSERT(mDB != nullptr);
@@ -468,6 +717,29 @@ sqlite3_stmt* DBConnection::Prepare(enum StatementID id, const char* sql)
     return stmt;
 }
 
+std::optional<size_t> DBConnection::ReadBlob(const char* table, const char* column,
+                                             int64_t rowid, void* dest, size_t offset, size_t bytes)
+{
+    // Read only, and closed at once, so that no read transaction stays open
+    // to hold back checkpoints
+    sqlite3_blob* blob = nullptr;
+    if (sqlite3_blob_open(mDB, "main", table, column, rowid, 0, &blob) != SQLITE_OK) {
+        sqlite3_blob_close(blob);
+        return {};
+    }
+    auto closer = finally([blob]{ sqlite3_blob_close(blob); });
+
+    const auto blobBytes = static_cast<size_t>(sqlite3_blob_bytes(blob));
+    offset = std::min(offset, blobBytes);
+    const auto count = std::min(bytes, blobBytes - offset);
+    if (count > 0
+        && sqlite3_blob_read(blob, dest, static_cast<int>(count),
+                             static_cast<int>(offset)) != SQLITE_OK) {
+        return {};
+    }
+    return count;
+}
+
 void DBConnection::CheckpointThread(sqlite3* db, const FilePath& fileName)
 {
     int rc = SQLITE_OK;
@@ -588,6 +860,8 @@ struct DBConnectionTransactionScopeImpl final : TransactionScopeImpl {
     bool TransactionRollback(const wxString& name) override;
 
     DBConnection& mConnection;
+    //! Held from the start of the transaction to the end of this
+    std::unique_lock<std::recursive_mutex> mLock;
 };
 
 static TransactionScope::Factory::Scope scope {
@@ -601,10 +875,32 @@ static TransactionScope::Factory::Scope scope {
         }
     } };
 
-DBConnectionTransactionScopeImpl::~DBConnectionTransactionScopeImpl() = default;
+DBConnectionTransactionScopeImpl::~DBConnectionTransactionScopeImpl()
+{
+    if (mLock) {
+        if (const auto pWriter = mConnection.GetBlockWriter()) {
+            pWriter->EndScope();
+        }
+    }
+}
 
 bool DBConnectionTransactionScopeImpl::TransactionStart(const wxString& name)
 {
+    // Blocks created before the transaction must not be rolled back with it
+    if (!mConnection.FlushBlockWriter()) {
+        return false;
+    }
+
+    // Keep the block writer's connection from waiting for the lock of the
+    // database, while other threads insert blocks within this transaction
+    mLock = mConnection.LockTransactions();
+    if (const auto pWriter = mConnection.GetBlockWriter();
+        pWriter && !pWriter->BeginScope()) {
+        pWriter->EndScope();
+        mLock.unlock();
+        return false;
+    }
+
     char* errmsg = nullptr;
 
     int rc = sqlite3_exec(mConnection.DB(),
@@ -630,6 +926,7 @@ bool DBConnectionTransactionScopeImpl::TransactionCommit(const wxString& name)
 {
     char* errmsg = nullptr;
 
+    const auto lock = mConnection.LockTransactions();
     int rc = sqlite3_exec(mConnection.DB(),
                           wxT("RELEASE ") + name + wxT(";"),
                           nullptr,
@@ -653,6 +950,7 @@ bool DBConnectionTransactionScopeImpl::TransactionRollback(const wxString& name)
 {
     char* errmsg = nullptr;
 
+    auto lock = mConnection.LockTransactions();
     int rc = sqlite3_exec(mConnection.DB(),
                           wxT("ROLLBACK TO ") + name + wxT(";"),
                           nullptr,
@@ -671,6 +969,7 @@ bool DBConnectionTransactionScopeImpl::TransactionRollback(const wxString& name)
     if (rc != SQLITE_OK) {
         return false;
     }
+    lock.unlock();
 
     // Rollback AND REMOVE the transaction
     // -- must do both; rolling back a savepoint only rewinds it
@@ -18,6 +18,7 @@ Paul Licameli -- split from ProjectFileIO.h
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <chrono>
 
@@ -28,6 +29,13 @@ struct sqlite3;
 struct sqlite3_stmt;
 class wxString;
 class AudacityProject;
+class SampleBlockWriter;
+class DisplayDataStore;
+class IntSetting;
+
+//! How much of each project file to read through a memory map, in megabytes;
+//! zero disables it
+PROJECT_FILE_IO_API extern IntSetting ProjectFileMmapSize;
 
 struct DBConnectionErrors
 {
@@ -61,6 +69,8 @@ public:
     int SafeMode(const char* schema = "main");
     int FastMode(const char* schema = "main");
     int SetPageSize(const char* schema = "main");
+    //! Failure is not an error; reading is just slower
+    int SetMmapSize(const char* schema = "main");
 
     bool Assign(sqlite3* handle);
     sqlite3* Detach();
@@ -79,13 +89,92 @@ public:
         InsertSampleBlock,
         DeleteSampleBlock,
         GetSampleBlockSize,
-        GetAllSampleBlocksSize
+        GetAllSampleBlocksSize,
+        GetSummary16,
+        GetSummary64,
+        GetSummary1k,
+        GetSummary4k,
+        GetSummary16k,
+        InsertSummaryPyramid,
+        DeleteSummaryPyramid,
+        LoadEncodedSampleBlock,
+        InsertEncodedSampleBlock
     };
     sqlite3_stmt* Prepare(enum StatementID id, const char* sql);
 
+    //! Copy part of a blob in the main schema straight into memory
+    /*!
+     Unlike sqlite3_column_blob(), this does not first assemble a value that
+     spans several pages in a temporary buffer, and with the memory map, the
+     pages are not copied into the page cache either.
+     @return how many bytes were copied, fewer than `bytes` if the blob ends
+     first; or nullopt if the row could not be read
+     */
+    std::optional<size_t> ReadBlob(const char* table, const char* column, int64_t rowid, void* dest, size_t offset, size_t bytes);
+
+    //! SQL that creates the summarypyramids table in `<schema>`
+    static const char* const SummaryPyramidsSchema;
+    //! SQL that creates the displaycache table in `<schema>`
+    static const char* const DisplayCacheSchema;
+
+    //! Whether the summarypyramids table exists, which projects saved by
+    //! older versions may lack; checked once
+    bool HasSummaryPyramids();
+
+    //! Add the summarypyramids table, unless it is there, so that summaries
+    //! can be stored
+    /*!
+     Older projects get it only then, and not when opened.  Does nothing
+     within a transaction, nor while the block writer inserts.
+     @return whether the table is there
+     */
+    bool EnableSummaryPyramids();
+
+    //! Whether the displaycache table exists, which projects saved by older
+    //! versions may lack; checked once
+    bool HasDisplayCache();
+
+    //! Whether the sampleblocks table has the codec column, which projects
+    //! saved by older versions may lack; checked once
+    bool HasBlockCodecs();
+
+    //! Add the codec column, unless it is there, so that compressed blocks
+    //! can be stored
+    /*!
+     Does nothing within a transaction, which might roll the column back, nor
+     while the block writer inserts, since compression is optional.
+     @return whether the column is there
+     */
+    bool EnableBlockCodecs();
+
     void SetBypass(bool bypass);
     bool ShouldBypass();
 
+    //! Inserts new sample blocks in the background
+    /*! @return null if AsyncBlockCommits was off when the connection opened */
+    SampleBlockWriter* GetBlockWriter();
+
+    //! Wait until all sample blocks queued for insertion are in the database
+    /*! @return false, with the error stored, if any insertion failed */
+    bool FlushBlockWriter();
+
+    //! Data computed for display, kept in the project file
+    /*!
+     @param create whether to add the table if it is missing, as for
+     EnableSummaryPyramids()
+     @return null if DisplayDataStoreSize is zero, or the table is missing
+     */
+    DisplayDataStore* GetDisplayDataStore(bool create = false);
+
+    //! Held by each transaction scope for its whole life, and by the
+    //! SampleBlockWriter for each batch, so that the writer's connection does
+    //! not wait for the lock of the database while a scope holds it
+    std::unique_lock<std::recursive_mutex> LockTransactions();
+
+    //! Must be held while inserting on the primary connection and then
+    //! reading the last inserted row id
+    std::unique_lock<std::mutex> LockInsertions();
+
     //! Just set stored errors
     void SetError(
         const TranslatableString& msg, const TranslatableString& libraryError = {}, int errorCode = {});
@@ -95,6 +184,11 @@ public:
         const TranslatableString& msg, const TranslatableString& libraryError = {}, int errorCode = -1);
 
 private:
+    //! Whether the table `name` exists in the main schema; checked once
+    bool HasTable(std::atomic<int>& known, const char* name);
+    //! Create a table with `schema`, unless `known` says it is there
+    bool AddTable(std::atomic<int>& known, const char* schema);
+
     int OpenStepByStep(const FilePath fileName);
     int ModeConfig(sqlite3* db, const char* schema, const char* config);
 
@@ -105,6 +199,8 @@ private:
     std::weak_ptr<AudacityProject> mpProject;
     sqlite3* mDB;
     sqlite3* mCheckpointDB;
+    //! Used only by the SampleBlockWriter
+    sqlite3* mBlockWriterDB;
 
     std::thread mCheckpointThread;
     std::condition_variable mCheckpointCondition;
@@ -117,6 +213,20 @@ private:
     using StatementIndex = std::pair<enum StatementID, std::thread::id>;
     std::map<StatementIndex, sqlite3_stmt*> mStatements;
 
+    std::recursive_mutex mTransactionMutex;
+    std::mutex mInsertMutex;
+    std::unique_ptr<SampleBlockWriter> mpBlockWriter;
+
+    //! Unknown while negative
+    std::atomic<int> mHasSummaryPyramids{ -1 };
+    std::atomic<int> mHasBlockCodecs{ -1 };
+    std::atomic<int> mHasDisplayCache{ -1 };
+
+    std::mutex mDisplayDataStoreMutex;
+    std::unique_ptr<DisplayDataStore> mpDisplayDataStoreOwner;
+    //! Not null once made; then never changes
+    std::atomic<DisplayDataStore*> mpDisplayDataStore{ nullptr };
+
     std::shared_ptr<DBConnectionErrors> mpErrors;
     CheckpointFailureCallback mCallback;
 
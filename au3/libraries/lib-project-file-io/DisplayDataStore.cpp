@@ -0,0 +1,163 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file DisplayDataStore.cpp
+@brief Implements DisplayDataStore
+
+**********************************************************************/
+
+#include "DisplayDataStore.h"
+
+#include <sqlite3.h>
+
+#include "Prefs.h"
+
+IntSetting DisplayDataStoreSize{ L"/ProjectFileIO/DisplayDataStoreSize", 32 };
+
+DisplayDataStore::DisplayDataStore(sqlite3* db, size_t maxBytes)
+    : mDB{db}
+    , mMaxBytes{maxBytes}
+{
+    // Fails if the table is missing, as in a read-only file of an older version
+    mValid
+        =sqlite3_prepare_v3(mDB,
+                            "SELECT data FROM displaycache WHERE key = ?1;",
+                            -1, SQLITE_PREPARE_PERSISTENT, &mSelectStatement, nullptr) == SQLITE_OK
+          && sqlite3_prepare_v3(mDB,
+                                "UPDATE displaycache SET used = ?2 WHERE key = ?1;",
+                                -1, SQLITE_PREPARE_PERSISTENT, &mTouchStatement, nullptr) == SQLITE_OK
+          && sqlite3_prepare_v3(mDB,
+                                "INSERT OR REPLACE INTO displaycache (key, used, data)"
+                                "                                    VALUES(?1,?2,?3);",
+                                -1, SQLITE_PREPARE_PERSISTENT, &mInsertStatement, nullptr) == SQLITE_OK;
+    if (!mValid) {
+        return;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(mDB,
+                           "SELECT max(used), total(length(data)) FROM displaycache;",
+                           -1, &stmt, nullptr) == SQLITE_OK
+        && sqlite3_step(stmt) == SQLITE_ROW) {
+        mClock = sqlite3_column_int64(stmt, 0);
+        mTotalBytes = static_cast<size_t>(sqlite3_column_double(stmt, 1));
+    }
+    sqlite3_finalize(stmt);
+}
+
+DisplayDataStore::~DisplayDataStore()
+{
+    for (auto stmt : { mSelectStatement, mTouchStatement, mInsertStatement }) {
+        if (stmt) {
+            sqlite3_finalize(stmt);
+        }
+    }
+}
+
+bool DisplayDataStore::IsValid() const noexcept
+{
+    return mValid;
+}
+
+bool DisplayDataStore::Load(uint64_t key, std::vector<char>& data)
+{
+    if (!mValid) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock{ mMutex };
+    // Keys are hashes, stored in the signed column bit for bit
+    const auto sqlKey = static_cast<sqlite3_int64>(key);
+
+    auto stmt = mSelectStatement;
+    bool found = false;
+    if (sqlite3_bind_int64(stmt, 1, sqlKey) == SQLITE_OK
+        && sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto blob = static_cast<const char*>(sqlite3_column_blob(stmt, 0));
+        const auto bytes = sqlite3_column_bytes(stmt, 0);
+        data.assign(blob, blob + bytes);
+        found = true;
+    }
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+
+    if (found) {
+        // Postpone its eviction
+        stmt = mTouchStatement;
+        if (sqlite3_bind_int64(stmt, 1, sqlKey) == SQLITE_OK
+            && sqlite3_bind_int64(stmt, 2, ++mClock) == SQLITE_OK) {
+            sqlite3_step(stmt);
+        }
+        sqlite3_clear_bindings(stmt);
+        sqlite3_reset(stmt);
+    }
+
+    return found;
+}
+
+void DisplayDataStore::Store(uint64_t key, const void* data, size_t bytes)
+{
+    if (!mValid || bytes > mMaxBytes) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock{ mMutex };
+    auto stmt = mInsertStatement;
+    if (sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(key)) == SQLITE_OK
+        && sqlite3_bind_int64(stmt, 2, ++mClock) == SQLITE_OK
+        && sqlite3_bind_blob(stmt, 3, data, bytes, SQLITE_STATIC) == SQLITE_OK
+        && sqlite3_step(stmt) == SQLITE_DONE) {
+        // A replaced row is counted twice until the next eviction
+        mTotalBytes += bytes;
+    }
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+
+    if (mTotalBytes > mMaxBytes) {
+        Evict();
+    }
+}
+
+size_t DisplayDataStore::GetTotalBytes() const
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return mTotalBytes;
+}
+
+void DisplayDataStore::Evict()
+{
+    // Keep the most recently used rows within three quarters of the budget,
+    // so that evictions are infrequent
+    const auto target = mMaxBytes - mMaxBytes / 4;
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(mDB,
+                           "SELECT used, length(data) FROM displaycache ORDER BY used DESC;",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    size_t kept = 0;
+    sqlite3_int64 newestEvicted = -1;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const auto bytes = static_cast<size_t>(sqlite3_column_int64(stmt, 1));
+        if (newestEvicted < 0 && kept + bytes > target) {
+            newestEvicted = sqlite3_column_int64(stmt, 0);
+        }
+        if (newestEvicted < 0) {
+            kept += bytes;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (newestEvicted >= 0) {
+        auto sql = sqlite3_mprintf("DELETE FROM displaycache WHERE used <= %lld;", newestEvicted);
+        if (sqlite3_exec(mDB, sql, nullptr, nullptr, nullptr) != SQLITE_OK) {
+            // Try again after the next insertion
+            kept = mMaxBytes + 1;
+        }
+        sqlite3_free(sql);
+    }
+    mTotalBytes = kept;
+}
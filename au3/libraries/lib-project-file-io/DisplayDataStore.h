@@ -0,0 +1,73 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file DisplayDataStore.h
+@brief Declare DisplayDataStore, a size-bounded table of data computed for display, kept in the project file
+
+**********************************************************************/
+
+#ifndef __AUDACITY_DISPLAY_DATA_STORE__
+#define __AUDACITY_DISPLAY_DATA_STORE__
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct sqlite3;
+struct sqlite3_stmt;
+class IntSetting;
+
+//! Size budget of the display data in each project file, in megabytes; zero
+//! disables it
+PROJECT_FILE_IO_API extern IntSetting DisplayDataStoreSize;
+
+//! Rows of the displaycache table, which outlive the session
+/*!
+ Waveform displays are computed from summaries of the sample blocks.  After
+ a large project is opened, reading those summaries delays the first paint.
+ This class keeps the results instead, keyed by hashes of what they were
+ computed from, so that an edit never finds stale data; the rows of the old
+ contents are just never asked for again.
+
+ The least recently used rows are deleted whenever the total size exceeds
+ the budget.  Any row may be missing, and failures are not errors.
+
+ All member functions are thread-safe.
+ */
+class PROJECT_FILE_IO_API DisplayDataStore final
+{
+public:
+    //! @param maxBytes budget of the total size of the data
+    DisplayDataStore(sqlite3* db, size_t maxBytes);
+    ~DisplayDataStore();
+
+    //! Whether the table exists; if not, nothing is ever found or stored
+    bool IsValid() const noexcept;
+
+    //! @return whether the key was found
+    bool Load(uint64_t key, std::vector<char>& data);
+    void Store(uint64_t key, const void* data, size_t bytes);
+
+    //! Total size of the data, as known without asking the database
+    size_t GetTotalBytes() const;
+
+private:
+    //! @pre mMutex is locked
+    void Evict();
+
+    sqlite3* const mDB;
+    const size_t mMaxBytes;
+    sqlite3_stmt* mSelectStatement{ nullptr };
+    sqlite3_stmt* mTouchStatement{ nullptr };
+    sqlite3_stmt* mInsertStatement{ nullptr };
+    bool mValid{ false };
+
+    mutable std::mutex mMutex;
+    //! Increases with each use, to order the rows for eviction
+    int64_t mClock{ 0 };
+    //! An estimate, corrected by Evict(), since rollbacks may undo insertions
+    size_t mTotalBytes{ 0 };
+};
+
+#endif
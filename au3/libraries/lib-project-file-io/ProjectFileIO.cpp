@@ -10,6 +10,7 @@ Paul Licameli split from AudacityProject.cpp
 
 #include "ProjectFileIO.h"
 
+#include <algorithm>
 #include <atomic>
 #include <sqlite3.h>
 #include <optional>
@@ -25,12 +26,14 @@ Paul Licameli split from AudacityProject.cpp
 #include "DBConnection.h"
 #include "FileNames.h"
 #include "PendingTracks.h"
+#include "Prefs.h"
 #include "Project.h"
 #include "ProjectFileIOExtension.h"
 #include "ProjectHistory.h"
 #include "ProjectSerializer.h"
 #include "FileNames.h"
 #include "SampleBlock.h"
+#include "SampleBlockCache.h"
 #include "TempDirectory.h"
 #include "TransactionScope.h"
 #include "WaveTrack.h"
@@ -156,6 +159,8 @@ static const char* ProjectFileSchema
       // deleted.
       //
       // summin to summary64K are summaries at 3 distance scales.
+      //
+      // See BlockCodecsColumn for the column that compression adds.
       "CREATE TABLE IF NOT EXISTS <schema>.sampleblocks"
       "("
       "  blockid              INTEGER PRIMARY KEY AUTOINCREMENT,"
@@ -168,6 +173,27 @@ static const char* ProjectFileSchema
       "  samples              BLOB"
       ");";
 
+// ADD SQL codec column of sampleblocks
+// codec is a SampleBlockCodec::Codec, telling whether samples are compressed;
+// null in rows inserted before the column was added means they are not.  Its
+// values 0 and 1 take no space in the row but its header, so reading it never
+// pages through the blobs.
+//
+// Older versions copy the rows of sampleblocks with SELECT *, which fails when
+// the column is there; so DBConnection::EnableBlockCodecs() adds it only when a
+// block is to be compressed, and then the project is stamped with
+// BlockCodecsProjectFormatVersion, which older versions refuse to open.
+static const char* BlockCodecsColumn
+    ="ALTER TABLE <schema>.sampleblocks ADD COLUMN codec INTEGER;";
+
+//! The version to stamp on projects with compressed blocks
+static ProjectFormatVersion BlockCodecsStampVersion()
+{
+    return std::max(BaseProjectFormatVersion, BlockCodecsProjectFormatVersion);
+}
+
+// See DBConnection for the summarypyramids and displaycache tables
+
 class SQLiteBlobStream final
 {
 public:
@@ -546,6 +572,9 @@ bool ProjectFileIO::CloseConnection()
     }
     curConn.reset();
 
+    // Block ids are meaningful only within one database
+    SampleBlockCache::Get(mProject).Clear();
+
     SetFileName({});
 
     return true;
@@ -761,6 +790,9 @@ bool ProjectFileIO::CheckVersion()
         return false;
     }
 
+    // Tables that older versions did not make are added only when first
+    // written, by DBConnection, so that merely opening does not change the file
+
     return true;
 }
 
@@ -770,6 +802,8 @@ bool ProjectFileIO::InstallSchema(sqlite3* db, const char* schema /* = "main" */
 
     wxString sql;
     sql.Printf(ProjectFileSchema, ProjectFileID, BaseProjectFormatVersion.GetPacked());
+    sql += DBConnection::SummaryPyramidsSchema;
+    sql += DBConnection::DisplayCacheSchema;
     sql.Replace("<schema>", schema);
 
     rc = sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
@@ -811,6 +845,11 @@ void ProjectFileIO::InSet(sqlite3_context* context, int argc, sqlite3_value** ar
 
 bool ProjectFileIO::DeleteBlocks(const BlockIDs& blockids, bool complement)
 {
+    // Rows still queued for insertion must be seen by the deletion
+    if (!GetConnection().FlushBlockWriter()) {
+        return false;
+    }
+
     auto db = DB();
     int rc;
 
@@ -881,6 +920,14 @@ bool ProjectFileIO::DeleteBlocks(const BlockIDs& blockids, bool complement)
         mRecovered = true;
     }
 
+    // Their summary pyramids too; failure only wastes some space
+    if (GetConnection().HasSummaryPyramids()) {
+        sql = wxString::Format(
+            "DELETE FROM summarypyramids WHERE %sinset(blockid);",
+            complement ? "NOT " : "");
+        sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
+    }
+
     return true;
 }
 
@@ -897,6 +944,11 @@ bool ProjectFileIO::CopyTo(const FilePath& destpath,
         return false;
     }
 
+    // The copy must include all blocks created so far
+    if (!pConn->FlushBlockWriter()) {
+        return false;
+    }
+
     // Get access to the active tracklist
     auto pProject = &mProject;
 
@@ -1005,6 +1057,21 @@ bool ProjectFileIO::CopyTo(const FilePath& destpath,
         return false;
     }
 
+    // The rows to copy may be compressed
+    if (pConn->HasBlockCodecs()) {
+        wxString alterSql{ BlockCodecsColumn };
+        alterSql += wxString::Format("PRAGMA outbound.user_version = %u;",
+                                     BlockCodecsStampVersion().GetPacked());
+        alterSql.Replace("<schema>", "outbound");
+        rc = sqlite3_exec(db, alterSql, nullptr, nullptr, nullptr);
+        if (rc != SQLITE_OK) {
+            SetDBError(
+                XO("Unable to initialize the project file")
+                );
+            return false;
+        }
+    }
+
     {
         // Ensure statement gets cleaned up
         sqlite3_stmt* stmt = nullptr;
@@ -1017,6 +1084,7 @@ bool ProjectFileIO::CopyTo(const FilePath& destpath,
         });
 
         // Prepare the statement only once
+        // The destination has the codec column just when the source does
         rc = sqlite3_prepare_v2(db,
                                 "INSERT INTO outbound.sampleblocks"
                                 "  SELECT * FROM main.sampleblocks"
@@ -1099,6 +1167,25 @@ bool ProjectFileIO::CopyTo(const FilePath& destpath,
             }
         }
 
+        // Copy the summary pyramids of the copied blocks.  If that fails,
+        // the copy computes them again when needed.
+        if (pConn->HasSummaryPyramids()) {
+            sqlite3_exec(db,
+                         "INSERT INTO outbound.summarypyramids"
+                         "  SELECT * FROM main.summarypyramids"
+                         "  WHERE blockid IN (SELECT blockid FROM outbound.sampleblocks);",
+                         nullptr, nullptr, nullptr);
+        }
+
+        // And what was computed for display, so that the copy paints as
+        // quickly.  Rows for pruned blocks are just never used again.
+        if (pConn->HasDisplayCache()) {
+            sqlite3_exec(db,
+                         "INSERT INTO outbound.displaycache"
+                         "  SELECT * FROM main.displaycache;",
+                         nullptr, nullptr, nullptr);
+        }
+
         // Write the doc.
         //
         // If we're compacting a temporary project (user initiated from the File
@@ -1136,6 +1223,11 @@ bool ProjectFileIO::ShouldCompact(const std::vector<const TrackList*>& tracks)
     WaveTrackUtilities::SampleBlockIDSet active;
     unsigned long long current = 0;
 
+    // Once for all blocks, rather than for each one still queued
+    if (HasConnection() && !GetConnection().FlushBlockWriter()) {
+        return false;
+    }
+
     {
         auto fn = BlockSpaceUsageAccumulator(current);
         for (auto pTracks : tracks) {
@@ -1713,6 +1805,13 @@ void ProjectFileIO::WriteXML(XMLWriter& xmlFile,
 
 bool ProjectFileIO::AutoSave(bool recording)
 {
+    // The document must not refer to blocks missing from the database, should
+    // the application crash after writing it.  (WriteDoc() also flushes, in
+    // starting its transaction, but be explicit about this barrier.)
+    if (HasConnection() && !GetConnection().FlushBlockWriter()) {
+        return false;
+    }
+
     ProjectSerializer autosave;
     WriteXMLHeader(autosave);
     WriteXML(autosave, recording);
@@ -1888,8 +1987,12 @@ bool ProjectFileIO::WriteDoc(const char* table,
         return false;
     }
 
+    // Keep older versions from opening projects with compressed blocks
+    const auto version = GetConnection().HasBlockCodecs()
+                         ? BlockCodecsStampVersion()
+                         : BaseProjectFormatVersion;
     const wxString setVersionSql
-        =wxString::Format("PRAGMA user_version = %u", BaseProjectFormatVersion.GetPacked());
+        =wxString::Format("PRAGMA user_version = %u", version.GetPacked());
 
     if (!Query(setVersionSql.c_str(), [](auto...) { return 0; })) {
         // DV: Very unlikely case.
@@ -2437,6 +2540,10 @@ int64_t ProjectFileIO::GetBlockUsage(SampleBlockID blockid)
     if (!pConn) {
         return 0;
     }
+    // Measure rows still queued for insertion too
+    if (!pConn->FlushBlockWriter()) {
+        pConn->ThrowException(true);
+    }
     return GetDiskUsage(*pConn, blockid);
 }
 
@@ -2465,6 +2572,10 @@ int64_t ProjectFileIO::GetTotalUsage()
     if (!pConn) {
         return 0;
     }
+    // Measure rows still queued for insertion too
+    if (!pConn->FlushBlockWriter()) {
+        pConn->ThrowException(true);
+    }
     return GetDiskUsage(*pConn, 0);
 }
 
@@ -139,6 +139,8 @@ public:
 
     // Return the bytes used for the given block using the connection to a
     // specific database. This is the workhorse for the above 3 methods.
+    // Rows still queued in the block writer are not counted; callers flush
+    // it first, once for all the blocks they measure.
     static int64_t GetDiskUsage(DBConnection& conn, SampleBlockID blockid);
 
     // Displays an error dialog with a button that offers help
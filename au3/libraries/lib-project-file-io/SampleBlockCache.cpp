@@ -0,0 +1,137 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockCache.cpp
+@brief Implements SampleBlockCache
+
+**********************************************************************/
+
+#include "SampleBlockCache.h"
+
+#include "Prefs.h"
+#include "Project.h"
+
+#include <algorithm>
+
+IntSetting SampleBlockCacheSize{ L"/ProjectFileIO/SampleBlockCacheSize", 256 };
+
+static const AudacityProject::AttachedObjects::RegisteredFactory
+    sSampleBlockCacheKey{
+    []( AudacityProject& ){
+        const auto megabytes = std::max(0, SampleBlockCacheSize.Read());
+        return std::make_shared< SampleBlockCache >(
+            static_cast<size_t>(megabytes) << 20);
+    }
+};
+
+SampleBlockCache& SampleBlockCache::Get(AudacityProject& project)
+{
+    return project.AttachedObjects::Get< SampleBlockCache >(sSampleBlockCacheKey);
+}
+
+const SampleBlockCache& SampleBlockCache::Get(const AudacityProject& project)
+{
+    return Get(const_cast< AudacityProject& >(project));
+}
+
+SampleBlockCache::SampleBlockCache(size_t budget)
+    : mBudget{budget}
+{
+}
+
+SampleBlockCache::~SampleBlockCache() = default;
+
+auto SampleBlockCache::Find(SampleBlockID id, Kind kind) -> Data
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    const auto found = mIndex.find({ id, kind });
+    if (found == mIndex.end()) {
+        ++mMisses;
+        return {};
+    }
+    ++mHits;
+    // Move to the front
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+    return found->second->data;
+}
+
+void SampleBlockCache::Insert(SampleBlockID id, Kind kind, Data data)
+{
+    if (!data) {
+        return;
+    }
+    const auto bytes = data->size() * sizeof(float);
+    std::lock_guard<std::mutex> lock{ mMutex };
+    if (bytes > mBudget) {
+        return;
+    }
+    const Key key{ id, kind };
+    if (const auto found = mIndex.find(key); found != mIndex.end()) {
+        // Another thread loaded the same contents meanwhile
+        Erase(found->second);
+    }
+    mEntries.push_front({ key, std::move(data), bytes });
+    mIndex.emplace(key, mEntries.begin());
+    mBytes += bytes;
+    Evict();
+}
+
+void SampleBlockCache::Invalidate(SampleBlockID id)
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    for (size_t ii = 0; ii < static_cast<size_t>(Kind::nKinds); ++ii) {
+        const auto kind = static_cast<Kind>(ii);
+        if (const auto found = mIndex.find({ id, kind }); found != mIndex.end()) {
+            Erase(found->second);
+        }
+    }
+}
+
+void SampleBlockCache::Clear()
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    mIndex.clear();
+    mEntries.clear();
+    mBytes = 0;
+}
+
+bool SampleBlockCache::IsEnabled() const
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return mBudget > 0;
+}
+
+void SampleBlockCache::SetBudget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    mBudget = budget;
+    Evict();
+}
+
+auto SampleBlockCache::GetStatistics() const -> Statistics
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return { mHits, mMisses, mEvictions, mEntries.size(), mBytes, mBudget };
+}
+
+void SampleBlockCache::ResetStatistics()
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    mHits = mMisses = mEvictions = 0;
+}
+
+void SampleBlockCache::Erase(Entries::iterator iter)
+{
+    mBytes -= iter->bytes;
+    mIndex.erase(iter->key);
+    mEntries.erase(iter);
+}
+
+void SampleBlockCache::Evict()
+{
+    while (mBytes > mBudget) {
+        Erase(std::prev(mEntries.end()));
+        ++mEvictions;
+    }
+}
@@ -0,0 +1,129 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockCache.h
+@brief Declare SampleBlockCache, a size-bounded LRU cache of decoded sample blocks
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_BLOCK_CACHE__
+#define __AUDACITY_SAMPLE_BLOCK_CACHE__
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ClientData.h"
+#include "SampleBlock.h" // for SampleBlockID
+
+class AudacityProject;
+class IntSetting;
+
+//! Memory budget of each project's cache, in megabytes; zero disables it
+PROJECT_FILE_IO_API extern IntSetting SampleBlockCacheSize;
+
+//! Project-wide cache of sample block contents, converted to float
+/*!
+ Keeps the most recently used blocks within a memory budget, so that
+ scrubbing, looped playback and effect previews need not read and decode
+ the same rows of the database again and again.
+
+ Entries are immutable once inserted and are shared with the callers, so
+ an eviction never invalidates data that is still in use.
+
+ All member functions are thread-safe.
+ */
+class PROJECT_FILE_IO_API SampleBlockCache final : public ClientData::Base, public std::enable_shared_from_this<SampleBlockCache>
+{
+public:
+    static SampleBlockCache& Get(AudacityProject& project);
+    static const SampleBlockCache& Get(const AudacityProject& project);
+
+    //! Which contents of the row
+    enum class Kind : unsigned char {
+        Samples, Summary256, Summary64k,
+        //! Levels of the summary pyramid, in the order of
+        //! SampleBlockSummary::pyramidFactors
+        Summary16, Summary64, Summary1k, Summary4k, Summary16k,
+        nKinds
+    };
+
+    using Data = std::shared_ptr<std::vector<float> >;
+
+    struct Statistics {
+        size_t hits{};
+        size_t misses{};
+        size_t evictions{};
+        size_t entries{};
+        size_t bytes{};
+        size_t budget{};
+    };
+
+    explicit SampleBlockCache(size_t budget);
+    ~SampleBlockCache() override;
+
+    //! Count a hit or a miss
+    /*! @return null if not found */
+    Data Find(SampleBlockID id, Kind kind);
+
+    //! Replace any previous entry, then evict the least recently used ones
+    //! until within budget
+    /*! Does nothing if `data` alone exceeds the budget */
+    void Insert(SampleBlockID id, Kind kind, Data data);
+
+    //! Remove all entries for the block, which must be done before its id
+    //! can be reused by the database
+    void Invalidate(SampleBlockID id);
+
+    void Clear();
+
+    bool IsEnabled() const;
+
+    //! Evict as needed to fit the new budget, in bytes
+    void SetBudget(size_t budget);
+
+    Statistics GetStatistics() const;
+    void ResetStatistics();
+
+private:
+    struct Key {
+        SampleBlockID id;
+        Kind kind;
+        bool operator==(const Key& other) const
+        {
+            return id == other.id && kind == other.kind;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<SampleBlockID>{}(key.id)
+                   * static_cast<size_t>(Kind::nKinds)
+                   + static_cast<size_t>(key.kind);
+        }
+    };
+    struct Entry {
+        Key key;
+        Data data;
+        size_t bytes;
+    };
+    //! Most recently used first
+    using Entries = std::list<Entry>;
+
+    void Erase(Entries::iterator iter);
+    void Evict();
+
+    mutable std::mutex mMutex;
+    Entries mEntries;
+    std::unordered_map<Key, Entries::iterator, KeyHash> mIndex;
+    size_t mBytes{ 0 };
+    size_t mBudget;
+    size_t mHits{ 0 };
+    size_t mMisses{ 0 };
+    size_t mEvictions{ 0 };
+};
+
+#endif
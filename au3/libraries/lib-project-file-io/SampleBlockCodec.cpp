@@ -0,0 +1,334 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockCodec.cpp
+@brief Implements SampleBlockCodec
+
+**********************************************************************/
+
+#include "SampleBlockCodec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "Prefs.h"
+
+BoolSetting CompressSampleBlocks{ L"/ProjectFileIO/CompressSampleBlocks", false };
+
+namespace SampleBlockCodec {
+namespace {
+constexpr unsigned MaxOrder = 3;
+constexpr unsigned OrderBits = 2;
+constexpr unsigned ParameterBits = 6;
+//! A quotient this large is written as ones only, followed by the residual
+//! in EscapeBits; so no code is longer than 72 bits
+constexpr unsigned EscapeQuotient = 32;
+//! Enough for any residual of order MaxOrder of 32 bit samples, zigzagged
+constexpr unsigned EscapeBits = 40;
+constexpr unsigned MaxParameter = EscapeBits - 1;
+
+// Samples are predicted and coded as these integers
+
+int32_t ToInteger(const void* samples, size_t ii, sampleFormat format)
+{
+    const auto src = static_cast<const char*>(samples);
+    if (format == int16Sample) {
+        int16_t value;
+        memcpy(&value, src + ii * sizeof(value), sizeof(value));
+        return value;
+    }
+    uint32_t bits;
+    memcpy(&bits, src + ii * sizeof(bits), sizeof(bits));
+    if (format == floatSample && (bits & 0x80000000u)) {
+        // Negative floats descend as their bits ascend
+        return -1 - static_cast<int32_t>(bits & 0x7fffffffu);
+    }
+    // Also int24Sample, which is kept in 32 bits; any upper bits survive
+    return static_cast<int32_t>(bits);
+}
+
+void FromInteger(int32_t value, void* samples, size_t ii, sampleFormat format)
+{
+    const auto dest = static_cast<char*>(samples);
+    if (format == int16Sample) {
+        const auto sample = static_cast<int16_t>(value);
+        memcpy(dest + ii * sizeof(sample), &sample, sizeof(sample));
+        return;
+    }
+    auto bits = static_cast<uint32_t>(value);
+    if (format == floatSample && value < 0) {
+        bits = 0x80000000u | static_cast<uint32_t>(-1 - value);
+    }
+    memcpy(dest + ii * sizeof(bits), &bits, sizeof(bits));
+}
+
+//! The fixed polynomial predictors of FLAC
+int64_t Predict(unsigned order, int64_t x1, int64_t x2, int64_t x3)
+{
+    switch (order) {
+    case 0: return 0;
+    case 1: return x1;
+    case 2: return 2 * x1 - x2;
+    default: return 3 * x1 - 3 * x2 + x3;
+    }
+}
+
+uint64_t ZigZag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+//! Writes bits, the most significant first
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<char>& out)
+        : mOut{out} {}
+
+    //! @pre `bits <= 32` and `value < 2^bits`
+    void Put(uint64_t value, unsigned bits)
+    {
+        mAccumulator = (mAccumulator << bits) | value;
+        mCount += bits;
+        while (mCount >= 8) {
+            mCount -= 8;
+            mOut.push_back(static_cast<char>(mAccumulator >> mCount));
+        }
+    }
+
+    void PutRice(uint64_t value, unsigned parameter)
+    {
+        const auto quotient = value >> parameter;
+        if (quotient >= EscapeQuotient) {
+            Put(0xffffffffu, EscapeQuotient);
+            Put(value >> (EscapeBits / 2), EscapeBits / 2);
+            Put(value & ((1u << (EscapeBits / 2)) - 1), EscapeBits / 2);
+            return;
+        }
+        // Ones, then a zero
+        Put(((1ull << quotient) - 1) << 1, quotient + 1);
+        // The remainder may have more than 32 bits
+        const auto remainder = value & ((1ull << parameter) - 1);
+        if (parameter > 32) {
+            Put(remainder >> 32, parameter - 32);
+            Put(remainder & 0xffffffffu, 32);
+        } else {
+            Put(remainder, parameter);
+        }
+    }
+
+    //! Pad the last byte with zeroes
+    void Finish()
+    {
+        if (mCount > 0) {
+            Put(0, 8 - mCount);
+        }
+    }
+
+private:
+    std::vector<char>& mOut;
+    uint64_t mAccumulator{ 0 };
+    unsigned mCount{ 0 };
+};
+
+//! Reads what BitWriter wrote; past the end it reads zeroes, and notes that
+class BitReader
+{
+public:
+    BitReader(const unsigned char* begin, const unsigned char* end)
+        : mNext{begin}, mEnd{end} {}
+
+    //! @pre `bits <= 32`
+    uint64_t Get(unsigned bits)
+    {
+        Fill(bits);
+        mCount -= bits;
+        return (mAccumulator >> mCount) & ((1ull << bits) - 1);
+    }
+
+    uint64_t GetRice(unsigned parameter)
+    {
+        Fill(EscapeQuotient);
+        const auto window = static_cast<uint32_t>(mAccumulator >> (mCount - EscapeQuotient));
+        unsigned quotient = 0;
+        while (quotient < EscapeQuotient && (window & (0x80000000u >> quotient))) {
+            ++quotient;
+        }
+        if (quotient == EscapeQuotient) {
+            mCount -= EscapeQuotient;
+            const auto high = Get(EscapeBits / 2);
+            return (high << (EscapeBits / 2)) | Get(EscapeBits / 2);
+        }
+        mCount -= quotient + 1;
+        uint64_t remainder;
+        if (parameter > 32) {
+            const auto high = Get(parameter - 32);
+            remainder = (high << 32) | Get(32);
+        } else {
+            remainder = Get(parameter);
+        }
+        return (static_cast<uint64_t>(quotient) << parameter) | remainder;
+    }
+
+    //! Whether all bits read were in the blob
+    bool Good() const
+    {
+        return mCount >= 8 * mPadding;
+    }
+
+private:
+    void Fill(unsigned bits)
+    {
+        while (mCount < bits) {
+            unsigned char byte = 0;
+            if (mNext != mEnd) {
+                byte = *mNext++;
+            } else {
+                ++mPadding;
+            }
+            mAccumulator = (mAccumulator << 8) | byte;
+            mCount += 8;
+        }
+    }
+
+    const unsigned char* mNext;
+    const unsigned char* const mEnd;
+    uint64_t mAccumulator{ 0 };
+    unsigned mCount{ 0 };
+    size_t mPadding{ 0 };
+};
+
+bool IsKnownFormat(uint32_t format)
+{
+    return format == static_cast<uint32_t>(int16Sample)
+           || format == static_cast<uint32_t>(int24Sample)
+           || format == static_cast<uint32_t>(floatSample);
+}
+}
+
+std::vector<char> Encode(const void* samples, size_t count, sampleFormat format)
+{
+    const auto rawBytes = count * SAMPLE_SIZE(format);
+    if (count == 0 || !IsKnownFormat(static_cast<uint32_t>(format)) || count > UINT32_MAX) {
+        return {};
+    }
+
+    std::vector<char> result(HeaderBytes);
+    const uint32_t header[] { static_cast<uint32_t>(format), static_cast<uint32_t>(count) };
+    memcpy(result.data(), header, sizeof(header));
+    result.reserve(rawBytes);
+    BitWriter writer{ result };
+
+    std::vector<int64_t> values(PartitionSamples + MaxOrder);
+    int64_t history[MaxOrder] {};
+    for (size_t start = 0; start < count; start += PartitionSamples) {
+        const auto length = std::min(PartitionSamples, count - start);
+        // Preceded by the end of the previous partition
+        std::copy(history, history + MaxOrder, values.begin());
+        for (size_t ii = 0; ii < length; ++ii) {
+            values[MaxOrder + ii] = ToInteger(samples, start + ii, format);
+        }
+        const auto x = values.data() + MaxOrder;
+
+        // Choose the order that leaves the least residual
+        unsigned order = 0;
+        uint64_t total = UINT64_MAX;
+        for (unsigned tryOrder = 0; tryOrder <= MaxOrder; ++tryOrder) {
+            uint64_t sum = 0;
+            for (size_t ii = 0; ii < length; ++ii) {
+                sum += ZigZag(x[ii] - Predict(tryOrder, x[ii - 1], x[ii - 2], x[ii - 3])) >> 1;
+            }
+            if (sum < total) {
+                total = sum;
+                order = tryOrder;
+            }
+        }
+
+        // Rice parameter near the logarithm of the mean residual
+        unsigned parameter = 0;
+        while (parameter < MaxParameter && (static_cast<uint64_t>(length) << (parameter + 1)) < total) {
+            ++parameter;
+        }
+
+        writer.Put(order, OrderBits);
+        writer.Put(parameter, ParameterBits);
+        for (size_t ii = 0; ii < length; ++ii) {
+            writer.PutRice(ZigZag(x[ii] - Predict(order, x[ii - 1], x[ii - 2], x[ii - 3])), parameter);
+        }
+
+        std::copy(x + length - MaxOrder, x + length, history);
+
+        if (result.size() >= rawBytes) {
+            return {};
+        }
+    }
+    writer.Finish();
+
+    if (result.size() >= rawBytes) {
+        return {};
+    }
+    return result;
+}
+
+size_t DecodedBytes(const void* blob, size_t bytes)
+{
+    uint32_t header[2];
+    if (!blob || bytes < sizeof(header)) {
+        return 0;
+    }
+    memcpy(header, blob, sizeof(header));
+    const auto [format, count] = header;
+    if (!IsKnownFormat(format)) {
+        return 0;
+    }
+    return count * SAMPLE_SIZE(static_cast<sampleFormat>(format));
+}
+
+bool Decode(const void* blob, size_t bytes, sampleFormat format, void* dest, size_t destBytes)
+{
+    const auto decodedBytes = DecodedBytes(blob, bytes);
+    uint32_t header[2];
+    if (decodedBytes == 0 || decodedBytes != destBytes) {
+        return false;
+    }
+    memcpy(header, blob, sizeof(header));
+    if (header[0] != static_cast<uint32_t>(format)) {
+        return false;
+    }
+    const size_t count = header[1];
+
+    const auto begin = static_cast<const unsigned char*>(blob);
+    BitReader reader{ begin + HeaderBytes, begin + bytes };
+    int64_t x1 = 0, x2 = 0, x3 = 0;
+    for (size_t start = 0; start < count; start += PartitionSamples) {
+        const auto length = std::min(PartitionSamples, count - start);
+        const auto order = static_cast<unsigned>(reader.Get(OrderBits));
+        const auto parameter = static_cast<unsigned>(reader.Get(ParameterBits));
+        if (parameter > MaxParameter) {
+            return false;
+        }
+        for (size_t ii = 0; ii < length; ++ii) {
+            const auto value
+                =Predict(order, x1, x2, x3) + UnZigZag(reader.GetRice(parameter));
+            if (value < INT32_MIN || value > INT32_MAX) {
+                return false;
+            }
+            FromInteger(static_cast<int32_t>(value), dest, start + ii, format);
+            x3 = x2;
+            x2 = x1;
+            x1 = value;
+        }
+        if (!reader.Good()) {
+            return false;
+        }
+    }
+    return true;
+}
+}
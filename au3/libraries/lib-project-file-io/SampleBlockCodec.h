@@ -0,0 +1,73 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockCodec.h
+@brief Lossless compression of the samples stored in each sample block
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_BLOCK_CODEC__
+#define __AUDACITY_SAMPLE_BLOCK_CODEC__
+
+#include <cstddef>
+#include <vector>
+
+#include "SampleFormat.h"
+
+class BoolSetting;
+
+//! Whether new sample blocks are stored compressed, when that makes them
+//! smaller
+PROJECT_FILE_IO_API extern BoolSetting CompressSampleBlocks;
+
+//! Lossless compression of the samples column of the sampleblocks table
+/*!
+ The codec column of the table tells how each row's samples are stored.  A
+ compressed blob decodes to exactly the bytes that were encoded, bit for bit,
+ in every sample format.
+
+ Each sample is predicted from the previous ones by a polynomial of fixed
+ order, as in FLAC, and the residuals are Rice coded.  Partitions of the
+ block choose their own order and Rice parameter.  Float samples are first
+ mapped to integers that keep their ordering, so that nearby values are
+ nearby integers.
+
+ Decoding is a single pass with no allocation, many times faster than real
+ time.
+ */
+namespace SampleBlockCodec {
+//! Values of the codec column
+enum Codec : int {
+    //! Also what a null value, in rows of older versions, means
+    Raw = 0,
+    Lossless = 1,
+};
+
+//! Header of an encoded blob, giving the format and number of samples
+constexpr size_t HeaderBytes = 8;
+//! Samples sharing one predictor order and Rice parameter
+constexpr size_t PartitionSamples = 4096;
+
+//! Compress `count` samples of `format`
+/*!
+ @return empty if compression would not make the blob smaller
+ */
+PROJECT_FILE_IO_API std::vector<char> Encode(const void* samples, size_t count, sampleFormat format);
+
+//! Size of the samples that a blob decodes to, read from its header
+/*!
+ @param bytes may be just HeaderBytes, to read no more of the blob
+ @return zero if the header is not valid
+ */
+PROJECT_FILE_IO_API size_t DecodedBytes(const void* blob, size_t bytes);
+
+//! Decompress a blob made by Encode()
+/*!
+ @return false if the blob is not of samples of `format` filling exactly
+ `destBytes`, or is corrupt; then `dest` may be partly written
+ */
+PROJECT_FILE_IO_API bool Decode(const void* blob, size_t bytes, sampleFormat format, void* dest, size_t destBytes);
+}
+
+#endif
@@ -0,0 +1,296 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockSummary.cpp
+@brief Implements SampleBlockSummary
+
+Moved from SqliteSampleBlock::CalcSummary
+
+**********************************************************************/
+
+#include "SampleBlockSummary.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace SampleBlockSummary {
+namespace {
+//! Two vectors' worth for SSE or NEON, one for AVX
+constexpr size_t Lanes = 8;
+
+//! First four bytes of an encoded level
+enum LevelFormat : uint32_t {
+    FloatLevel = 1,
+    Int16Level = 2,
+};
+constexpr float Int16Scale = 32767.0f;
+}
+
+void MinMaxSumSquares(const float* samples, size_t count, float& min, float& max, float& sumsq)
+{
+    // Start every lane from the first sample, so that NaN is ignored unless
+    // it is first, as in a sequential loop
+    const auto first = samples[0];
+    float mins[Lanes], maxs[Lanes], sums[Lanes];
+    std::fill_n(mins, Lanes, first);
+    std::fill_n(maxs, Lanes, first);
+    std::fill_n(sums, Lanes, 0.0f);
+
+    size_t ii = 0;
+    for (; ii + Lanes <= count; ii += Lanes) {
+        for (size_t lane = 0; lane < Lanes; ++lane) {
+            const auto sample = samples[ii + lane];
+            mins[lane] = std::min(mins[lane], sample);
+            maxs[lane] = std::max(maxs[lane], sample);
+            sums[lane] += sample * sample;
+        }
+    }
+
+    // Pairwise, like the adds of a horizontal reduction
+    for (size_t width = Lanes / 2; width > 0; width /= 2) {
+        for (size_t lane = 0; lane < width; ++lane) {
+            mins[lane] = std::min(mins[lane], mins[lane + width]);
+            maxs[lane] = std::max(maxs[lane], maxs[lane + width]);
+            sums[lane] += sums[lane + width];
+        }
+    }
+    min = mins[0];
+    max = maxs[0];
+    sumsq = sums[0];
+
+    for (; ii < count; ++ii) {
+        const auto sample = samples[ii];
+        min = std::min(min, sample);
+        max = std::max(max, sample);
+        sumsq += sample * sample;
+    }
+}
+
+Totals Calculate(const float* samples, size_t count, float* summary256, size_t frames256, float* summary64k, size_t frames64k)
+{
+    float min;
+    float max;
+    float sumsq;
+    double totalSquares = 0.0;
+    double fraction = 0.0;
+
+    // Recalc 256 summaries
+    const size_t sumLen256 = (count + 255) / 256;
+    int summaries = 256;
+
+    for (size_t i = 0; i < sumLen256; ++i) {
+        size_t jcount = 256;
+        if (jcount > count - i * 256) {
+            jcount = count - i * 256;
+            fraction = 1.0 - (jcount / 256.0);
+        }
+
+        MinMaxSumSquares(samples + i * 256, jcount, min, max, sumsq);
+
+        totalSquares += sumsq;
+
+        summary256[i * fields] = min;
+        summary256[i * fields + 1] = max;
+        // The rms is correct, but this may be for less than 256 samples in last loop.
+        summary256[i * fields + 2] = (float)sqrt(sumsq / jcount);
+    }
+
+    for (size_t i = sumLen256; i < frames256; ++i) {
+        // filling in the remaining bits with non-harming/contributing values
+        // rms values are not "non-harming", so keep count of them:
+        summaries--;
+        summary256[i * fields] = FLT_MAX;      // min
+        summary256[i * fields + 1] = -FLT_MAX; // max
+        summary256[i * fields + 2] = 0.0f;     // rms
+    }
+
+    Totals totals;
+
+    // Calculate now while we can do it accurately
+    totals.rms = sqrt(totalSquares / count);
+
+    // Recalc 64K summaries
+    const size_t sumLen64k = (count + 65535) / 65536;
+
+    for (size_t i = 0; i < sumLen64k; ++i) {
+        min = summary256[3 * i * 256];
+        max = summary256[3 * i * 256 + 1];
+        sumsq = summary256[3 * i * 256 + 2];
+        sumsq *= sumsq;
+
+        for (size_t j = 1; j < 256; ++j) {
+            // we can overflow the useful summary256 values here, but have put
+            // non-harmful values in them
+            if (summary256[3 * (i * 256 + j)] < min) {
+                min = summary256[3 * (i * 256 + j)];
+            }
+
+            if (summary256[3 * (i * 256 + j) + 1] > max) {
+                max = summary256[3 * (i * 256 + j) + 1];
+            }
+
+            float r1 = summary256[3 * (i * 256 + j) + 2];
+            sumsq += r1 * r1;
+        }
+
+        double denom = (i < sumLen64k - 1) ? 256.0 : summaries - fraction;
+        float rms = (float)sqrt(sumsq / denom);
+
+        summary64k[i * fields] = min;
+        summary64k[i * fields + 1] = max;
+        summary64k[i * fields + 2] = rms;
+    }
+
+    for (size_t i = sumLen64k; i < frames64k; ++i) {
+        summary64k[i * fields] = 0.0f;   // probably should be FLT_MAX, need a test case
+        summary64k[i * fields + 1] = 0.0f; // probably should be -FLT_MAX, need a test case
+        summary64k[i * fields + 2] = 0.0f; // just padding
+    }
+
+    // Recalc block-level summary (rms already calculated)
+    min = summary64k[0];
+    max = summary64k[1];
+
+    for (size_t i = 1; i < sumLen64k; ++i) {
+        if (summary64k[i * fields] < min) {
+            min = summary64k[i * fields];
+        }
+
+        if (summary64k[i * fields + 1] > max) {
+            max = summary64k[i * fields + 1];
+        }
+    }
+
+    totals.min = min;
+    totals.max = max;
+    return totals;
+}
+
+void Summarize(const float* samples, size_t count, size_t factor, float* dest)
+{
+    const auto frames = PyramidFrames(count, factor);
+    for (size_t ii = 0; ii < frames; ++ii) {
+        const auto first = ii * factor;
+        const auto len = std::min(factor, count - first);
+        float min, max, sumsq;
+        MinMaxSumSquares(samples + first, len, min, max, sumsq);
+        dest[ii * fields] = min;
+        dest[ii * fields + 1] = max;
+        dest[ii * fields + 2] = std::sqrt(sumsq / len);
+    }
+}
+
+void Coarsen(const float* finer, size_t count, size_t finerFactor, size_t ratio, float* dest)
+{
+    const auto finerFrames = PyramidFrames(count, finerFactor);
+    const auto frames = PyramidFrames(finerFrames, ratio);
+    for (size_t ii = 0; ii < frames; ++ii) {
+        const auto first = ii * ratio;
+        const auto last = std::min(first + ratio, finerFrames);
+        float min = finer[first * fields];
+        float max = finer[first * fields + 1];
+        double sumsq = 0;
+        for (size_t jj = first; jj < last; ++jj) {
+            min = std::min(min, finer[jj * fields]);
+            max = std::max(max, finer[jj * fields + 1]);
+            const double rms = finer[jj * fields + 2];
+            // Only the last frame of the finer summary may be partial
+            const auto len = std::min(finerFactor, count - jj * finerFactor);
+            sumsq += rms * rms * len;
+        }
+        const auto len = std::min(ratio * finerFactor, count - first * finerFactor);
+        dest[ii * fields] = min;
+        dest[ii * fields + 1] = max;
+        dest[ii * fields + 2] = static_cast<float>(std::sqrt(sumsq / len));
+    }
+}
+
+PyramidBlobs CalculatePyramid(const float* samples, size_t count, const float* summary256, bool quantize)
+{
+    PyramidBlobs result;
+    std::vector<float> finer, coarser;
+    size_t finerFactor = 0;
+    for (size_t level = 0; level < pyramidFactors.size(); ++level) {
+        const auto factor = pyramidFactors[level];
+        coarser.resize(PyramidFrames(count, factor) * fields);
+        if (finerFactor == 0) {
+            Summarize(samples, count, factor, coarser.data());
+        } else if (finerFactor < 256 && factor > 256) {
+            // No need to look at the finer levels again
+            Coarsen(summary256, count, 256, factor / 256, coarser.data());
+        } else {
+            Coarsen(finer.data(), count, finerFactor, factor / finerFactor, coarser.data());
+        }
+        result[level] = EncodeLevel(coarser.data(), PyramidFrames(count, factor), quantize);
+        finer.swap(coarser);
+        finerFactor = factor;
+    }
+    return result;
+}
+
+std::vector<char> EncodeLevel(const float* frames, size_t numFrames, bool quantize)
+{
+    const auto values = numFrames * fields;
+    // Written so that NaN fails the test
+    quantize = quantize && std::all_of(frames, frames + values,
+                                       [](float value){ return value >= -1.0f && value <= 1.0f; });
+
+    const uint32_t format = quantize ? Int16Level : FloatLevel;
+    std::vector<char> result(
+        sizeof(format) + values * (quantize ? sizeof(int16_t) : sizeof(float)));
+    memcpy(result.data(), &format, sizeof(format));
+    const auto dest = result.data() + sizeof(format);
+
+    if (!quantize) {
+        memcpy(dest, frames, values * sizeof(float));
+        return result;
+    }
+
+    for (size_t ii = 0; ii < numFrames; ++ii) {
+        const int16_t packed[fields] {
+            static_cast<int16_t>(std::floor(frames[ii * fields] * Int16Scale)),
+            static_cast<int16_t>(std::ceil(frames[ii * fields + 1] * Int16Scale)),
+            static_cast<int16_t>(std::lround(frames[ii * fields + 2] * Int16Scale)),
+        };
+        memcpy(dest + ii * sizeof(packed), packed, sizeof(packed));
+    }
+    return result;
+}
+
+bool DecodeLevel(const void* blob, size_t bytes, float* dest, size_t numFrames)
+{
+    uint32_t format;
+    if (!blob || bytes < sizeof(format)) {
+        return false;
+    }
+    memcpy(&format, blob, sizeof(format));
+    const auto src = static_cast<const char*>(blob) + sizeof(format);
+    const auto values = numFrames * fields;
+    bytes -= sizeof(format);
+
+    switch (format) {
+    case FloatLevel:
+        if (bytes != values * sizeof(float)) {
+            return false;
+        }
+        memcpy(dest, src, bytes);
+        return true;
+    case Int16Level:
+        if (bytes != values * sizeof(int16_t)) {
+            return false;
+        }
+        for (size_t ii = 0; ii < values; ++ii) {
+            int16_t value;
+            memcpy(&value, src + ii * sizeof(value), sizeof(value));
+            dest[ii] = value / Int16Scale;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+}
@@ -0,0 +1,106 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockSummary.h
+@brief Computation of the min, max and rms summaries stored with each sample block
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_BLOCK_SUMMARY__
+#define __AUDACITY_SAMPLE_BLOCK_SUMMARY__
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace SampleBlockSummary {
+enum : size_t {
+    fields = 3, /* min, max, rms */
+    bytesPerFrame = fields * sizeof(float),
+};
+
+//! Summary of the entire block
+struct Totals {
+    double min{};
+    double max{};
+    double rms{};
+};
+
+//! Minimum, maximum and sum of squares of a range of samples
+/*!
+ Accumulates in several independent lanes, which the compiler can keep in
+ vector registers, then combines them.  The minimum and maximum are exactly
+ those of a sequential loop; the sum of squares may differ in rounding.
+
+ @pre `count > 0`
+ */
+PROJECT_FILE_IO_API void MinMaxSumSquares(const float* samples, size_t count, float& min, float& max, float& sumsq);
+
+//! Fill the summaries of 256 and of 64k samples, and return the totals
+/*!
+ @param frames256 the size of `summary256` divided by bytesPerFrame; frames
+ past the samples are filled with values that do not change the totals
+ @param frames64k the size of `summary64k` divided by bytesPerFrame
+ @pre `count > 0`
+ */
+PROJECT_FILE_IO_API Totals Calculate(const float* samples, size_t count, float* summary256, size_t frames256, float* summary64k,
+                                     size_t frames64k);
+
+//! Factors, in samples per frame, of the summaries in the summarypyramids
+//! table
+/*!
+ They fill in between the 256 and 64k summaries of the sampleblocks table,
+ so that consecutive levels differ by a factor of 4.  Drawing at any zoom
+ level then reads at most four frames for each column of pixels.
+ */
+constexpr std::array<size_t, 5> pyramidFactors{ 16, 64, 1024, 4096, 16384 };
+
+//! Number of frames summarizing `count` samples; the last may be partial
+constexpr size_t PyramidFrames(size_t count, size_t factor)
+{
+    return (count + factor - 1) / factor;
+}
+
+//! Summarize consecutive groups of `factor` samples
+/*!
+ @param dest receives PyramidFrames(count, factor) frames
+ @pre `count > 0`
+ */
+PROJECT_FILE_IO_API void Summarize(const float* samples, size_t count, size_t factor, float* dest);
+
+//! Summarize consecutive groups of `ratio` frames of a finer summary
+/*!
+ @param finer summary of `count` samples by `finerFactor`; frames past
+ PyramidFrames(count, finerFactor), such as the padding of the 256
+ summaries, are ignored
+ @param dest receives PyramidFrames(count, finerFactor * ratio) frames
+ @pre `count > 0`
+ */
+PROJECT_FILE_IO_API void Coarsen(const float* finer, size_t count, size_t finerFactor, size_t ratio, float* dest);
+
+//! Stored levels of a pyramid, in the order of pyramidFactors
+using PyramidBlobs = std::array<std::vector<char>, pyramidFactors.size()>;
+
+//! Compute and encode all levels of the pyramid
+/*!
+ @param summary256 as filled by Calculate()
+ @param quantize passed to EncodeLevel()
+ @pre `count > 0`
+ */
+PROJECT_FILE_IO_API PyramidBlobs CalculatePyramid(const float* samples, size_t count, const float* summary256, bool quantize);
+
+//! Pack a level for storage
+/*!
+ If `quantize`, and all values are within [-1, 1], then each is stored in 16
+ bits, rounded outward for min and max so that drawing never shrinks the
+ waveform; else as floats
+ */
+PROJECT_FILE_IO_API std::vector<char> EncodeLevel(const float* frames, size_t numFrames, bool quantize);
+
+//! Unpack a level stored by EncodeLevel()
+/*! @return false if the blob is not of `numFrames` frames in a known format */
+PROJECT_FILE_IO_API bool DecodeLevel(const void* blob, size_t bytes, float* dest, size_t numFrames);
+}
+
+#endif
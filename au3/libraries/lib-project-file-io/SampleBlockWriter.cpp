@@ -0,0 +1,532 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockWriter.cpp
+@brief Implements SampleBlockWriter
+
+**********************************************************************/
+
+#include "SampleBlockWriter.h"
+
+#include <sqlite3.h>
+
+#include <algorithm>
+
+#include "Prefs.h"
+#include "SampleBlockCodec.h"
+#include "concurrency/ThreadPool.h"
+
+BoolSetting AsyncBlockCommits{ L"/ProjectFileIO/AsyncBlockCommits", true };
+BoolSetting DeferBlockSummaries{ L"/ProjectFileIO/DeferBlockSummaries", true };
+
+void SampleBlockWriter::Row::Summarize()
+{
+    // Don't let exceptions escape call_once, which some implementations
+    // do not survive
+    std::call_once(mSummarized, [this]{
+        if (calcSummary) {
+            try {
+                calcSummary(*this);
+            }
+            catch (...) {
+                mSummaryException = std::current_exception();
+            }
+        }
+    });
+    if (mSummaryException) {
+        std::rethrow_exception(mSummaryException);
+    }
+}
+
+void SampleBlockWriter::Row::Encode()
+{
+    std::call_once(mEncoded, [this]{
+        if (!codec) {
+            return;
+        }
+        try {
+            encoded = SampleBlockCodec::Encode(
+                samples.get(), sampleBytes / SAMPLE_SIZE(format), format);
+        }
+        catch (...) {
+            // Memory exhaustion; compression is optional
+            encoded.clear();
+        }
+        codec->store(encoded.empty() ? SampleBlockCodec::Raw : SampleBlockCodec::Lossless);
+    });
+}
+
+SampleBlockWriter::Statements::~Statements()
+{
+    for (auto stmt : { insert, insertEncoded, insertPyramid }) {
+        if (stmt) {
+            sqlite3_finalize(stmt);
+        }
+    }
+}
+
+SampleBlockWriter::SampleBlockWriter(
+    sqlite3* db, sqlite3* writerDB, std::recursive_mutex& transactionMutex, FailureHandler onFailure)
+    : mDB{db}
+    , mTransactionMutex{transactionMutex}
+    , mOnFailure{std::move(onFailure)}
+    , mpSummaryPool{std::make_unique<audacity::concurrency::ThreadPool>(
+                        audacity::concurrency::ThreadPool::DefaultNumWorkers())}
+    , mWriterStatements{writerDB}
+    , mCallerStatements{db}
+{
+    mThread = std::thread([this]{ Run(); });
+}
+
+SampleBlockWriter::~SampleBlockWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        mStop = true;
+    }
+    mCondition.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+SampleBlockID SampleBlockWriter::NewBlockID()
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    if (mNextID == 0) {
+        // First use since the connection opened.  The table declares
+        // AUTOINCREMENT, so ids of deleted rows are not reused either; respect
+        // that by consulting sqlite_sequence too, when it exists.
+        sqlite3_stmt* stmt = nullptr;
+        int rc = sqlite3_prepare_v2(mDB,
+                                    "SELECT max(ifnull((SELECT max(blockid) FROM sampleblocks), 0),"
+                                    "           ifnull((SELECT seq FROM sqlite_sequence"
+                                    "                     WHERE name = 'sampleblocks'), 0));",
+                                    -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            // Perhaps a database older than the AUTOINCREMENT declaration
+            rc = sqlite3_prepare_v2(mDB,
+                                    "SELECT ifnull(max(blockid), 0) FROM sampleblocks;",
+                                    -1, &stmt, nullptr);
+        }
+        if (rc != SQLITE_OK) {
+            return 0;
+        }
+        auto finalizer = finally([&stmt]{ sqlite3_finalize(stmt); });
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            return 0;
+        }
+        mNextID = sqlite3_column_int64(stmt, 0) + 1;
+    }
+    return mNextID++;
+}
+
+bool SampleBlockWriter::Enqueue(RowPtr row)
+{
+    if (!row) {
+        return true;
+    }
+    const auto bytes = row->Bytes();
+    std::unique_lock<std::mutex> lock{ mMutex };
+    // Let one row through, however large, if nothing else is waiting; but
+    // don't wait for the background thread while a transaction scope blocks it
+    mCondition.wait(lock, [&]{
+        return mFailed || mScopes > 0 || mQueuedBytes == 0
+               || mQueuedBytes + bytes <= MaxQueuedBytes;
+    });
+    if (!ReportFailure(lock)) {
+        return false;
+    }
+    if (mScopes > 0) {
+        lock.unlock();
+        InsertNow({ std::move(row) });
+        lock.lock();
+        return ReportFailure(lock);
+    }
+    mQueue.push_back({ std::move(row), Clock::now() });
+    mQueuedBytes += bytes;
+    lock.unlock();
+    mCondition.notify_all();
+    return true;
+}
+
+bool SampleBlockWriter::EnqueueDurable(RowPtr row)
+{
+    const auto bytes = row->Bytes();
+    std::unique_lock<std::mutex> lock{ mMutex };
+    // Once queued while no scope is open, the row is inserted either by the
+    // background thread, or by BeginScope() before its transaction begins
+    mCondition.wait(lock, [&]{
+        return mFailed || (mScopes == 0
+                           && (mQueuedBytes == 0 || mQueuedBytes + bytes <= MaxQueuedBytes));
+    });
+    if (!ReportFailure(lock)) {
+        return false;
+    }
+    mQueue.push_back({ row, Clock::now() });
+    mQueuedBytes += bytes;
+    // Don't let the batch wait for more rows
+    ++mFlushWaiters;
+    mCondition.notify_all();
+    mCondition.wait(lock, [&]{
+        const auto state = row->state.load();
+        return state != RowState::Pending && state != RowState::Inserting;
+    });
+    --mFlushWaiters;
+    const bool inserted = row->state == RowState::Inserted;
+    return ReportFailure(lock) && inserted;
+}
+
+bool SampleBlockWriter::Cancel(SampleBlockID id)
+{
+    std::unique_lock<std::mutex> lock{ mMutex };
+    const auto matches = [id](const auto& row){ return row->id == id; };
+    RowPtr pRow;
+    const auto found = std::find_if(mQueue.begin(), mQueue.end(),
+                                    [&](const Queued& queued){ return matches(queued.row); });
+    if (found != mQueue.end()) {
+        pRow = found->row;
+    } else if (const auto inFlight = std::find_if(mInFlight.begin(), mInFlight.end(), matches);
+               inFlight != mInFlight.end()) {
+        pRow = *inFlight;
+    } else {
+        return false;
+    }
+
+    auto expected = RowState::Pending;
+    if (pRow->state.compare_exchange_strong(expected, RowState::Cancelled)) {
+        // Whoever takes it up later will skip it
+        if (found != mQueue.end()) {
+            mQueuedBytes -= pRow->Bytes();
+            mQueue.erase(found);
+            lock.unlock();
+            mCondition.notify_all();
+        }
+        return true;
+    }
+    // Let the inserting thread finish with it
+    mCondition.wait(lock, [&]{ return pRow->state != RowState::Inserting; });
+    return false;
+}
+
+bool SampleBlockWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock{ mMutex };
+    ++mFlushWaiters;
+    mCondition.notify_all();
+    mCondition.wait(lock, [&]{
+        return mScopes > 0 || (mQueue.empty() && mInFlight.empty());
+    });
+    --mFlushWaiters;
+    if (mScopes > 0) {
+        // The background thread can't proceed
+        const auto rows = PendingRows();
+        lock.unlock();
+        InsertNow(rows);
+        lock.lock();
+    }
+    return ReportFailure(lock);
+}
+
+bool SampleBlockWriter::BeginScope()
+{
+    std::unique_lock<std::mutex> lock{ mMutex };
+    if (mScopes++ > 0) {
+        return true;
+    }
+    // Wake threads waiting for the background thread, to insert rows instead
+    mCondition.notify_all();
+    const auto rows = PendingRows();
+    if (!rows.empty()) {
+        // Still outside of the transaction; and the background thread is
+        // excluded by the transaction mutex
+        lock.unlock();
+        InsertNow(rows);
+        lock.lock();
+    }
+    return ReportFailure(lock);
+}
+
+void SampleBlockWriter::EndScope()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mMutex };
+        --mScopes;
+    }
+    mCondition.notify_all();
+}
+
+auto SampleBlockWriter::GetStatistics() const -> Statistics
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    return mStatistics;
+}
+
+void SampleBlockWriter::Run()
+{
+    std::unique_lock<std::mutex> lock{ mMutex };
+    while (true) {
+        mCondition.wait(lock, [&]{ return mStop || !mQueue.empty(); });
+        if (mQueue.empty()) {
+            // Stopped, and nothing remains to do
+            break;
+        }
+
+        // Give the batch some time to fill, unless somebody waits for it
+        const auto hurry = [&]{
+            return mStop || mFlushWaiters > 0 || mQueue.size() >= MaxBatchRows;
+        };
+        mCondition.wait_until(lock, mQueue.front().time + MaxBatchDelay, hurry);
+        if (mQueue.empty()) {
+            // All were cancelled or inserted by others meanwhile
+            continue;
+        }
+
+        const auto count = std::min(mQueue.size(), MaxBatchRows);
+        size_t bytes = 0;
+        for (size_t ii = 0; ii < count; ++ii) {
+            bytes += mQueue.front().row->Bytes();
+            mInFlight.push_back(std::move(mQueue.front().row));
+            mQueue.pop_front();
+        }
+
+        lock.unlock();
+        InsertBatch(mInFlight);
+        lock.lock();
+
+        mStatistics.rows += mInFlight.size();
+        ++mStatistics.batches;
+        mQueuedBytes -= bytes;
+        // Release the last references to the rows' contents; readers now find
+        // them in the database
+        mInFlight.clear();
+        mCondition.notify_all();
+    }
+}
+
+void SampleBlockWriter::InsertBatch(const std::vector<RowPtr>& batch)
+{
+    // Finish deferred summaries and compression first, and outside of the
+    // transaction
+    try {
+        mpSummaryPool->ParallelFor(batch.size(), [&](size_t ii, size_t){
+            batch[ii]->Summarize();
+            batch[ii]->Encode();
+        });
+    }
+    catch (...) {
+        // Memory exhaustion; try again one row at a time, needing less
+        PrepareRows(batch);
+    }
+
+    // Wait while a transaction scope is open on the other connection, which
+    // may hold the lock of the database for long
+    std::lock_guard<std::recursive_mutex> transactionLock{ mTransactionMutex };
+
+    const auto db = mWriterStatements.db;
+    int rc = sqlite3_exec(db, "SAVEPOINT SampleBlockWriter;", nullptr, nullptr, nullptr);
+    if (rc != SQLITE_OK) {
+        // Still insert the rows, each in its own transaction; dropping them
+        // would lose the samples
+        InsertPending(batch, mWriterStatements);
+        return;
+    }
+
+    InsertPending(batch, mWriterStatements);
+
+    rc = sqlite3_exec(db, "RELEASE SampleBlockWriter;", nullptr, nullptr, nullptr);
+    if (rc != SQLITE_OK) {
+        RecordFailure(rc, db);
+        sqlite3_exec(db, "ROLLBACK TO SampleBlockWriter;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "RELEASE SampleBlockWriter;", nullptr, nullptr, nullptr);
+    }
+}
+
+void SampleBlockWriter::InsertNow(const std::vector<RowPtr>& rows)
+{
+    PrepareRows(rows);
+    std::lock_guard<std::mutex> lock{ mCallerStatementsMutex };
+    InsertPending(rows, mCallerStatements);
+}
+
+void SampleBlockWriter::PrepareRows(const std::vector<RowPtr>& rows)
+{
+    for (const auto& pRow : rows) {
+        try {
+            pRow->Summarize();
+        }
+        catch (...) {
+            // Memory exhaustion.  The totals are not ready, nor ever will be
+            // from this row, so do not insert it; readers of the block find
+            // it missing and throw instead of using the totals
+            auto expected = RowState::Pending;
+            if (pRow->state.compare_exchange_strong(expected, RowState::Failed)) {
+                RecordFailure(SQLITE_NOMEM, mDB);
+            }
+            continue;
+        }
+        pRow->Encode();
+    }
+}
+
+void SampleBlockWriter::InsertPending(
+    const std::vector<RowPtr>& rows, Statements& statements)
+{
+    // Keep going after failures:  other rows may yet succeed, and whatever
+    // waits for the queue to drain must not wait forever
+    for (auto& pRow : rows) {
+        auto expected = RowState::Pending;
+        if (!pRow->state.compare_exchange_strong(expected, RowState::Inserting)) {
+            continue;
+        }
+        if (const auto rc = InsertRow(*pRow, statements); rc != SQLITE_OK) {
+            RecordFailure(rc, statements.db);
+            pRow->state.store(RowState::Failed);
+        } else {
+            InsertPyramid(*pRow, statements);
+            pRow->state.store(RowState::Inserted);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock{ mMutex };
+    // Forget queued rows inserted here, before the background thread comes
+    // to them
+    for (auto iter = mQueue.begin(); iter != mQueue.end();) {
+        if (iter->row->state == RowState::Pending) {
+            ++iter;
+        } else {
+            mQueuedBytes -= iter->row->Bytes();
+            iter = mQueue.erase(iter);
+        }
+    }
+    mCondition.notify_all();
+    // Rows that another thread took up are not in the database until it is done
+    mCondition.wait(lock, [&]{
+        return std::none_of(rows.begin(), rows.end(), [](const RowPtr& pRow){
+            return pRow->state == RowState::Inserting;
+        });
+    });
+}
+
+int SampleBlockWriter::InsertRow(const Row& row, Statements& statements)
+{
+    int rc;
+    // The codec column is named only when needed, because projects of older
+    // versions may lack it
+    const bool encoded = !row.encoded.empty();
+    auto& stmt = encoded ? statements.insertEncoded : statements.insert;
+    if (!stmt) {
+        rc = sqlite3_prepare_v3(statements.db,
+                                encoded
+                                ? "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax, sumrms,"
+                                "                          summary256, summary64k, samples, codec)"
+                                "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8,?9);"
+                                : "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax, sumrms,"
+                                "                          summary256, summary64k, samples)"
+                                "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8);",
+                                -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+    }
+
+    const auto& totals = *row.totals;
+    if ((rc = sqlite3_bind_int64(stmt, 1, row.id))
+        || (rc = sqlite3_bind_int(stmt, 2, static_cast<int>(row.format)))
+        || (rc = sqlite3_bind_double(stmt, 3, totals.min))
+        || (rc = sqlite3_bind_double(stmt, 4, totals.max))
+        || (rc = sqlite3_bind_double(stmt, 5, totals.rms))
+        || (rc = sqlite3_bind_blob(stmt, 6, row.summary256.get(), row.summary256Bytes, SQLITE_STATIC))
+        || (rc = sqlite3_bind_blob(stmt, 7, row.summary64k.get(), row.summary64kBytes, SQLITE_STATIC))
+        || (rc = encoded
+                 ? sqlite3_bind_blob(stmt, 8, row.encoded.data(), row.encoded.size(), SQLITE_STATIC)
+                 : sqlite3_bind_blob(stmt, 8, row.samples.get(), row.sampleBytes, SQLITE_STATIC))
+        || (encoded && (rc = sqlite3_bind_int(stmt, 9, SampleBlockCodec::Lossless)))) {
+        sqlite3_clear_bindings(stmt);
+        return rc;
+    }
+
+    rc = sqlite3_step(stmt);
+
+    // Clear statement bindings and rewind statement
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+
+    return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+void SampleBlockWriter::InsertPyramid(const Row& row, Statements& statements)
+{
+    if (row.pyramid[0].empty()) {
+        return;
+    }
+    if (!statements.insertPyramid) {
+        // The table of an older project is missing until
+        // DBConnection::EnableSummaryPyramids() adds it; try again for later
+        // rows
+        if (sqlite3_prepare_v3(statements.db,
+                               "INSERT INTO summarypyramids (blockid, summary16k, summary4k,"
+                               "                             summary1k, summary64, summary16)"
+                               "                            VALUES(?1,?2,?3,?4,?5,?6);",
+                               -1, SQLITE_PREPARE_PERSISTENT, &statements.insertPyramid, nullptr)
+            != SQLITE_OK) {
+            return;
+        }
+    }
+
+    const auto stmt = statements.insertPyramid;
+    const auto& pyramid = row.pyramid;
+    // Bind the levels coarsest first, in the order of the columns
+    bool bound = sqlite3_bind_int64(stmt, 1, row.id) == SQLITE_OK;
+    for (size_t level = 0; bound && level < pyramid.size(); ++level) {
+        const auto& blob = pyramid[pyramid.size() - 1 - level];
+        bound = sqlite3_bind_blob(stmt, 2 + level, blob.data(), blob.size(), SQLITE_STATIC) == SQLITE_OK;
+    }
+    if (bound) {
+        sqlite3_step(stmt);
+    }
+
+    // Clear statement bindings and rewind statement
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+}
+
+std::vector<SampleBlockWriter::RowPtr> SampleBlockWriter::PendingRows() const
+{
+    std::vector<RowPtr> rows;
+    rows.reserve(mQueue.size() + mInFlight.size());
+    for (const auto& queued : mQueue) {
+        rows.push_back(queued.row);
+    }
+    rows.insert(rows.end(), mInFlight.begin(), mInFlight.end());
+    return rows;
+}
+
+void SampleBlockWriter::RecordFailure(int rc, sqlite3* db)
+{
+    std::lock_guard<std::mutex> lock{ mMutex };
+    // Keep only the first
+    if (!mFailed) {
+        mFailed = true;
+        mFailureCode = rc;
+        mFailureMessage = sqlite3_errmsg(db);
+    }
+}
+
+bool SampleBlockWriter::ReportFailure(std::unique_lock<std::mutex>& lock)
+{
+    if (!mFailed) {
+        return true;
+    }
+    mFailed = false;
+    const auto rc = mFailureCode;
+    const auto message = std::move(mFailureMessage);
+    // Don't call out while locked
+    lock.unlock();
+    if (mOnFailure) {
+        mOnFailure(rc, message);
+    }
+    lock.lock();
+    return false;
+}
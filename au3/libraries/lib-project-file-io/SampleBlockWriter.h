@@ -0,0 +1,294 @@
+/*!********************************************************************
+
+Audacity: A Digital Audio Editor
+
+@file SampleBlockWriter.h
+@brief Declare SampleBlockWriter, which inserts new sample blocks into the database in batches, in a background thread
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_BLOCK_WRITER__
+#define __AUDACITY_SAMPLE_BLOCK_WRITER__
+
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MemoryX.h"
+#include "SampleBlock.h" // for SampleBlockID
+#include "SampleBlockSummary.h"
+#include "SampleFormat.h"
+
+namespace audacity::concurrency {
+class ThreadPool;
+}
+
+struct sqlite3;
+struct sqlite3_stmt;
+class BoolSetting;
+
+//! Whether connections opened from now on insert new sample blocks in a
+//! background thread
+PROJECT_FILE_IO_API extern BoolSetting AsyncBlockCommits;
+
+//! Whether the summaries of new sample blocks may be computed later, by the
+//! background thread and its helpers, or by the first reader
+PROJECT_FILE_IO_API extern BoolSetting DeferBlockSummaries;
+
+//! Inserts rows of the sampleblocks table in a background thread
+/*!
+ Recording and importing create many blocks in quick succession.  Inserting
+ each one in its own implicit transaction makes every block pay for a
+ journal commit.  This class instead gathers the rows into batches, each
+ inserted within one transaction of a connection of its own, so that neither
+ its transactions nor those of the other connection can undo the other's rows.
+
+ The background thread inserts nothing while a transaction scope is open on
+ the other connection.  Rows are inserted instead by the threads making them,
+ within that transaction, as SqliteSampleBlock did before; so no thread waits
+ for the background thread while a scope that blocks it is open.
+
+ Ids are allocated at once by NewBlockID(), so the callers need not wait
+ for the insertion.  The caller keeps a weak pointer to the Row, and may
+ read the contents from memory for as long as it locks.
+
+ A row may leave its summaries to be computed, and may ask for compression;
+ the background thread does those for a whole batch at once, on several
+ threads, before inserting it.
+
+ Enqueue() waits while too much data is waiting, and Flush() waits until all
+ of it is in the database.
+
+ All public member functions are thread-safe.
+ */
+class PROJECT_FILE_IO_API SampleBlockWriter final
+{
+public:
+    //! Totals of the summary, which the block may need after the row is gone
+    struct Totals : SampleBlockSummary::Totals {
+        //! Set, with release semantics, after the other members
+        std::atomic<bool> ready{ false };
+    };
+
+    enum class RowState {
+        Pending, Inserting, Inserted, Cancelled,
+        //! Not inserted, for want of memory or because the database refused
+        Failed
+    };
+
+    //! Contents of one row of the sampleblocks table
+    struct Row {
+        SampleBlockID id{};
+        //! Whoever changes it from Pending inserts the row, or cancels it
+        std::atomic<RowState> state{ RowState::Pending };
+        sampleFormat format{ floatSample };
+        std::shared_ptr<Totals> totals;
+        ArrayOf<char> samples;
+        size_t sampleBytes{};
+        ArrayOf<char> summary256;
+        size_t summary256Bytes{};
+        ArrayOf<char> summary64k;
+        size_t summary64kBytes{};
+        //! Inserted into the summarypyramids table, if not empty
+        SampleBlockSummary::PyramidBlobs pyramid;
+        //! Passed to SampleBlockSummary::EncodeLevel() when deferred
+        bool quantizePyramid{ true };
+        //! If not null, the samples are compressed by the background thread
+        //! and its helpers, if that makes them smaller, and this receives the
+        //! SampleBlockCodec::Codec before insertion
+        std::shared_ptr<std::atomic<int> > codec;
+        //! The compressed samples, inserted instead of `samples` if not empty
+        std::vector<char> encoded;
+
+        //! If not null, computes the summaries and totals from the samples
+        void (*calcSummary)(Row& row){ nullptr };
+
+        //! Not counting the pyramid, which a deferred summary fills later
+        size_t Bytes() const
+        {
+            return sampleBytes + summary256Bytes + summary64kBytes;
+        }
+
+        //! Make the summaries and totals valid, calling calcSummary if that
+        //! was not yet done; concurrent callers wait for the first.  If that
+        //! threw, so does every call
+        void Summarize();
+
+        //! Fill `encoded` and `codec`, if `codec` is not null and that was
+        //! not yet done; concurrent callers wait for the first.  Leaves the
+        //! samples uncompressed if memory is short, rather than throw
+        void Encode();
+
+    private:
+        std::once_flag mSummarized;
+        std::exception_ptr mSummaryException;
+        std::once_flag mEncoded;
+    };
+    using RowPtr = std::shared_ptr<Row>;
+
+    //! Receives, in the thread calling Enqueue() or Flush(), the first error
+    //! met by the background thread since the last report
+    using FailureHandler = std::function<void (int rc, const std::string& message)>;
+
+    struct Statistics {
+        size_t rows{};
+        size_t batches{};
+    };
+
+    //! Start the background thread
+    /*!
+     @param db the connection that the rest of the program uses, which must
+     remain open for the lifetime of this
+     @param writerDB another connection to the same database, used only by
+     the background thread, which must remain open for the lifetime of this
+     @param transactionMutex held by the background thread for the duration of
+     each batch; each transaction scope on `db` must hold it for its whole
+     life, between calls of BeginScope() and EndScope()
+     */
+    SampleBlockWriter(sqlite3* db, sqlite3* writerDB, std::recursive_mutex& transactionMutex, FailureHandler onFailure);
+    //! Insert all queued rows, then stop the background thread
+    ~SampleBlockWriter();
+
+    SampleBlockWriter(const SampleBlockWriter&) = delete;
+    SampleBlockWriter& operator=(const SampleBlockWriter&) = delete;
+
+    //! Allocate an id that is not used and was never used in the table
+    /*! @return zero if the database could not be queried */
+    SampleBlockID NewBlockID();
+
+    //! Queue a row for insertion, waiting first while too much data is queued
+    /*!
+     While a transaction scope is open, insert it at once instead, on this
+     thread.
+     @pre `row->id` was given by NewBlockID()
+     @return false, without queuing, if an earlier insertion failed;
+     the failure handler was called
+     */
+    bool Enqueue(RowPtr row);
+
+    //! Queue a row, and wait until it is in the database outside of any
+    //! transaction scope, so that no rollback can undo it
+    /*!
+     Waits first for any transaction scope to end.  Not to be called within a
+     transaction scope on this thread.
+     @pre `row->id` was given by NewBlockID()
+     @return false if the row was not inserted
+     */
+    bool EnqueueDurable(RowPtr row);
+
+    //! Remove a row that was not yet inserted
+    /*!
+     If the row is already being inserted, wait for that instead
+     @return whether the row will never be inserted, so that there is no
+     need to delete it from the table
+     */
+    bool Cancel(SampleBlockID id);
+
+    //! Wait until all rows queued so far are in the database
+    /*!
+     While a transaction scope is open, insert them instead on this thread,
+     within the transaction.
+     @return false if any insertion failed; the failure handler was called
+     */
+    bool Flush();
+
+    //! Called when a transaction scope on the connection starts
+    /*!
+     @pre this thread holds the transaction mutex, and has not yet begun the
+     transaction
+     The outermost scope first inserts the rows still queued, on this thread,
+     so that they are not rolled back with the scope.
+     @return false if any insertion failed; the failure handler was called
+     */
+    bool BeginScope();
+    //! Called when a transaction scope ends, whether committed or not
+    void EndScope();
+
+    Statistics GetStatistics() const;
+
+    //! At most so many rows in one batch
+    static constexpr size_t MaxBatchRows = 64;
+    //! The first row of a batch waits for more at most so long
+    static constexpr std::chrono::milliseconds MaxBatchDelay{ 50 };
+    //! Enqueue() waits while so many bytes of blobs are queued
+    static constexpr size_t MaxQueuedBytes = 64 << 20;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Queued {
+        RowPtr row;
+        Clock::time_point time;
+    };
+
+    //! Prepared on one connection
+    struct Statements {
+        explicit Statements(sqlite3* db)
+            : db{db} {}
+        ~Statements();
+
+        sqlite3* const db;
+        sqlite3_stmt* insert{ nullptr };
+        sqlite3_stmt* insertEncoded{ nullptr };
+        sqlite3_stmt* insertPyramid{ nullptr };
+    };
+
+    void Run();
+    void InsertBatch(const std::vector<RowPtr>& batch);
+    //! Insert on the calling thread, within whatever transaction is open
+    //! on mDB
+    void InsertNow(const std::vector<RowPtr>& rows);
+    //! Summarize and encode the rows one at a time on this thread; mark those
+    //! that can't be summarized as failed
+    void PrepareRows(const std::vector<RowPtr>& rows);
+    //! Insert those rows still pending, and notify any waiting in Cancel()
+    void InsertPending(const std::vector<RowPtr>& rows, Statements& statements);
+    int InsertRow(const Row& row, Statements& statements);
+    //! Failure is not an error; readers compute missing pyramids
+    void InsertPyramid(const Row& row, Statements& statements);
+    //! Queued and in flight rows; @pre mMutex is locked
+    std::vector<RowPtr> PendingRows() const;
+    void RecordFailure(int rc, sqlite3* db);
+    //! @pre mMutex is locked by `lock`
+    bool ReportFailure(std::unique_lock<std::mutex>& lock);
+
+    sqlite3* const mDB;
+    std::recursive_mutex& mTransactionMutex;
+    const FailureHandler mOnFailure;
+    //! Helps the background thread with summaries
+    const std::unique_ptr<audacity::concurrency::ThreadPool> mpSummaryPool;
+    //! Used only by the background thread
+    Statements mWriterStatements;
+    //! Used by other threads while a transaction scope is open
+    std::mutex mCallerStatementsMutex;
+    Statements mCallerStatements;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Queued> mQueue;
+    std::vector<RowPtr> mInFlight;
+    size_t mQueuedBytes{ 0 };
+    size_t mFlushWaiters{ 0 };
+    //! Number of transaction scopes open on mDB
+    size_t mScopes{ 0 };
+    bool mStop{ false };
+
+    SampleBlockID mNextID{ 0 };
+
+    bool mFailed{ false };
+    int mFailureCode{ 0 };
+    std::string mFailureMessage;
+
+    Statistics mStatistics;
+
+    std::thread mThread;
+};
+
+#endif
@@ -13,7 +13,13 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 
 #include "BasicUI.h"
 #include "DBConnection.h"
+#include "DisplayDataStore.h"
+#include "Prefs.h"
 #include "ProjectFileIO.h"
+#include "SampleBlockCache.h"
+#include "SampleBlockCodec.h"
+#include "SampleBlockSummary.h"
+#include "SampleBlockWriter.h"
 #include "SampleFormat.h"
 #include "AudioSegmentSampleView.h"
 #include "XMLTagHandler.h"
@@ -27,10 +33,15 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 #include "SentryHelper.h"
 #include <wx/log.h>
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 
 class SqliteSampleBlockFactory;
 
+//! Whether summary pyramids of new blocks may be stored in 16 bits
+static BoolSetting QuantizeSummaryPyramids{ L"/ProjectFileIO/QuantizeSummaryPyramids", true };
+
 ///\brief Implementation of @ref SampleBlock using Sqlite database
 class SqliteSampleBlock final : public SampleBlock
 {
@@ -48,12 +59,19 @@ public:
 
     void CloseLock() noexcept override;
 
+    //! @param durable whether to wait until the row is in the database
+    //! outside of any transaction scope
     void SetSamples(
-        constSamplePtr src, size_t numsamples, sampleFormat srcformat);
+        constSamplePtr src, size_t numsamples, sampleFormat srcformat, bool durable = false);
 
     //! Numbers of bytes needed for 256 and for 64k summaries
     using Sizes = std::pair< size_t, size_t >;
     void Commit(Sizes sizes);
+    //! Give the row to the SampleBlockWriter instead
+    /*! @param deferSummary if true, CalcSummary() was not called, and the
+     summaries will be computed by the writer's threads or by the first reader
+     */
+    void CommitAsync(SampleBlockWriter& writer, Sizes sizes, bool deferSummary, bool durable);
 
     void Delete();
 
@@ -65,6 +83,7 @@ public:
 
     bool GetSummary256(float* dest, size_t frameoffset, size_t numframes) override;
     bool GetSummary64k(float* dest, size_t frameoffset, size_t numframes) override;
+    bool GetSummary(size_t factor, float* dest, size_t frameoffset, size_t numframes) override;
     double GetSumMin() const;
     double GetSumMax() const;
     double GetSumRms() const;
@@ -81,15 +100,41 @@ public:
 private:
     bool IsSilent() const { return mBlockID <= 0; }
     void Load(SampleBlockID sbid);
-    bool GetSummary(float* dest, size_t frameoffset, size_t numframes, DBConnection::StatementID id, const char* sql);
-    size_t GetBlob(void* dest, sampleFormat destformat, sqlite3_stmt* stmt, sampleFormat srcformat, size_t srcoffset, size_t srcbytes);
+    bool GetSummary(float* dest, size_t frameoffset, size_t numframes, SampleBlockCache::Kind kind);
+    //! Read from the row awaiting insertion, if any, else from the database
+    size_t GetBlob(void* dest, sampleFormat destformat, SampleBlockCache::Kind kind, sampleFormat srcformat, size_t srcoffset,
+                   size_t srcbytes);
+    //! Convert part of a blob, padding with zeroes past its end
+    static size_t CopyBlob(void* dest, sampleFormat destformat, constSamplePtr src, size_t blobbytes, sampleFormat srcformat,
+                           size_t srcoffset, size_t srcbytes);
+    //! Entire blob converted to float, from the project's cache if possible,
+    //! else from the database, then cached
+    SampleBlockCache::Data GetCachedBlob(SampleBlockCache::Kind kind, sampleFormat srcformat, size_t srcbytes);
+    //! Copy a range of cached floats, padding with zeroes past the end
+    static void CopyCached(const std::vector<float>& cached, float* dest, size_t offset, size_t count);
+    //! A level of the summary pyramid, from the project's cache if possible,
+    //! else from the database, else computed, then cached
+    /*! @param level index into SampleBlockSummary::pyramidFactors */
+    SampleBlockCache::Data GetPyramidLevel(size_t level);
+    //! @return false if the level is not stored
+    bool ReadPyramidLevel(size_t level, float* dest);
+    void ComputePyramidLevel(size_t level, float* dest);
+    //! Failure is not an error; readers compute missing pyramids
+    void InsertPyramid();
 
     enum {
-        fields = 3, /* min, max, rms */
-        bytesPerFrame = fields * sizeof(float),
+        fields = SampleBlockSummary::fields,
+        bytesPerFrame = SampleBlockSummary::bytesPerFrame,
     };
+    static Sizes GetSizes(size_t numsamples);
     Sizes SetSizes(size_t numsamples, sampleFormat srcformat);
     void CalcSummary(Sizes sizes);
+    //! SampleBlockWriter::Row::calcSummary for deferred summaries
+    static void CalcSummary(SampleBlockWriter::Row& row);
+    //! Waits for a deferred summary if necessary
+    SampleBlockSummary::Totals GetTotals() const;
+    //! How the samples are stored in the database
+    SampleBlockCodec::Codec GetCodec() const;
 
 private:
     //! This must never be called for silent blocks
@@ -108,6 +153,15 @@ private:
 
     SampleBlockID mBlockID{ 0 };
 
+    //! Contents given to the SampleBlockWriter, while not yet inserted
+    std::weak_ptr<SampleBlockWriter::Row> mPending;
+    //! Not null if the summary was deferred; then it replaces mSumMin,
+    //! mSumMax and mSumRms
+    std::shared_ptr<const SampleBlockWriter::Totals> mpDeferredTotals;
+    //! Not null if compression was left to the SampleBlockWriter; then it
+    //! replaces mCodec
+    std::shared_ptr<const std::atomic<int> > mpDeferredCodec;
+
     ArrayOf<char> mSamples;
     size_t mSampleBytes;
     size_t mSampleCount;
@@ -115,6 +169,11 @@ private:
 
     ArrayOf<char> mSummary256;
     ArrayOf<char> mSummary64k;
+    SampleBlockSummary::PyramidBlobs mPyramid;
+    bool mQuantizePyramid{ true };
+    //! Whether new samples are to be compressed
+    bool mCompress{ false };
+    SampleBlockCodec::Codec mCodec{ SampleBlockCodec::Raw };
     double mSumMin;
     double mSumMax;
     double mSumRms;
@@ -129,6 +188,8 @@ private:
 // used length values
 static std::map< SampleBlockID, std::shared_ptr<SqliteSampleBlock> >
 sSilentBlocks;
+//! Guards sSilentBlocks, which worker threads of effects may use together
+static std::mutex sSilentBlocksMutex;
 
 ///\brief Implementation of @ref SampleBlockFactory using Sqlite database
 class SqliteSampleBlockFactory final : public SampleBlockFactory, public std::enable_shared_from_this<SqliteSampleBlockFactory>
@@ -140,8 +201,13 @@ public:
 
     SampleBlockIDs GetActiveBlockIDs() override;
 
+    bool LoadDisplayData(uint64_t key, std::vector<char>& data) override;
+    void StoreDisplayData(uint64_t key, const void* data, size_t bytes) override;
+
     SampleBlockPtr DoCreate(constSamplePtr src, size_t numsamples, sampleFormat srcformat) override;
 
+    SampleBlockPtr DoCreateDurable(constSamplePtr src, size_t numsamples, sampleFormat srcformat) override;
+
     SampleBlockPtr DoCreateSilent(
         size_t numsamples, sampleFormat srcformat) override;
 
@@ -159,6 +225,9 @@ public:
     }
 
 private:
+    //! @return null if there is no connection, or no store
+    DisplayDataStore* GetDisplayDataStore(bool create = false) const;
+
     void OnBeginPurge(size_t begin, size_t end);
     void OnEndPurge();
 
@@ -168,6 +237,7 @@ private:
     Observer::Subscription mUndoSubscription;
     std::function<void()> mSampleBlockDeletionCallback;
     const std::shared_ptr<ConnectionPtr> mppConnection;
+    const std::shared_ptr<SampleBlockCache> mpCache;
 
     // Track all blocks that this factory has created, but don't control
     // their lifetimes (so use weak_ptr)
@@ -176,11 +246,15 @@ private:
     using AllBlocksMap
         =std::map< SampleBlockID, std::weak_ptr< SqliteSampleBlock > >;
     AllBlocksMap mAllBlocks;
+    //! Blocks may be created on several threads at once, as by effects that
+    //! process tracks concurrently
+    std::mutex mAllBlocksMutex;
 };
 
 SqliteSampleBlockFactory::SqliteSampleBlockFactory(AudacityProject& project)
     : mProject{project}
     , mppConnection{ConnectionPtr::Get(project).shared_from_this()}
+    , mpCache{SampleBlockCache::Get(project).shared_from_this()}
 {
     mUndoSubscription = UndoManager::Get(project)
                         .Subscribe([this](UndoRedoMessage message){
@@ -203,6 +277,18 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
     auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
     sb->SetSamples(src, numsamples, srcformat);
     // block id has now been assigned
+    std::lock_guard<std::mutex> lock{ mAllBlocksMutex };
+    mAllBlocks[ sb->GetBlockID() ] = sb;
+    return sb;
+}
+
+SampleBlockPtr SqliteSampleBlockFactory::DoCreateDurable(
+    constSamplePtr src, size_t numsamples, sampleFormat srcformat)
+{
+    auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
+    sb->SetSamples(src, numsamples, srcformat, true);
+    // block id has now been assigned
+    std::lock_guard<std::mutex> lock{ mAllBlocksMutex };
     mAllBlocks[ sb->GetBlockID() ] = sb;
     return sb;
 }
@@ -210,6 +296,7 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
 auto SqliteSampleBlockFactory::GetActiveBlockIDs() -> SampleBlockIDs
 {
     SampleBlockIDs result;
+    std::lock_guard<std::mutex> lock{ mAllBlocksMutex };
     for (auto end = mAllBlocks.end(), it = mAllBlocks.begin(); it != end;) {
         if (it->second.expired()) {
             // Tighten up the map
@@ -222,10 +309,30 @@ auto SqliteSampleBlockFactory::GetActiveBlockIDs() -> SampleBlockIDs
     return result;
 }
 
+DisplayDataStore* SqliteSampleBlockFactory::GetDisplayDataStore(bool create) const
+{
+    auto& pConnection = mppConnection->mpConnection;
+    return pConnection ? pConnection->GetDisplayDataStore(create) : nullptr;
+}
+
+bool SqliteSampleBlockFactory::LoadDisplayData(uint64_t key, std::vector<char>& data)
+{
+    const auto pStore = GetDisplayDataStore();
+    return pStore && pStore->Load(key, data);
+}
+
+void SqliteSampleBlockFactory::StoreDisplayData(uint64_t key, const void* data, size_t bytes)
+{
+    if (const auto pStore = GetDisplayDataStore(true)) {
+        pStore->Store(key, data, bytes);
+    }
+}
+
 SampleBlockPtr SqliteSampleBlockFactory::DoCreateSilent(
     size_t numsamples, sampleFormat)
 {
     auto id = -static_cast< SampleBlockID >(numsamples);
+    std::lock_guard<std::mutex> lock{ sSilentBlocksMutex };
     auto& result = sSilentBlocks[ id ];
     if (!result) {
         result = std::make_shared<SqliteSampleBlock>(nullptr);
@@ -265,6 +372,7 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromId(
     }
 
     // First see if this block id was previously loaded
+    std::lock_guard<std::mutex> lock{ mAllBlocksMutex };
     auto& wb = mAllBlocks[id];
 
     if (auto block = wb.lock()) {
@@ -282,10 +390,28 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromId(
     return ssb;
 }
 
+namespace {
+//! Views zeroes, shared by all silent blocks
+BlockSampleView Silence(size_t count)
+{
+    static std::mutex mutex;
+    static std::shared_ptr<const std::vector<float> > zeroes;
+    std::lock_guard<std::mutex> lock{ mutex };
+    if (!zeroes || zeroes->size() < count) {
+        zeroes = std::make_shared<const std::vector<float> >(count);
+    }
+    return { zeroes, zeroes->data(), count };
+}
+}
+
 BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
 {
     assert(mSampleCount > 0);
 
+    if (IsSilent()) {
+        return Silence(mSampleCount);
+    }
+
     // Double-checked locking.
     // `weak_ptr::lock()` guarantees atomicity, which is important to make this
     // work without races.
@@ -293,26 +419,38 @@ BlockSampleView SqliteSampleBlock::GetFloatSampleView(bool mayThrow)
     if (cache) {
         return cache;
     }
+
+    if (mSampleFormat == floatSample) {
+        if (const auto pRow = mPending.lock()) {
+            // Not yet inserted, and already in the final format
+            return { pRow, reinterpret_cast<const float*>(pRow->samples.get()),
+                     mSampleCount };
+        }
+    }
+
     std::lock_guard<std::mutex> lock(mCacheMutex);
     cache = mCache.lock();
     if (cache) {
         return cache;
     }
 
-    const auto newCache
-        =std::make_shared<std::vector<float> >(mSampleCount);
+    std::shared_ptr<std::vector<float> > newCache;
     try {
-        const auto cachedSize = DoGetSamples(
-            reinterpret_cast<samplePtr>(newCache->data()), floatSample, 0,
-            mSampleCount);
-        assert(cachedSize == mSampleCount);
+        if (!mValid) {
+            Load(mBlockID);
+        }
+        // Share the contents with the project's cache, which outlives
+        // this weak pointer
+        newCache = GetCachedBlob(SampleBlockCache::Kind::Samples,
+                                 mSampleFormat, mSampleBytes);
+        assert(newCache->size() == mSampleCount);
     }
     catch (...)
     {
         if (mayThrow) {
             std::rethrow_exception(std::current_exception());
         }
-        std::fill(newCache->begin(), newCache->end(), 0.f);
+        newCache = std::make_shared<std::vector<float> >(mSampleCount);
     }
     mCache = newCache;
     return newCache;
@@ -410,13 +548,20 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
         return numsamples;
     }
 
-    // Prepare and cache statement...automatically finalized at DB close
-    sqlite3_stmt* stmt = Conn()->Prepare(DBConnection::GetSamples,
-                                         "SELECT samples FROM sampleblocks WHERE blockid = ?1;");
+    if (destformat == floatSample && mpFactory->mpCache->IsEnabled()) {
+        // Decode the whole block once; the database returns all of it anyway
+        if (!mValid) {
+            Load(mBlockID);
+        }
+        const auto samples = GetCachedBlob(SampleBlockCache::Kind::Samples,
+                                           mSampleFormat, mSampleBytes);
+        CopyCached(*samples, reinterpret_cast<float*>(dest), sampleoffset, numsamples);
+        return numsamples;
+    }
 
     return GetBlob(dest,
                    destformat,
-                   stmt,
+                   SampleBlockCache::Kind::Samples,
                    mSampleFormat,
                    sampleoffset * SAMPLE_SIZE(mSampleFormat),
                    numsamples * SAMPLE_SIZE(mSampleFormat)) / SAMPLE_SIZE(mSampleFormat);
@@ -424,14 +569,41 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
 
 void SqliteSampleBlock::SetSamples(constSamplePtr src,
                                    size_t numsamples,
-                                   sampleFormat srcformat)
+                                   sampleFormat srcformat,
+                                   bool durable)
 {
     auto sizes = SetSizes(numsamples, srcformat);
     mSamples.reinit(mSampleBytes);
     memcpy(mSamples.get(), src, mSampleBytes);
+    mQuantizePyramid = QuantizeSummaryPyramids.Read();
+    mCompress = CompressSampleBlocks.Read() && Conn()->EnableBlockCodecs();
+    // An older project gets the table only now; if it can't, the summaries
+    // are computed again when the block is next loaded
+    Conn()->EnableSummaryPyramids();
+
+    if (const auto pWriter = Conn()->GetBlockWriter()) {
+        const bool deferSummary = DeferBlockSummaries.Read();
+        if (!deferSummary) {
+            CalcSummary(sizes);
+        }
+        CommitAsync(*pWriter, sizes, deferSummary, durable);
+        return;
+    }
 
     CalcSummary(sizes);
 
+    if (durable) {
+        // Wait for the scopes of other threads to end, and keep new ones from
+        // beginning, so that the row is inserted outside of any savepoint
+        const auto lock = Conn()->LockTransactions();
+        if (!sqlite3_get_autocommit(DB())) {
+            // This thread is within a transaction scope
+            Conn()->ThrowException(false);
+        }
+        Commit(sizes);
+        return;
+    }
+
     Commit(sizes);
 }
 
@@ -439,36 +611,42 @@ bool SqliteSampleBlock::GetSummary256(float* dest,
                                       size_t frameoffset,
                                       size_t numframes)
 {
-    return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary256,
-                      "SELECT summary256 FROM sampleblocks WHERE blockid = ?1;");
+    return GetSummary(dest, frameoffset, numframes, SampleBlockCache::Kind::Summary256);
 }
 
 bool SqliteSampleBlock::GetSummary64k(float* dest,
                                       size_t frameoffset,
                                       size_t numframes)
 {
-    return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary64k,
-                      "SELECT summary64k FROM sampleblocks WHERE blockid = ?1;");
+    return GetSummary(dest, frameoffset, numframes, SampleBlockCache::Kind::Summary64k);
 }
 
 bool SqliteSampleBlock::GetSummary(float* dest,
                                    size_t frameoffset,
                                    size_t numframes,
-                                   DBConnection::StatementID id,
-                                   const char* sql)
+                                   SampleBlockCache::Kind kind)
 {
     // Non-throwing, it returns true for success
     bool silent = IsSilent();
     if (!silent) {
         // Not a silent block
         try {
-            // Prepare and cache statement...automatically finalized at DB close
-            auto stmt = Conn()->Prepare(id, sql);
+            if (mpFactory->mpCache->IsEnabled()) {
+                if (!mValid) {
+                    Load(mBlockID);
+                }
+                const auto sizes = GetSizes(mSampleCount);
+                const auto summary = GetCachedBlob(kind, floatSample,
+                                                   kind == SampleBlockCache::Kind::Summary256
+                                                   ? sizes.first : sizes.second);
+                CopyCached(*summary, dest, frameoffset * fields, numframes * fields);
+                return true;
+            }
             // Note GetBlob returns a size_t, not a bool
             // REVIEW: An error in GetBlob() will throw an exception.
             GetBlob(dest,
                     floatSample,
-                    stmt,
+                    kind,
                     floatSample,
                     frameoffset * fields * SAMPLE_SIZE(floatSample),
                     numframes * fields * SAMPLE_SIZE(floatSample));
@@ -482,19 +660,77 @@ bool SqliteSampleBlock::GetSummary(float* dest,
     return silent;
 }
 
+bool SqliteSampleBlock::GetSummary(size_t factor,
+                                   float* dest,
+                                   size_t frameoffset,
+                                   size_t numframes)
+{
+    using namespace SampleBlockSummary;
+    const auto found = std::find(pyramidFactors.begin(), pyramidFactors.end(), factor);
+    if (found == pyramidFactors.end()) {
+        // 256 or 64k
+        return SampleBlock::GetSummary(factor, dest, frameoffset, numframes);
+    }
+
+    // Non-throwing, it returns true for success
+    bool silent = IsSilent();
+    if (!silent) {
+        try {
+            if (!mValid) {
+                Load(mBlockID);
+            }
+            const auto summary = GetPyramidLevel(found - pyramidFactors.begin());
+            CopyCached(*summary, dest, frameoffset * fields, numframes * fields);
+            return true;
+        }
+        catch (const AudacityException&) {
+        }
+    }
+    memset(dest, 0, 3 * numframes * sizeof(float));
+    // Return true for success only if we didn't catch
+    return silent;
+}
+
 double SqliteSampleBlock::GetSumMin() const
 {
-    return mSumMin;
+    return GetTotals().min;
 }
 
 double SqliteSampleBlock::GetSumMax() const
 {
-    return mSumMax;
+    return GetTotals().max;
 }
 
 double SqliteSampleBlock::GetSumRms() const
 {
-    return mSumRms;
+    return GetTotals().rms;
+}
+
+SampleBlockSummary::Totals SqliteSampleBlock::GetTotals() const
+{
+    if (!mpDeferredTotals) {
+        return { mSumMin, mSumMax, mSumRms };
+    }
+    if (!mpDeferredTotals->ready.load(std::memory_order_acquire)) {
+        // Compute now, or wait for the thread that is computing.
+        // If the row is gone, it was summarized before insertion, unless
+        // memory ran short and the writer gave up on it.
+        if (const auto pRow = mPending.lock()) {
+            pRow->Summarize();
+        }
+        if (!mpDeferredTotals->ready.load(std::memory_order_acquire)) {
+            Conn()->ThrowException(false);
+        }
+    }
+    return *mpDeferredTotals;
+}
+
+SampleBlockCodec::Codec SqliteSampleBlock::GetCodec() const
+{
+    // Read only after the row is inserted, when the writer has decided
+    return mpDeferredCodec
+           ? static_cast<SampleBlockCodec::Codec>(mpDeferredCodec->load())
+           : mCodec;
 }
 
 /// Retrieves the minimum, maximum, and maximum RMS of the
@@ -547,7 +783,8 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS(size_t start, size_t len)
 /// these values are already computed.
 MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS() const
 {
-    return { (float)mSumMin, (float)mSumMax, (float)mSumRms };
+    const auto totals = GetTotals();
+    return { (float)totals.min, (float)totals.max, (float)totals.rms };
 }
 
 size_t SqliteSampleBlock::GetSpaceUsage() const
@@ -555,27 +792,71 @@ size_t SqliteSampleBlock::GetSpaceUsage() const
     if (IsSilent()) {
         return 0;
     } else {
+        // Still queued: the flush inserts every queued row, so that a caller
+        // measuring all blocks flushes at most once
+        if (!mPending.expired() && !Conn()->FlushBlockWriter()) {
+            Conn()->ThrowException(true);
+        }
         return ProjectFileIO::GetDiskUsage(*Conn(), mBlockID);
     }
 }
 
 size_t SqliteSampleBlock::GetBlob(void* dest,
                                   sampleFormat destformat,
-                                  sqlite3_stmt* stmt,
+                                  SampleBlockCache::Kind kind,
                                   sampleFormat srcformat,
                                   size_t srcoffset,
                                   size_t srcbytes)
 {
-    auto db = DB();
+    using Kind = SampleBlockCache::Kind;
 
     wxASSERT(!IsSilent());
 
+    if (const auto pRow = mPending.lock()) {
+        // Not yet inserted
+        if (kind != Kind::Samples) {
+            pRow->Summarize();
+        }
+        const auto [src, blobbytes]
+            =kind == Kind::Samples ? std::pair{ pRow->samples.get(), pRow->sampleBytes }
+              : kind == Kind::Summary256 ? std::pair{ pRow->summary256.get(), pRow->summary256Bytes }
+              : std::pair{ pRow->summary64k.get(), pRow->summary64kBytes };
+        return CopyBlob(dest, destformat, src, blobbytes, srcformat, srcoffset, srcbytes);
+    }
+
+    auto db = DB();
+
     if (!mValid) {
         Load(mBlockID);
     }
 
+    const auto codec = kind == Kind::Samples ? GetCodec() : SampleBlockCodec::Raw;
+
+    if (srcformat == destformat && codec == SampleBlockCodec::Raw) {
+        // No conversion, so copy straight out of the pages of the file
+        const auto column = kind == Kind::Samples ? "samples"
+                            : kind == Kind::Summary256 ? "summary256"
+                            : "summary64k";
+        if (const auto copied = Conn()->ReadBlob(
+                "sampleblocks", column, mBlockID, dest, srcoffset, srcbytes)) {
+            memset(static_cast<samplePtr>(dest) + *copied, 0, srcbytes - *copied);
+            return srcbytes;
+        }
+        // Else try again below, where errors are reported
+    }
+
+    // Prepare and cache statement...automatically finalized at DB close
+    sqlite3_stmt* stmt
+        =kind == Kind::Samples
+          ? Conn()->Prepare(DBConnection::GetSamples,
+                            "SELECT samples FROM sampleblocks WHERE blockid = ?1;")
+          : kind == Kind::Summary256
+          ? Conn()->Prepare(DBConnection::GetSummary256,
+                            "SELECT summary256 FROM sampleblocks WHERE blockid = ?1;")
+          : Conn()->Prepare(DBConnection::GetSummary64k,
+                            "SELECT summary64k FROM sampleblocks WHERE blockid = ?1;");
+
     int rc;
-    size_t minbytes = 0;
 
     // Bind statement parameters
     // Might return SQLITE_MISUSE which means it's our mistake that we violated
@@ -613,16 +894,47 @@ size_t SqliteSampleBlock::GetBlob(void* dest,
     }
 
     // Retrieve returned data
-    samplePtr src = (samplePtr)sqlite3_column_blob(stmt, 0);
+    constSamplePtr src = (constSamplePtr)sqlite3_column_blob(stmt, 0);
     size_t blobbytes = (size_t)sqlite3_column_bytes(stmt, 0);
 
-    srcoffset = std::min(srcoffset, blobbytes);
-    minbytes = std::min(srcbytes, blobbytes - srcoffset);
+    ArrayOf<char> decoded;
+    if (codec == SampleBlockCodec::Lossless) {
+        // Decompress all, even to copy part
+        decoded.reinit(mSampleBytes);
+        if (!SampleBlockCodec::Decode(src, blobbytes, srcformat, decoded.get(), mSampleBytes)) {
+            ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::GetBlob::decode");
 
-    if (srcoffset != 0) {
-        srcoffset += 0;
+            wxLogDebug(wxT("SqliteSampleBlock::GetBlob - corrupt compressed samples"));
+
+            sqlite3_clear_bindings(stmt);
+            sqlite3_reset(stmt);
+
+            Conn()->ThrowException(false);
+        }
+        src = decoded.get();
+        blobbytes = mSampleBytes;
     }
 
+    CopyBlob(dest, destformat, src, blobbytes, srcformat, srcoffset, srcbytes);
+
+    // Clear statement bindings and rewind statement
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+
+    return srcbytes;
+}
+
+size_t SqliteSampleBlock::CopyBlob(void* dest,
+                                   sampleFormat destformat,
+                                   constSamplePtr src,
+                                   size_t blobbytes,
+                                   sampleFormat srcformat,
+                                   size_t srcoffset,
+                                   size_t srcbytes)
+{
+    srcoffset = std::min(srcoffset, blobbytes);
+    const size_t minbytes = std::min(srcbytes, blobbytes - srcoffset);
+
     /*
      Will dithering happen in CopySamples?  Answering this as of 3.0.3 by
      examining all uses.
@@ -671,11 +983,133 @@ size_t SqliteSampleBlock::GetBlob(void* dest,
         memset(dest, 0, srcbytes - minbytes);
     }
 
+    return srcbytes;
+}
+
+SampleBlockCache::Data SqliteSampleBlock::GetCachedBlob(
+    SampleBlockCache::Kind kind, sampleFormat srcformat, size_t srcbytes)
+{
+    auto& cache = *mpFactory->mpCache;
+    if (auto cached = cache.Find(mBlockID, kind)) {
+        return cached;
+    }
+
+    auto result = std::make_shared<std::vector<float> >(
+        srcbytes / SAMPLE_SIZE(srcformat));
+    GetBlob(result->data(), floatSample, kind, srcformat, 0, srcbytes);
+    cache.Insert(mBlockID, kind, result);
+    return result;
+}
+
+void SqliteSampleBlock::CopyCached(
+    const std::vector<float>& cached, float* dest, size_t offset, size_t count)
+{
+    offset = std::min(offset, cached.size());
+    const auto copied = std::min(count, cached.size() - offset);
+    std::copy_n(cached.data() + offset, copied, dest);
+    std::fill_n(dest + copied, count - copied, 0.0f);
+}
+
+SampleBlockCache::Data SqliteSampleBlock::GetPyramidLevel(size_t level)
+{
+    using namespace SampleBlockSummary;
+    const auto kind = static_cast<SampleBlockCache::Kind>(
+        static_cast<size_t>(SampleBlockCache::Kind::Summary16) + level);
+    auto& cache = *mpFactory->mpCache;
+    if (auto cached = cache.Find(mBlockID, kind)) {
+        return cached;
+    }
+
+    auto result = std::make_shared<std::vector<float> >(
+        PyramidFrames(mSampleCount, pyramidFactors[level]) * fields);
+    if (!ReadPyramidLevel(level, result->data())) {
+        // Not stored by older versions
+        ComputePyramidLevel(level, result->data());
+    }
+    cache.Insert(mBlockID, kind, result);
+    return result;
+}
+
+bool SqliteSampleBlock::ReadPyramidLevel(size_t level, float* dest)
+{
+    using namespace SampleBlockSummary;
+    const auto numFrames = PyramidFrames(mSampleCount, pyramidFactors[level]);
+
+    if (const auto pRow = mPending.lock()) {
+        // Not yet inserted
+        pRow->Summarize();
+        const auto& blob = pRow->pyramid[level];
+        return DecodeLevel(blob.data(), blob.size(), dest, numFrames);
+    }
+
+    if (!Conn()->HasSummaryPyramids()) {
+        return false;
+    }
+
+    // Prepare and cache statement...automatically finalized at DB close
+    static const std::pair<DBConnection::StatementID, const char*> statements[] {
+        { DBConnection::GetSummary16, "SELECT summary16 FROM summarypyramids WHERE blockid = ?1;" },
+        { DBConnection::GetSummary64, "SELECT summary64 FROM summarypyramids WHERE blockid = ?1;" },
+        { DBConnection::GetSummary1k, "SELECT summary1k FROM summarypyramids WHERE blockid = ?1;" },
+        { DBConnection::GetSummary4k, "SELECT summary4k FROM summarypyramids WHERE blockid = ?1;" },
+        { DBConnection::GetSummary16k, "SELECT summary16k FROM summarypyramids WHERE blockid = ?1;" },
+    };
+    static_assert(std::size(statements) == pyramidFactors.size());
+    sqlite3_stmt* stmt = Conn()->Prepare(statements[level].first, statements[level].second);
+
+    bool result = false;
+    if (sqlite3_bind_int64(stmt, 1, mBlockID) == SQLITE_OK
+        && sqlite3_step(stmt) == SQLITE_ROW) {
+        result = DecodeLevel(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0), dest, numFrames);
+    }
+
     // Clear statement bindings and rewind statement
     sqlite3_clear_bindings(stmt);
     sqlite3_reset(stmt);
 
-    return srcbytes;
+    return result;
+}
+
+void SqliteSampleBlock::ComputePyramidLevel(size_t level, float* dest)
+{
+    using namespace SampleBlockSummary;
+    const auto factor = pyramidFactors[level];
+    if (factor < 256) {
+        const auto samples = GetCachedBlob(SampleBlockCache::Kind::Samples,
+                                           mSampleFormat, mSampleBytes);
+        Summarize(samples->data(), mSampleCount, factor, dest);
+    } else {
+        const auto summary256 = GetCachedBlob(SampleBlockCache::Kind::Summary256,
+                                              floatSample, GetSizes(mSampleCount).first);
+        Coarsen(summary256->data(), mSampleCount, 256, factor / 256, dest);
+    }
+}
+
+void SqliteSampleBlock::InsertPyramid()
+{
+    if (mPyramid[0].empty() || !Conn()->HasSummaryPyramids()) {
+        return;
+    }
+
+    // Prepare and cache statement...automatically finalized at DB close
+    sqlite3_stmt* stmt = Conn()->Prepare(DBConnection::InsertSummaryPyramid,
+                                         "INSERT INTO summarypyramids (blockid, summary16k, summary4k,"
+                                         "                             summary1k, summary64, summary16)"
+                                         "                            VALUES(?1,?2,?3,?4,?5,?6);");
+
+    // Bind the levels coarsest first, in the order of the columns
+    bool bound = sqlite3_bind_int64(stmt, 1, mBlockID) == SQLITE_OK;
+    for (size_t level = 0; bound && level < mPyramid.size(); ++level) {
+        const auto& blob = mPyramid[mPyramid.size() - 1 - level];
+        bound = sqlite3_bind_blob(stmt, 2 + level, blob.data(), blob.size(), SQLITE_STATIC) == SQLITE_OK;
+    }
+    if (bound && sqlite3_step(stmt) != SQLITE_DONE) {
+        wxLogDebug(wxT("SqliteSampleBlock::InsertPyramid - SQLITE error %s"), sqlite3_errmsg(DB()));
+    }
+
+    // Clear statement bindings and rewind statement
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
 }
 
 void SqliteSampleBlock::Load(SampleBlockID sbid)
@@ -693,10 +1127,16 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
     mSumMin = 0.0;
 
     // Prepare and cache statement...automatically finalized at DB close
-    sqlite3_stmt* stmt = Conn()->Prepare(DBConnection::LoadSampleBlock,
-                                         "SELECT sampleformat, summin, summax, sumrms,"
-                                         "       length(samples)"
-                                         "  FROM sampleblocks WHERE blockid = ?1;");
+    sqlite3_stmt* stmt
+        =Conn()->HasBlockCodecs()
+          ? Conn()->Prepare(DBConnection::LoadEncodedSampleBlock,
+                            "SELECT sampleformat, summin, summax, sumrms,"
+                            "       length(samples), codec"
+                            "  FROM sampleblocks WHERE blockid = ?1;")
+          : Conn()->Prepare(DBConnection::LoadSampleBlock,
+                            "SELECT sampleformat, summin, summax, sumrms,"
+                            "       length(samples)"
+                            "  FROM sampleblocks WHERE blockid = ?1;");
 
     // Bind statement parameters
     // Might return SQLITE_MISUSE which means it's our mistake that we violated
@@ -732,12 +1172,32 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
     mSumMax = sqlite3_column_double(stmt, 2);
     mSumRms = sqlite3_column_double(stmt, 3);
     mSampleBytes = sqlite3_column_int(stmt, 4);
-    mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+    // Null, or no such column, also means raw
+    mCodec = sqlite3_column_count(stmt) > 5
+             && sqlite3_column_int(stmt, 5) == SampleBlockCodec::Lossless
+             ? SampleBlockCodec::Lossless : SampleBlockCodec::Raw;
 
     // Clear statement bindings and rewind statement
     sqlite3_clear_bindings(stmt);
     sqlite3_reset(stmt);
 
+    if (mCodec == SampleBlockCodec::Lossless) {
+        // The size of the decompressed samples is in the header
+        char header[SampleBlockCodec::HeaderBytes];
+        const auto copied = Conn()->ReadBlob(
+            "sampleblocks", "samples", sbid, header, 0, sizeof(header));
+        mSampleBytes = copied
+                       ? SampleBlockCodec::DecodedBytes(header, *copied) : 0;
+        if (mSampleBytes == 0) {
+            ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Load::header");
+
+            wxLogDebug(wxT("SqliteSampleBlock::Load - corrupt compressed samples"));
+
+            Conn()->ThrowException(false);
+        }
+    }
+    mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+
     mValid = true;
 }
 
@@ -749,11 +1209,25 @@ void SqliteSampleBlock::Commit(Sizes sizes)
     auto db = DB();
     int rc;
 
+    std::vector<char> encoded;
+    if (mCompress) {
+        encoded = SampleBlockCodec::Encode(mSamples.get(), mSampleCount, mSampleFormat);
+    }
+    mCodec = encoded.empty() ? SampleBlockCodec::Raw : SampleBlockCodec::Lossless;
+
     // Prepare and cache statement...automatically finalized at DB close
-    sqlite3_stmt* stmt = Conn()->Prepare(DBConnection::InsertSampleBlock,
-                                         "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
-                                         "                          summary256, summary64k, samples)"
-                                         "                         VALUES(?1,?2,?3,?4,?5,?6,?7);");
+    // The codec column is named only when needed, because projects of older
+    // versions may lack it
+    sqlite3_stmt* stmt
+        =encoded.empty()
+          ? Conn()->Prepare(DBConnection::InsertSampleBlock,
+                            "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
+                            "                          summary256, summary64k, samples)"
+                            "                         VALUES(?1,?2,?3,?4,?5,?6,?7);")
+          : Conn()->Prepare(DBConnection::InsertEncodedSampleBlock,
+                            "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
+                            "                          summary256, summary64k, samples, codec)"
+                            "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8);");
 
     // Bind statement parameters
     // Might return SQLITE_MISUSE which means it's our mistake that we violated
@@ -764,7 +1238,10 @@ void SqliteSampleBlock::Commit(Sizes sizes)
         || sqlite3_bind_double(stmt, 4, mSumRms)
         || sqlite3_bind_blob(stmt, 5, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC)
         || sqlite3_bind_blob(stmt, 6, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC)
-        || sqlite3_bind_blob(stmt, 7, mSamples.get(), mSampleBytes, SQLITE_STATIC)) {
+        || (encoded.empty()
+            ? sqlite3_bind_blob(stmt, 7, mSamples.get(), mSampleBytes, SQLITE_STATIC)
+            : sqlite3_bind_blob(stmt, 7, encoded.data(), encoded.size(), SQLITE_STATIC))
+        || (!encoded.empty() && sqlite3_bind_int(stmt, 8, mCodec))) {
         ADD_EXCEPTION_CONTEXT(
             "sqlite3.rc", std::to_string(sqlite3_errcode(Conn()->DB())));
         ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::bind");
@@ -772,9 +1249,12 @@ void SqliteSampleBlock::Commit(Sizes sizes)
         wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
     }
 
-    // Execute the statement
+    // Execute the statement.  The last inserted row id belongs to the
+    // connection, so insertions from other threads must not intervene.
+    auto lock = Conn()->LockInsertions();
     rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
+        lock.unlock();
         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
         ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::step");
 
@@ -791,20 +1271,75 @@ void SqliteSampleBlock::Commit(Sizes sizes)
 
     // Retrieve returned data
     mBlockID = sqlite3_last_insert_rowid(db);
+    lock.unlock();
+    // The id of a deleted row may be reused; be sure nothing stale remains
+    mpFactory->mpCache->Invalidate(mBlockID);
+
+    // Clear statement bindings and rewind statement
+    sqlite3_clear_bindings(stmt);
+    sqlite3_reset(stmt);
+
+    InsertPyramid();
 
     // Reset local arrays
     mSamples.reset();
     mSummary256.reset();
     mSummary64k.reset();
+    mPyramid = {};
     {
         std::lock_guard<std::mutex> lock(mCacheMutex);
         mCache.reset();
     }
 
-    // Clear statement bindings and rewind statement
-    sqlite3_clear_bindings(stmt);
-    sqlite3_reset(stmt);
+    mValid = true;
+}
 
+void SqliteSampleBlock::CommitAsync(
+    SampleBlockWriter& writer, Sizes sizes, bool deferSummary, bool durable)
+{
+    // Hand the contents over to the background thread, which inserts the
+    // row later; reads are served from memory until then
+    auto pRow = std::make_shared<SampleBlockWriter::Row>();
+    pRow->id = writer.NewBlockID();
+    if (pRow->id <= 0) {
+        Conn()->ThrowException(true);
+    }
+    pRow->format = mSampleFormat;
+    pRow->totals = std::make_shared<SampleBlockWriter::Totals>();
+    if (deferSummary) {
+        pRow->calcSummary = &SqliteSampleBlock::CalcSummary;
+    } else {
+        pRow->totals->min = mSumMin;
+        pRow->totals->max = mSumMax;
+        pRow->totals->rms = mSumRms;
+        pRow->totals->ready = true;
+    }
+    pRow->samples = std::move(mSamples);
+    pRow->sampleBytes = mSampleBytes;
+    pRow->summary256 = std::move(mSummary256);
+    pRow->summary256Bytes = sizes.first;
+    pRow->summary64k = std::move(mSummary64k);
+    pRow->summary64kBytes = sizes.second;
+    pRow->pyramid = std::move(mPyramid);
+    pRow->quantizePyramid = mQuantizePyramid;
+    if (mCompress) {
+        pRow->codec = std::make_shared<std::atomic<int> >(SampleBlockCodec::Raw);
+        mpDeferredCodec = pRow->codec;
+    }
+    const auto id = pRow->id;
+    mPending = pRow;
+    if (deferSummary) {
+        mpDeferredTotals = pRow->totals;
+    }
+    if (!(durable ? writer.EnqueueDurable(std::move(pRow)) : writer.Enqueue(std::move(pRow)))) {
+        // An earlier insertion failed, or this one
+        Conn()->ThrowException(true);
+    }
+    mBlockID = id;
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        mCache.reset();
+    }
     mValid = true;
 }
 
@@ -815,6 +1350,14 @@ void SqliteSampleBlock::Delete()
 
     wxASSERT(!IsSilent());
 
+    // A row not yet inserted need never be
+    if (!mPending.expired()) {
+        if (const auto pWriter = Conn()->GetBlockWriter();
+            pWriter && pWriter->Cancel(mBlockID)) {
+            return;
+        }
+    }
+
     // Prepare and cache statement...automatically finalized at DB close
     sqlite3_stmt* stmt = Conn()->Prepare(DBConnection::DeleteSampleBlock,
                                          "DELETE FROM sampleblocks WHERE blockid = ?1;");
@@ -850,6 +1393,19 @@ void SqliteSampleBlock::Delete()
     // Clear statement bindings and rewind statement
     sqlite3_clear_bindings(stmt);
     sqlite3_reset(stmt);
+
+    // Failure only wastes some space
+    if (Conn()->HasSummaryPyramids()) {
+        stmt = Conn()->Prepare(DBConnection::DeleteSummaryPyramid,
+                               "DELETE FROM summarypyramids WHERE blockid = ?1;");
+        if (sqlite3_bind_int64(stmt, 1, mBlockID) == SQLITE_OK) {
+            sqlite3_step(stmt);
+        }
+        sqlite3_clear_bindings(stmt);
+        sqlite3_reset(stmt);
+    }
+
+    mpFactory->mpCache->Invalidate(mBlockID);
 }
 
 void SqliteSampleBlock::SaveXML(XMLWriter& xmlFile)
@@ -864,7 +1420,12 @@ auto SqliteSampleBlock::SetSizes(
     mSampleCount = numsamples;
     mSampleBytes = mSampleCount * SAMPLE_SIZE(mSampleFormat);
 
-    int frames64k = (mSampleCount + 65535) / 65536;
+    return GetSizes(mSampleCount);
+}
+
+auto SqliteSampleBlock::GetSizes(size_t numsamples) -> Sizes
+{
+    int frames64k = (numsamples + 65535) / 65536;
     int frames256 = frames64k * 256;
     return { frames256* bytesPerFrame, frames64k* bytesPerFrame };
 }
@@ -894,119 +1455,43 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
     mSummary256.reinit(mSummary256Bytes);
     mSummary64k.reinit(mSummary64kBytes);
 
-    float* summary256 = (float*)mSummary256.get();
-    float* summary64k = (float*)mSummary64k.get();
-
-    float min;
-    float max;
-    float sumsq;
-    double totalSquares = 0.0;
-    double fraction = 0.0;
-
-    // Recalc 256 summaries
-    int sumLen = (mSampleCount + 255) / 256;
-    int summaries = 256;
-
-    for (int i = 0; i < sumLen; ++i) {
-        min = samples[i * 256];
-        max = samples[i * 256];
-        sumsq = min * min;
-
-        int jcount = 256;
-        if (jcount > mSampleCount - i * 256) {
-            jcount = mSampleCount - i * 256;
-            fraction = 1.0 - (jcount / 256.0);
-        }
-
-        for (int j = 1; j < jcount; ++j) {
-            float f1 = samples[i * 256 + j];
-            sumsq += f1 * f1;
+    const auto totals = SampleBlockSummary::Calculate(samples, mSampleCount,
+                                                      (float*)mSummary256.get(), mSummary256Bytes / bytesPerFrame,
+                                                      (float*)mSummary64k.get(), mSummary64kBytes / bytesPerFrame);
+    mSumMin = totals.min;
+    mSumMax = totals.max;
+    mSumRms = totals.rms;
 
-            if (f1 < min) {
-                min = f1;
-            } else if (f1 > max) {
-                max = f1;
-            }
-        }
-
-        totalSquares += sumsq;
-
-        summary256[i * fields] = min;
-        summary256[i * fields + 1] = max;
-        // The rms is correct, but this may be for less than 256 samples in last loop.
-        summary256[i * fields + 2] = (float)sqrt(sumsq / jcount);
-    }
-
-    for (int i = sumLen, frames256 = mSummary256Bytes / bytesPerFrame;
-         i < frames256; ++i) {
-        // filling in the remaining bits with non-harming/contributing values
-        // rms values are not "non-harming", so keep count of them:
-        summaries--;
-        summary256[i * fields] = FLT_MAX;      // min
-        summary256[i * fields + 1] = -FLT_MAX; // max
-        summary256[i * fields + 2] = 0.0f;     // rms
-    }
-
-    // Calculate now while we can do it accurately
-    mSumRms = sqrt(totalSquares / mSampleCount);
-
-    // Recalc 64K summaries
-    sumLen = (mSampleCount + 65535) / 65536;
-
-    for (int i = 0; i < sumLen; ++i) {
-        min = summary256[3 * i * 256];
-        max = summary256[3 * i * 256 + 1];
-        sumsq = summary256[3 * i * 256 + 2];
-        sumsq *= sumsq;
-
-        for (int j = 1; j < 256; ++j) {
-            // we can overflow the useful summary256 values here, but have put
-            // non-harmful values in them
-            if (summary256[3 * (i * 256 + j)] < min) {
-                min = summary256[3 * (i * 256 + j)];
-            }
-
-            if (summary256[3 * (i * 256 + j) + 1] > max) {
-                max = summary256[3 * (i * 256 + j) + 1];
-            }
-
-            float r1 = summary256[3 * (i * 256 + j) + 2];
-            sumsq += r1 * r1;
-        }
-
-        double denom = (i < sumLen - 1) ? 256.0 : summaries - fraction;
-        float rms = (float)sqrt(sumsq / denom);
-
-        summary64k[i * fields] = min;
-        summary64k[i * fields + 1] = max;
-        summary64k[i * fields + 2] = rms;
-    }
-
-    for (int i = sumLen, frames64k = mSummary64kBytes / bytesPerFrame;
-         i < frames64k; ++i) {
-        wxASSERT_MSG(false, wxT("Out of data for mSummaryInfo")); // Do we ever get here?
-
-        summary64k[i * fields] = 0.0f;   // probably should be FLT_MAX, need a test case
-        summary64k[i * fields + 1] = 0.0f; // probably should be -FLT_MAX, need a test case
-        summary64k[i * fields + 2] = 0.0f; // just padding
-    }
+    mPyramid = SampleBlockSummary::CalculatePyramid(samples, mSampleCount,
+                                                    (const float*)mSummary256.get(), mQuantizePyramid);
+}
 
-    // Recalc block-level summary (mRMS already calculated)
-    min = summary64k[0];
-    max = summary64k[1];
+void SqliteSampleBlock::CalcSummary(SampleBlockWriter::Row& row)
+{
+    const auto count = row.sampleBytes / SAMPLE_SIZE(row.format);
 
-    for (int i = 1; i < sumLen; ++i) {
-        if (summary64k[i * fields] < min) {
-            min = summary64k[i * fields];
-        }
+    Floats samplebuffer;
+    const float* samples;
 
-        if (summary64k[i * fields + 1] > max) {
-            max = summary64k[i * fields + 1];
-        }
+    if (row.format == floatSample) {
+        samples = (const float*)row.samples.get();
+    } else {
+        samplebuffer.reinit(count);
+        SamplesToFloats(row.samples.get(), row.format, samplebuffer.get(), count);
+        samples = samplebuffer.get();
     }
 
-    mSumMin = min;
-    mSumMax = max;
+    row.summary256.reinit(row.summary256Bytes);
+    row.summary64k.reinit(row.summary64kBytes);
+
+    auto& totals = *row.totals;
+    static_cast<SampleBlockSummary::Totals&>(totals)
+        =SampleBlockSummary::Calculate(samples, count,
+                                       (float*)row.summary256.get(), row.summary256Bytes / bytesPerFrame,
+                                       (float*)row.summary64k.get(), row.summary64kBytes / bytesPerFrame);
+    row.pyramid = SampleBlockSummary::CalculatePyramid(samples, count,
+                                                       (const float*)row.summary256.get(), row.quantizePyramid);
+    totals.ready.store(true, std::memory_order_release);
 }
 
 //! Just to find a denominator for a progress indicator.
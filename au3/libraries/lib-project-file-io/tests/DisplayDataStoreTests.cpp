@@ -0,0 +1,130 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  DisplayDataStoreTests.cpp
+
+**********************************************************************/
+#include "DisplayDataStore.h"
+
+#include <catch2/catch.hpp>
+#include <sqlite3.h>
+
+#include <string>
+
+namespace {
+// Same as the schema that ProjectFileIO installs
+constexpr auto Schema
+    ="CREATE TABLE IF NOT EXISTS displaycache"
+     "("
+     "  key                  INTEGER PRIMARY KEY,"
+     "  used                 INTEGER,"
+     "  data                 BLOB"
+     ");";
+
+struct TestDatabase {
+    TestDatabase()
+    {
+        REQUIRE(sqlite3_open(":memory:", &db) == SQLITE_OK);
+    }
+
+    ~TestDatabase()
+    {
+        sqlite3_close(db);
+    }
+
+    void Install()
+    {
+        REQUIRE(sqlite3_exec(db, Schema, nullptr, nullptr, nullptr) == SQLITE_OK);
+    }
+
+    long long Count()
+    {
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_prepare_v2(db, "SELECT count(*) FROM displaycache;", -1, &stmt, nullptr);
+        sqlite3_step(stmt);
+        const auto result = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+        return result;
+    }
+
+    sqlite3* db{};
+};
+
+void Store(DisplayDataStore& store, uint64_t key, size_t bytes)
+{
+    const std::string data(bytes, static_cast<char>(key));
+    store.Store(key, data.data(), data.size());
+}
+} // namespace
+
+TEST_CASE("DisplayDataStore")
+{
+    TestDatabase database;
+
+    SECTION("does nothing without its table")
+    {
+        DisplayDataStore store{ database.db, 1000 };
+        REQUIRE(!store.IsValid());
+        Store(store, 1, 10);
+        std::vector<char> data;
+        REQUIRE(!store.Load(1, data));
+    }
+
+    SECTION("finds what was stored, by key")
+    {
+        database.Install();
+        DisplayDataStore store{ database.db, 1000 };
+        REQUIRE(store.IsValid());
+        Store(store, 1, 10);
+        // Keys are 64 bit hashes
+        Store(store, 0xfedcba9876543210ull, 20);
+        std::vector<char> data;
+        REQUIRE(store.Load(1, data));
+        REQUIRE(data == std::vector<char>(10, 1));
+        REQUIRE(store.Load(0xfedcba9876543210ull, data));
+        REQUIRE(data.size() == 20);
+        REQUIRE(!store.Load(2, data));
+    }
+
+    SECTION("keeps its contents across connections")
+    {
+        database.Install();
+        {
+            DisplayDataStore store{ database.db, 1000 };
+            Store(store, 1, 100);
+        }
+        DisplayDataStore store{ database.db, 1000 };
+        REQUIRE(store.GetTotalBytes() == 100);
+        std::vector<char> data;
+        REQUIRE(store.Load(1, data));
+    }
+
+    SECTION("evicts the least recently used rows to stay within budget")
+    {
+        database.Install();
+        DisplayDataStore store{ database.db, 1000 };
+        for (uint64_t key = 1; key <= 9; ++key) {
+            Store(store, key, 100);
+        }
+        REQUIRE(database.Count() == 9);
+        std::vector<char> data;
+        // Now the first is the most recently used
+        REQUIRE(store.Load(1, data));
+        Store(store, 10, 100);
+        Store(store, 11, 100);
+        REQUIRE(store.GetTotalBytes() <= 1000);
+        REQUIRE(store.Load(1, data));
+        REQUIRE(!store.Load(2, data));
+        REQUIRE(store.Load(11, data));
+    }
+
+    SECTION("does not store what exceeds the budget by itself")
+    {
+        database.Install();
+        DisplayDataStore store{ database.db, 1000 };
+        Store(store, 1, 1001);
+        REQUIRE(database.Count() == 0);
+    }
+}
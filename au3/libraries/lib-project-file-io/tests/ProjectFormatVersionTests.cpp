@@ -0,0 +1,45 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  ProjectFormatVersionTests.cpp
+
+**********************************************************************/
+#include "ProjectFormatVersion.h"
+
+#include <catch2/catch.hpp>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <string>
+
+namespace {
+// As ProjectFileIO stamps and reads the version
+ProjectFormatVersion Stamp(ProjectFormatVersion version)
+{
+    sqlite3* db = nullptr;
+    REQUIRE(sqlite3_open(":memory:", &db) == SQLITE_OK);
+    const auto sql = "PRAGMA user_version = " + std::to_string(version.GetPacked());
+    REQUIRE(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_stmt* stmt = nullptr;
+    REQUIRE(sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK);
+    REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+    const auto packed = static_cast<uint32_t>(sqlite3_column_int64(stmt, 0));
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return ProjectFormatVersion::FromPacked(packed);
+}
+}
+
+TEST_CASE("Projects with compressed blocks need a newer version")
+{
+    const auto version = Stamp(std::max(BaseProjectFormatVersion, BlockCodecsProjectFormatVersion));
+    REQUIRE(version.IsValid());
+    // Versions before compression refuse to open the project
+    REQUIRE(BaseProjectFormatVersion < version);
+    // This version opens it
+    REQUIRE(!(SupportedProjectFormatVersion < version));
+
+    REQUIRE(Stamp(BaseProjectFormatVersion) == BaseProjectFormatVersion);
+}
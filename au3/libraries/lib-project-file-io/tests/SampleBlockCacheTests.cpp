@@ -0,0 +1,164 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleBlockCacheTests.cpp
+
+**********************************************************************/
+#include "SampleBlockCache.h"
+#include "SampleFormat.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+using Kind = SampleBlockCache::Kind;
+
+SampleBlockCache::Data MakeData(size_t size, float value = 0.0f)
+{
+    return std::make_shared<std::vector<float> >(size, value);
+}
+} // namespace
+
+TEST_CASE("SampleBlockCache")
+{
+    // Room for four blocks of 1000 samples
+    SampleBlockCache cache{ 4000 * sizeof(float) };
+
+    SECTION("finds what was inserted, by id and kind")
+    {
+        const auto samples = MakeData(1000, 1.0f);
+        const auto summary = MakeData(12, 2.0f);
+        cache.Insert(1, Kind::Samples, samples);
+        cache.Insert(1, Kind::Summary256, summary);
+        REQUIRE(cache.Find(1, Kind::Samples) == samples);
+        REQUIRE(cache.Find(1, Kind::Summary256) == summary);
+        REQUIRE(cache.Find(1, Kind::Summary64k) == nullptr);
+        REQUIRE(cache.Find(2, Kind::Samples) == nullptr);
+
+        const auto statistics = cache.GetStatistics();
+        REQUIRE(statistics.hits == 2);
+        REQUIRE(statistics.misses == 2);
+        REQUIRE(statistics.entries == 2);
+        REQUIRE(statistics.bytes == 1012 * sizeof(float));
+    }
+
+    SECTION("evicts the least recently used first")
+    {
+        for (SampleBlockID id = 1; id <= 4; ++id) {
+            cache.Insert(id, Kind::Samples, MakeData(1000));
+        }
+        // Use block 1 again, so that 2 is now the oldest
+        REQUIRE(cache.Find(1, Kind::Samples));
+        cache.Insert(5, Kind::Samples, MakeData(1000));
+        REQUIRE(cache.Find(1, Kind::Samples));
+        REQUIRE(!cache.Find(2, Kind::Samples));
+        REQUIRE(cache.Find(3, Kind::Samples));
+        REQUIRE(cache.Find(5, Kind::Samples));
+        REQUIRE(cache.GetStatistics().evictions == 1);
+        REQUIRE(cache.GetStatistics().bytes <= cache.GetStatistics().budget);
+    }
+
+    SECTION("evicted data remains valid for its users")
+    {
+        cache.Insert(1, Kind::Samples, MakeData(1000, 3.0f));
+        const auto data = cache.Find(1, Kind::Samples);
+        cache.SetBudget(0);
+        REQUIRE(!cache.Find(1, Kind::Samples));
+        REQUIRE((*data)[999] == 3.0f);
+        REQUIRE(!cache.IsEnabled());
+    }
+
+    SECTION("ignores data larger than the budget")
+    {
+        cache.Insert(1, Kind::Samples, MakeData(4001));
+        REQUIRE(!cache.Find(1, Kind::Samples));
+        REQUIRE(cache.GetStatistics().bytes == 0);
+    }
+
+    SECTION("replaces an entry with the same key")
+    {
+        cache.Insert(1, Kind::Samples, MakeData(1000, 1.0f));
+        cache.Insert(1, Kind::Samples, MakeData(500, 2.0f));
+        REQUIRE(cache.Find(1, Kind::Samples)->size() == 500);
+        REQUIRE(cache.GetStatistics().bytes == 500 * sizeof(float));
+    }
+
+    SECTION("invalidation removes all kinds for the block")
+    {
+        for (auto kind : { Kind::Samples, Kind::Summary256, Kind::Summary64k }) {
+            cache.Insert(1, kind, MakeData(10));
+            cache.Insert(2, kind, MakeData(10));
+        }
+        cache.Invalidate(1);
+        REQUIRE(!cache.Find(1, Kind::Samples));
+        REQUIRE(!cache.Find(1, Kind::Summary256));
+        REQUIRE(!cache.Find(1, Kind::Summary64k));
+        REQUIRE(cache.Find(2, Kind::Summary64k));
+        REQUIRE(cache.GetStatistics().entries == 3);
+    }
+}
+
+TEST_CASE("SampleBlockCache looped playback benchmark", "[benchmark][.]")
+{
+    // A two hour mono project at 44.1 kHz, in blocks of the default
+    // maximum size, stored as 16 bit samples
+    constexpr size_t rate = 44100;
+    constexpr size_t blockSize = 1 << 18;
+    constexpr size_t projectSamples = 2 * 3600 * rate;
+    constexpr size_t numBlocks = (projectSamples + blockSize - 1) / blockSize;
+    std::vector<short> stored(blockSize);
+    std::iota(stored.begin(), stored.end(), short{});
+
+    // Loop over 30 seconds in the middle of it, reading as playback does
+    constexpr size_t loopStart = projectSamples / 2;
+    constexpr size_t loopLength = 30 * rate;
+    constexpr size_t chunk = 4096;
+    constexpr auto loops = 4;
+    static_assert(loopStart + loopLength <= numBlocks * blockSize);
+    std::vector<float> buffer(chunk);
+
+    // Without a cache, each read fetches and decodes the whole blob, as
+    // sqlite returns it; a lower bound of the cost of the database
+    const auto decodeBlock = [&](SampleBlockID) {
+        auto result = std::make_shared<std::vector<float> >(blockSize);
+        SamplesToFloats(reinterpret_cast<constSamplePtr>(stored.data()),
+                        int16Sample, result->data(), blockSize);
+        return result;
+    };
+    const auto play = [&](auto&& read) {
+        for (auto loop = 0; loop < loops; ++loop) {
+            for (auto pos = loopStart; pos < loopStart + loopLength; pos += chunk) {
+                const auto id = static_cast<SampleBlockID>(pos / blockSize) + 1;
+                const auto block = read(id);
+                const auto offset = pos % blockSize;
+                const auto count = std::min(chunk, blockSize - offset);
+                std::copy_n(block->data() + offset, count, buffer.data());
+            }
+        }
+        return buffer[0];
+    };
+
+    BENCHMARK("uncached")
+    {
+        return play(decodeBlock);
+    };
+
+    SampleBlockCache cache{ size_t { 256 } << 20 };
+    BENCHMARK("cached")
+    {
+        return play([&](SampleBlockID id) {
+            auto data = cache.Find(id, Kind::Samples);
+            if (!data) {
+                data = decodeBlock(id);
+                cache.Insert(id, Kind::Samples, data);
+            }
+            return data;
+        });
+    };
+    const auto statistics = cache.GetStatistics();
+    WARN("hits " << statistics.hits << ", misses " << statistics.misses);
+}
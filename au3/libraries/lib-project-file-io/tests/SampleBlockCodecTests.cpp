@@ -0,0 +1,154 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleBlockCodecTests.cpp
+
+**********************************************************************/
+#include "SampleBlockCodec.h"
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr size_t Count = 262144;
+constexpr double Rate = 44100;
+constexpr double Pi = 3.14159265358979323846;
+
+std::vector<float> Tones(size_t count)
+{
+    std::vector<float> result(count);
+    std::mt19937 engine{ 1 };
+    std::normal_distribution<float> noise{ 0.0f, 1e-3f };
+    for (size_t ii = 0; ii < count; ++ii) {
+        result[ii] = 0.5f * std::sin(2 * Pi * 440 * ii / Rate)
+                     + 0.25f * std::sin(2 * Pi * 1234.5 * ii / Rate)
+                     + noise(engine);
+    }
+    return result;
+}
+
+template<typename Sample>
+std::vector<Sample> Quantize(const std::vector<float>& samples, float scale)
+{
+    std::vector<Sample> result(samples.size());
+    for (size_t ii = 0; ii < samples.size(); ++ii) {
+        result[ii] = static_cast<Sample>(std::lround(samples[ii] * scale));
+    }
+    return result;
+}
+
+template<typename Sample>
+void RequireRoundTrip(const std::vector<Sample>& samples, sampleFormat format, bool compressible = true)
+{
+    const auto bytes = samples.size() * sizeof(Sample);
+    const auto blob = SampleBlockCodec::Encode(samples.data(), samples.size(), format);
+    if (!compressible) {
+        REQUIRE(blob.empty());
+        return;
+    }
+    REQUIRE(!blob.empty());
+    REQUIRE(blob.size() < bytes);
+    REQUIRE(SampleBlockCodec::DecodedBytes(blob.data(), SampleBlockCodec::HeaderBytes) == bytes);
+    std::vector<Sample> decoded(samples.size());
+    REQUIRE(SampleBlockCodec::Decode(blob.data(), blob.size(), format, decoded.data(), bytes));
+    // Bit for bit, even NaN
+    REQUIRE(memcmp(decoded.data(), samples.data(), bytes) == 0);
+}
+}
+
+TEST_CASE("SampleBlockCodec")
+{
+    const auto tones = Tones(Count);
+
+    SECTION("restores 16 bit samples exactly")
+    {
+        RequireRoundTrip(Quantize<int16_t>(tones, 32767), int16Sample);
+    }
+
+    SECTION("restores 24 bit samples exactly")
+    {
+        RequireRoundTrip(Quantize<int32_t>(tones, 8388607), int24Sample);
+    }
+
+    SECTION("restores float samples exactly")
+    {
+        auto samples = tones;
+        // Extremes of every kind, too
+        samples[100] = std::numeric_limits<float>::quiet_NaN();
+        samples[200] = std::numeric_limits<float>::infinity();
+        samples[300] = -std::numeric_limits<float>::max();
+        samples[400] = -0.0f;
+        samples[500] = std::numeric_limits<float>::denorm_min();
+        RequireRoundTrip(samples, floatSample);
+    }
+
+    SECTION("restores partial partitions and extreme integers")
+    {
+        std::vector<int32_t> samples(SampleBlockCodec::PartitionSamples + 5, 0);
+        samples[1] = std::numeric_limits<int32_t>::max();
+        samples[2] = std::numeric_limits<int32_t>::min();
+        samples[3] = std::numeric_limits<int32_t>::max();
+        RequireRoundTrip(samples, int24Sample);
+    }
+
+    SECTION("declines what it cannot compress")
+    {
+        std::vector<uint32_t> samples(Count);
+        std::mt19937 engine{ 2 };
+        for (auto& sample : samples) {
+            sample = engine();
+        }
+        RequireRoundTrip(samples, floatSample, false);
+    }
+
+    SECTION("rejects corrupt or mismatched blobs")
+    {
+        const auto samples = Quantize<int16_t>(tones, 32767);
+        const auto bytes = samples.size() * sizeof(int16_t);
+        const auto blob = SampleBlockCodec::Encode(samples.data(), samples.size(), int16Sample);
+        std::vector<int16_t> decoded(samples.size());
+        REQUIRE(!SampleBlockCodec::Decode(blob.data(), blob.size() / 2, int16Sample, decoded.data(), bytes));
+        REQUIRE(!SampleBlockCodec::Decode(blob.data(), blob.size(), int16Sample, decoded.data(), bytes - 2));
+        REQUIRE(!SampleBlockCodec::Decode(blob.data(), blob.size(), floatSample, decoded.data(), bytes));
+        REQUIRE(SampleBlockCodec::DecodedBytes(blob.data(), 4) == 0);
+    }
+}
+
+TEST_CASE("SampleBlockCodec benchmark", "[benchmark][.]")
+{
+    // Decoding must be many times faster than real time, to keep up with
+    // playback of many tracks
+    const auto samples = Tones(Count);
+    const auto bytes = samples.size() * sizeof(float);
+    const auto blob = SampleBlockCodec::Encode(samples.data(), samples.size(), floatSample);
+    REQUIRE(!blob.empty());
+    std::vector<float> decoded(samples.size());
+
+    BENCHMARK("Encode float")
+    {
+        return SampleBlockCodec::Encode(samples.data(), samples.size(), floatSample);
+    };
+
+    BENCHMARK("Decode float")
+    {
+        return SampleBlockCodec::Decode(blob.data(), blob.size(), floatSample, decoded.data(), bytes);
+    };
+
+    const auto samples16 = Quantize<int16_t>(samples, 32767);
+    const auto blob16 = SampleBlockCodec::Encode(samples16.data(), samples16.size(), int16Sample);
+    std::vector<int16_t> decoded16(samples16.size());
+
+    BENCHMARK("Decode 16 bit")
+    {
+        return SampleBlockCodec::Decode(blob16.data(), blob16.size(), int16Sample,
+                                        decoded16.data(), samples16.size() * sizeof(int16_t));
+    };
+}
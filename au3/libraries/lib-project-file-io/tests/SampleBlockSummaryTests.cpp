@@ -0,0 +1,393 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleBlockSummaryTests.cpp
+
+**********************************************************************/
+#include "SampleBlockSummary.h"
+#include "concurrency/ThreadPool.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+using namespace SampleBlockSummary;
+
+//! The sequential computation that SqliteSampleBlock::CalcSummary used to do
+Totals ReferenceCalculate(const float* samples, size_t count, float* summary256, size_t frames256, float* summary64k, size_t frames64k)
+{
+    float min, max, sumsq;
+    double totalSquares = 0.0;
+    double fraction = 0.0;
+    int sumLen = (count + 255) / 256;
+    int summaries = 256;
+    for (int i = 0; i < sumLen; ++i) {
+        min = samples[i * 256];
+        max = samples[i * 256];
+        sumsq = min * min;
+        int jcount = 256;
+        if (jcount > int(count) - i * 256) {
+            jcount = count - i * 256;
+            fraction = 1.0 - (jcount / 256.0);
+        }
+        for (int j = 1; j < jcount; ++j) {
+            float f1 = samples[i * 256 + j];
+            sumsq += f1 * f1;
+            if (f1 < min) {
+                min = f1;
+            } else if (f1 > max) {
+                max = f1;
+            }
+        }
+        totalSquares += sumsq;
+        summary256[i * 3] = min;
+        summary256[i * 3 + 1] = max;
+        summary256[i * 3 + 2] = (float)sqrt(sumsq / jcount);
+    }
+    for (int i = sumLen; i < int(frames256); ++i) {
+        summaries--;
+        summary256[i * 3] = FLT_MAX;
+        summary256[i * 3 + 1] = -FLT_MAX;
+        summary256[i * 3 + 2] = 0.0f;
+    }
+    Totals totals;
+    totals.rms = sqrt(totalSquares / count);
+    sumLen = (count + 65535) / 65536;
+    for (int i = 0; i < sumLen; ++i) {
+        min = summary256[3 * i * 256];
+        max = summary256[3 * i * 256 + 1];
+        sumsq = summary256[3 * i * 256 + 2];
+        sumsq *= sumsq;
+        for (int j = 1; j < 256; ++j) {
+            if (summary256[3 * (i * 256 + j)] < min) {
+                min = summary256[3 * (i * 256 + j)];
+            }
+            if (summary256[3 * (i * 256 + j) + 1] > max) {
+                max = summary256[3 * (i * 256 + j) + 1];
+            }
+            float r1 = summary256[3 * (i * 256 + j) + 2];
+            sumsq += r1 * r1;
+        }
+        double denom = (i < sumLen - 1) ? 256.0 : summaries - fraction;
+        summary64k[i * 3] = min;
+        summary64k[i * 3 + 1] = max;
+        summary64k[i * 3 + 2] = (float)sqrt(sumsq / denom);
+    }
+    for (int i = sumLen; i < int(frames64k); ++i) {
+        summary64k[i * 3] = summary64k[i * 3 + 1] = summary64k[i * 3 + 2] = 0.0f;
+    }
+    min = summary64k[0];
+    max = summary64k[1];
+    for (int i = 1; i < sumLen; ++i) {
+        min = std::min(min, summary64k[i * 3]);
+        max = std::max(max, summary64k[i * 3 + 1]);
+    }
+    totals.min = min;
+    totals.max = max;
+    return totals;
+}
+
+struct Summaries {
+    explicit Summaries(size_t count)
+        : frames64k{ (count + 65535) / 65536 }
+        , frames256{ frames64k * 256 }
+        , summary256(frames256 * fields)
+        , summary64k(frames64k * fields)
+    {}
+    size_t frames64k;
+    size_t frames256;
+    std::vector<float> summary256;
+    std::vector<float> summary64k;
+};
+
+std::vector<float> RandomSamples(size_t count, unsigned seed)
+{
+    std::mt19937 engine{ seed };
+    std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+    std::vector<float> result(count);
+    for (auto& sample : result) {
+        sample = distribution(engine);
+    }
+    return result;
+}
+
+void RequireSameSummaries(const std::vector<float>& actual, const std::vector<float>& expected)
+{
+    REQUIRE(actual.size() == expected.size());
+    for (size_t ii = 0; ii < actual.size(); ++ii) {
+        if (ii % fields == 2) {
+            // Sums of squares were added in another order
+            REQUIRE(actual[ii] == Approx(expected[ii]).epsilon(1e-5));
+        } else {
+            REQUIRE(actual[ii] == expected[ii]);
+        }
+    }
+}
+
+//! Decode all levels of the pyramid
+std::vector<std::vector<float> > DecodePyramid(const PyramidBlobs& blobs, size_t count)
+{
+    std::vector<std::vector<float> > result;
+    for (size_t level = 0; level < pyramidFactors.size(); ++level) {
+        const auto frames = PyramidFrames(count, pyramidFactors[level]);
+        auto& decoded = result.emplace_back(frames * fields);
+        REQUIRE(DecodeLevel(blobs[level].data(), blobs[level].size(), decoded.data(), frames));
+    }
+    return result;
+}
+} // namespace
+
+TEST_CASE("SampleBlockSummary::Calculate agrees with the sequential computation")
+{
+    // Whole and partial 256 and 64k frames, and fewer samples than lanes
+    const auto count = GENERATE(size_t{ 1 }, size_t{ 7 }, size_t{ 300 }, size_t{ 65536 }, size_t{ 3 * 65536 + 1000 },
+                                size_t{ 262144 });
+    const auto samples = RandomSamples(count, unsigned(count));
+
+    Summaries expected{ count };
+    const auto expectedTotals = ReferenceCalculate(samples.data(), count,
+                                                   expected.summary256.data(), expected.frames256,
+                                                   expected.summary64k.data(), expected.frames64k);
+
+    Summaries actual{ count };
+    const auto actualTotals = Calculate(samples.data(), count,
+                                        actual.summary256.data(), actual.frames256,
+                                        actual.summary64k.data(), actual.frames64k);
+
+    RequireSameSummaries(actual.summary256, expected.summary256);
+    RequireSameSummaries(actual.summary64k, expected.summary64k);
+    REQUIRE(actualTotals.min == expectedTotals.min);
+    REQUIRE(actualTotals.max == expectedTotals.max);
+    REQUIRE(actualTotals.rms == Approx(expectedTotals.rms).epsilon(1e-6));
+}
+
+TEST_CASE("SampleBlockSummary::MinMaxSumSquares ignores NaN unless first")
+{
+    const auto nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<float> samples(100, 0.5f);
+    samples[1] = nan;
+    samples[9] = -0.25f;
+    samples[50] = nan;
+    samples[99] = 0.75f;
+
+    float min, max, sumsq;
+    MinMaxSumSquares(samples.data(), samples.size(), min, max, sumsq);
+    REQUIRE(min == -0.25f);
+    REQUIRE(max == 0.75f);
+    REQUIRE(std::isnan(sumsq));
+
+    samples[0] = nan;
+    MinMaxSumSquares(samples.data(), samples.size(), min, max, sumsq);
+    REQUIRE(std::isnan(min));
+    REQUIRE(std::isnan(max));
+}
+
+TEST_CASE("SampleBlockSummary pyramid levels summarize the samples")
+{
+    const auto count = GENERATE(size_t{ 1 }, size_t{ 7 }, size_t{ 300 }, size_t{ 65536 + 5 }, size_t{ 262144 });
+    const auto samples = RandomSamples(count, unsigned(count));
+    Summaries summaries{ count };
+    Calculate(samples.data(), count,
+              summaries.summary256.data(), summaries.frames256,
+              summaries.summary64k.data(), summaries.frames64k);
+
+    const auto levels = DecodePyramid(
+        CalculatePyramid(samples.data(), count, summaries.summary256.data(), false), count);
+    for (size_t level = 0; level < pyramidFactors.size(); ++level) {
+        std::vector<float> expected(PyramidFrames(count, pyramidFactors[level]) * fields);
+        Summarize(samples.data(), count, pyramidFactors[level], expected.data());
+        RequireSameSummaries(levels[level], expected);
+    }
+}
+
+TEST_CASE("SampleBlockSummary quantized pyramid levels contain the samples")
+{
+    constexpr size_t count = 100000;
+    const auto samples = RandomSamples(count, 1);
+    Summaries summaries{ count };
+    Calculate(samples.data(), count,
+              summaries.summary256.data(), summaries.frames256,
+              summaries.summary64k.data(), summaries.frames64k);
+
+    const auto blobs = CalculatePyramid(samples.data(), count, summaries.summary256.data(), true);
+    const auto exact = DecodePyramid(
+        CalculatePyramid(samples.data(), count, summaries.summary256.data(), false), count);
+    const auto quantized = DecodePyramid(blobs, count);
+
+    const auto step = 1.0f / 32767;
+    for (size_t level = 0; level < pyramidFactors.size(); ++level) {
+        // Half the size of floats, but for the format
+        REQUIRE(blobs[level].size() - sizeof(uint32_t) == exact[level].size() * sizeof(int16_t));
+        for (size_t ii = 0; ii < exact[level].size(); ii += fields) {
+            // Min and max are rounded outward
+            REQUIRE(quantized[level][ii] <= exact[level][ii]);
+            REQUIRE(quantized[level][ii] >= exact[level][ii] - step);
+            REQUIRE(quantized[level][ii + 1] >= exact[level][ii + 1]);
+            REQUIRE(quantized[level][ii + 1] <= exact[level][ii + 1] + step);
+            REQUIRE(std::abs(quantized[level][ii + 2] - exact[level][ii + 2]) <= step);
+        }
+    }
+}
+
+TEST_CASE("SampleBlockSummary::EncodeLevel keeps floats out of the range of 16 bits")
+{
+    const std::vector<float> frames{ -0.5f, 0.5f, 0.25f, -1.0f, 1.5f, 1.0f };
+    const auto blob = EncodeLevel(frames.data(), 2, true);
+    REQUIRE(blob.size() == sizeof(uint32_t) + frames.size() * sizeof(float));
+
+    std::vector<float> decoded(frames.size());
+    REQUIRE(DecodeLevel(blob.data(), blob.size(), decoded.data(), 2));
+    REQUIRE(decoded == frames);
+
+    // Wrong sizes and formats are rejected
+    REQUIRE(!DecodeLevel(blob.data(), blob.size(), decoded.data(), 1));
+    REQUIRE(!DecodeLevel(blob.data(), 2, decoded.data(), 0));
+    auto corrupt = blob;
+    corrupt[0] = 99;
+    REQUIRE(!DecodeLevel(corrupt.data(), corrupt.size(), decoded.data(), 2));
+}
+
+TEST_CASE("SampleBlockSummary pyramid zoom benchmark", "[benchmark][.]")
+{
+    // Draw a 1920 pixel wide view of each track of a 3 hour, 8 track project
+    // at 44.1 kHz, at every zoom level from one sample per pixel to the whole
+    // project, from the summaries that WaveDataCache would choose.
+    constexpr size_t BlockSamples = 262144;
+    constexpr size_t TrackSamples = size_t{ 3 * 3600 } * 44100;
+    constexpr size_t Tracks = 8;
+    constexpr size_t Columns = 1920;
+
+    // Every block of a track has the same contents, so that the summaries of
+    // all the blocks need not fit in memory
+    const std::vector<size_t> allFactors{ 16, 64, 256, 1024, 4096, 16384, 65536 };
+    std::vector<std::vector<float> > samples;
+    std::vector<std::vector<std::vector<float> > > levels(Tracks);
+    for (size_t track = 0; track < Tracks; ++track) {
+        samples.push_back(RandomSamples(BlockSamples, unsigned(track)));
+        Summaries summaries{ BlockSamples };
+        Calculate(samples[track].data(), BlockSamples,
+                  summaries.summary256.data(), summaries.frames256,
+                  summaries.summary64k.data(), summaries.frames64k);
+        auto& trackLevels = levels[track];
+        for (const auto factor : allFactors) {
+            auto& level = trackLevels.emplace_back(PyramidFrames(BlockSamples, factor) * fields);
+            Summarize(samples[track].data(), BlockSamples, factor, level.data());
+        }
+    }
+
+    // Returns the number of frames (or samples) read
+    const auto draw = [&](const std::vector<size_t>& factors, double& checksum) {
+        size_t read = 0;
+        for (double spp = 1; spp * Columns / 2 <= TrackSamples; spp *= 2) {
+            // Coarsest with at least one frame per column
+            size_t index = 0;
+            while (index + 1 < factors.size() && factors[index + 1] <= spp) {
+                ++index;
+            }
+            const auto factor = factors[index];
+            const auto levelIndex
+                =std::find(allFactors.begin(), allFactors.end(), factor) - allFactors.begin();
+            const auto first = static_cast<size_t>(std::max(0.0, TrackSamples / 2 - spp * Columns / 2));
+            for (size_t track = 0; track < Tracks; ++track) {
+                for (size_t column = 0; column < Columns; ++column) {
+                    const auto from = first + static_cast<size_t>(spp * column);
+                    const auto to = std::min(TrackSamples, first + static_cast<size_t>(spp * (column + 1)));
+                    float min = FLT_MAX, max = -FLT_MAX;
+                    for (auto sample = from; sample < to; sample += factor, ++read) {
+                        const auto offset = sample % BlockSamples;
+                        if (factor == 1) {
+                            min = std::min(min, samples[track][offset]);
+                            max = std::max(max, samples[track][offset]);
+                        } else {
+                            const auto& level = levels[track][levelIndex];
+                            const auto frame = offset / factor;
+                            min = std::min(min, level[frame * fields]);
+                            max = std::max(max, level[frame * fields + 1]);
+                        }
+                    }
+                    checksum += max - min;
+                }
+            }
+        }
+        return read;
+    };
+
+    using Clock = std::chrono::steady_clock;
+    const auto run = [&](const char* what, const std::vector<size_t>& factors) {
+        double checksum = 0;
+        const auto start = Clock::now();
+        const auto read = draw(factors, checksum);
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        WARN(what << ": " << elapsed.count() << " s, "
+                  << double(read) / Tracks / Columns << " frames per column over all zoom levels");
+        return read;
+    };
+
+    const auto before = run("256 and 64k summaries", { 1, 256, 65536 });
+    const auto after = run("summary pyramid", { 1, 16, 64, 256, 1024, 4096, 16384, 65536 });
+    REQUIRE(after < before);
+}
+
+TEST_CASE("SampleBlockSummary import benchmark", "[benchmark][.]")
+{
+    // A 4 GB WAV file of 16 bit samples, imported into blocks of the largest
+    // size, 2^18 float samples
+    constexpr size_t BlockSamples = 262144;
+    constexpr size_t TotalSamples = (size_t{ 4 } << 30) / sizeof(short);
+    constexpr size_t Blocks = TotalSamples / BlockSamples;
+    // More distinct blocks than fit in the cache, as the import streams
+    constexpr size_t Distinct = 64;
+
+    std::vector<std::vector<float> > blocks;
+    for (size_t ii = 0; ii < Distinct; ++ii) {
+        blocks.push_back(RandomSamples(BlockSamples, unsigned(ii)));
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto report = [](const char* what, std::chrono::duration<double> elapsed) {
+        WARN(what << ": " << elapsed.count() << " s for 4 GB, "
+                  << elapsed.count() * 1e9 / TotalSamples << " ns/sample");
+    };
+
+    using Function = Totals (*)(const float*, size_t, float*, size_t, float*, size_t);
+    const auto serial = [&](Function function) {
+        Summaries summaries{ BlockSamples };
+        double checksum = 0;
+        for (size_t ii = 0; ii < Blocks; ++ii) {
+            checksum += function(blocks[ii % Distinct].data(), BlockSamples,
+                                 summaries.summary256.data(), summaries.frames256,
+                                 summaries.summary64k.data(), summaries.frames64k).rms;
+        }
+        return checksum;
+    };
+
+    auto start = Clock::now();
+    const auto expected = serial(ReferenceCalculate);
+    report("sequential, on the importing thread", Clock::now() - start);
+
+    start = Clock::now();
+    const auto actual = serial(Calculate);
+    report("vectorized, on the importing thread", Clock::now() - start);
+    REQUIRE(actual == Approx(expected));
+
+    // As SampleBlockWriter does for the deferred summaries of each batch
+    audacity::concurrency::ThreadPool pool{ audacity::concurrency::ThreadPool::DefaultNumWorkers() };
+    std::vector<Summaries> scratch(pool.GetConcurrency(), Summaries{ BlockSamples });
+    start = Clock::now();
+    pool.ParallelFor(Blocks, [&](size_t ii, size_t participant) {
+        auto& summaries = scratch[participant];
+        Calculate(blocks[ii % Distinct].data(), BlockSamples,
+                  summaries.summary256.data(), summaries.frames256,
+                  summaries.summary64k.data(), summaries.frames64k);
+    });
+    report("vectorized, deferred to the pool", Clock::now() - start);
+}
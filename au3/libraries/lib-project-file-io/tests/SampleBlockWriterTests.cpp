@@ -0,0 +1,433 @@
+/*  SPDX-License-Identifier: GPL-2.0-or-later */
+/*!********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  SampleBlockWriterTests.cpp
+
+**********************************************************************/
+#include "SampleBlockWriter.h"
+
+#include <catch2/catch.hpp>
+#include <sqlite3.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace {
+// Same as the schema that ProjectFileIO installs
+constexpr auto Schema
+    ="CREATE TABLE IF NOT EXISTS sampleblocks"
+     "("
+     "  blockid              INTEGER PRIMARY KEY AUTOINCREMENT,"
+     "  sampleformat         INTEGER,"
+     "  summin               REAL,"
+     "  summax               REAL,"
+     "  sumrms               REAL,"
+     "  summary256           BLOB,"
+     "  summary64k           BLOB,"
+     "  samples              BLOB"
+     ");";
+
+// Same as the optional table that ProjectFileIO installs
+constexpr auto PyramidSchema
+    ="CREATE TABLE IF NOT EXISTS summarypyramids"
+     "("
+     "  blockid              INTEGER PRIMARY KEY,"
+     "  summary16k           BLOB,"
+     "  summary4k            BLOB,"
+     "  summary1k            BLOB,"
+     "  summary64            BLOB,"
+     "  summary16            BLOB"
+     ");";
+
+// Same as the column that DBConnection adds when blocks are first compressed
+constexpr auto CodecColumn
+    ="ALTER TABLE sampleblocks ADD COLUMN codec INTEGER;";
+
+// Same as DBConnection's safe mode
+constexpr auto SafeConfig
+    ="PRAGMA busy_timeout = 5000;"
+     "PRAGMA locking_mode = SHARED;"
+     "PRAGMA synchronous = NORMAL;"
+     "PRAGMA journal_mode = WAL;";
+
+struct TestDatabase {
+    explicit TestDatabase(const char* name)
+        : path{ (std::filesystem::temp_directory_path() / name).string() }
+    {
+        Remove();
+        REQUIRE(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+        REQUIRE(sqlite3_exec(db, SafeConfig, nullptr, nullptr, nullptr) == SQLITE_OK);
+        REQUIRE(sqlite3_exec(db, Schema, nullptr, nullptr, nullptr) == SQLITE_OK);
+        // As DBConnection opens for the writer
+        REQUIRE(sqlite3_open(path.c_str(), &writerDb) == SQLITE_OK);
+        REQUIRE(sqlite3_exec(writerDb, SafeConfig, nullptr, nullptr, nullptr) == SQLITE_OK);
+    }
+
+    ~TestDatabase()
+    {
+        sqlite3_close(writerDb);
+        sqlite3_close(db);
+        Remove();
+    }
+
+    void Remove()
+    {
+        for (auto suffix : { "", "-wal", "-shm", "-journal" }) {
+            std::remove((path + suffix).c_str());
+        }
+    }
+
+    long long Count(const char* where = "1")
+    {
+        sqlite3_stmt* stmt = nullptr;
+        const auto sql = std::string{ "SELECT count(*) FROM sampleblocks WHERE " } + where + ";";
+        sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr);
+        sqlite3_step(stmt);
+        const auto result = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+        return result;
+    }
+
+    std::string path;
+    sqlite3* db{};
+    sqlite3* writerDb{};
+    std::recursive_mutex transactionMutex;
+};
+
+std::shared_ptr<SampleBlockWriter::Row> MakeRow(SampleBlockID id, size_t numsamples)
+{
+    auto pRow = std::make_shared<SampleBlockWriter::Row>();
+    pRow->id = id;
+    pRow->format = floatSample;
+    pRow->totals = std::make_shared<SampleBlockWriter::Totals>();
+    pRow->totals->ready = true;
+    pRow->sampleBytes = numsamples * sizeof(float);
+    pRow->samples.reinit(pRow->sampleBytes, true);
+    const auto frames64k = (numsamples + 65535) / 65536;
+    pRow->summary256Bytes = frames64k * 256 * 3 * sizeof(float);
+    pRow->summary256.reinit(pRow->summary256Bytes, true);
+    pRow->summary64kBytes = frames64k * 3 * sizeof(float);
+    pRow->summary64k.reinit(pRow->summary64kBytes, true);
+    return pRow;
+}
+} // namespace
+
+TEST_CASE("SampleBlockWriter")
+{
+    TestDatabase database{ "SampleBlockWriterTests.aup3" };
+    std::atomic<int> failures{ 0 };
+    SampleBlockWriter writer{ database.db, database.writerDb, database.transactionMutex,
+                              [&](int, const std::string&){ ++failures; } };
+
+    SECTION("allocates ids past any used before")
+    {
+        REQUIRE(sqlite3_exec(database.db,
+                             "INSERT INTO sampleblocks (samples) VALUES (zeroblob(4));"
+                             "INSERT INTO sampleblocks (samples) VALUES (zeroblob(4));"
+                             "DELETE FROM sampleblocks WHERE blockid = 2;",
+                             nullptr, nullptr, nullptr) == SQLITE_OK);
+        // AUTOINCREMENT does not reuse 2, and neither may the writer
+        REQUIRE(writer.NewBlockID() == 3);
+        REQUIRE(writer.NewBlockID() == 4);
+    }
+
+    SECTION("inserts queued rows by the time Flush returns")
+    {
+        for (int ii = 0; ii < 200; ++ii) {
+            REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        }
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 200);
+        REQUIRE(database.Count("length(samples) = 4000") == 200);
+        // Rows were grouped
+        const auto statistics = writer.GetStatistics();
+        REQUIRE(statistics.rows == 200);
+        REQUIRE(statistics.batches < 200);
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("releases the contents of rows once inserted")
+    {
+        std::weak_ptr<const SampleBlockWriter::Row> wRow;
+        {
+            auto pRow = MakeRow(writer.NewBlockID(), 1000);
+            wRow = pRow;
+            REQUIRE(writer.Enqueue(std::move(pRow)));
+        }
+        REQUIRE(writer.Flush());
+        REQUIRE(wRow.expired());
+    }
+
+    SECTION("does not insert cancelled rows")
+    {
+        const auto first = writer.NewBlockID();
+        const auto second = writer.NewBlockID();
+        REQUIRE(writer.Enqueue(MakeRow(first, 1000)));
+        REQUIRE(writer.Enqueue(MakeRow(second, 1000)));
+        // The batch is still waiting to fill
+        REQUIRE(writer.Cancel(first));
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 1);
+        REQUIRE(database.Count(("blockid = " + std::to_string(second)).c_str()) == 1);
+        // Too late now
+        REQUIRE(!writer.Cancel(second));
+    }
+
+    SECTION("is not rolled back with the other connection's savepoints")
+    {
+        REQUIRE(sqlite3_exec(database.db, "SAVEPOINT Outer;", nullptr, nullptr, nullptr) == SQLITE_OK);
+        REQUIRE(sqlite3_exec(database.db, "INSERT INTO sampleblocks (samples) VALUES (zeroblob(4));",
+                             nullptr, nullptr, nullptr) == SQLITE_OK);
+        // The writer's connection waits for the lock of the database
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        REQUIRE(sqlite3_exec(database.db, "ROLLBACK TO Outer; RELEASE Outer;",
+                             nullptr, nullptr, nullptr) == SQLITE_OK);
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 1);
+        REQUIRE(database.Count("length(samples) = 4000") == 1);
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("inserts within transaction scopes, on the calling thread")
+    {
+        // Queued before the scope, so not to be rolled back with it
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        {
+            std::lock_guard<std::recursive_mutex> lock{ database.transactionMutex };
+            REQUIRE(writer.BeginScope());
+            REQUIRE(database.Count() == 1);
+            REQUIRE(sqlite3_exec(database.db, "SAVEPOINT Outer;", nullptr, nullptr, nullptr) == SQLITE_OK);
+            // Not waiting for the background thread, which waits for the lock
+            REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+            REQUIRE(database.Count() == 2);
+            // Inserted by another thread too, as by workers of an effect
+            std::thread{ [&]{
+                REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+                REQUIRE(writer.Flush());
+            } }.join();
+            REQUIRE(database.Count() == 3);
+            REQUIRE(sqlite3_exec(database.db, "ROLLBACK TO Outer; RELEASE Outer;",
+                                 nullptr, nullptr, nullptr) == SQLITE_OK);
+            writer.EndScope();
+        }
+        REQUIRE(database.Count() == 1);
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 2);
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("inserts durable rows only outside of transaction scopes")
+    {
+        const auto id = writer.NewBlockID();
+        std::atomic<bool> done{ false };
+        std::thread ingester;
+        {
+            std::lock_guard<std::recursive_mutex> lock{ database.transactionMutex };
+            REQUIRE(writer.BeginScope());
+            REQUIRE(sqlite3_exec(database.db, "SAVEPOINT Outer;", nullptr, nullptr, nullptr) == SQLITE_OK);
+            // As by the thread that copies imported audio into the project
+            ingester = std::thread{ [&]{
+                REQUIRE(writer.EnqueueDurable(MakeRow(id, 1000)));
+                done = true;
+            } };
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+            REQUIRE(!done);
+            REQUIRE(database.Count() == 0);
+            REQUIRE(sqlite3_exec(database.db, "ROLLBACK TO Outer; RELEASE Outer;",
+                                 nullptr, nullptr, nullptr) == SQLITE_OK);
+            writer.EndScope();
+        }
+        ingester.join();
+        REQUIRE(done);
+        REQUIRE(database.Count() == 1);
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("cancels rows that no thread yet inserts")
+    {
+        const auto id = writer.NewBlockID();
+        REQUIRE(writer.Enqueue(MakeRow(id, 1000)));
+        std::thread canceller{ [&]{ writer.Cancel(id); } };
+        REQUIRE(writer.Flush());
+        canceller.join();
+        // Either cancelled, or inserted before cancelling came too late
+        REQUIRE(database.Count() <= 1);
+        REQUIRE(!writer.Cancel(id));
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("reports a failed insertion once, and recovers")
+    {
+        const auto id = writer.NewBlockID();
+        REQUIRE(writer.Enqueue(MakeRow(id, 1000)));
+        // Duplicate key
+        REQUIRE(writer.Enqueue(MakeRow(id, 1000)));
+        REQUIRE(!writer.Flush());
+        REQUIRE(failures == 1);
+        REQUIRE(database.Count() == 1);
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 2);
+    }
+
+    SECTION("computes deferred summaries once, before insertion")
+    {
+        static std::atomic<int> calls;
+        calls = 0;
+        auto pRow = MakeRow(writer.NewBlockID(), 1000);
+        pRow->totals->ready = false;
+        pRow->calcSummary = [](SampleBlockWriter::Row& row){
+            ++calls;
+            row.totals->min = -1;
+            row.totals->ready.store(true, std::memory_order_release);
+        };
+        const auto totals = pRow->totals;
+        REQUIRE(writer.Enqueue(pRow));
+        // As by a reader arriving first
+        pRow->Summarize();
+        pRow.reset();
+        REQUIRE(writer.Flush());
+        REQUIRE(calls == 1);
+        REQUIRE(totals->ready);
+        REQUIRE(database.Count("summin = -1") == 1);
+    }
+
+    SECTION("inserts the rest of a batch when a summary fails for want of memory")
+    {
+        auto pFailing = MakeRow(writer.NewBlockID(), 1000);
+        pFailing->totals->ready = false;
+        pFailing->calcSummary = [](SampleBlockWriter::Row&){ throw std::bad_alloc{}; };
+        const auto totals = pFailing->totals;
+        REQUIRE(writer.Enqueue(std::move(pFailing)));
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        REQUIRE(!writer.Flush());
+        REQUIRE(failures == 1);
+        // Readers find the row missing and the totals never ready
+        REQUIRE(database.Count() == 1);
+        REQUIRE(!totals->ready);
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 2);
+    }
+
+    SECTION("inserts summary pyramids if their table exists")
+    {
+        REQUIRE(sqlite3_exec(database.db, PyramidSchema, nullptr, nullptr, nullptr) == SQLITE_OK);
+        auto pRow = MakeRow(writer.NewBlockID(), 1000);
+        for (auto& blob : pRow->pyramid) {
+            blob.resize(16);
+        }
+        REQUIRE(writer.Enqueue(std::move(pRow)));
+        // Rows without a pyramid have none inserted
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 2);
+        REQUIRE(database.Count("blockid IN (SELECT blockid FROM summarypyramids"
+                               "            WHERE length(summary16) = 16)") == 1);
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("inserts rows without their pyramids if the table is missing")
+    {
+        auto pRow = MakeRow(writer.NewBlockID(), 1000);
+        pRow->pyramid[0].resize(16);
+        REQUIRE(writer.Enqueue(std::move(pRow)));
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 1);
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("compresses the samples of rows that ask for it")
+    {
+        REQUIRE(sqlite3_exec(database.db, CodecColumn, nullptr, nullptr, nullptr) == SQLITE_OK);
+        auto pRow = MakeRow(writer.NewBlockID(), 1000);
+        pRow->codec = std::make_shared<std::atomic<int> >(0);
+        const auto codec = pRow->codec;
+        REQUIRE(writer.Enqueue(std::move(pRow)));
+        REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), 1000)));
+        REQUIRE(writer.Flush());
+        REQUIRE(*codec == 1);
+        REQUIRE(database.Count("codec = 1 AND length(samples) < 4000") == 1);
+        REQUIRE(database.Count("codec IS NULL AND length(samples) = 4000") == 1);
+        REQUIRE(failures == 0);
+    }
+
+    SECTION("applies back-pressure without deadlock")
+    {
+        // Each row is a quarter of the limit
+        const auto numsamples = SampleBlockWriter::MaxQueuedBytes / sizeof(float) / 4;
+        for (int ii = 0; ii < 6; ++ii) {
+            REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), numsamples)));
+        }
+        REQUIRE(writer.Flush());
+        REQUIRE(database.Count() == 6);
+    }
+}
+
+TEST_CASE("SampleBlockWriter throughput", "[benchmark][.]")
+{
+    // 32 channels at 96 kHz of float samples
+    constexpr size_t Channels = 32;
+    constexpr size_t Rate = 96000;
+    constexpr size_t Seconds = 10;
+    constexpr double BytesPerSecond = Channels * Rate * sizeof(float);
+
+    // Block sizes as when recording with small and with the largest blocks
+    for (size_t blockSamples : { 16384, 262144 }) {
+        const size_t blocks = Channels * Rate * Seconds / blockSamples;
+        const auto report = [&](const char* what, std::chrono::duration<double> elapsed){
+            const auto bytesPerSecond = blocks * blockSamples * sizeof(float) / elapsed.count();
+            WARN(what << ", blocks of " << blockSamples << " samples: "
+                      << bytesPerSecond / 1e6 << " MB/s, "
+                      << bytesPerSecond / BytesPerSecond << "x real time");
+        };
+        using Clock = std::chrono::steady_clock;
+
+        {
+            // Each row in its own transaction, as SqliteSampleBlock did
+            TestDatabase database{ "SampleBlockWriterBenchmark.aup3" };
+            sqlite3_stmt* stmt = nullptr;
+            sqlite3_prepare_v2(database.db,
+                               "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
+                               "                          summary256, summary64k, samples)"
+                               "                         VALUES(?1,?2,?3,?4,?5,?6,?7);",
+                               -1, &stmt, nullptr);
+            const auto start = Clock::now();
+            for (size_t ii = 0; ii < blocks; ++ii) {
+                const auto pRow = MakeRow(0, blockSamples);
+                sqlite3_bind_int(stmt, 1, static_cast<int>(pRow->format));
+                sqlite3_bind_double(stmt, 2, pRow->totals->min);
+                sqlite3_bind_double(stmt, 3, pRow->totals->max);
+                sqlite3_bind_double(stmt, 4, pRow->totals->rms);
+                sqlite3_bind_blob(stmt, 5, pRow->summary256.get(), pRow->summary256Bytes, SQLITE_STATIC);
+                sqlite3_bind_blob(stmt, 6, pRow->summary64k.get(), pRow->summary64kBytes, SQLITE_STATIC);
+                sqlite3_bind_blob(stmt, 7, pRow->samples.get(), pRow->sampleBytes, SQLITE_STATIC);
+                REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+                sqlite3_reset(stmt);
+            }
+            report("synchronous", Clock::now() - start);
+            sqlite3_finalize(stmt);
+        }
+
+        {
+            TestDatabase database{ "SampleBlockWriterBenchmark.aup3" };
+            SampleBlockWriter writer{ database.db, database.writerDb, database.transactionMutex, {} };
+            const auto start = Clock::now();
+            for (size_t ii = 0; ii < blocks; ++ii) {
+                REQUIRE(writer.Enqueue(MakeRow(writer.NewBlockID(), blockSamples)));
+            }
+            const auto enqueued = Clock::now();
+            REQUIRE(writer.Flush());
+            report("batched", Clock::now() - start);
+            report("batched, time spent by the producer", enqueued - start);
+        }
+    }
+}
@@ -42,3 +42,5 @@ PROJECT_API bool operator<(ProjectFormatVersion lhs, ProjectFormatVersion rhs) n
 PROJECT_API extern const ProjectFormatVersion SupportedProjectFormatVersion;
 //! This is a helper constant for the "most compatible" project version which is the current MAJ.MIN.0.0
 PROJECT_API extern const ProjectFormatVersion BaseProjectFormatVersion;
+//! The least version that can open projects with compressed sample blocks
+PROJECT_API extern const ProjectFormatVersion BlockCodecsProjectFormatVersion;
@@ -13,6 +13,9 @@
 #include "Project.h"
 #include "UndoManager.h"
 
+#include <algorithm>
+#include <thread>
+
 RealtimeEffectList::RealtimeEffectList()
 {
 }
@@ -34,6 +37,7 @@ std::unique_ptr<ClientData::Cloneable<> > RealtimeEffectList::Clone() const
 RealtimeEffectList& RealtimeEffectList::operator=(const RealtimeEffectList& other)
 {
     mStates = other.mStates;
+    PublishChain();
     SetActive(other.IsActive());
     return *this;
 }
@@ -94,8 +98,8 @@ RealtimeEffectList::AddState(std::shared_ptr<RealtimeEffectState> pState)
     if (pState->GetEffect() != nullptr) {
         auto shallowCopy = mStates;
         shallowCopy.emplace_back(pState);
-        // Lock for only a short time
-        (LockGuard{ mLock }, swap(shallowCopy, mStates));
+        swap(shallowCopy, mStates);
+        PublishChain();
 
         Publisher<RealtimeEffectListMessage>::Publish({
             RealtimeEffectListMessage::Type::Insert,
@@ -130,8 +134,8 @@ RealtimeEffectList::ReplaceState(size_t index,
         });
 
         swap(pState, shallowCopy[index]);
-        // Lock for only a short time
-        (LockGuard{ mLock }, swap(shallowCopy, mStates));
+        swap(shallowCopy, mStates);
+        PublishChain();
 
         Publisher<RealtimeEffectListMessage>::Publish({
             RealtimeEffectListMessage::Type::DidReplace,
@@ -157,8 +161,8 @@ void RealtimeEffectList::RemoveState(
         const auto index = std::distance(shallowCopy.begin(), found);
         shallowCopy.erase(found);
 
-        // Lock for only a short time
-        (LockGuard{ mLock }, swap(shallowCopy, mStates));
+        swap(shallowCopy, mStates);
+        PublishChain();
 
         Publisher<RealtimeEffectListMessage>::Publish({
             RealtimeEffectListMessage::Type::Remove,
@@ -174,8 +178,8 @@ void RealtimeEffectList::Clear()
     decltype(mStates) temp;
 
     // Swap an empty list in as a whole, not removing one at a time
-    // Lock for only a short time
-    (LockGuard{ mLock }, swap(temp, mStates));
+    swap(temp, mStates);
+    PublishChain();
 
     for (auto index = temp.size(); index--;) {
         Publisher<RealtimeEffectListMessage>::Publish(
@@ -234,8 +238,8 @@ void RealtimeEffectList::MoveEffect(size_t fromIndex, size_t toIndex)
         const auto last = shallowCopy.rbegin() + (shallowCopy.size() - toIndex);
         std::rotate(first, first + 1, last);
     }
-    // Lock for only a short time
-    (LockGuard{ mLock }, swap(shallowCopy, mStates));
+    swap(shallowCopy, mStates);
+    PublishChain();
 
     Publisher<RealtimeEffectListMessage>::Publish({
         RealtimeEffectListMessage::Type::Move,
@@ -271,6 +275,7 @@ XMLTagHandler* RealtimeEffectList::HandleXMLChild(const std::string_view& tag)
 {
     if (tag == RealtimeEffectState::XMLTag()) {
         mStates.push_back(RealtimeEffectState::make_shared(PluginID {}));
+        PublishChain();
         return mStates.back().get();
     }
     return nullptr;
@@ -293,5 +298,76 @@ bool RealtimeEffectList::IsActive() const
 
 void RealtimeEffectList::SetActive(bool value)
 {
-    (LockGuard{ mLock }, mActive.store(value, std::memory_order_relaxed));
+    mActive.store(value, std::memory_order_relaxed);
+}
+
+RealtimeEffectList::Chain::Chain(
+    const States& states, unsigned nChannels, size_t capacity)
+    : states{ states }
+    , nChannels{ states.empty() ? 0 : nChannels }
+    , capacity{ states.empty() ? 0 : capacity }
+    , inputs{ std::make_unique<float*[]>(this->nChannels) }
+    , outputs{ std::make_unique<float*[]>(this->nChannels) }
+    , scratch{ std::make_unique<float[]>(
+                   (2 * this->nChannels + 1) * this->capacity) }
+{
+}
+
+void RealtimeEffectList::ReserveBuffers(unsigned nChannels, size_t capacity)
+{
+    if (nChannels == mBufferChannels && capacity == mBufferCapacity) {
+        return;
+    }
+    mBufferChannels = nChannels;
+    mBufferCapacity = capacity;
+    PublishChain();
+}
+
+void RealtimeEffectList::PublishChain()
+{
+    auto pChain = std::make_unique<const Chain>(
+        mStates, mBufferChannels, mBufferCapacity);
+    // Sequential consistency of this exchange and of the load of the epoch
+    // orders them with PinChain():  if the worker has not yet incremented the
+    // epoch to odd, its next pin will find the new chain
+    std::unique_ptr<const Chain> pOld{
+        mpChain.exchange(pChain.release(), std::memory_order_seq_cst) };
+    if (pOld) {
+        mRetired.emplace_back(
+            std::move(pOld), mWorkerEpoch.load(std::memory_order_seq_cst));
+    }
+    ReclaimChains();
+}
+
+void RealtimeEffectList::ReclaimChains()
+{
+    const auto epoch = mWorkerEpoch.load(std::memory_order_acquire);
+    const auto end = mRetired.end();
+    mRetired.erase(std::remove_if(mRetired.begin(), end,
+                                  [epoch](const auto& pair) {
+        // Was the worker between scopes when the chain was replaced, or has
+        // it since finished the scope it was in?
+        return pair.second % 2 == 0 || pair.second != epoch;
+    }), end);
+}
+
+void RealtimeEffectList::Synchronize()
+{
+    ReclaimChains();
+    while (!mRetired.empty()) {
+        std::this_thread::yield();
+        ReclaimChains();
+    }
+}
+
+void RealtimeEffectList::PinChain() noexcept
+{
+    mWorkerEpoch.fetch_add(1, std::memory_order_seq_cst);
+    mpPinnedChain = mpChain.load(std::memory_order_seq_cst);
+}
+
+void RealtimeEffectList::UnpinChain() noexcept
+{
+    mpPinnedChain = nullptr;
+    mWorkerEpoch.fetch_add(1, std::memory_order_release);
 }
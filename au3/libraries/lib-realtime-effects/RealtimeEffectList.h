@@ -10,12 +10,13 @@
 #define __AUDACITY_REALTIMEEFFECTLIST_H__
 
 #include <atomic>
+#include <memory>
 #include <optional>
 #include <vector>
 
 #include "ClientData.h"
+#include "MemoryX.h"
 #include "PluginProvider.h" // for PluginID
-#include "spinlock.h"
 #include "XMLTagHandler.h"
 #include "Observer.h"
 
@@ -53,14 +54,11 @@ public:
     RealtimeEffectList& operator=(const RealtimeEffectList&);
     std::unique_ptr<ClientData::Cloneable<> > Clone() const override;
 
-    using Lock = spinlock;
     using States = std::vector<std::shared_ptr<RealtimeEffectState> >;
 
     RealtimeEffectList();
     virtual ~RealtimeEffectList();
 
-    Lock& GetLock() const { return mLock; }
-
     static RealtimeEffectList& Get(AudacityProject& project);
     static const RealtimeEffectList& Get(const AudacityProject& project);
     static RealtimeEffectList& Set(
@@ -75,6 +73,7 @@ public:
     // std::function<void(RealtimeEffectState &state, bool listIsActive)> ;
 
     //! Apply the function to all states sequentially.
+    //! Use only in the main thread
     template<typename StateVisitor>
     void Visit(const StateVisitor& func)
     {
@@ -84,6 +83,7 @@ public:
     }
 
     //! Apply the function to all states sequentially.
+    //! Use only in the main thread
     template<typename StateVisitor>
     void Visit(const StateVisitor& func) const
     {
@@ -92,6 +92,59 @@ public:
         }
     }
 
+    //! Immutable copy of the states, with the buffers to process them
+    /*! Buffers exist only if there are states.  Only the one thread that
+     processes the list writes into them */
+    struct Chain {
+        Chain(const States& states, unsigned nChannels, size_t capacity);
+
+        //! Buffer i < nChannels receives output; buffer nChannels is for
+        //! output to discard; the rest replace missing input channels
+        float* Scratch(unsigned i) const noexcept
+        { return scratch.get() + i * capacity; }
+
+        const States states;
+        const unsigned nChannels;
+        //! Samples in each buffer
+        const size_t capacity;
+        const std::unique_ptr<float*[]> inputs;
+        const std::unique_ptr<float*[]> outputs;
+        const std::unique_ptr<float[]> scratch;
+    };
+
+    //! Use only in the main thread, before processing.  Republish the chain
+    //! with buffers for so many channels and samples
+    void ReserveBuffers(unsigned nChannels, size_t capacity);
+
+    //! Worker thread takes the states last published by the main thread, to
+    //! visit them until UnpinChain()
+    /*! Does not block or allocate.  The main thread will not destroy this
+     chain while it is pinned, however the list may change meanwhile */
+    void PinChain() noexcept;
+
+    //! Use only in the worker thread, between PinChain() and UnpinChain()
+    const Chain* GetPinnedChain() const noexcept { return mpPinnedChain; }
+
+    //! Apply the function to the pinned states sequentially.
+    //! Use only in the worker thread, between PinChain() and UnpinChain()
+    template<typename StateVisitor>
+    void VisitPinned(const StateVisitor& func)
+    {
+        if (mpPinnedChain) {
+            for (auto& state : mpPinnedChain->states) {
+                func(*state, IsActive());
+            }
+        }
+    }
+
+    //! Worker thread releases the chain taken by PinChain()
+    void UnpinChain() noexcept;
+
+    //! Use only in the main thread.  Wait until the worker thread no longer
+    //! visits any states since removed from the list
+    /*! Waits at most for the end of one processing scope */
+    void Synchronize();
+
     //! Use only in the main thread
     //! Returns true for success.
     //! Sends Insert message on success.
@@ -153,14 +206,32 @@ public:
     //! Non-blocking atomic boolean load
     bool IsActive() const;
 
-    //! Done by main thread only, under a lock guard
+    //! Done by main thread only
     void SetActive(bool value);
 
 private:
+    //! Make a copy of mStates available to the worker thread; keep the chain
+    //! it replaces until the worker can no longer be visiting it
+    void PublishChain();
+    //! Destroy those superseded chains that the worker can't be visiting
+    void ReclaimChains();
+
     States mStates;
 
-    using LockGuard = std::lock_guard<Lock>;
-    mutable Lock mLock;
+    //! Channels and samples of the buffers of each published chain
+    unsigned mBufferChannels{ 0 };
+    size_t mBufferCapacity{ 0 };
+
+    //! Immutable copy of mStates, replaced whenever that changes
+    AtomicUniquePointer<const Chain> mpChain{ nullptr };
+    //! Incremented by the worker thread as it pins and unpins the chain, so
+    //! odd while the worker might visit a chain
+    std::atomic<unsigned> mWorkerEpoch{ 0 };
+    //! Chain visited by the worker thread, or null
+    const Chain* mpPinnedChain{};
+    //! Chains replaced while the worker might still visit them, each with the
+    //! worker epoch at the time
+    std::vector<std::pair<std::unique_ptr<const Chain>, unsigned> > mRetired;
 
     std::atomic<bool> mActive{ true };
 };
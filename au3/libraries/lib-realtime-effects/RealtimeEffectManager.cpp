@@ -14,7 +14,9 @@
 #include <memory>
 #include "Project.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
 #include <wx/time.h>
 
 static const AttachedProjectObjects::RegisteredFactory manager
@@ -53,7 +55,7 @@ bool RealtimeEffectManager::IsActive() const noexcept
 void RealtimeEffectManager::Initialize(
     RealtimeEffects::InitializationScope& scope,
     unsigned numPlaybackChannels,
-    double sampleRate, size_t audioThreadBufferSize)
+    double sampleRate, size_t audioThreadBufferSize, size_t bufferCapacity)
 {
     // (Re)Set processor parameters
     mRates.clear();
@@ -74,11 +76,14 @@ void RealtimeEffectManager::Initialize(
     VisitGroup(MasterGroup, [&](RealtimeEffectState& state, bool) {
         scope.mInstances.push_back(state.AddGroup(MasterGroup, numPlaybackChannels, sampleRate, audioThreadBufferSize));
     });
+    RealtimeEffectList::Get(mProject)
+    .ReserveBuffers(numPlaybackChannels, bufferCapacity);
 }
 
 void RealtimeEffectManager::AddGroup(
     RealtimeEffects::InitializationScope& scope,
-    const ChannelGroup& group, unsigned chans, float rate, size_t audioThreadBufferSize)
+    const ChannelGroup& group, unsigned chans, float rate,
+    size_t audioThreadBufferSize, size_t bufferCapacity)
 {
     mGroups.push_back(&group);
     mRates.insert({ &group, rate });
@@ -88,6 +93,8 @@ void RealtimeEffectManager::AddGroup(
         scope.mInstances.push_back(state.AddGroup(&group, chans, rate, audioThreadBufferSize));
     }
                );
+    RealtimeEffectList::Get(const_cast<ChannelGroup&>(group))
+    .ReserveBuffers(chans, bufferCapacity);
 }
 
 void RealtimeEffectManager::Finalize() noexcept
@@ -97,6 +104,15 @@ void RealtimeEffectManager::Finalize() noexcept
 
     VisitAll([](RealtimeEffectState& state, bool){ state.Finalize(); });
 
+    // Give back the buffers; failing that only wastes memory until the next
+    // playback
+    VisitAllLists([](RealtimeEffectList& list){
+        try {
+            list.ReserveBuffers(0, 0);
+        } catch (...) {
+        }
+    });
+
     // Reset processor parameters
     mGroups.clear();
     mRates.clear();
@@ -110,10 +126,15 @@ void RealtimeEffectManager::Finalize() noexcept
 //
 void RealtimeEffectManager::ProcessStart(bool suspended)
 {
-    // Can be suspended because of the audio stream being paused or because
-    // effects have been suspended.
-    VisitAll([suspended](RealtimeEffectState& state, bool listIsActive){
-        state.ProcessStart(!suspended && listIsActive);
+    // Take the chains of states that the main thread last published, and
+    // keep them unchanged for the whole processing scope, without locking
+    VisitAllLists([suspended](RealtimeEffectList& list){
+        list.PinChain();
+        // Can be suspended because of the audio stream being paused or
+        // because effects have been suspended.
+        list.VisitPinned([suspended](RealtimeEffectState& state, bool listIsActive){
+            state.ProcessStart(!suspended && listIsActive);
+        });
     });
 }
 
@@ -121,7 +142,7 @@ void RealtimeEffectManager::ProcessStart(bool suspended)
 //
 size_t RealtimeEffectManager::Process(bool suspended,
                                       const ChannelGroup* group,
-                                      float* const* buffers, float* const* scratch, float* const dummy,
+                                      float* const* buffers,
                                       unsigned nBuffers, size_t numSamples)
 {
     // Can be suspended because of the audio stream being paused or because
@@ -130,17 +151,33 @@ size_t RealtimeEffectManager::Process(bool suspended,
         return 0;
     }
 
-    // Allocate the in and out buffer arrays
-    const auto ibuf
-        =static_cast<float**>(alloca(nBuffers * sizeof(float*)));
-    const auto obuf
-        =static_cast<float**>(alloca(nBuffers * sizeof(float*)));
-
-    // And populate the input with the buffers we've been given while allocating
-    // NEW output buffers
+    auto& list = group
+                 ? RealtimeEffectList::Get(*const_cast<ChannelGroup*>(group))
+                 : RealtimeEffectList::Get(mProject);
+    const auto pChain = list.GetPinnedChain();
+    if (!pChain || pChain->states.empty()) {
+        return 0;
+    }
+    // Initialize() and AddGroup() reserved the buffers for playback
+    assert(nBuffers <= pChain->nChannels);
+    assert(numSamples <= pChain->capacity);
+
+    // Only this thread processes the group, so it may use the arrays and
+    // buffers of the chain
+    const auto ibuf = pChain->inputs.get();
+    const auto obuf = pChain->outputs.get();
+    const auto dummy = pChain->Scratch(pChain->nChannels);
+
+    // And populate the input with the buffers we've been given, or silence
+    // for channels the group lacks, and the output with the scratch buffers
     for (unsigned int i = 0; i < nBuffers; i++) {
-        ibuf[i] = buffers[i];
-        obuf[i] = scratch[i];
+        if (buffers[i]) {
+            ibuf[i] = buffers[i];
+        } else {
+            ibuf[i] = pChain->Scratch(pChain->nChannels + 1 + i);
+            std::fill(ibuf[i], ibuf[i] + numSamples, 0.0f);
+        }
+        obuf[i] = pChain->Scratch(i);
     }
 
     // Now call each effect in the chain while swapping buffer pointers to feed
@@ -148,20 +185,26 @@ size_t RealtimeEffectManager::Process(bool suspended,
     // Tracks how many processors were called
     size_t called = 0;
     size_t totalDiscardable = 0;
-    VisitGroup(group,
-               [&](RealtimeEffectState& state, bool)
+    list.VisitPinned([&](RealtimeEffectState& state, bool)
     {
-        const size_t discardable = std::min(state.Process(group, nBuffers, ibuf, obuf, dummy, numSamples), numSamples);
+        // A bypassed effect leaves the samples where they are
+        const bool inPlace = state.IsBypassed();
+        const size_t discardable = std::min(
+            state.Process(group, nBuffers, ibuf, inPlace ? ibuf : obuf, dummy,
+                          numSamples),
+            numSamples);
         for (unsigned int i = 0; i < nBuffers; i++) {
             ibuf[i] += discardable;
             obuf[i] += discardable;
         }
         numSamples -= discardable;
         totalDiscardable += discardable;
-        for (auto i = 0; i < nBuffers; ++i) {
-            std::swap(ibuf[i], obuf[i]);
+        if (!inPlace) {
+            for (auto i = 0; i < nBuffers; ++i) {
+                std::swap(ibuf[i], obuf[i]);
+            }
+            called++;
         }
-        called++;
     });
 
     // Once we're done, we might wind up with the last effect storing its results
@@ -170,7 +213,9 @@ size_t RealtimeEffectManager::Process(bool suspended,
     // is odd.
     if (called & 1) {
         for (unsigned int i = 0; i < nBuffers; i++) {
-            memcpy(buffers[i], ibuf[i], numSamples * sizeof(float));
+            if (buffers[i]) {
+                memcpy(buffers[i], ibuf[i], numSamples * sizeof(float));
+            }
         }
     }
 
@@ -187,8 +232,11 @@ void RealtimeEffectManager::ProcessEnd(bool suspended) noexcept
 {
     // Can be suspended because of the audio stream being paused or because
     // effects have been suspended.
-    VisitAll([suspended](RealtimeEffectState& state, bool){
-        state.ProcessEnd();
+    VisitAllLists([](RealtimeEffectList& list){
+        list.VisitPinned([](RealtimeEffectState& state, bool){
+            state.ProcessEnd();
+        });
+        list.UnpinChain();
     });
 }
 
@@ -248,7 +296,7 @@ std::shared_ptr<RealtimeEffectState> RealtimeEffectManager::AddState(
         return nullptr;
     }
 
-    // Only now add the completed state to the list, under a lock guard
+    // Only now add the completed state to the list, and publish it
     if (!states.AddState(pState)) {
         return nullptr;
     }
@@ -273,11 +321,13 @@ std::shared_ptr<RealtimeEffectState> RealtimeEffectManager::ReplaceState(
         return nullptr;
     }
 
-    // Only now swap the completed state into the list, under a lock guard
+    // Only now swap the completed state into the list, and publish it
     if (!states.ReplaceState(index, pNewState)) {
         return nullptr;
     }
     if (mActive) {
+        // The worker may still be processing with the old state
+        states.Synchronize();
         pOldState->Finalize();
     }
     Publish({
@@ -293,9 +343,11 @@ void RealtimeEffectManager::RemoveState(
 {
     auto& states = FindStates(mProject, pGroup);
 
-    // Remove the state from processing (under the lock guard) before finalizing
+    // Remove the state from processing before finalizing
     states.RemoveState(pState);
     if (mActive) {
+        // The worker may still be processing with the old state
+        states.Synchronize();
         pState->Finalize();
     }
     Publish({
@@ -125,11 +125,11 @@ private:
 
     //! Main thread begins to define a set of groups for playback
     void Initialize(RealtimeEffects::InitializationScope& scope, unsigned numPlaybackChannels, double sampleRate,
-                    size_t audioThreadBufferSize);
+                    size_t audioThreadBufferSize, size_t bufferCapacity);
     //! Main thread adds one group (passing the first of one or more
     //! channels), still before playback
     void AddGroup(RealtimeEffects::InitializationScope& scope, const ChannelGroup& group, unsigned chans, float rate,
-                  size_t audioThreadBufferSize);
+                  size_t audioThreadBufferSize, size_t bufferCapacity);
     //! Main thread cleans up after playback
     void Finalize() noexcept;
 
@@ -138,8 +138,7 @@ private:
     void ProcessStart(bool suspended);
 
     /*! @copydoc ProcessScope::Process */
-    size_t Process(bool suspended, const ChannelGroup* group, float* const* buffers, float* const* scratch, float* dummy, unsigned nBuffers,
-                   size_t numSamples);
+    size_t Process(bool suspended, const ChannelGroup* group, float* const* buffers, unsigned nBuffers, size_t numSamples);
     void ProcessEnd(bool suspended) noexcept;
 
     RealtimeEffectManager(const RealtimeEffectManager&) = delete;
@@ -182,6 +181,17 @@ private:
         }
     }
 
+    //! Visit the per-project list first, then the lists of all groups from
+    //! AddGroup
+    template<typename ListVisitor>
+    void VisitAllLists(const ListVisitor& func)
+    {
+        func(RealtimeEffectList::Get(mProject));
+        for (auto group : mGroups) {
+            func(RealtimeEffectList::Get(*group));
+        }
+    }
+
     AudacityProject& mProject;
     //Latency mLatency{ 0 };
 
@@ -202,16 +212,23 @@ class InitializationScope
 {
 public:
     InitializationScope() {}
+    /*!
+     @param bufferCapacity most samples that ProcessingScope::Process will be
+     given at once
+     */
     explicit InitializationScope(
         std::weak_ptr<AudacityProject> wProject, double sampleRate,
-        unsigned numPlaybackChannels, size_t audioThreadBufferSize)
+        unsigned numPlaybackChannels, size_t audioThreadBufferSize,
+        size_t bufferCapacity)
         : mSampleRate{sampleRate}
         , mwProject{move(wProject)}
         , mNumPlaybackChannels{numPlaybackChannels}
         , mAudioThreadBufferSize{audioThreadBufferSize}
+        , mBufferCapacity{bufferCapacity}
     {
         if (const auto pProject = mwProject.lock()) {
-            RealtimeEffectManager::Get(*pProject).Initialize(*this, numPlaybackChannels, sampleRate, audioThreadBufferSize);
+            RealtimeEffectManager::Get(*pProject).Initialize(*this, numPlaybackChannels, sampleRate, audioThreadBufferSize,
+                                                             bufferCapacity);
         }
     }
 
@@ -229,7 +246,8 @@ public:
     {
         if (auto pProject = mwProject.lock()) {
             RealtimeEffectManager::Get(*pProject)
-            .AddGroup(*this, group, chans, rate, audioThreadBufferSize);
+            .AddGroup(*this, group, chans, rate, audioThreadBufferSize,
+                      mBufferCapacity);
         }
     }
 
@@ -237,6 +255,7 @@ public:
     double mSampleRate;
     unsigned mNumPlaybackChannels;
     size_t mAudioThreadBufferSize;
+    size_t mBufferCapacity;
 
 private:
     std::weak_ptr<AudacityProject> mwProject;
@@ -266,18 +285,17 @@ public:
     }
 
     //! @return how many samples to discard for latency
+    /*! May be called for different groups in different threads at once, but
+     not for the same group */
     size_t Process(const ChannelGroup* group,
-                   float* const* buffers,
-                   float* const* scratch,
-                   float* dummy,
-                   unsigned nBuffers, //!< how many buffers; equal number of scratches
+                   float* const* buffers, //!< null for channels the group lacks
+                   unsigned nBuffers, //!< how many buffers
                    size_t numSamples //!< length of each buffer
                    )
     {
         if (const auto pProject = mwProject.lock()) {
             return RealtimeEffectManager::Get(*pProject)
-                   .Process(mSuspended, group, buffers, scratch, dummy,
-                            nBuffers, numSamples);
+                   .Process(mSuspended, group, buffers, nBuffers, numSamples);
         }
         return 0; // consider them trivially processed
     }
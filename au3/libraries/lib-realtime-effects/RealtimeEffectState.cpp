@@ -18,7 +18,6 @@
 
 #include <chrono>
 #include <thread>
-#include <condition_variable>
 
 //! Mediator of two-way inter-thread communication of changes of settings
 class RealtimeEffectState::AccessState : public NonInterferingBase
@@ -83,14 +82,10 @@ public:
 
     void WorkerWrite()
     {
-        {
-            std::unique_lock lk(mLockForCV);
-
-            // Worker thread avoids memory allocation.
-            mChannelToMain.Write(CounterAndOutputs {
-                mState.mWorkerSettings.counter, mState.mOutputs.get() });
-        }
-        mCV.notify_one();
+        // Worker thread avoids memory allocation, and locks nothing that the
+        // main thread might hold; the main thread polls for the answer
+        mChannelToMain.Write(CounterAndOutputs {
+            mState.mWorkerSettings.counter, mState.mOutputs.get() });
     }
 
     struct ToMainSlot {
@@ -204,9 +199,6 @@ public:
 
     MessageBuffer<ToMainSlot> mChannelToMain;
 
-    std::mutex mLockForCV;
-    std::condition_variable mCV;
-
     std::thread::id mMainThreadId;
 };
 
@@ -308,14 +300,13 @@ struct RealtimeEffectState::Access final : EffectSettingsAccess {
                 assert(pAccessState->mMainThreadId == std::this_thread::get_id());
 
                 if (pAccessState->mState.mInitialized) {
-                    std::unique_lock lk(pAccessState->mLockForCV);
-                    pAccessState->mCV.wait(lk,
-                                           [&] {
-                        auto& lastSettings = pAccessState->mLastSettings;
+                    // The worker answers once per processing scope
+                    auto& lastSettings = pAccessState->mLastSettings;
+                    pAccessState->MainRead();
+                    while (pAccessState->mCounter != lastSettings.counter) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
                         pAccessState->MainRead();
-                        return pAccessState->mCounter == lastSettings.counter;
                     }
-                                           );
                 }
 
                 // Update what GetSettings() will return, during play and before
@@ -595,7 +586,10 @@ size_t RealtimeEffectState::Process(
     size_t numSamples)
 {
     const auto pInstance = mwInstance.lock();
-    const auto& pair = mGroups[group];
+    // Don't insert into the map in the worker thread
+    const auto iter = mGroups.find(group);
+    const auto pair = iter == mGroups.end()
+                      ? std::pair<size_t, double> {} : iter->second;
     const float** const clientIn
         =pInstance ? stackAllocate(const float*, pInstance->GetAudioInCount())
           : nullptr;
@@ -616,9 +610,11 @@ size_t RealtimeEffectState::Process(
     };
 
     if (!mPlugin || !pInstance || !mLastActive) {
-        // Process trivially
+        // Process trivially; nothing to copy if processing in place
         for (size_t ii = 0; ii < chans; ++ii) {
-            memcpy(outbuf[ii], inbuf[ii], numSamples * sizeof(float));
+            if (outbuf[ii] != inbuf[ii]) {
+                memcpy(outbuf[ii], inbuf[ii], numSamples * sizeof(float));
+            }
         }
         if (pInstance) {
             auto processor = pair.first;
@@ -724,6 +720,11 @@ bool RealtimeEffectState::ProcessEnd()
     return result;
 }
 
+bool RealtimeEffectState::IsBypassed() const noexcept
+{
+    return !mLastActive;
+}
+
 bool RealtimeEffectState::IsEnabled() const noexcept
 {
     return mMainSettings.settings.extra.GetActive();
@@ -80,6 +80,7 @@ public:
     bool ProcessStart(bool running);
     //! Worker thread processes part of a batch of samples
     /*!
+     If IsBypassed(), `outbuf` may be the same as `inbuf`
      @return how many leading samples are discardable for latency
      */
     size_t Process(const ChannelGroup* group, unsigned chans, // How many channels the playback device needs
@@ -98,6 +99,10 @@ public:
     //! Test only in the worker thread, or else when there is no processing
     bool IsActive() const noexcept;
 
+    //! Test only in the worker thread, after ProcessStart():  whether Process()
+    //! passes samples through unchanged in this processing scope
+    bool IsBypassed() const noexcept;
+
     //! Set only in the main thread
     void SetActive(bool active);
 
@@ -25,7 +25,7 @@ AudioSegmentSampleView::AudioSegmentSampleView(
         start + length
         <= std::accumulate(
             mBlockViews.begin(), mBlockViews.end(), 0u,
-            [](size_t acc, const auto& block) { return acc + block->size(); }));
+            [](size_t acc, const auto& block) { return acc + block.size(); }));
 }
 
 AudioSegmentSampleView::AudioSegmentSampleView(size_t length)
@@ -65,8 +65,8 @@ void AudioSegmentSampleView::DoAdd(float* buffer, size_t bufferSize) const
     size_t written = 0u;
     size_t offset = mStart;
     for (const auto& block : mBlockViews) {
-        const auto toWriteFromBlock = std::min(block->size() - offset, toWrite);
-        const auto src = block->data() + offset;
+        const auto toWriteFromBlock = std::min(block.size() - offset, toWrite);
+        const auto src = block.data() + offset;
         const auto dst = buffer + written;
         std::transform(src, src + toWriteFromBlock, dst, dst, std::plus {});
         toWrite -= toWriteFromBlock;
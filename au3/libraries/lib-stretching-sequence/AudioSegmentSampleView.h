@@ -20,7 +20,47 @@ ranges.
 #include <memory>
 #include <vector>
 
-using BlockSampleView = std::shared_ptr<std::vector<float> >;
+//! Read-only samples of one block, which shares ownership of their storage
+/*!
+ The storage need not be a vector of its own, so that samples already in
+ memory in float format are viewed without a copy.
+ */
+class BlockSampleView final
+{
+public:
+    BlockSampleView() = default;
+
+    //! Views all of the vector
+    BlockSampleView(std::shared_ptr<const std::vector<float> > samples)
+        : mData{samples ? samples->data() : nullptr}
+        , mSize{samples ? samples->size() : 0}
+        , mOwner{std::move(samples)}
+    {
+    }
+
+    BlockSampleView(std::shared_ptr<std::vector<float> > samples)
+        : BlockSampleView{std::shared_ptr<const std::vector<float> > {
+                              std::move(samples) }}
+    {
+    }
+
+    //! Views `size` samples at `data`, which `owner` keeps valid
+    BlockSampleView(
+        std::shared_ptr<const void> owner, const float* data, size_t size)
+        : mData{data}
+        , mSize{size}
+        , mOwner{std::move(owner)}
+    {
+    }
+
+    const float* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    const float* mData{ nullptr };
+    size_t mSize{ 0 };
+    std::shared_ptr<const void> mOwner;
+};
 
 class STRETCHING_SEQUENCE_API AudioSegmentSampleView final
 {
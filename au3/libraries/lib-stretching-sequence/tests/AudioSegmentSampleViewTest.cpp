@@ -12,6 +12,8 @@
 
 #include <catch2/catch.hpp>
 
+#include <numeric>
+
 TEST_CASE("AudioSegmentSampleView", "Copy returns expected values when")
 {
     SECTION("AudioSegmentSampleView is silent")
@@ -56,3 +58,17 @@ TEST_CASE("AudioSegmentSampleView", "Copy returns expected values when")
         }
     }
 }
+
+TEST_CASE("BlockSampleView", "views samples in storage of another type")
+{
+    const auto storage = std::make_shared<std::vector<char> >(
+        4 * sizeof(float));
+    const auto samples = reinterpret_cast<float*>(storage->data());
+    std::iota(samples, samples + 4, 1.f);
+    // The last three samples
+    BlockSampleView view { storage, samples + 1, 3 };
+    AudioSegmentSampleView sut { { view }, 1u, 2u };
+    std::vector<float> out(2u);
+    sut.Copy(out.data(), out.size());
+    REQUIRE(out == std::vector<float> { 3.f, 4.f });
+}
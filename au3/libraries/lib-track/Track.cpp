@@ -115,6 +115,11 @@ auto Track::Duplicate(DuplicateOptions options) const -> Holder
     return result;
 }
 
+auto Track::DuplicateForHistory(const Track*) const -> Holder
+{
+    return Duplicate(DuplicateOptions {}.Backup());
+}
+
 Track::Holder Track::GetEmptyCopy() const
 {
     return TrackEmptyCopy();
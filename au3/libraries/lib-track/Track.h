@@ -297,6 +297,14 @@ public:
 
     //! public nonvirtual duplication function that invokes Clone()
     virtual Holder Duplicate(DuplicateOptions = {}) const;
+
+    //! Duplicate as for backup, to store in a state of the undo history
+    /*!
+     Overrides may share unchanged parts with the track of the previous state,
+     because tracks of the history are never modified
+     @param pPrevious the track with the same id in the previous state, or null
+     */
+    virtual Holder DuplicateForHistory(const Track* pPrevious) const;
     Holder GetEmptyCopy() const;
 
     void ReparentAllAttachments();
@@ -11,13 +11,53 @@
 #include "PendingTracks.h"
 #include "Track.h"
 #include "UndoManager.h"
+#include "XMLWriter.h"
+
+#include <map>
 
 // Undo/redo handling of selection changes
 namespace {
+//! Hash of what the track would save in the project
+uint64_t Digest(const Track& track)
+{
+    XMLDigestWriter writer;
+    track.WriteXML(writer);
+    return writer.GetDigest();
+}
+
+//! The tracks of the current state, which may be replaced by a new one
+const TrackList* FindPreviousTracks(AudacityProject& project)
+{
+    auto& undoManager = UndoManager::Get(project);
+    if (undoManager.GetNumStates() == 0) {
+        return nullptr;
+    }
+    const TrackList* result = nullptr;
+    const size_t current = undoManager.GetCurrentState();
+    undoManager.VisitStates([&](const UndoStackElem& elem){
+        result = UndoTracks::Find(elem);
+    }, current, current + 1);
+    return result;
+}
+
 struct TrackListRestorer final : UndoStateExtension {
     TrackListRestorer(AudacityProject& project)
-        : mpTracks{TrackList::Get(project).Duplicate()}
+        : mpTracks{TrackList::Create(nullptr)}
     {
+        // Consecutive states share what did not change
+        const auto pPrevious = FindPreviousTracks(project);
+        for (auto pTrack : TrackList::Get(project)) {
+            const auto id = pTrack->GetId();
+            if (id == TrackId {}) {
+                // Don't copy a pending added track
+                continue;
+            }
+            const Track* pPreviousTrack
+                =pPrevious ? pPrevious->FindById(id) : nullptr;
+            mpTracks->Add(pTrack->DuplicateForHistory(pPreviousTrack),
+                          TrackList::DoAssignId::No);
+            mDigests.emplace(id, Digest(*pTrack));
+        }
     }
 
     void RestoreUndoRedoState(AudacityProject& project) override
@@ -41,15 +81,11 @@ struct TrackListRestorer final : UndoStateExtension {
     }
 
     const std::shared_ptr<TrackList> mpTracks;
+    //! Digests of the tracks when the state was pushed
+    std::map<TrackId, uint64_t> mDigests;
 };
 
-UndoRedoExtensionRegistry::Entry<TrackListRestorer> sEntry { [] (AudacityProject& project)->std::shared_ptr<UndoStateExtension> {
-        return std::make_shared<TrackListRestorer>(project);
-    }
-};
-}
-
-TrackList* UndoTracks::Find(const UndoStackElem& state)
+const TrackListRestorer* FindRestorer(const UndoStackElem& state)
 {
     auto& exts = state.state.extensions;
     auto end = exts.end(),
@@ -57,7 +93,38 @@ TrackList* UndoTracks::Find(const UndoStackElem& state)
         return dynamic_cast<TrackListRestorer*>(entry.second.get());
     });
     if (iter != end) {
-        return static_cast<TrackListRestorer*>(iter->second.get())->mpTracks.get();
+        return static_cast<TrackListRestorer*>(iter->second.get());
     }
     return nullptr;
 }
+
+UndoRedoExtensionRegistry::Entry<TrackListRestorer> sEntry { [] (AudacityProject& project)->std::shared_ptr<UndoStateExtension> {
+        return std::make_shared<TrackListRestorer>(project);
+    }
+};
+}
+
+TrackList* UndoTracks::Find(const UndoStackElem& state)
+{
+    const auto pRestorer = FindRestorer(state);
+    return pRestorer ? pRestorer->mpTracks.get() : nullptr;
+}
+
+auto UndoTracks::FindChangedTracks(
+    const TrackList& tracks, const UndoStackElem& state)
+-> std::optional<std::vector<TrackId> >
+{
+    const auto pRestorer = FindRestorer(state);
+    if (!pRestorer) {
+        return {};
+    }
+    std::vector<TrackId> result;
+    for (auto pTrack : tracks) {
+        const auto iter = pRestorer->mDigests.find(pTrack->GetId());
+        if (iter != pRestorer->mDigests.end()
+            && iter->second != Digest(*pTrack)) {
+            result.push_back(pTrack->GetId());
+        }
+    }
+    return result;
+}
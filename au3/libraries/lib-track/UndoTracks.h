@@ -10,11 +10,25 @@
 #ifndef __AUDACITY_UNDO_TRACKS__
 #define __AUDACITY_UNDO_TRACKS__
 
+#include <optional>
+#include <vector>
+
+class TrackId;
 class TrackList;
 struct UndoStackElem;
 
 namespace UndoTracks {
 TRACK_API TrackList* Find(const UndoStackElem& state);
+
+//! Find the tracks, of both the list and the state, that restoring the state
+//! would change
+/*!
+ Tracks are compared by what they would save in the project, so that this is
+ much cheaper than a comparison of all clips
+ @return nullopt if the state has no tracks
+ */
+TRACK_API std::optional<std::vector<TrackId> >
+FindChangedTracks(const TrackList& tracks, const UndoStackElem& state);
 }
 
 #endif
@@ -15,6 +15,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <type_traits>
 
 #include "SampleBlock.h"
 #include "SampleFormat.h"
@@ -45,7 +46,8 @@ public:
             if (mSampleType != WaveCacheSampleBlock::Type::Samples) {
                 mCachedData.clear();
                 mCachedData.resize(
-                    RoundUpUnsafe(clip.GetSequence(0)->GetMaxBlockSize(), 256));
+                    RoundUpUnsafe(clip.GetSequence(0)->GetMaxBlockSize(),
+                                  WaveCacheSampleBlock::SamplesPerElement(mSampleType)));
             }
         }
 
@@ -65,16 +67,11 @@ public:
             std::copy(appendBuffer, appendBuffer + appendedSamples, outBuffer);
         }
         break;
-        case WaveCacheSampleBlock::Type::MinMaxRMS256:
-            FillBlocksFromAppendBuffer<256>(
-                appendBuffer, appendedSamples, outBlock);
-            break;
-        case WaveCacheSampleBlock::Type::MinMaxRMS64k:
-            FillBlocksFromAppendBuffer<64 * 1024>(
-                appendBuffer, appendedSamples, outBlock);
-            break;
         default:
-            return false;
+            FillBlocksFromAppendBuffer(
+                appendBuffer, appendedSamples,
+                WaveCacheSampleBlock::SamplesPerElement(mSampleType), outBlock);
+            break;
         }
 
         // If the append buffer was flushed during the copy operation,
@@ -118,9 +115,8 @@ private:
         return mConvertedAppendBufferData.data();
     }
 
-    template<size_t blockSize>
     void FillBlocksFromAppendBuffer(
-        const float* bufferSamples, size_t samplesCount,
+        const float* bufferSamples, size_t samplesCount, size_t blockSize,
         WaveCacheSampleBlock& outBlock)
     {
         const size_t startingBlock = mLastProcessedSample / blockSize;
@@ -234,28 +230,19 @@ MakeDefaultDataProvider(const WaveClip& clip, int channelIndex)
                 ptr, floatSample, 0, outBlock.NumSamples, false);
         }
         break;
-        case WaveCacheSampleBlock::Type::MinMaxRMS256:
-        {
-            size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 256);
-
-            float* ptr
-                =static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
-
-            inputBlock.sb->GetSummary256(ptr, 0, framesCount);
-        }
-        break;
-        case WaveCacheSampleBlock::Type::MinMaxRMS64k:
+        default:
         {
-            size_t framesCount = RoundUpUnsafe(outBlock.NumSamples, 64 * 1024);
+            const size_t samplesPerElement
+                =WaveCacheSampleBlock::SamplesPerElement(dataType);
+            size_t framesCount
+                =RoundUpUnsafe(outBlock.NumSamples, samplesPerElement);
 
             float* ptr
                 =static_cast<float*>(outBlock.GetWritePointer(framesCount * 3));
 
-            inputBlock.sb->GetSummary64k(ptr, 0, framesCount);
+            inputBlock.sb->GetSummary(samplesPerElement, ptr, 0, framesCount);
         }
         break;
-        default:
-            return false;
         }
 
         outBlock.DataType = dataType;
@@ -271,6 +258,7 @@ WaveDataCache::WaveDataCache(const WaveClip& waveClip, int channelIndex)
         [] { return std::make_unique<WaveCacheElement>(); }),
     mProvider { MakeDefaultDataProvider(waveClip, channelIndex) },
 mWaveClip { waveClip },
+mSequence { waveClip.GetSequence(channelIndex) },
 mStretchChangedSubscription {
     const_cast<WaveClip&>(waveClip)
     .Observer::Publisher<StretchRatioChange>::Subscribe(
@@ -299,11 +287,24 @@ bool WaveDataCache::InitializeElement(
         =samplesPerColumn * WaveDataCache::CacheElementWidth;
     size_t processedSamples = 0;
 
-    const WaveCacheSampleBlock::Type blockType
-        =samplesPerColumn >= 64 * 1024
-          ? WaveCacheSampleBlock::Type::MinMaxRMS64k
-          : (samplesPerColumn >= 256 ? WaveCacheSampleBlock::Type::MinMaxRMS256
-             : WaveCacheSampleBlock::Type::Samples);
+    // The coarsest data with at least one element per column, so that each
+    // column reads at most as many elements as the ratio of the levels
+    auto blockType = WaveCacheSampleBlock::Type::MinMaxRMS64k;
+    while (blockType != WaveCacheSampleBlock::Type::Samples
+           && WaveCacheSampleBlock::SamplesPerElement(blockType) > samplesPerColumn) {
+        blockType = static_cast<WaveCacheSampleBlock::Type>(
+            static_cast<int>(blockType) - 1);
+    }
+
+    // Elements made from samples are quick to compute again, and there are
+    // too many zoom levels of them to be worth keeping
+    const auto contentKey
+        =blockType == WaveCacheSampleBlock::Type::Samples
+          ? std::nullopt
+          : GetContentKey(key, samplesPerColumn, elementSamplesCount);
+    if (contentKey && LoadElement(*contentKey, element)) {
+        return true;
+    }
 
     if (blockType != mCachedBlock.DataType) {
         mCachedBlock.Reset();
@@ -374,9 +375,161 @@ bool WaveDataCache::InitializeElement(
     element.AvailableColumns = columnIndex;
     element.IsComplete       = processedSamples == elementSamplesCount;
 
+    if (contentKey && element.IsComplete) {
+        StoreElement(*contentKey, element);
+    }
+
     return processedSamples != 0;
 }
 
+namespace {
+// Change it whenever the computation or the encoding of elements changes, so
+// that what older versions stored is not found
+constexpr uint32_t StoredElementVersion = 1;
+
+enum StoredElementFormat : uint16_t {
+    FloatColumns = 1,
+    Int16Columns = 2,
+};
+
+//! 64 bit FNV-1a
+class ContentHasher final
+{
+public:
+    template<typename T> void Add(const T& value) noexcept
+    {
+        static_assert(std::is_arithmetic_v<T>);
+        const auto bytes = reinterpret_cast<const unsigned char*>(&value);
+        for (size_t ii = 0; ii < sizeof(T); ++ii) {
+            mHash = (mHash ^ bytes[ii]) * 0x100000001b3ull;
+        }
+    }
+
+    uint64_t Get() const noexcept
+    {
+        return mHash;
+    }
+
+private:
+    uint64_t mHash { 0xcbf29ce484222325ull };
+};
+} // namespace
+
+std::optional<uint64_t> WaveDataCache::GetContentKey(
+    const GraphicsDataCacheKey& key, double samplesPerColumn,
+    size_t elementSamplesCount) const
+{
+    const auto first = key.FirstSample;
+    const auto last = first + static_cast<int64_t>(elementSamplesCount);
+    if (first < 0 || elementSamplesCount == 0
+        || last > mSequence->GetNumSamples().as_long_long()) {
+        return std::nullopt;
+    }
+
+    ContentHasher hasher;
+    hasher.Add(StoredElementVersion);
+    hasher.Add(first);
+    hasher.Add(samplesPerColumn);
+
+    const auto& blocks = mSequence->GetBlockArray();
+    for (auto index = static_cast<size_t>(mSequence->FindBlock(sampleCount { first }));
+         index < blocks.size() && blocks[index].start.as_long_long() < last;
+         ++index) {
+        const auto& block = blocks[index];
+        hasher.Add(block.start.as_long_long());
+        hasher.Add(block.sb->GetBlockID());
+        hasher.Add(block.sb->GetSampleCount());
+        // Ids may be reused once their blocks are gone, as after compaction,
+        // but not with the same contents
+        const auto totals = block.sb->GetMinMaxRMS(false);
+        hasher.Add(totals.min);
+        hasher.Add(totals.max);
+        hasher.Add(totals.RMS);
+    }
+
+    return hasher.Get();
+}
+
+bool WaveDataCache::LoadElement(
+    uint64_t contentKey, WaveCacheElement& element) const
+{
+    std::vector<char> data;
+    if (!mSequence->GetFactory()->LoadDisplayData(contentKey, data)) {
+        return false;
+    }
+
+    uint16_t header[2];
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(header, data.data(), sizeof(header));
+    const auto columns = header[0];
+    const auto format = header[1];
+    const auto values = 3 * size_t(columns);
+    const auto payload = data.data() + sizeof(header);
+    const auto payloadBytes = data.size() - sizeof(header);
+
+    if (columns == 0 || columns > CacheElementWidth) {
+        return false;
+    }
+
+    float* dest = &element.Data[0].min;
+    static_assert(sizeof(WaveDisplayColumn) == 3 * sizeof(float));
+    if (format == FloatColumns && payloadBytes == values * sizeof(float)) {
+        std::memcpy(dest, payload, payloadBytes);
+    } else if (format == Int16Columns && payloadBytes == values * sizeof(int16_t)) {
+        for (size_t ii = 0; ii < values; ++ii) {
+            int16_t value;
+            std::memcpy(&value, payload + ii * sizeof(value), sizeof(value));
+            dest[ii] = value / 32767.0f;
+        }
+    } else {
+        return false;
+    }
+
+    element.AvailableColumns = columns;
+    element.IsComplete = true;
+    return true;
+}
+
+void WaveDataCache::StoreElement(
+    uint64_t contentKey, const WaveCacheElement& element) const
+{
+    const auto columns = element.AvailableColumns;
+    const auto values = 3 * columns;
+    const float* source = &element.Data[0].min;
+
+    // Sixteen bits are plenty for display, if the values fit; round outward
+    // so that the extremes still contain the samples
+    const bool quantize = std::all_of(source, source + values,
+                                      [](float value) { return value >= -1.0f && value <= 1.0f; });
+
+    const uint16_t header[2] = {
+        static_cast<uint16_t>(columns),
+        quantize ? Int16Columns : FloatColumns,
+    };
+    std::vector<char> data(
+        sizeof(header) + values * (quantize ? sizeof(int16_t) : sizeof(float)));
+    std::memcpy(data.data(), header, sizeof(header));
+    const auto payload = data.data() + sizeof(header);
+
+    if (quantize) {
+        for (size_t column = 0; column < columns; ++column) {
+            const auto& columnData = element.Data[column];
+            const int16_t encoded[] = {
+                static_cast<int16_t>(std::floor(columnData.min * 32767.0f)),
+                static_cast<int16_t>(std::ceil(columnData.max * 32767.0f)),
+                static_cast<int16_t>(std::lround(columnData.rms * 32767.0f)),
+            };
+            std::memcpy(payload + column * sizeof(encoded), encoded, sizeof(encoded));
+        }
+    } else {
+        std::memcpy(payload, source, values * sizeof(float));
+    }
+
+    mSequence->GetFactory()->StoreDisplayData(contentKey, data.data(), data.size());
+}
+
 bool WaveCacheSampleBlock::ContainsSample(int64_t sampleIndex) const noexcept
 {
     return sampleIndex >= FirstSample
@@ -389,6 +542,29 @@ float* WaveCacheSampleBlock::GetWritePointer(size_t floatsCount)
     return mData.data();
 }
 
+size_t WaveCacheSampleBlock::SamplesPerElement(Type type) noexcept
+{
+    switch (type) {
+    case Type::MinMaxRMS16:
+        return 16;
+    case Type::MinMaxRMS64:
+        return 64;
+    case Type::MinMaxRMS256:
+        return 256;
+    case Type::MinMaxRMS1k:
+        return 1024;
+    case Type::MinMaxRMS4k:
+        return 4096;
+    case Type::MinMaxRMS16k:
+        return 16 * 1024;
+    case Type::MinMaxRMS64k:
+        return 64 * 1024;
+    case Type::Samples:
+    default:
+        return 1;
+    }
+}
+
 void WaveCacheSampleBlock::Reset() noexcept
 {
     FirstSample = 0;
@@ -396,9 +572,8 @@ void WaveCacheSampleBlock::Reset() noexcept
 }
 
 namespace {
-template<size_t blockSize>
 void processBlock(
-    const float* input, int64_t from, size_t count,
+    const float* input, int64_t from, size_t count, size_t blockSize,
     WaveCacheSampleBlock::Summary& summary)
 {
     input = input + 3 * (from / blockSize);
@@ -458,14 +633,10 @@ WaveCacheSampleBlock::Summary WaveCacheSampleBlock::GetSummary(
 
         assert(summary.Min <= summary.Max);
 
-        break;
-    case WaveCacheSampleBlock::Type::MinMaxRMS256:
-        processBlock<256>(data, from, samplesCount, summary);
-        break;
-    case WaveCacheSampleBlock::Type::MinMaxRMS64k:
-        processBlock<64 * 1024>(data, from, samplesCount, summary);
         break;
     default:
+        processBlock(
+            data, from, samplesCount, SamplesPerElement(DataType), summary);
         break;
     }
 
@@ -13,6 +13,7 @@
 #include <array>
 #include <cstdint>
 #include <numeric>
+#include <optional>
 #include <vector>
 #include <functional>
 
@@ -20,6 +21,7 @@
 #include "WaveData.h"
 #include "Observer.h"
 
+class Sequence;
 class WaveClip;
 
 //! Helper structure used to transfer the data between the data and graphics layers
@@ -30,6 +32,16 @@ struct WAVE_TRACK_PAINT_API WaveCacheSampleBlock final
     {
         //! Each element of the resulting array is a sample
         Samples,
+        /*!
+         * Each element of the resulting array is a tuple (min, max, rms)
+         * calculated over 16 samples.
+         */
+        MinMaxRMS16,
+        /*!
+         * Each element of the resulting array is a tuple (min, max, rms)
+         * calculated over 64 samples.
+         */
+        MinMaxRMS64,
         /*!
          * Each element of the resulting array is a tuple (min, max, rms)
          * calculated over 256 samples.
@@ -37,11 +49,29 @@ struct WAVE_TRACK_PAINT_API WaveCacheSampleBlock final
         MinMaxRMS256,
         /*!
          * Each element of the resulting array is a tuple (min, max, rms)
-         * calculated over 256 samples.
+         * calculated over 1024 samples.
+         */
+        MinMaxRMS1k,
+        /*!
+         * Each element of the resulting array is a tuple (min, max, rms)
+         * calculated over 4096 samples.
+         */
+        MinMaxRMS4k,
+        /*!
+         * Each element of the resulting array is a tuple (min, max, rms)
+         * calculated over 16384 samples.
+         */
+        MinMaxRMS16k,
+        /*!
+         * Each element of the resulting array is a tuple (min, max, rms)
+         * calculated over 65536 samples.
          */
         MinMaxRMS64k,
     };
 
+    //! Number of samples summarized by one element of the data of the type
+    static size_t SamplesPerElement(Type type) noexcept;
+
     //! Summary calculated over the requested range
     struct Summary final
     {
@@ -99,10 +129,20 @@ private:
     bool InitializeElement(
         const GraphicsDataCacheKey& key, WaveCacheElement& element) override;
 
+    //! Hash of the blocks the element is computed from, and of the zoom
+    /*! @return nullopt if it depends on the append buffer */
+    std::optional<uint64_t> GetContentKey(
+        const GraphicsDataCacheKey& key, double samplesPerColumn,
+        size_t elementSamplesCount) const;
+    //! From the persistent storage of the sample block factory
+    bool LoadElement(uint64_t contentKey, WaveCacheElement& element) const;
+    void StoreElement(uint64_t contentKey, const WaveCacheElement& element) const;
+
     DataProvider mProvider;
 
     WaveCacheSampleBlock mCachedBlock;
 
     const WaveClip& mWaveClip;
+    const Sequence* const mSequence;
     Observer::Subscription mStretchChangedSubscription;
 };
@@ -12,6 +12,10 @@ SampleBlock.cpp
 
 #include <wx/defs.h>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 SampleBlockFactoryPtr SampleBlockFactory::New(AudacityProject& project)
 {
     auto& factory = Factory::Get();
@@ -35,6 +39,24 @@ SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src,
     return result;
 }
 
+SampleBlockPtr SampleBlockFactory::CreateDurable(constSamplePtr src,
+                                                 size_t numsamples,
+                                                 sampleFormat srcformat)
+{
+    auto result = DoCreateDurable(src, numsamples, srcformat);
+    if (!result) {
+        THROW_INCONSISTENCY_EXCEPTION;
+    }
+    Publisher<SampleBlockCreateMessage>::Publish({});
+    return result;
+}
+
+SampleBlockPtr SampleBlockFactory::DoCreateDurable(
+    constSamplePtr src, size_t numsamples, sampleFormat srcformat)
+{
+    return DoCreate(src, numsamples, srcformat);
+}
+
 SampleBlockPtr SampleBlockFactory::CreateSilent(
     size_t numsamples,
     sampleFormat srcformat)
@@ -70,6 +92,15 @@ SampleBlockPtr SampleBlockFactory::CreateFromId(
     return result;
 }
 
+bool SampleBlockFactory::LoadDisplayData(uint64_t, std::vector<char>&)
+{
+    return false;
+}
+
+void SampleBlockFactory::StoreDisplayData(uint64_t, const void*, size_t)
+{
+}
+
 SampleBlock::~SampleBlock() = default;
 
 size_t SampleBlock::GetSamples(samplePtr dest,
@@ -89,6 +120,43 @@ size_t SampleBlock::GetSamples(samplePtr dest,
     }
 }
 
+bool SampleBlock::GetSummary(
+    size_t factor, float* dest, size_t frameoffset, size_t numframes)
+{
+    if (factor == 256) {
+        return GetSummary256(dest, frameoffset, numframes);
+    }
+    if (factor == 64 * 1024) {
+        return GetSummary64k(dest, frameoffset, numframes);
+    }
+
+    const auto count = GetSampleCount();
+    std::vector<float> samples(count);
+    const bool success = GetSamples(reinterpret_cast<samplePtr>(samples.data()),
+                                    floatSample, 0, count, false) == count;
+
+    for (size_t ii = 0; ii < numframes; ++ii, dest += 3) {
+        const auto first = (frameoffset + ii) * factor;
+        if (first >= count) {
+            std::fill(dest, dest + 3, 0.0f);
+            continue;
+        }
+        const auto last = std::min(first + factor, count);
+        float min = samples[first];
+        float max = samples[first];
+        double sumsq = 0;
+        for (auto jj = first; jj < last; ++jj) {
+            min = std::min(min, samples[jj]);
+            max = std::max(max, samples[jj]);
+            sumsq += double(samples[jj]) * samples[jj];
+        }
+        dest[0] = min;
+        dest[1] = max;
+        dest[2] = static_cast<float>(std::sqrt(sumsq / (last - first)));
+    }
+    return success;
+}
+
 MinMaxRMS SampleBlock::GetMinMaxRMS(
     size_t start, size_t len, bool mayThrow)
 {
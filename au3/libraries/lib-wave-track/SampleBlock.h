@@ -13,9 +13,11 @@ SampleBlock.h
 #include "SampleFormat.h"
 #include "AudioSegmentSampleView.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "Observer.h"
 #include "XMLTagHandler.h"
@@ -69,6 +71,19 @@ public:
     virtual bool
     GetSummary64k(float* dest, size_t frameoffset, size_t numframes) = 0;
 
+    //! Factors, in samples per frame, of the summaries that GetSummary() gives
+    static constexpr size_t SummaryFactors[] = { 16, 64, 256, 1024, 4096, 16384, 64 * 1024 };
+
+    //! Summary of `factor` samples per frame; the last frame may be partial
+    /*!
+     Non-throwing, should fill with zeroes on failure.
+     The default gives GetSummary256() and GetSummary64k() for those factors,
+     and otherwise computes from the samples.
+     @pre `factor` is one of SummaryFactors
+     */
+    virtual bool
+    GetSummary(size_t factor, float* dest, size_t frameoffset, size_t numframes);
+
     /// Gets extreme values for the specified region
     // If !mayThrow and there is an error, ignores it and returns zeroes.
     // That may be appropriate when only attempting to display samples, not edit.
@@ -112,6 +127,13 @@ public:
                                                SampleBlockFactoryPtr(AudacityProject&)
                                                > {};
 
+    //! Global hook making blocks that read from files outside the project,
+    //! from the attributes that they saved; it returns null for other blocks
+    struct WAVE_TRACK_API AliasFactory : GlobalHook<AliasFactory,
+                                                    SampleBlockPtr(const SampleBlockFactoryPtr& pFactory, sampleFormat srcformat,
+                                                                   const AttributesList& attrs)
+                                                    > {};
+
     // Invoke the installed factory (throw an exception if none was installed)
     static SampleBlockFactoryPtr New(AudacityProject& project);
 
@@ -120,6 +142,14 @@ public:
     // Returns a non-null pointer or else throws an exception
     SampleBlockPtr Create(constSamplePtr src, size_t numsamples, sampleFormat srcformat);
 
+    //! Like Create(), but no transaction that is open meanwhile can undo the
+    //! storage of the block; it may wait for such transactions to end
+    /*!
+     Not to be called while the calling thread has a transaction open.
+     Returns a non-null pointer or else throws an exception
+     */
+    SampleBlockPtr CreateDurable(constSamplePtr src, size_t numsamples, sampleFormat srcformat);
+
     // Returns a non-null pointer or else throws an exception
     SampleBlockPtr CreateSilent(
         size_t numsamples, sampleFormat srcformat);
@@ -135,11 +165,26 @@ public:
     /*! @return ids of all sample blocks created by this factory and still extant */
     virtual SampleBlockIDs GetActiveBlockIDs() = 0;
 
+    //! Optional storage, lasting across sessions, of data computed for display
+    /*!
+     The key should hash everything the data was computed from, such as ids
+     of sample blocks, so that edits never find stale data.  Anything may be
+     forgotten at any time.  The default stores nothing.
+     Non-throwing.
+     @return whether the key was found
+     */
+    virtual bool LoadDisplayData(uint64_t key, std::vector<char>& data);
+    //! Non-throwing; the default does nothing
+    virtual void StoreDisplayData(uint64_t key, const void* data, size_t bytes);
+
 protected:
     // The override should throw more informative exceptions on error than the
     // default InconsistencyException thrown by Create
     virtual SampleBlockPtr DoCreate(constSamplePtr src, size_t numsamples, sampleFormat srcformat) = 0;
 
+    //! The default calls DoCreate(), for storage without transactions
+    virtual SampleBlockPtr DoCreateDurable(constSamplePtr src, size_t numsamples, sampleFormat srcformat);
+
     // The override should throw more informative exceptions on error than the
     // default InconsistencyException thrown by CreateSilent
     virtual SampleBlockPtr DoCreateSilent(
@@ -825,8 +825,13 @@ bool Sequence::HandleXMLTag(const std::string_view& tag, const AttributesList& a
     if (tag == WaveBlock_tag) {
         SeqBlock wb;
 
-        // Give SampleBlock a go at the attributes first
-        wb.sb = factory.CreateFromXML(mSampleFormats.Stored(), attrs);
+        // Give SampleBlock a go at the attributes first, beginning with any
+        // reference to audio not yet copied into the project
+        wb.sb = SampleBlockFactory::AliasFactory::Call(
+            mpFactory, mSampleFormats.Stored(), attrs);
+        if (!wb.sb) {
+            wb.sb = factory.CreateFromXML(mSampleFormats.Stored(), attrs);
+        }
         if (wb.sb == nullptr) {
             mErrorOpening = true;
             return false;
@@ -1161,6 +1166,22 @@ bool Sequence::Get(samplePtr buffer, sampleFormat format,
            && !outOfBounds;
 }
 
+void Sequence::Prefetch(sampleCount start, sampleCount len) const
+{
+    const auto end = std::min(start + len, mNumSamples);
+    if (start < 0) {
+        start = 0;
+    }
+    if (start >= end) {
+        return;
+    }
+    for (size_t b = FindBlock(start); b < mBlock.size() && mBlock[b].start < end; ++b) {
+        // Only for the side effect: blocks that read from storage may keep
+        // what they read in a cache
+        mBlock[b].sb->GetFloatSampleView(false);
+    }
+}
+
 bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len, bool mayThrow) const
 {
@@ -1357,6 +1378,20 @@ void Sequence::AppendSharedBlock(const SeqBlock::SampleBlockPtr& pBlock)
 #endif
 }
 
+/*! @excsafety{Strong} */
+void Sequence::AppendBlock(
+    const SeqBlock::SampleBlockPtr& pBlock, sampleFormat effectiveFormat)
+{
+    // Samples pending in the append buffer would otherwise go after the block
+    if (mAppendBufferLen > 0
+        || pBlock->GetSampleFormat() != mSampleFormats.Stored()) {
+        THROW_INCONSISTENCY_EXCEPTION;
+    }
+    AppendSharedBlock(pBlock);
+    // Change our effective format now that AppendSharedBlock didn't throw
+    mSampleFormats.UpdateEffective(effectiveFormat);
+}
+
 /*! @excsafety{Weak} */
 bool Sequence::Append(
     constSamplePtr buffer, sampleFormat format, size_t len, size_t stride,
@@ -103,6 +103,10 @@ public:
      */
     bool Get(samplePtr buffer, sampleFormat format, sampleCount start, size_t len, bool mayThrow) const;
 
+    //! Load into memory the blocks that Get() would read for the range
+    /*! Read errors are ignored */
+    void Prefetch(sampleCount start, sampleCount len) const;
+
     /*!
      Get a view of the lesser of `len` samples or what remains after `start`
      @pre `start < GetNumSamples()`
@@ -163,6 +167,12 @@ public:
     //! Append a complete block, not coalescing
     /*! @excsafety{Strong} */
     void AppendSharedBlock(const SeqBlock::SampleBlockPtr& pBlock);
+    //! Append a complete block, made in the stored format, not coalescing
+    /*!
+     @pre nothing is pending in the append buffer
+     @excsafety{Strong}
+     */
+    void AppendBlock(const SeqBlock::SampleBlockPtr& pBlock, sampleFormat effectiveFormat);
     /*! @excsafety{Strong} */
     void Delete(sampleCount start, sampleCount len);
 
@@ -987,6 +987,18 @@ void WaveClip::AppendLegacySharedBlock(
     mSequences[0]->AppendSharedBlock(pBlock);
 }
 
+/*! @excsafety{Strong} */
+void WaveClip::AppendBlock(size_t iChannel,
+                           const std::shared_ptr<SampleBlock>& pBlock, sampleFormat effectiveFormat)
+{
+    assert(iChannel < NChannels());
+    mSequences[iChannel]->AppendBlock(pBlock, effectiveFormat);
+
+    // use No-fail-guarantee
+    UpdateEnvelopeTrackLen();
+    MarkChanged();
+}
+
 bool WaveClip::Append(size_t iChannel, const size_t nChannels,
                       constSamplePtr buffers[], sampleFormat format,
                       size_t len, unsigned int stride, sampleFormat effectiveFormat)
@@ -1959,6 +1971,21 @@ sampleCount WaveClip::GetSequenceSamplesCount() const
     return GetNumSamples() * NChannels();
 }
 
+void WaveClip::Prefetch(double t0, double t1) const
+{
+    t0 = std::max(t0, GetPlayStartTime());
+    t1 = std::min(t1, GetPlayEndTime());
+    if (t0 >= t1) {
+        return;
+    }
+    const auto start = TimeToSequenceSamples(t0);
+    // One more, for rounding
+    const auto len = TimeToSequenceSamples(t1) - start + 1;
+    for (const auto& pSequence : mSequences) {
+        pSequence->Prefetch(start, len);
+    }
+}
+
 double WaveClip::GetPlayStartTime() const noexcept
 {
     return SnapToTrackSample(mSequenceOffset + mTrimLeft);
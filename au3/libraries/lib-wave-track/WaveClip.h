@@ -452,6 +452,9 @@ public:
     //! (but not counting the cutlines)
     sampleCount GetSequenceSamplesCount() const;
 
+    //! Load into memory the samples that play of the time interval would read
+    void Prefetch(double t0, double t1) const;
+
     //! Closed-begin of play region. Always a multiple of the track's sample
     //! period, whether the clip is stretched or not.
     double GetPlayStartTime() const noexcept override;
@@ -686,6 +689,14 @@ public:
      */
     void AppendLegacySharedBlock(const std::shared_ptr<SampleBlock>& pBlock);
 
+    //! Append a block made in the stored format, as by an importer that
+    //! builds the blocks itself
+    /*!
+     @pre `iChannel < NChannels()`
+     @pre nothing is pending in the append buffer of the channel
+     */
+    void AppendBlock(size_t iChannel, const std::shared_ptr<SampleBlock>& pBlock, sampleFormat effectiveFormat);
+
     //! Append (non-interleaved) samples to some or all channels
     //! You must call Flush after the last Append
     /*!
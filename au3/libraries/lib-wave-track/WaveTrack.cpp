@@ -39,6 +39,7 @@ from the project that will own the track.
 #include <numeric>
 #include <optional>
 #include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "float_cast.h"
@@ -59,6 +60,7 @@ from the project that will own the track.
 #include "Prefs.h"
 #include "QualitySettings.h"
 #include "TimeWarper.h"
+#include "XMLWriter.h"
 
 #include "InconsistencyException.h"
 
@@ -809,6 +811,67 @@ Track::Holder WaveTrack::Clone(bool backup) const
     return newTrack;
 }
 
+namespace {
+//! Hash of what the clip would save in the project, with what else its copies
+//! must preserve; or nullopt for a clip that is not saved as it is
+std::optional<uint64_t> HistoryDigest(const WaveClip& clip)
+{
+    if (clip.GetSequenceSamplesCount() <= 0) {
+        return {};
+    }
+    for (size_t ii = 0; ii < clip.NChannels(); ++ii) {
+        if (clip.GetAppendBufferLen(ii) > 0) {
+            return {};
+        }
+    }
+    XMLDigestWriter writer;
+    writer.WriteAttr(wxT("id"), static_cast<long long>(clip.GetId()));
+    writer.WriteAttr(wxT("rate"), clip.GetRate());
+    writer.WriteAttr(wxT("placeholder"), clip.GetIsPlaceholder());
+    writer.WriteAttr(wxT("channels"), clip.NChannels());
+    for (size_t ii = 0; ii < clip.NChannels(); ++ii) {
+        clip.WriteXML(ii, writer);
+    }
+    return writer.GetDigest();
+}
+}
+
+Track::Holder WaveTrack::DuplicateForHistory(const Track* pPrevious) const
+{
+    const auto pPreviousTrack = dynamic_cast<const WaveTrack*>(pPrevious);
+    if (!pPreviousTrack) {
+        return Track::DuplicateForHistory(pPrevious);
+    }
+
+    std::unordered_map<uint64_t, WaveClipHolder> previousClips;
+    for (const auto& clip : pPreviousTrack->mClips) {
+        if (const auto digest = HistoryDigest(*clip)) {
+            previousClips.emplace(*digest, clip);
+        }
+    }
+
+    auto newTrack = EmptyCopy(NChannels());
+    newTrack->mLegacyFormat = mLegacyFormat;
+    newTrack->mLegacyRate = mLegacyRate;
+    for (const auto& clip : mClips) {
+        const auto digest = HistoryDigest(*clip);
+        const auto iter
+            =digest ? previousClips.find(*digest) : previousClips.end();
+        if (iter != previousClips.end()) {
+            // Not InsertClip(): the clip was adjusted to the tempo when it was
+            // inserted in the previous state, and nothing observes the new track
+            newTrack->mClips.push_back(iter->second);
+            previousClips.erase(iter);
+        } else {
+            newTrack->InsertClip(newTrack->mClips,
+                                 WaveClip::NewSharedFrom(*clip, newTrack->mpFactory, true, true),
+                                 false, true, false);
+        }
+    }
+    CopyAttachments(*newTrack, *this, true);
+    return newTrack;
+}
+
 wxString WaveTrack::MakeClipCopyName(const wxString& originalName) const
 {
     auto name = originalName;
@@ -2354,6 +2417,14 @@ bool WaveChannel::AppendBuffer(constSamplePtr buffer, sampleFormat format,
            .Append(iChannel, buffer, format, len, stride, effectiveFormat);
 }
 
+/*! @excsafety{Strong} */
+void WaveChannel::AppendBlock(
+    const std::shared_ptr<SampleBlock>& pBlock, sampleFormat effectiveFormat)
+{
+    const size_t iChannel = GetChannelIndex();
+    GetTrack().AppendBlock(iChannel, pBlock, effectiveFormat);
+}
+
 /*! @excsafety{Partial}
 -- Some prefix (maybe none) of the buffer is appended,
 and no content already flushed to disk is lost. */
@@ -2380,6 +2451,14 @@ bool WaveTrack::Append(size_t iChannel,
                          buffers, format, len, stride, effectiveFormat);
 }
 
+/*! @excsafety{Strong} */
+void WaveTrack::AppendBlock(size_t iChannel,
+                            const std::shared_ptr<SampleBlock>& pBlock, sampleFormat effectiveFormat)
+{
+    assert(iChannel < NChannels());
+    RightmostOrNewClip()->AppendBlock(iChannel, pBlock, effectiveFormat);
+}
+
 size_t WaveTrack::GetBestBlockSize(sampleCount s) const
 {
     auto bestBlockSize = GetMaxBlockSize();
@@ -2996,6 +3075,13 @@ void WaveChannel::GetEnvelopeValues(
     return GetTrack().GetEnvelopeValues(buffer, bufferLen, t0, backwards);
 }
 
+void WaveTrack::Prefetch(double t0, double t1) const
+{
+    for (const auto& pClip : mClips) {
+        pClip->Prefetch(t0, t1);
+    }
+}
+
 void WaveTrack::GetEnvelopeValues(
     double* buffer, size_t bufferLen, double t0, bool backwards) const
 {
@@ -32,6 +32,7 @@ namespace BasicUI {
 class ProgressDialog;
 }
 
+class SampleBlock;
 class SampleBlockFactory;
 using SampleBlockFactoryPtr = std::shared_ptr<SampleBlockFactory>;
 
@@ -171,6 +172,13 @@ public:
 
     bool AppendBuffer(constSamplePtr buffer, sampleFormat format, size_t len, unsigned stride, sampleFormat effectiveFormat);
 
+    //! Append a block made by the track's factory in its sample format,
+    //! copying no samples
+    /*!
+     @pre nothing was appended by AppendBuffer() and not yet flushed
+     */
+    void AppendBlock(const std::shared_ptr<SampleBlock>& pBlock, sampleFormat effectiveFormat);
+
     /*!
      If there is an existing WaveClip in the WaveTrack that owns the channel,
      then the data are appended to that clip. If there are no WaveClips in the
@@ -275,6 +283,10 @@ public:
     //! Overwrite data excluding the sample sequence but including display
     //! settings
     void Init(const WaveTrack& orig);
+
+    //! Like Clone(true), but shares with `pPrevious` the clips that would be
+    //! saved the same
+    Track::Holder DuplicateForHistory(const Track* pPrevious) const override;
 private:
     std::ptrdiff_t FindClip(const Interval& clip);
 
@@ -481,6 +493,12 @@ public:
                 sampleFormat effectiveFormat = widestSampleFormat)
     override;
 
+    /*!
+     Like Append(), for a block made by the factory of this track
+     @pre `iChannel < NChannels()`
+     */
+    void AppendBlock(size_t iChannel, const std::shared_ptr<SampleBlock>& pBlock, sampleFormat effectiveFormat);
+
     void Flush() override;
 
     void RepairChannels() override;
@@ -539,6 +557,8 @@ public:
     void GetEnvelopeValues(
         double* buffer, size_t bufferLen, double t0, bool backwards) const override;
 
+    void Prefetch(double t0, double t1) const override;
+
     //
     // Getting information about the track's internal block sizes
     // and alignment for efficiency
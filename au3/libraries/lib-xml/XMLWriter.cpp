@@ -22,6 +22,11 @@ the general functionality for creating XML in UTF8 encoding.
 \class XMLStringWriter
 \brief Wrapper to output XML data to strings.
 
+*//****************************************************************//**
+
+\class XMLDigestWriter
+\brief Hashes XML data instead of writing it.
+
 *//*******************************************************************/
 
 #include "XMLWriter.h"
@@ -428,6 +433,112 @@ void XMLStringWriter::Write(const wxString& data)
     Append(data);
 }
 
+///
+/// XMLDigestWriter class
+///
+XMLDigestWriter::XMLDigestWriter()
+{
+}
+
+XMLDigestWriter::~XMLDigestWriter()
+{
+}
+
+void XMLDigestWriter::StartTag(const wxString& name)
+{
+    // Markers keep the nesting of tags in the digest
+    Hash("<", 1);
+    Hash(name);
+}
+
+void XMLDigestWriter::EndTag(const wxString& name)
+{
+    Hash(">", 1);
+    Hash(name);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, const wxString& value)
+{
+    Hash(name);
+    Hash(value);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, const wxChar* value)
+{
+    WriteAttr(name, wxString(value));
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, int value)
+{
+    HashAttr(name, value);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, bool value)
+{
+    HashAttr(name, value);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, long value)
+{
+    HashAttr(name, value);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, long long value)
+{
+    HashAttr(name, value);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, size_t value)
+{
+    HashAttr(name, value);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, float value, int)
+{
+    HashAttr(name, value);
+}
+
+void XMLDigestWriter::WriteAttr(const wxString& name, double value, int)
+{
+    HashAttr(name, value);
+}
+
+void XMLDigestWriter::WriteData(const wxString& value)
+{
+    Hash(value);
+}
+
+void XMLDigestWriter::WriteSubTree(const wxString& value)
+{
+    Hash(value);
+}
+
+void XMLDigestWriter::Write(const wxString& data)
+{
+    Hash(data);
+}
+
+void XMLDigestWriter::Hash(const void* data, size_t bytes) noexcept
+{
+    // FNV-1a
+    auto bytePtr = static_cast<const unsigned char*>(data);
+    for (size_t ii = 0; ii < bytes; ++ii) {
+        mDigest ^= bytePtr[ii];
+        mDigest *= 1099511628211ull;
+    }
+}
+
+void XMLDigestWriter::Hash(const wxString& value) noexcept
+{
+    // The length separates consecutive strings
+    const size_t length = value.length();
+    Hash(&length, sizeof(length));
+    for (const auto ch : value) {
+        const auto codePoint = static_cast<uint32_t>(ch.GetValue());
+        Hash(&codePoint, sizeof(codePoint));
+    }
+}
+
 void XMLUtf8BufferWriter::StartTag(const std::string_view& name)
 {
     if (mInTag) {
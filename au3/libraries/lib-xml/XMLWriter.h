@@ -10,6 +10,7 @@
 #ifndef __AUDACITY_XML_XML_FILE_WRITER__
 #define __AUDACITY_XML_XML_FILE_WRITER__
 
+#include <cstdint>
 #include <vector>
 #include <wx/ffile.h> // to inherit
 
@@ -146,6 +147,55 @@ public:
 private:
 };
 
+///
+/// XMLDigestWriter
+///
+
+/// This computes a hash of what would be written, without formatting the
+/// numbers, so that objects can be compared by what they would save
+class XML_API XMLDigestWriter final : public XMLWriter
+{
+public:
+    XMLDigestWriter();
+    virtual ~XMLDigestWriter();
+
+    void StartTag(const wxString& name) override;
+    void EndTag(const wxString& name) override;
+
+    using XMLWriter::WriteAttr;
+    void WriteAttr(const wxString& name, const wxString& value) override;
+    void WriteAttr(const wxString& name, const wxChar* value) override;
+
+    void WriteAttr(const wxString& name, int value) override;
+    void WriteAttr(const wxString& name, bool value) override;
+    void WriteAttr(const wxString& name, long value) override;
+    void WriteAttr(const wxString& name, long long value) override;
+    void WriteAttr(const wxString& name, size_t value) override;
+    //! Digits are ignored; values are hashed exactly
+    void WriteAttr(const wxString& name, float value, int digits = -1) override;
+    void WriteAttr(const wxString& name, double value, int digits = -1) override;
+
+    void WriteData(const wxString& value) override;
+
+    void WriteSubTree(const wxString& value) override;
+
+    void Write(const wxString& data) override;
+
+    uint64_t GetDigest() const noexcept { return mDigest; }
+
+private:
+    void Hash(const void* data, size_t bytes) noexcept;
+    void Hash(const wxString& value) noexcept;
+    template<typename T> void HashAttr(const wxString& name, T value) noexcept
+    {
+        Hash(name);
+        Hash(&value, sizeof(value));
+    }
+
+    // FNV-1a offset basis
+    uint64_t mDigest{ 14695981039346656037ull };
+};
+
 class XML_API XMLUtf8BufferWriter final
 {
 public:
@@ -43,6 +43,7 @@ function.
 #define OSINPUT(X) OSFILENAME(X)
 #endif
 
+#include "libraries/lib-import-export/ExportMixerPipeline.h"
 #include "libraries/lib-import-export/ExportPluginHelpers.h"
 #include "libraries/lib-import-export/PlainExportOptionsEditor.h"
 #include "FFmpegDefines.h"
@@ -1381,6 +1382,7 @@ bool FFmpegExportProcessor::Initialize(AudacityProject& project,
 {
     context.t0 = t0;
     context.t1 = t1;
+    context.numChannels = channels;
 
     if (!FFmpegFunctions::Load()) {
         throw ExportException(_("Properly configured FFmpeg is required to proceed.\nYou can configure it at Preferences > Libraries."));
@@ -1433,13 +1435,17 @@ ExportResult FFmpegExportProcessor::Process(ExportProcessorDelegate& delegate)
     delegate.SetStatusString(context.status);
     auto exportResult = ExportResult::Success;
     {
+        // Mix the next blocks while this one is encoded
+        ExportMixerPipeline pipeline{
+            *context.mixer, context.numChannels, true, int16Sample };
+
         while (exportResult == ExportResult::Success) {
-            auto pcmNumSamples = context.mixer->Process();
+            auto pcmNumSamples = pipeline.Process();
             if (pcmNumSamples == 0) {
                 break;
             }
 
-            short* pcmBuffer = (short*)context.mixer->GetBuffer();
+            short* pcmBuffer = (short*)pipeline.GetBuffer();
 
             if (!context.exporter->EncodeAudioFrame(pcmBuffer, pcmNumSamples)) {
                 // All errors should already have been reported.
@@ -1448,7 +1454,7 @@ ExportResult FFmpegExportProcessor::Process(ExportProcessorDelegate& delegate)
 
             if (exportResult == ExportResult::Success) {
                 exportResult = ExportPluginHelpers::UpdateProgress(
-                    delegate, *context.mixer, context.t0, context.t1);
+                    delegate, pipeline, context.t0, context.t1);
             }
         }
     }
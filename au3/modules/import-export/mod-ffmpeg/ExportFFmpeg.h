@@ -130,6 +130,7 @@ class FFmpegExportProcessor final : public ExportProcessor
         TranslatableString status;
         double t0;
         double t1;
+        unsigned numChannels;
         std::unique_ptr<Mixer> mixer;
         std::unique_ptr<FFmpegExporter> exporter;
     } context;
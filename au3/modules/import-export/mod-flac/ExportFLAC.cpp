@@ -32,6 +32,7 @@ Joshua Haberman
 
 #include "wxFileNameWrapper.h"
 
+#include "ExportMixerPipeline.h"
 #include "ExportPluginHelpers.h"
 #include "ExportPluginRegistry.h"
 #include "PlainExportOptionsEditor.h"
@@ -422,14 +423,18 @@ ExportResult FLACExportProcessor::Process(ExportProcessorDelegate& delegate)
 
     ArraysOf<FLAC__int32> tmpsmplbuf{ context.numChannels, SAMPLES_PER_RUN, true };
 
+    // Mix the next blocks while this one is encoded
+    ExportMixerPipeline pipeline{
+        *context.mixer, context.numChannels, false, context.format };
+
     while (exportResult == ExportResult::Success) {
-        auto samplesThisRun = context.mixer->Process();
+        auto samplesThisRun = pipeline.Process();
         if (samplesThisRun == 0) { //stop encoding
             break;
         }
 
         for (size_t i = 0; i < context.numChannels; i++) {
-            auto mixed = context.mixer->GetBuffer(i);
+            auto mixed = pipeline.GetBuffer(i);
             if (context.format == int24Sample) {
                 for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
                     tmpsmplbuf[i][j] = ((const int*)mixed)[j];
@@ -447,7 +452,7 @@ ExportResult FLACExportProcessor::Process(ExportProcessorDelegate& delegate)
             throw ExportDiskFullError(context.fName);
         }
         exportResult = ExportPluginHelpers::UpdateProgress(
-            delegate, *context.mixer, context.t0, context.t1);
+            delegate, pipeline, context.t0, context.t1);
     }
 
     if (exportResult != ExportResult::Cancelled && exportResult != ExportResult::Error) {
@@ -25,6 +25,7 @@
 #include <wx/defs.h>
 
 #include "Import.h"
+#include "ImportPipeline.h"
 #include "ImportPlugin.h"
 #include "ImportProgressListener.h"
 
@@ -44,9 +45,15 @@ static const auto exts = {
 
 #include "FLAC++/decoder.h"
 
+#include "FileException.h"
+#include "SampleBlock.h"
 #include "WaveTrack.h"
 #include "ImportUtils.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #ifdef USE_LIBID3TAG
 extern "C" {
 #include <id3tag.h>
@@ -79,8 +86,6 @@ public:
         return mWasError;
     }
 
-    ImportProgressListener* mImportProgressListener { nullptr };
-
 private:
     friend class FLACImportFileHandle;
     FLACImportFileHandle* mFile;
@@ -92,6 +97,40 @@ protected:
     void error_callback(FLAC__StreamDecoderErrorStatus status) override;
 };
 
+//! Decodes the audio of the file from any position, for ImportPipeline
+class FLACReader final : public FLAC::Decoder::File, public ImportPipeline::Reader
+{
+public:
+    FLACReader(const FilePath& filename, unsigned numChannels, unsigned bitsPerSample);
+
+    //! The format of the samples that Read() delivers
+    static sampleFormat ReadFormat(unsigned bitsPerSample);
+
+    //! @return whether the file could be opened
+    bool Open();
+
+    void Seek(sampleCount frame) override;
+    size_t Read(samplePtr buffer, size_t frames) override;
+
+protected:
+    FLAC__StreamDecoderWriteStatus write_callback(const FLAC__Frame* frame, const FLAC__int32* const buffer[]) override;
+    void metadata_callback(const FLAC__StreamMetadata*) override {}
+    void error_callback(FLAC__StreamDecoderErrorStatus) override {}
+
+private:
+    bool AtEnd();
+
+    const FilePath mFilename;
+    const unsigned mNumChannels;
+    const unsigned mBitsPerSample;
+    const sampleFormat mFormat;
+    const size_t mFrameBytes;
+    wxFFile mHandle;
+    //! Interleaved frames decoded but not yet read
+    std::vector<char> mPending;
+    size_t mPendingOffset{ 0 };
+};
+
 class FLACImportPlugin final : public ImportPlugin
 {
 public:
@@ -209,59 +248,137 @@ void MyFLACFile::error_callback(FLAC__StreamDecoderErrorStatus WXUNUSED(status))
     }*/
 }
 
-FLAC__StreamDecoderWriteStatus MyFLACFile::write_callback(const FLAC__Frame* frame,
+FLAC__StreamDecoderWriteStatus MyFLACFile::write_callback(const FLAC__Frame*,
+                                                          const FLAC__int32* const[])
+{
+    // Only the metadata are decoded with this; FLACReader decodes the audio
+    return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+}
+
+FLACReader::FLACReader(
+    const FilePath& filename, unsigned numChannels, unsigned bitsPerSample)
+    : mFilename{filename}
+    , mNumChannels{numChannels}
+    , mBitsPerSample{bitsPerSample}
+    , mFormat{ReadFormat(bitsPerSample)}
+    , mFrameBytes{numChannels * SAMPLE_SIZE(mFormat)}
+{
+    set_metadata_ignore_all();
+}
+
+sampleFormat FLACReader::ReadFormat(unsigned bitsPerSample)
+{
+    if (bitsPerSample <= 16) {
+        return int16Sample;
+    } else if (bitsPerSample <= 24) {
+        return int24Sample;
+    } else {
+        return floatSample;
+    }
+}
+
+bool FLACReader::Open()
+{
+#ifdef LEGACY_FLAC
+    if (!set_filename(OSINPUT(mFilename)) || init() != FLAC__FILE_DECODER_OK) {
+        return false;
+    }
+#else
+    if (!mHandle.Open(mFilename, wxT("rb"))) {
+        return false;
+    }
+    // As in FLACImportFileHandle::Init(); libflac closes the file
+    const auto result = init(mHandle.fp());
+    mHandle.Detach();
+    if (result != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
+        return false;
+    }
+#endif
+    return process_until_end_of_metadata();
+}
+
+bool FLACReader::AtEnd()
+{
+#ifdef LEGACY_FLAC
+    return get_state() == FLAC__FILE_DECODER_END_OF_FILE;
+#else
+    return get_state() == FLAC__STREAM_DECODER_END_OF_STREAM;
+#endif
+}
+
+void FLACReader::Seek(sampleCount frame)
+{
+    mPending.clear();
+    mPendingOffset = 0;
+    // libflac passes the frame containing the target to write_callback,
+    // starting at the target
+    if (!seek_absolute(frame.as_long_long())) {
+        throw FileException{ FileException::Cause::Read, mFilename };
+    }
+}
+
+size_t FLACReader::Read(samplePtr buffer, size_t frames)
+{
+    size_t done = 0;
+    while (true) {
+        const auto available = (mPending.size() - mPendingOffset) / mFrameBytes;
+        const auto toCopy = std::min(frames - done, available);
+        memcpy(buffer + done * mFrameBytes,
+               mPending.data() + mPendingOffset, toCopy * mFrameBytes);
+        mPendingOffset += toCopy * mFrameBytes;
+        done += toCopy;
+        if (mPendingOffset == mPending.size()) {
+            mPending.clear();
+            mPendingOffset = 0;
+        }
+        if (done == frames || AtEnd()) {
+            break;
+        }
+        if (!process_single()) {
+            if (AtEnd()) {
+                break;
+            }
+            throw FileException{ FileException::Cause::Read, mFilename };
+        }
+    }
+    return done;
+}
+
+FLAC__StreamDecoderWriteStatus FLACReader::write_callback(const FLAC__Frame* frame,
                                                           const FLAC__int32* const buffer[])
 {
     // Don't let C++ exceptions propagate through libflac
     return GuardedCall< FLAC__StreamDecoderWriteStatus >([&] {
-
-        unsigned chn = 0;
-        ImportUtils::ForEachChannel(*mFile->mTrack, [&](auto& channel)
-        {
-
-            if (frame->header.bits_per_sample == 8) {
-                auto tmp = ArrayOf< short > { frame->header.blocksize };
-                for (unsigned int s = 0; s < frame->header.blocksize; s++) {
-                    tmp[s] = buffer[chn][s] << 8;
+        const auto blocksize = frame->header.blocksize;
+        const auto offset = mPending.size();
+        mPending.resize(offset + blocksize * mFrameBytes);
+        const auto dest = mPending.data() + offset;
+
+        // Interleave, in the narrowest format that holds the samples
+        for (unsigned chn = 0; chn < mNumChannels; ++chn) {
+            const auto src = buffer[chn];
+            if (mBitsPerSample == 8) {
+                const auto samples = reinterpret_cast<short*>(dest) + chn;
+                for (unsigned s = 0; s < blocksize; s++) {
+                    samples[s * mNumChannels] = src[s] << 8;
+                }
+            } else if (mFormat == int16Sample) {
+                const auto samples = reinterpret_cast<short*>(dest) + chn;
+                for (unsigned s = 0; s < blocksize; s++) {
+                    samples[s * mNumChannels] = src[s];
+                }
+            } else if (mFormat == int24Sample) {
+                const auto samples = reinterpret_cast<int*>(dest) + chn;
+                for (unsigned s = 0; s < blocksize; s++) {
+                    samples[s * mNumChannels] = src[s];
                 }
-                channel.AppendBuffer((samplePtr)tmp.get(),
-                                     int16Sample,
-                                     frame->header.blocksize, 1,
-                                     int16Sample);
-            } else if (frame->header.bits_per_sample <= 16) {
-                channel.AppendBuffer((samplePtr)buffer[chn],
-                                     int16Sample,
-                                     frame->header.blocksize, 1,
-                                     int16Sample);
-            } else if (frame->header.bits_per_sample <= 24) {
-                channel.AppendBuffer((samplePtr)buffer[chn],
-                                     int24Sample,
-                                     frame->header.blocksize, 1,
-                                     int24Sample);
             } else {
-                auto tmp = ArrayOf< float > { frame->header.blocksize };
-                for (unsigned int s = 0; s < frame->header.blocksize; s++) {
-                    tmp[s] = static_cast<float>(buffer[chn][s]) / static_cast<float>(1<<(frame->header.bits_per_sample-1));
+                const auto samples = reinterpret_cast<float*>(dest) + chn;
+                for (unsigned s = 0; s < blocksize; s++) {
+                    samples[s * mNumChannels] = static_cast<float>(src[s]) / static_cast<float>(1 << (mBitsPerSample - 1));
                 }
-                channel.AppendBuffer((samplePtr)tmp.get(),
-                                     floatSample,
-                                     frame->header.blocksize, 1,
-                                     floatSample);
             }
-            ++chn;
-        });
-
-        mFile->mSamplesDone += frame->header.blocksize;
-
-        if (mFile->mNumSamples > 0) {
-            mImportProgressListener->OnImportProgress(static_cast<double>(mFile->mSamplesDone)
-                                                      / static_cast<double>(mFile->mNumSamples));
         }
-
-        if (mFile->IsCancelled() || mFile->IsStopped()) {
-            return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
-        }
-
         return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
     }, MakeSimpleGuard(FLAC__STREAM_DECODER_WRITE_STATUS_ABORT));
 }
@@ -399,21 +516,72 @@ void FLACImportFileHandle::Import(
 
     outTracks.clear();
 
-    auto cleanup = finally([&]{ mFile->mImportProgressListener = nullptr; });
-
     wxASSERT(mStreamInfoDone);
 
     mTrack = ImportUtils::NewWaveTrack(*trackFactory, mNumChannels, mFormat, mSampleRate);
 
-    mFile->mImportProgressListener = &progressListener;
+    auto pFirstReader = std::make_unique<FLACReader>(GetFilename(), mNumChannels, mBitsPerSample);
+    if (!pFirstReader->Open()) {
+        progressListener.OnImportResult(ImportProgressListener::ImportResult::Error);
+        return;
+    }
+
+    // Each chunk of the file becomes one block in each channel
+    const auto readFormat = FLACReader::ReadFormat(mBitsPerSample);
+    const auto maxBlock = mTrack->GetMaxBlockSize();
+    ImportPipeline::Options options;
+    options.numChannels = mNumChannels;
+    options.readFormat = readFormat;
+    options.storedFormat = mTrack->GetSampleFormat();
+    options.chunkFrames = maxBlock;
+    options.totalFrames = mNumSamples;
+    // Without the total in the header, read sequentially to the end
+    if (mNumSamples > 0) {
+        // Bound the decoding buffers of all threads together
+        constexpr size_t MaxBufferBytes = 64 * 1024 * 1024;
+        const auto chunkBytes = maxBlock * mNumChannels * SAMPLE_SIZE(readFormat);
+        options.numReaders = std::max<size_t>(1, std::min(
+                                                  ImportPipeline::DefaultNumReaders((mNumSamples + maxBlock - 1) / maxBlock),
+                                                  MaxBufferBytes / chunkBytes));
+    }
+
+    const auto readerFactory = [&]() -> std::unique_ptr<ImportPipeline::Reader> {
+        if (pFirstReader) {
+            return std::move(pFirstReader);
+        }
+        auto pReader = std::make_unique<FLACReader>(GetFilename(), mNumChannels, mBitsPerSample);
+        if (!pReader->Open()) {
+            return nullptr;
+        }
+        return pReader;
+    };
+
+    // Blocks are made directly from the split channels on the decoding
+    // threads, not accumulated in the append buffers of the track
+    const auto pFactory = trackFactory->GetSampleBlockFactory();
+    const auto storedFormat = options.storedFormat;
+    const auto builder = [&](unsigned, sampleCount, constSamplePtr samples, size_t frames) {
+        return pFactory->Create(samples, frames, storedFormat);
+    };
+
+    ImportPipeline pipeline{ readerFactory, builder, options };
+    pipeline.Run([&](const std::vector<std::shared_ptr<SampleBlock> >& blocks, size_t frames)
+    {
+        unsigned chn = 0;
+        ImportUtils::ForEachChannel(*mTrack, [&](auto& channel)
+        {
+            channel.AppendBlock(blocks[chn++], readFormat);
+        });
+
+        mSamplesDone += frames;
+
+        if (mNumSamples > 0) {
+            progressListener.OnImportProgress(static_cast<double>(mSamplesDone)
+                                              / static_cast<double>(mNumSamples));
+        }
 
-    // TODO: Vigilant Sentry: Variable res unused after assignment (error code DA1)
-    //    Should check the result.
-   #ifdef LEGACY_FLAC
-    bool res = (mFile->process_until_end_of_file() != 0);
-   #else
-    bool res = (mFile->process_until_end_of_stream() != 0);
-   #endif
+        return !IsCancelled() && !IsStopped();
+    });
 
     if (IsCancelled()) {
         progressListener.OnImportResult(ImportProgressListener::ImportResult::Cancelled);
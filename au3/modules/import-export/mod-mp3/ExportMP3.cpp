@@ -88,6 +88,7 @@
 #endif
 
 #include "libraries/lib-import-export/ExportOptionsEditor.h"
+#include "libraries/lib-import-export/ExportMixerPipeline.h"
 #include "libraries/lib-import-export/ExportPluginHelpers.h"
 #include "libraries/lib-import-export/ExportPluginRegistry.h"
 
@@ -1527,13 +1528,18 @@ ExportResult MP3ExportProcessor::Process(ExportProcessorDelegate& delegate)
     auto exportResult = ExportResult::Success;
 
     {
+        // Mix the next blocks while this one is encoded
+        ExportMixerPipeline pipeline{
+            *context.mixer, static_cast<unsigned>(context.channels), true,
+            floatSample };
+
         while (exportResult == ExportResult::Success) {
-            auto blockLen = context.mixer->Process();
+            auto blockLen = pipeline.Process();
             if (blockLen == 0) {
                 break;
             }
 
-            float* mixed = (float*)context.mixer->GetBuffer();
+            float* mixed = (float*)pipeline.GetBuffer();
 
             if ((int)blockLen < context.inSamples) {
                 if (context.channels > 1) {
@@ -1562,7 +1568,7 @@ ExportResult MP3ExportProcessor::Process(ExportProcessorDelegate& delegate)
 
             if (exportResult == ExportResult::Success) {
                 exportResult = ExportPluginHelpers::UpdateProgress(
-                    delegate, *context.mixer, context.t0, context.t1);
+                    delegate, pipeline, context.t0, context.t1);
             }
         }
     }
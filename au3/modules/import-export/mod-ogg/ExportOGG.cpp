@@ -19,6 +19,7 @@
 #include <vorbis/vorbisenc.h>
 
 #include "wxFileNameWrapper.h"
+#include "ExportMixerPipeline.h"
 #include "ExportPluginHelpers.h"
 #include "ExportPluginRegistry.h"
 #include "FileIO.h"
@@ -275,19 +276,23 @@ ExportResult OGGExportProcessor::Process(ExportProcessorDelegate& delegate)
     delegate.SetStatusString(context.status);
     auto exportResult = ExportResult::Success;
     {
+        // Mix the next blocks while this one is encoded
+        ExportMixerPipeline pipeline{
+            *context.mixer, context.numChannels, false, floatSample };
+
         int err;
         int eos = 0;
         while (exportResult == ExportResult::Success && !eos) {
             float** vorbis_buffer = vorbis_analysis_buffer(&context.dsp, SAMPLES_PER_RUN);
-            auto samplesThisRun = context.mixer->Process();
+            auto samplesThisRun = pipeline.Process();
 
             if (samplesThisRun == 0) {
                 // Tell the library that we wrote 0 bytes - signalling the end.
                 err = vorbis_analysis_wrote(&context.dsp, 0);
             } else {
                 for (size_t i = 0; i < context.numChannels; i++) {
-                    float* temp = (float*)context.mixer->GetBuffer(i);
-                    memcpy(vorbis_buffer[i], temp, sizeof(float) * SAMPLES_PER_RUN);
+                    float* temp = (float*)pipeline.GetBuffer(i);
+                    memcpy(vorbis_buffer[i], temp, sizeof(float) * samplesThisRun);
                 }
 
                 // tell the encoder how many samples we have
@@ -339,7 +344,7 @@ ExportResult OGGExportProcessor::Process(ExportProcessorDelegate& delegate)
                 throw ExportErrorException("OGG:355");
             }
             exportResult = ExportPluginHelpers::UpdateProgress(
-                delegate, *context.mixer, context.t0, context.t1);
+                delegate, pipeline, context.t0, context.t1);
         }
     }
 
@@ -27,6 +27,7 @@
 #include "Track.h"
 #include "Tags.h"
 
+#include "ExportMixerPipeline.h"
 #include "ExportPluginHelpers.h"
 #include "ExportOptionsEditor.h"
 #include "ExportPluginRegistry.h"
@@ -757,20 +758,24 @@ ExportResult OpusExportProcessor::Process(ExportProcessorDelegate& delegate)
 
     auto exportResult = ExportResult::Success;
 
+    // Mix the next blocks while this one is encoded
+    ExportMixerPipeline pipeline{
+        *context.mixer, context.numChannels, true, floatSample };
+
     int64_t granulePos = 0;
 
     int32_t latencyLeft = context.opus.preskip;
 
     while (exportResult == ExportResult::Success)
     {
-        auto samplesThisRun = context.mixer->Process();
+        auto samplesThisRun = pipeline.Process();
 
         if (samplesThisRun == 0) {
             break;
         }
 
         auto mixedAudioBuffer
-            =reinterpret_cast<const float*>(context.mixer->GetBuffer());
+            =reinterpret_cast<const float*>(pipeline.GetBuffer());
 
         // bestFrameSize <= context.opus.frameSize by design
         auto bestFrameSize = GetBestFrameSize(samplesThisRun);
@@ -828,7 +833,7 @@ ExportResult OpusExportProcessor::Process(ExportProcessorDelegate& delegate)
         context.ogg.audioStreamPacket.packet.packetno++;
 
         exportResult = ExportPluginHelpers::UpdateProgress(
-            delegate, *context.mixer, context.t0, context.t1);
+            delegate, pipeline, context.t0, context.t1);
     }
 
     // Flush the encoder
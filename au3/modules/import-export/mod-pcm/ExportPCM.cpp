@@ -27,6 +27,7 @@
 #include "libraries/lib-import-export/Export.h"
 #include "libraries/lib-import-export/ExportOptionsEditor.h"
 
+#include "libraries/lib-import-export/ExportMixerPipeline.h"
 #include "libraries/lib-import-export/ExportPluginHelpers.h"
 #include "libraries/lib-import-export/ExportPluginRegistry.h"
 
@@ -609,14 +610,19 @@ ExportResult PCMExportProcessor::Process(ExportProcessorDelegate& delegate)
             dither.reserve(maxBlockLen * context.info.channels * SAMPLE_SIZE(int24Sample));
         }
 
+        // Mix the next blocks while this one is written
+        ExportMixerPipeline pipeline{
+            *context.mixer, static_cast<unsigned>(context.info.channels), true,
+            context.format };
+
         while (exportResult == ExportResult::Success) {
             sf_count_t samplesWritten;
-            size_t numSamples = context.mixer->Process();
+            size_t numSamples = pipeline.Process();
             if (numSamples == 0) {
                 break;
             }
 
-            auto mixed = context.mixer->GetBuffer();
+            auto mixed = pipeline.GetBuffer();
 
             // Bug 1572: Not ideal, but it does add the desired dither
             if ((context.info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_24) {
@@ -668,7 +674,7 @@ ExportResult PCMExportProcessor::Process(ExportProcessorDelegate& delegate)
             }
             if (exportResult == ExportResult::Success) {
                 exportResult = ExportPluginHelpers::UpdateProgress(
-                    delegate, *context.mixer, context.t0, context.t1);
+                    delegate, pipeline, context.t0, context.t1);
             }
         }
     }
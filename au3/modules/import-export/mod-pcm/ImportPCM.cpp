@@ -33,12 +33,18 @@
 
 #include "libraries/lib-file-formats/FileFormats.h"
 #include "libraries/lib-import-export/GetAcidizerTags.h"
+#include "libraries/lib-import-export/ImportPipeline.h"
 #include "libraries/lib-import-export/ImportPlugin.h"
 #include "libraries/lib-import-export/ImportProgressListener.h"
 #include "libraries/lib-import-export/ImportUtils.h"
+#include "libraries/lib-import-export/LazyIngest.h"
+#include "FileException.h"
+#include "Prefs.h"
+#include "SampleBlock.h"
 #include "WaveTrack.h"
 
 #include <algorithm>
+#include <utility>
 
 #include "ImportPCM.h"
 
@@ -56,6 +62,143 @@ void id3_latin1_decode(id3_latin1_t const*, id3_ucs4_t*);
 
 #define DESC XO("WAV, AIFF, and other uncompressed types")
 
+namespace {
+SFFile OpenSFFile(const FilePath& filename, SF_INFO& info)
+{
+    wxFile f;  // will be closed when it goes out of scope
+    SFFile file;
+
+    memset(&info, 0, sizeof(info));
+
+    if (f.Open(filename)) {
+        // Even though there is an sf_open() that takes a filename, use the one that
+        // takes a file descriptor since wxWidgets can open a file with a Unicode name and
+        // libsndfile can't (under Windows).
+        file.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &info, TRUE));
+    }
+
+    // The file descriptor is now owned by "file", so we must tell "f" to leave
+    // it alone.  The file descriptor is closed by the destructor of file even if an error
+    // occurs.
+    f.Detach();
+
+    return file;
+}
+
+//! Open the file again, if it is still the one described by `expected`
+SFFile ReopenSFFile(const FilePath& filename, const SF_INFO& expected)
+{
+    SF_INFO info;
+    auto file = OpenSFFile(filename, info);
+    if (!file || info.frames != expected.frames
+        || info.channels != expected.channels || info.format != expected.format) {
+        return {};
+    }
+    return file;
+}
+
+//! Whether any frame can be found without decoding those before it, so that
+//! the file can be read from several positions at once
+bool IsRandomAccess(const SF_INFO& info)
+{
+    if (!info.seekable || info.frames <= 0) {
+        return false;
+    }
+    // FLAC has some of these subtypes too, and seeks with its seek table
+    switch (info.format & SF_FORMAT_SUBMASK) {
+    case SF_FORMAT_PCM_S8:
+    case SF_FORMAT_PCM_U8:
+    case SF_FORMAT_PCM_16:
+    case SF_FORMAT_PCM_24:
+    case SF_FORMAT_PCM_32:
+    case SF_FORMAT_FLOAT:
+    case SF_FORMAT_DOUBLE:
+    case SF_FORMAT_ULAW:
+    case SF_FORMAT_ALAW:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//! Reads from a libsndfile handle, which is used by no other thread
+class SFReader final : public ImportPipeline::Reader
+{
+public:
+    SFReader(const FilePath& filename, SNDFILE* file, sampleFormat format)
+        : mFilename{filename}, mFile{file}, mFormat{format}
+    {}
+
+    //! Takes ownership of the handle
+    SFReader(const FilePath& filename, SFFile&& file, sampleFormat format)
+        : SFReader{filename, file.get(), format}
+    {
+        mOwned = std::move(file);
+    }
+
+    void Seek(sampleCount frame) override
+    {
+        if (SFCall<sf_count_t>(sf_seek, mFile, frame.as_long_long(), SEEK_SET) < 0) {
+            throw FileException{ FileException::Cause::Read, mFilename };
+        }
+    }
+
+    size_t Read(samplePtr buffer, size_t frames) override
+    {
+        sf_count_t read;
+        if (mFormat == int16Sample) {
+            read = SFCall<sf_count_t>(sf_readf_short, mFile, (short*)buffer, frames);
+        }
+        //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
+        else {
+            read = SFCall<sf_count_t>(sf_readf_float, mFile, (float*)buffer, frames);
+        }
+        if (read < 0 || read > (sf_count_t)frames) {
+            wxASSERT(false);
+            read = frames;
+        }
+        return read;
+    }
+
+private:
+    const FilePath mFilename;
+    SNDFILE* const mFile;
+    const sampleFormat mFormat;
+    SFFile mOwned;
+};
+
+//! The first reader takes the file already open, the others open it again
+ImportPipeline::ReaderFactory LazyReaderFactory(
+    const FilePath& filename, SFFile file, const SF_INFO& info, sampleFormat readFormat)
+{
+    auto pFile = std::make_shared<SFFile>(std::move(file));
+    return [filename, pFile, info, readFormat]() -> std::unique_ptr<ImportPipeline::Reader> {
+        auto file = *pFile ? std::move(*pFile) : ReopenSFFile(filename, info);
+        if (!file) {
+            return nullptr;
+        }
+        return std::make_unique<SFReader>(filename, std::move(file), readFormat);
+    };
+}
+
+//! Reopens files for blocks of a recovered project that were not yet copied
+//! into it
+LazyIngest::SourceFactory::Scope sLazySourceFactory {
+    [](const FilePath& filename, sampleFormat format) -> std::shared_ptr<LazyIngest::Source> {
+        SF_INFO info;
+        auto file = OpenSFFile(filename, info);
+        if (!file || !IsRandomAccess(info)) {
+            return nullptr;
+        }
+        // As at the import, which stored the blocks in this format
+        const auto readFormat = (format == int16Sample) ? int16Sample : floatSample;
+        return std::make_shared<LazyIngest::Source>(
+            filename, LazyReaderFactory(filename, std::move(file), info, readFormat),
+            info.channels, readFormat);
+    }
+};
+}
+
 PCMImportPlugin::PCMImportPlugin()
     :  ImportPlugin(sf_get_all_extensions())
 {
@@ -91,10 +234,6 @@ std::unique_ptr<ImportFileHandle> PCMImportPlugin::Open(
     const FilePath& filename, AudacityProject*)
 {
     SF_INFO info;
-    wxFile f;  // will be closed when it goes out of scope
-    SFFile file;
-
-    memset(&info, 0, sizeof(info));
 
 #ifdef __WXGTK__
     if (filename.Lower().EndsWith(wxT("mp3"))) {
@@ -112,17 +251,7 @@ std::unique_ptr<ImportFileHandle> PCMImportPlugin::Open(
     }
 #endif
 
-    if (f.Open(filename)) {
-        // Even though there is an sf_open() that takes a filename, use the one that
-        // takes a file descriptor since wxWidgets can open a file with a Unicode name and
-        // libsndfile can't (under Windows).
-        file.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_READ, &info, TRUE));
-    }
-
-    // The file descriptor is now owned by "file", so we must tell "f" to leave
-    // it alone.  The file descriptor is closed by the destructor of file even if an error
-    // occurs.
-    f.Detach();
+    auto file = OpenSFFile(filename, info);
 
     if (!file) {
         // TODO: Handle error
@@ -293,66 +422,84 @@ void PCMImportFileHandle::Import(
             return;
         }
 
-        SampleBuffer srcbuffer, buffer;
-        wxASSERT(mInfo.channels >= 0);
-        while (NULL == srcbuffer.Allocate(maxBlock * mInfo.channels, mFormat).ptr()
-               || NULL == buffer.Allocate(maxBlock, mFormat).ptr())
-        {
-            maxBlock /= 2;
-            if (maxBlock < 1) {
-                progressListener.OnImportResult(ImportProgressListener::ImportResult::Error);
-                return;
-            }
-        }
-
-        decltype(fileTotalFrames) framescompleted = 0;
+        const auto readFormat = (mFormat == int16Sample) ? int16Sample : floatSample;
 
-        long block;
-        do {
-            block = maxBlock;
-
-            if (mFormat == int16Sample) {
-                block = SFCall<sf_count_t>(sf_readf_short, mFile.get(), (short*)srcbuffer.ptr(), block);
+        const auto pFactory = trackFactory->GetSampleBlockFactory();
+        SFFile lazyFile;
+        if (IsRandomAccess(mInfo) && LazyImport.Read()) {
+            lazyFile = ReopenSFFile(GetFilename(), mInfo);
+        }
+        if (lazyFile) {
+            // Make the tracks now; until a background thread copies the file
+            // into the project, they read from it
+            const auto pSource = std::make_shared<LazyIngest::Source>(
+                GetFilename(),
+                LazyReaderFactory(GetFilename(), std::move(lazyFile), mInfo, readFormat),
+                mInfo.channels, readFormat);
+            auto& lazyIngest = LazyIngest::Get();
+            for (sampleCount start = 0; start < fileTotalFrames; start += maxBlock) {
+                const auto frames = limitSampleBufferSize(maxBlock, fileTotalFrames - start);
+                const auto blocks = lazyIngest.MakeBlocks(pSource, pFactory, format, start, frames);
+                unsigned c = 0;
+                ImportUtils::ForEachChannel(*trackList, [&](auto& channel)
+                {
+                    channel.AppendBlock(blocks[c++], mEffectiveFormat);
+                });
             }
-            //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
-            else {
-                block = SFCall<sf_count_t>(sf_readf_float, mFile.get(), (float*)srcbuffer.ptr(), block);
+        } else {
+            // Each chunk of the file becomes one block in each channel
+            ImportPipeline::Options options;
+            options.numChannels = mInfo.channels;
+            options.readFormat = readFormat;
+            options.storedFormat = format;
+            options.chunkFrames = maxBlock;
+            options.totalFrames = fileTotalFrames;
+            if (IsRandomAccess(mInfo)) {
+                // Bound the decoding buffers of all threads together
+                constexpr size_t MaxBufferBytes = 64 * 1024 * 1024;
+                const auto chunkBytes = maxBlock * mInfo.channels * SAMPLE_SIZE(readFormat);
+                options.numReaders = std::max<size_t>(1, std::min(
+                                                          ImportPipeline::DefaultNumReaders((fileTotalFrames + maxBlock - 1) / maxBlock),
+                                                          MaxBufferBytes / chunkBytes));
             }
 
-            if (block < 0 || block > (long)maxBlock) {
-                wxASSERT(false);
-                block = maxBlock;
-            }
+            // The first reader uses the file already open, the others open it
+            // again
+            bool first = true;
+            const auto readerFactory = [&]() -> std::unique_ptr<ImportPipeline::Reader> {
+                if (std::exchange(first, false)) {
+                    return std::make_unique<SFReader>(GetFilename(), mFile.get(), readFormat);
+                }
+                auto file = ReopenSFFile(GetFilename(), mInfo);
+                if (!file) {
+                    return nullptr;
+                }
+                return std::make_unique<SFReader>(GetFilename(), std::move(file), readFormat);
+            };
 
-            if (block) {
+            // Blocks are made directly from the split channels on the decoding
+            // threads, not accumulated in the append buffers of the tracks
+            const auto builder = [&](unsigned, sampleCount, constSamplePtr samples, size_t frames) {
+                return pFactory->Create(samples, frames, format);
+            };
+
+            decltype(fileTotalFrames) framescompleted = 0;
+
+            ImportPipeline pipeline{ readerFactory, builder, options };
+            pipeline.Run([&](const std::vector<std::shared_ptr<SampleBlock> >& blocks, size_t frames)
+            {
                 unsigned c = 0;
                 ImportUtils::ForEachChannel(*trackList, [&](auto& channel)
                 {
-                    if (mFormat == int16Sample) {
-                        for (int j=0; j < block; j++) {
-                            ((short*)buffer.ptr())[j]
-                                =((short*)srcbuffer.ptr())[mInfo.channels * j + c];
-                        }
-                    } else {
-                        for (int j=0; j < block; j++) {
-                            ((float*)buffer.ptr())[j]
-                                =((float*)srcbuffer.ptr())[mInfo.channels * j + c];
-                        }
-                    }
-
-                    channel.AppendBuffer(
-                        buffer.ptr(),
-                        (mFormat == int16Sample) ? int16Sample : floatSample,
-                        block, 1, mEffectiveFormat
-                        );
-                    ++c;
+                    channel.AppendBlock(blocks[c++], mEffectiveFormat);
                 });
-                framescompleted += block;
-            }
-            if (fileTotalFrames > 0) {
-                progressListener.OnImportProgress(framescompleted.as_double() / fileTotalFrames.as_double());
-            }
-        } while (block > 0 && !IsCancelled() && !IsStopped());
+                framescompleted += frames;
+                if (fileTotalFrames > 0) {
+                    progressListener.OnImportProgress(framescompleted.as_double() / fileTotalFrames.as_double());
+                }
+                return !IsCancelled() && !IsStopped();
+            });
+        }
     }
 
     if (IsCancelled()) {
@@ -23,6 +23,7 @@
 #include "Track.h"
 #include "libraries/lib-tags/Tags.h"
 
+#include "libraries/lib-import-export/ExportMixerPipeline.h"
 #include "libraries/lib-import-export/ExportPluginHelpers.h"
 #include "libraries/lib-import-export/ExportOptionsEditor.h"
 #include "libraries/lib-import-export/ExportPluginRegistry.h"
@@ -354,22 +355,26 @@ ExportResult WavPackExportProcessor::Process(ExportProcessorDelegate& delegate)
 
     auto exportResult = ExportResult::Success;
     {
+        // Mix the next blocks while this one is encoded
+        ExportMixerPipeline pipeline{
+            *context.mixer, context.numChannels, true, context.format };
+
         while (exportResult == ExportResult::Success) {
-            auto samplesThisRun = context.mixer->Process();
+            auto samplesThisRun = pipeline.Process();
 
             if (samplesThisRun == 0) {
                 break;
             }
 
             if (context.format == int16Sample) {
-                const int16_t* mixed = reinterpret_cast<const int16_t*>(context.mixer->GetBuffer());
+                const int16_t* mixed = reinterpret_cast<const int16_t*>(pipeline.GetBuffer());
                 for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
                     for (size_t i = 0; i < context.numChannels; i++) {
                         wavpackBuffer[j * context.numChannels + i] = (static_cast<int32_t>(*mixed++) * 65536) >> 16;
                     }
                 }
             } else {
-                const int* mixed = reinterpret_cast<const int*>(context.mixer->GetBuffer());
+                const int* mixed = reinterpret_cast<const int*>(pipeline.GetBuffer());
                 for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
                     for (size_t i = 0; i < context.numChannels; i++) {
                         wavpackBuffer[j * context.numChannels + i] = *mixed++;
@@ -381,7 +386,7 @@ ExportResult WavPackExportProcessor::Process(ExportProcessorDelegate& delegate)
                 throw ExportErrorException(WavpackGetErrorMessage(context.wpc));
             }
             exportResult = ExportPluginHelpers::UpdateProgress(
-                delegate, *context.mixer, context.t0, context.t1);
+                delegate, pipeline, context.t0, context.t1);
         }
     }
 
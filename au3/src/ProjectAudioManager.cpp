@@ -125,6 +125,9 @@ public:
     bool RepositionPlayback(
         PlaybackSchedule& schedule, const Mixers& playbackMixers, size_t frames, size_t available) override;
 
+    Intervals PrefetchIntervals(
+        PlaybackSchedule& schedule, double trackTime, Duration lookahead) override;
+
 private:
     double GapStart() const
     { return mReversed ? mGapLeft + mGapLength : mGapLeft; }
@@ -295,6 +298,37 @@ bool CutPreviewPlaybackPolicy::RepositionPlayback(PlaybackSchedule&,
     }
     return true;
 }
+
+auto CutPreviewPlaybackPolicy::PrefetchIntervals(PlaybackSchedule& schedule,
+                                                 double trackTime, Duration lookahead) -> Intervals
+{
+    Intervals result;
+    auto remaining = lookahead.count();
+    // Cover the remaining real time from the given track time, up to a limit
+    const auto cover = [&](double from, double limit) {
+        auto to = schedule.SolveWarpedLength(from, mReversed ? -remaining : remaining);
+        if (AtOrBefore(limit, to)) {
+            remaining = std::max(0.0,
+                                 remaining - fabs(schedule.ComputeWarpedLength(from, limit)));
+            to = limit;
+        } else {
+            remaining = 0;
+        }
+        if (from != to) {
+            result.emplace_back(std::min(from, to), std::max(from, to));
+        }
+    };
+
+    // Skip the samples that are not heard
+    if (AtOrBefore(trackTime, GapStart()) && AtOrBefore(GapStart(), mEnd)) {
+        cover(trackTime, GapStart());
+        trackTime = GapEnd();
+    }
+    if (remaining > 0 && AtOrBefore(trackTime, mEnd)) {
+        cover(trackTime, mEnd);
+    }
+    return result;
+}
 }
 
 int ProjectAudioManager::PlayPlayRegion(const SelectedRegion& selectedRegion,
@@ -456,6 +456,31 @@ bool ScrubbingPlaybackPolicy::RepositionPlayback(
     return false;
 }
 
+auto ScrubbingPlaybackPolicy::PrefetchIntervals(
+    PlaybackSchedule&, double trackTime, Duration lookahead) -> Intervals
+{
+    // The rest of the current scrub interval comes first; after that the
+    // mouse may go either way
+    const auto endTime = mEndSample.as_double() / mRate;
+    const auto reach = lookahead.count() * std::max(1.0, fabs(mScrubSpeed));
+    auto minTime = std::max(0.0, trackTime - reach);
+    auto maxTime = trackTime + reach;
+    if (mOptions.minTime < mOptions.maxTime) {
+        minTime = std::max(minTime, mOptions.minTime);
+        maxTime = std::min(maxTime, mOptions.maxTime);
+    }
+    Intervals result;
+    const auto t0 = std::max(minTime, std::min(trackTime, endTime));
+    const auto t1 = std::min(maxTime, std::max(trackTime, endTime));
+    if (t0 < t1) {
+        result.emplace_back(t0, t1);
+    }
+    if (minTime < maxTime) {
+        result.emplace_back(minTime, maxTime);
+    }
+    return result;
+}
+
 void ScrubState::UpdateScrub
     (double endTimeOrSpeed, const ScrubbingOptions& options)
 {
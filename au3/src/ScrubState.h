@@ -73,6 +73,9 @@ public:
     bool RepositionPlayback(
         PlaybackSchedule& schedule, const Mixers& playbackMixers, size_t frames, size_t available) override;
 
+    Intervals PrefetchIntervals(
+        PlaybackSchedule& schedule, double trackTime, Duration lookahead) override;
+
 private:
     sampleCount mScrubDuration{ 0 }, mStartSample{ 0 }, mEndSample{ 0 };
     double mOldEndTime{ 0 }, mNewStartTime{ 0 };
@@ -18,6 +18,7 @@
 #include "ProjectHistory.h"
 #include "SpectralDataManager.h"
 #include "WaveTrack.h"
+#include "concurrency/ThreadPool.h"
 
 SpectralDataManager::SpectralDataManager() = default;
 
@@ -58,6 +59,9 @@ bool SpectralDataManager::ProcessTracks(AudacityProject& project)
     auto& tracks = TrackList::Get(project);
     int applyCount = 0;
     Setting setting;
+    // One pool shares out the FFTs of each channel in turn
+    audacity::concurrency::ThreadPool pool{
+        audacity::concurrency::ThreadPool::DefaultNumWorkers() };
     for (auto wt : tracks.Any<WaveTrack>()) {
         using Type = long long;
         Type startSample{ std::numeric_limits<Type>::max() };
@@ -85,6 +89,9 @@ bool SpectralDataManager::ProcessTracks(AudacityProject& project)
         long long processed{};
         for (auto pChannel : wt->Channels()) {
             Worker worker{ (*iter++).get(), setting };
+            // Processor still sees windows in order; only the FFTs are shared
+            // out
+            worker.SetBatching(SpectrumTransformer::DefaultBatchSize, &pool);
             auto& view = ChannelView::Get(*pChannel);
 
             if (auto waveChannelViewPtr = dynamic_cast<WaveChannelView*>(&view)) {
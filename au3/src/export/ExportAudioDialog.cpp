@@ -875,9 +875,10 @@ ExportResult ExportAudioDialog::DoExportSplitByLabels(const ExportPlugin& plugin
                                                       const ExportProcessor::Parameters& parameters,
                                                       FilePaths& exporterFiles)
 {
-    auto ok = ExportResult::Success;  // did it work?
-    /* Go round again and do the exporting (so this run is slow but
-     * non-interactive) */
+    ExportBatch batch;
+    // Reserved, so that the jobs may keep references to the elements
+    std::vector<wxString> fullPaths;
+    fullPaths.reserve(mExportSettings.size());
     for (auto& activeSetting : mExportSettings) {
         /* get the settings to use for the export from the array */
         // Bug 1440 fix.
@@ -885,26 +886,14 @@ ExportResult ExportAudioDialog::DoExportSplitByLabels(const ExportPlugin& plugin
             continue;
         }
 
-        // Export it
-        ok = DoExport(plugin, formatIndex, parameters, activeSetting.filename, activeSetting.channels,
-                      activeSetting.t0, activeSetting.t1, false, activeSetting.tags, exporterFiles);
-
-        if (ok == ExportResult::Stopped) {
-            AudacityMessageDialog dlgMessage(
-                nullptr,
-                XO("Continue to export remaining files?"),
-                XO("Export"),
-                wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
-            if (dlgMessage.ShowModal() != wxID_YES) {
-                // User decided not to continue - bail out!
-                break;
-            }
-        } else if (ok != ExportResult::Success) {
-            break;
-        }
+        fullPaths.emplace_back();
+        // All tracks are read, in the range of the label
+        batch.Add(MakeExportJob(plugin, formatIndex, parameters, activeSetting.filename, activeSetting.channels,
+                                activeSetting.t0, activeSetting.t1, false, activeSetting.tags, fullPaths.back()),
+                  std::to_string(activeSetting.t0) + "-" + std::to_string(activeSetting.t1));
     }
 
-    return ok;
+    return DoExportBatch(batch, fullPaths, exporterFiles);
 }
 
 ExportResult ExportAudioDialog::DoExportSplitByTracks(const ExportPlugin& plugin,
@@ -922,130 +911,146 @@ ExportResult ExportAudioDialog::DoExportSplitByTracks(const ExportPlugin& plugin
 
     auto& selectionState = SelectionState::Get(mProject);
 
-    /* Remember which tracks were selected, and set them to deselected */
-    SelectionStateChanger changer{ selectionState, tracks };
-    for (auto tr : tracks.Selected<WaveTrack>()) {
-        tr->SetSelected(false);
-    }
-
-    auto ok = ExportResult::Success;
+    ExportBatch batch;
+    // Reserved, so that the jobs may keep references to the elements
+    std::vector<wxString> fullPaths;
+    fullPaths.reserve(mExportSettings.size());
 
     int count = 0;
     for (auto tr : waveTracks) {
         wxLogDebug("Get setting %i", count);
         /* get the settings to use for the export from the array */
-        auto& activeSetting = mExportSettings[count];
+        auto& activeSetting = mExportSettings[count++];
         if (activeSetting.filename.GetName().empty()) {
-            count++;
             continue;
         }
 
-        /* Select the track */
-        SelectionStateChanger changer2{ selectionState, tracks };
-        tr->SetSelected(true);
-
         // Export the data. "channels" are per track.
-        ok = DoExport(plugin, formatIndex, parameters, activeSetting.filename, activeSetting.channels,
-                      activeSetting.t0, activeSetting.t1, true, activeSetting.tags, exporterFiles);
-
-        if (ok == ExportResult::Stopped) {
-            AudacityMessageDialog dlgMessage(
-                nullptr,
-                XO("Continue to export remaining files?"),
-                XO("Export"),
-                wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
-            if (dlgMessage.ShowModal() != wxID_YES) {
-                // User decided not to continue - bail out!
-                break;
+        fullPaths.emplace_back();
+        auto job = MakeExportJob(plugin, formatIndex, parameters, activeSetting.filename, activeSetting.channels,
+                                 activeSetting.t0, activeSetting.t1, true, activeSetting.tags, fullPaths.back());
+        batch.Add([&tracks, &selectionState, tr, job = std::move(job)]
+        {
+            // The mixer takes the selected tracks when the task is built;
+            // then the selection is restored
+            SelectionStateChanger changer{ selectionState, tracks };
+            for (auto other : tracks.Selected<WaveTrack>()) {
+                other->SetSelected(false);
             }
-        } else if (ok != ExportResult::Success) {
-            break;
-        }
-        // increment export counter
-        count++;
+            tr->SetSelected(true);
+            return job();
+        }, std::to_string(static_cast<int64_t>(tr->GetId())));
     }
 
-    return ok;
+    return DoExportBatch(batch, fullPaths, exporterFiles);
 }
 
-ExportResult ExportAudioDialog::DoExport(const ExportPlugin& plugin,
-                                         int formatIndex,
-                                         const ExportProcessor::Parameters& parameters,
-                                         const wxFileName& filename,
-                                         int channels,
-                                         double t0, double t1, bool selectedOnly,
-                                         const Tags& tags,
-                                         FilePaths& exportedFiles)
+ExportBatch::Factory ExportAudioDialog::MakeExportJob(const ExportPlugin& plugin,
+                                                      int formatIndex,
+                                                      const ExportProcessor::Parameters& parameters,
+                                                      const wxFileName& filename,
+                                                      int channels,
+                                                      double t0, double t1, bool selectedOnly,
+                                                      const Tags& tags,
+                                                      wxString& fullPath)
 {
-    wxFileName name;
+    return [this, &plugin, formatIndex, &parameters, filename, channels, t0, t1, selectedOnly, &tags, &fullPath,
+            overwrite = mOverwriteExisting->GetValue(),
+            sampleRate = mExportOptionsPanel->GetSampleRate()]() -> ExportTask
+    {
+        wxFileName name;
 
-    wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (filename.GetFullName()));
-    wxLogDebug(wxT("Channels: %i, Start: %lf, End: %lf "), channels, t0, t1);
-    if (selectedOnly) {
-        wxLogDebug(wxT("Selected Region Only"));
-    } else {
-        wxLogDebug(wxT("Whole Project"));
-    }
+        wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (filename.GetFullName()));
+        wxLogDebug(wxT("Channels: %i, Start: %lf, End: %lf "), channels, t0, t1);
+        if (selectedOnly) {
+            wxLogDebug(wxT("Selected Region Only"));
+        } else {
+            wxLogDebug(wxT("Whole Project"));
+        }
 
-    wxFileName backup;
-    if (mOverwriteExisting->GetValue()) {
-        name = filename;
-        backup.Assign(name);
-
-        int suffix = 0;
-        do {
-            backup.SetName(name.GetName()
-                           + wxString::Format(wxT("%d"), suffix));
-            ++suffix;
-        }while (backup.FileExists());
-        ::wxRenameFile(filename.GetFullPath(), backup.GetFullPath());
-    } else {
-        name = filename;
-        int i = 2;
-        wxString base(name.GetName());
-        while (name.FileExists()) {
-            name.SetName(wxString::Format(wxT("%s-%d"), base, i++));
+        wxFileName backup;
+        if (overwrite) {
+            name = filename;
+            backup.Assign(name);
+
+            int suffix = 0;
+            do {
+                backup.SetName(name.GetName()
+                               + wxString::Format(wxT("%d"), suffix));
+                ++suffix;
+            }while (backup.FileExists());
+            ::wxRenameFile(filename.GetFullPath(), backup.GetFullPath());
+        } else {
+            name = filename;
+            int i = 2;
+            wxString base(name.GetName());
+            while (name.FileExists()) {
+                name.SetName(wxString::Format(wxT("%s-%d"), base, i++));
+            }
         }
-    }
 
-    bool success{ false };
-    const wxString fullPath{ name.GetFullPath() };
+        fullPath = name.GetFullPath();
 
-    auto cleanup = finally([&] {
-        if (backup.IsOk()) {
-            if (success) {
-                // Remove backup
-                ::wxRemoveFile(backup.GetFullPath());
+        auto cleanup = [backup, fullPath = fullPath](bool success) {
+            if (backup.IsOk()) {
+                if (success) {
+                    // Remove backup
+                    ::wxRemoveFile(backup.GetFullPath());
+                } else {
+                    // Restore original
+                    ::wxRemoveFile(fullPath);
+                    ::wxRenameFile(backup.GetFullPath(), fullPath);
+                }
             } else {
-                // Restore original
-                ::wxRemoveFile(fullPath);
-                ::wxRenameFile(backup.GetFullPath(), fullPath);
-            }
-        } else {
-            if (!success) {
-                // Remove any new, and only partially written, file.
-                ::wxRemoveFile(fullPath);
+                if (!success) {
+                    // Remove any new, and only partially written, file.
+                    ::wxRemoveFile(fullPath);
+                }
             }
+        };
+
+        ExportTask task;
+        try {
+            task = ExportTaskBuilder {}.SetPlugin(&plugin, formatIndex)
+                   .SetParameters(parameters)
+                   .SetRange(t0, t1, selectedOnly)
+                   .SetTags(&tags)
+                   .SetNumChannels(channels)
+                   .SetFileName(fullPath)
+                   .SetSampleRate(sampleRate)
+                   .Build(mProject);
+        }
+        catch (...) {
+            cleanup(false);
+            throw;
         }
-    });
 
-    auto result = ExportResult::Error;
-    ExportProgressUI::ExceptionWrappedCall([&]
-    {
-        result = ExportProgressUI::Show(ExportTaskBuilder {}.SetPlugin(&plugin, formatIndex)
-                                        .SetParameters(parameters)
-                                        .SetRange(t0, t1, selectedOnly)
-                                        .SetTags(&tags)
-                                        .SetNumChannels(channels)
-                                        .SetFileName(fullPath)
-                                        .SetSampleRate(mExportOptionsPanel->GetSampleRate())
-                                        .Build(mProject));
-    });
+        return ExportTask([task = std::move(task), cleanup](ExportProcessorDelegate& delegate) mutable
+        {
+            auto result = ExportResult::Error;
+            auto finish = finally([&] {
+                cleanup(result == ExportResult::Success || result == ExportResult::Stopped);
+            });
+            auto future = task.get_future();
+            task(delegate);
+            result = future.get();
+            return result;
+        });
+    };
+}
 
-    success = result == ExportResult::Success || result == ExportResult::Stopped;
+ExportResult ExportAudioDialog::DoExportBatch(ExportBatch& batch,
+                                              const std::vector<wxString>& fullPaths,
+                                              FilePaths& exportedFiles)
+{
+    const auto result = ExportProgressUI::Show(batch);
 
-    if (success) {
-        exportedFiles.push_back(fullPath);
+    for (size_t ii = 0; ii < batch.GetJobCount(); ++ii) {
+        const auto& outcome = batch.GetOutcome(ii);
+        if (outcome.result == ExportResult::Success
+            || outcome.result == ExportResult::Stopped) {
+            exportedFiles.push_back(fullPaths[ii]);
+        }
     }
 
     return result;
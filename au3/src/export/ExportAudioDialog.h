@@ -11,6 +11,7 @@
 #pragma once
 
 #include "wxPanelWrapper.h"
+#include "ExportBatch.h"
 #include "ExportTypes.h"
 #include <wx/filename.h>
 
@@ -94,9 +95,13 @@ private:
     ExportResult DoExportSplitByTracks(const ExportPlugin& plugin, int formatIndex, const ExportProcessor::Parameters& parameters,
                                        FilePaths& exporterFiles);
 
-    ExportResult DoExport(const ExportPlugin& plugin, int formatIndex, const ExportProcessor::Parameters& parameters,
-                          const wxFileName& filename, int channels, double t0, double t1, bool selectedOnly, const Tags& tags,
-                          FilePaths& exportedFiles);
+    //! Makes a job that chooses the file name, and stores it in `fullPath`, when it starts
+    ExportBatch::Factory MakeExportJob(const ExportPlugin& plugin, int formatIndex, const ExportProcessor::Parameters& parameters,
+                                       const wxFileName& filename, int channels, double t0, double t1, bool selectedOnly,
+                                       const Tags& tags, wxString& fullPath);
+
+    //! Runs the jobs, and collects the names of files exported by jobs that succeeded or were stopped
+    ExportResult DoExportBatch(ExportBatch& batch, const std::vector<wxString>& fullPaths, FilePaths& exportedFiles);
 
     AudacityProject& mProject;
 
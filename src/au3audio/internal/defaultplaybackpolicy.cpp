@@ -272,6 +272,31 @@ bool DefaultPlaybackPolicy::RepositionPlayback(
     return false;
 }
 
+PlaybackPolicy::Intervals DefaultPlaybackPolicy::PrefetchIntervals(
+    PlaybackSchedule& schedule, double trackTime, Duration lookahead)
+{
+    // This executes in the SequenceBufferExchange thread
+    lookahead *= mLastPlaySpeed;
+    if (RevertToOldDefault(schedule)) {
+        return PlaybackPolicy::PrefetchIntervals(schedule, trackTime, lookahead);
+    }
+
+    // Cover the rest of the loop, then its start again
+    Intervals result;
+    auto remaining = lookahead.count();
+    auto time = std::min(trackTime, schedule.mT1);
+    for (auto pass = 0; pass < 2 && remaining > 0; ++pass) {
+        const auto end = std::min(schedule.mT1,
+                                  schedule.SolveWarpedLength(time, remaining));
+        if (time < end) {
+            result.emplace_back(time, end);
+            remaining -= schedule.ComputeWarpedLength(time, end);
+        }
+        time = schedule.mT0;
+    }
+    return result;
+}
+
 bool DefaultPlaybackPolicy::Looping(const PlaybackSchedule&) const
 {
     return mLoopEnabled;
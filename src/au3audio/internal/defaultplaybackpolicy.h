@@ -37,6 +37,9 @@ public:
     bool RepositionPlayback(
         PlaybackSchedule& schedule, const Mixers& playbackMixers, size_t frames, size_t available) override;
 
+    Intervals PrefetchIntervals(
+        PlaybackSchedule& schedule, double trackTime, Duration lookahead) override;
+
     bool Looping(const PlaybackSchedule&) const override;
 
 private:
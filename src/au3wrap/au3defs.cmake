@@ -59,6 +59,7 @@ set(AU3_DEF
     -DTIME_FREQUENCY_SELECTION_API=
     -DSCREEN_GEOMETRY_API=
     -DSQLITE_HELPERS_API=
+    -DCONCURRENCY_API=
 
     -DGRAPHICS_API=
     -DWAVE_TRACK_PAINT_API=
@@ -156,6 +157,7 @@ set(AU3_INCLUDE
 
     # compile lib-audio-io
     ${AU3_LIBRARIES}/lib-audio-io
+    ${AU3_LIBRARIES}/lib-concurrency
     ${AU3_LIBRARIES}/lib-realtime-effects
     ${AU3_LIBRARIES}/lib-module-manager
 
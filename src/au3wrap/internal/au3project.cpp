@@ -12,6 +12,7 @@
 #include "libraries/lib-import-export/Import.h"
 #include "libraries/lib-import-export/ImportPlugin.h"
 #include "libraries/lib-import-export/ImportProgressListener.h"
+#include "libraries/lib-import-export/LazyIngest.h"
 #include "libraries/lib-numeric-formats/ProjectTimeSignature.h"
 #include "libraries/lib-project-file-io/ProjectFileIO.h"
 #include "libraries/lib-project/Project.h"
@@ -172,6 +173,12 @@ bool Au3ProjectAccessor::save(const muse::io::path_t& filePath)
 {
     auto& project = m_data->projectRef();
 
+    // The saved project must not depend on imported files
+    if (!LazyIngest::Get().Finish(*WaveTrackFactory::Get(project).GetSampleBlockFactory())) {
+        LOGE() << "some imported audio could not be copied into the project";
+        return false;
+    }
+
     auto& projectFileIO = ProjectFileIO::Get(project);
     auto result = projectFileIO.SaveProject(wxFromString(filePath.toString()), m_lastSavedTracks.get());
     if (result) {
@@ -208,6 +215,10 @@ void Au3ProjectAccessor::close()
 {
     auto& project = m_data->projectRef();
 
+    // Copy no more imported audio into the project; blocks not yet copied
+    // go away with the tracks
+    LazyIngest::Get().Cancel(*WaveTrackFactory::Get(project).GetSampleBlockFactory());
+
     //! ============================================================================
     //! NOTE Step 1 - Go back to the last saved state if needed
     //! ============================================================================
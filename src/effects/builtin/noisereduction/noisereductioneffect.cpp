@@ -45,6 +45,7 @@
 #include "libraries/lib-wave-track-fft/TrackSpectrumTransformer.h"
 #include "libraries/lib-wave-track/WaveTrack.h"
 #include "libraries/lib-command-parameters/ShuttleAutomation.h"
+#include "libraries/lib-concurrency/concurrency/ThreadPool.h"
 #include <algorithm>
 #include <cmath>
 
@@ -364,6 +365,9 @@ bool NoiseReductionEffect::Worker::Process(
     TrackList& tracks, double inT0, double inT1, std::string& error)
 {
     mProgressTrackCount = 0;
+    // One pool shares out the FFTs of each channel in turn
+    audacity::concurrency::ThreadPool pool{
+        audacity::concurrency::ThreadPool::DefaultNumWorkers() };
     for (auto track : tracks.Selected<WaveTrack>()) {
         mProgressWindowCount = 0;
         if (track->GetRate() != mStatistics.mRate) {
@@ -418,6 +422,10 @@ bool NoiseReductionEffect::Worker::Process(
                                             mSettings.StepsPerWindow(),
                                             !mSettings.mDoProfile,
                                             !mSettings.mDoProfile };
+                // The processor still sees the windows one at a time and in
+                // order; only the FFTs are shared out
+                transformer.SetBatching(
+                    SpectrumTransformer::DefaultBatchSize, &pool);
                 if (!transformer.Process(
                         Processor, *pChannel, mHistoryLen, start, len)) {
                     return false;
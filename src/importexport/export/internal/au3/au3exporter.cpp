@@ -5,9 +5,12 @@
 #include "au3exporter.h"
 
 #include "libraries/lib-basic-ui/BasicUI.h"
+#include "libraries/lib-import-export/ExportBatch.h"
 #include "libraries/lib-import-export/ExportPluginRegistry.h"
 #include "libraries/lib-import-export/ExportUtils.h"
+#include "libraries/lib-import-export/LazyIngest.h"
 #include "libraries/lib-mixer/MixerOptions.h"
+#include "libraries/lib-strings/Internat.h"
 #include "libraries/lib-tags/Tags.h"
 #include "libraries/lib-track/Track.h"
 #include "libraries/lib-wave-track/WaveTrack.h"
@@ -17,6 +20,9 @@
 
 #include "translation.h"
 
+#include <algorithm>
+#include <set>
+
 using namespace au::au3;
 using namespace au::importexport;
 
@@ -31,6 +37,39 @@ ExportPlugin* formatPlugin(const std::string& format)
 
     return nullptr;
 }
+
+ExportResult runExportBatch(ExportBatch& batch)
+{
+    constexpr long long ProgressSteps = 1000ul;
+
+    std::unique_ptr<BasicUI::ProgressDialog> progressDialog;
+    while (batch.Poll(std::chrono::milliseconds(50))) {
+        if (!progressDialog) {
+            progressDialog = BasicUI::MakeProgress(XO("Export"), batch.GetStatus());
+        } else {
+            progressDialog->SetMessage(batch.GetStatus());
+        }
+
+        const auto result = progressDialog->Poll(batch.GetProgress() * ProgressSteps, ProgressSteps);
+        if (result == BasicUI::ProgressResult::Cancelled) {
+            batch.Cancel();
+        } else if (result == BasicUI::ProgressResult::Stopped) {
+            batch.Stop();
+        }
+    }
+
+    for (size_t i = 0; i < batch.GetJobCount(); ++i) {
+        if (batch.GetOutcome(i).result == ExportResult::Error) {
+            return ExportResult::Error;
+        }
+    }
+
+    if (batch.IsCancelled()) {
+        return ExportResult::Cancelled;
+    }
+
+    return batch.IsStopped() ? ExportResult::Stopped : ExportResult::Success;
+}
 }
 
 class DialogExportProgressDelegate : public ExportProcessorDelegate
@@ -172,6 +211,16 @@ muse::Ret Au3Exporter::exportData(std::string filename)
     // m_mixerSpec = std::make_unique<MixerOptions::Downmix>(exportedTracks.size(), m_numChannels).get();
     m_sampleRate = exportConfiguration()->exportSampleRate();
 
+    if (exportConfiguration()->processType() == ExportProcessType::TRACKS_AS_SEPARATE_AUDIO_FILES) {
+        return exportTracks(*project, wxfilename);
+    }
+
+    // Imported audio may still be read from the file to be overwritten
+    if (!LazyIngest::Get().Release(wxfilename.GetFullPath())) {
+        return muse::make_ret(muse::Ret::Code::InternalError,
+                              muse::trc("export", "Some imported audio could not yet be copied from this file into the project"));
+    }
+
     try {
         auto processor = m_plugin->CreateProcessor(m_format);
         if (!processor->Initialize(*project,
@@ -225,6 +274,88 @@ muse::Ret Au3Exporter::exportData(std::string filename)
     return muse::make_ret(muse::Ret::Code::Ok);
 }
 
+muse::Ret Au3Exporter::exportTracks(Au3Project& project, const wxFileName& filename)
+{
+    auto& tracks = TrackList::Get(project);
+
+    ExportBatch batch;
+    std::set<wxString> names;
+    for (const auto track : ExportUtils::FindExportWaveTracks(tracks, m_selectedOnly)) {
+        wxString trackName = track->GetName();
+        Internat::SanitiseFilename(trackName, wxT("_"));
+
+        // One file for each track, named after the file and the track
+        wxFileName trackFilename = filename;
+        trackFilename.SetName(filename.GetName() + wxT("-") + trackName);
+        for (int i = 2; !names.insert(trackFilename.GetName()).second; ++i) {
+            trackFilename.SetName(wxString::Format(wxT("%s-%s-%d"), filename.GetName(), trackName, i));
+        }
+
+        const auto trackId = track->GetId();
+        const unsigned numChannels = std::min<unsigned>(m_numChannels, track->NChannels());
+
+        // Built when the batch can start the job; the mixer takes the selected
+        // tracks then, and the selection is restored after
+        batch.Add([this, &project, &tracks, trackId, numChannels, trackFilename]() -> ExportTask
+        {
+            const auto selectedRange = tracks.Selected();
+            const std::vector<Track*> selected { selectedRange.begin(), selectedRange.end() };
+            for (auto other : selected) {
+                other->SetSelected(false);
+            }
+            tracks.FindById(trackId)->SetSelected(true);
+            auto restore = finally([&] {
+                tracks.FindById(trackId)->SetSelected(false);
+                for (auto other : selected) {
+                    other->SetSelected(true);
+                }
+            });
+
+            auto task = ExportTaskBuilder {}.SetPlugin(m_plugin, m_format)
+                        .SetParameters(m_parameters)
+                        .SetRange(m_t0, m_t1, true)
+                        .SetTags(m_tags)
+                        .SetNumChannels(numChannels)
+                        .SetFileName(trackFilename)
+                        .SetSampleRate(m_sampleRate)
+                        .Build(project);
+
+            return ExportTask([task = std::move(task), trackFilename](ExportProcessorDelegate& delegate) mutable
+            {
+                auto result = ExportResult::Error;
+                auto cleanup = finally([&] {
+                    if (result != ExportResult::Success && result != ExportResult::Stopped) {
+                        ::wxRemoveFile(trackFilename.GetFullPath());
+                    }
+                });
+
+                auto future = task.get_future();
+                task(delegate);
+                result = future.get();
+                return result;
+            });
+        }, std::to_string(static_cast<int64_t>(trackId)));
+    }
+
+    if (runExportBatch(batch) == ExportResult::Error) {
+        for (size_t i = 0; i < batch.GetJobCount(); ++i) {
+            const auto& outcome = batch.GetOutcome(i);
+            if (!outcome.exception) {
+                continue;
+            }
+            try {
+                std::rethrow_exception(outcome.exception);
+            } catch (const ExportException& e) {
+                return muse::make_ret(muse::Ret::Code::InternalError, e.What().ToStdString());
+            } catch (...) {
+            }
+        }
+        return muse::make_ret(muse::Ret::Code::InternalError);
+    }
+
+    return muse::make_ret(muse::Ret::Code::Ok);
+}
+
 std::vector<std::string> Au3Exporter::formatsList() const
 {
     std::vector<std::string> formatsList;
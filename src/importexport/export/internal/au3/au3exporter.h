@@ -8,6 +8,8 @@
 
 #include "libraries/lib-import-export/Export.h"
 
+#include "au3wrap/au3types.h"
+
 #include "../../iexporter.h"
 #include "internal/exportconfiguration.h"
 #include "trackedit/iselectioncontroller.h"
@@ -46,6 +48,9 @@ public:
     OptionsEditorUPtr optionsEditor() const;
 
 private:
+    //! Export each track that is not muted to a file of its own, several at once
+    muse::Ret exportTracks(au3::Au3Project& project, const wxFileName& filename);
+
     double m_t0 {};
     double m_t1 {};
     bool m_selectedOnly{};
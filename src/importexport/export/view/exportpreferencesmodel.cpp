@@ -35,9 +35,9 @@ std::map<ExportProcessType, std::string> EXPORT_PROCESS_MAPPING {
     { ExportProcessType::FULL_PROJECT_AUDIO, muse::trc("export", "Export full project audio") },
     { ExportProcessType::SELECTED_AUDIO, muse::trc("export", "Export selected audio") },
     { ExportProcessType::AUDIO_IN_LOOP_REGION, muse::trc("export", "Export audio in loop region") },
+    { ExportProcessType::TRACKS_AS_SEPARATE_AUDIO_FILES,
+      muse::trc("export", "Export tracks as a separate audio files (Stems)") },
     //! NOTE: not implemented yet
-    // { ExportProcessType::TRACKS_AS_SEPARATE_AUDIO_FILES,
-    //   muse::trc("export", "Export tracks as a separate audio files (Stems)") },
     // { ExportProcessType::EACH_LABEL_AS_SEPARATE_AUDIO_FILE, muse::trc("export",
     //                                                                                  "Export each label as a separate audio file (Chapters)") },
     // { ExportProcessType::ALL_LABELS_AS_SUBTITLE_FILE, muse::trc("export", "Export all labels as a subtitle file") }
@@ -848,6 +848,11 @@ Rectangle {
 
                 Layout.fillWidth: true
                 Layout.fillHeight: true
+
+                context: waveView.context
+                clipKey: waveView.clipKey
+                clipTime: waveView.clipTime
+                channelHeightRatio: waveView.channelHeightRatio
             }
         }
     }
@@ -0,0 +1,114 @@
+/*
+* Audacity: A Digital Audio Editor
+*/
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "view/tracksitemsview/au3/SpectrogramTileCache.h"
+
+using namespace au::projectscene;
+
+class ProjectScene_SpectrogramTileCacheTests : public ::testing::Test
+{
+protected:
+    static constexpr double SampleRate = 44100.0;
+    static constexpr size_t Columns = 16;
+
+    SpectrogramTileParameters linearParameters(int height) const
+    {
+        SpectrogramTileParameters params;
+        params.height = height;
+        params.sampleRate = SampleRate;
+        params.windowSize = 2048;
+        params.zeroPaddingFactor = 2;
+        params.windowType = 3; // Hann
+        params.gain = 20;
+        params.range = 80;
+        params.colorScheme = 3; // Inverse grayscale: brighter is louder
+        params.scale = NumberScale(nstLinear, 0.0f, SampleRate / 2);
+        return params;
+    }
+
+    //! A sine, and the offsets of Columns overlapping windows
+    std::vector<float> sine(double frequency, size_t windowSize, std::vector<size_t>& offsets) const
+    {
+        const size_t hop = windowSize / 4;
+        std::vector<float> samples(hop * (Columns - 1) + windowSize);
+        for (size_t ii = 0; ii < samples.size(); ++ii) {
+            samples[ii] = std::sin(2 * M_PI * frequency * ii / SampleRate);
+        }
+        offsets.clear();
+        for (size_t column = 0; column < Columns; ++column) {
+            offsets.push_back(column * hop);
+        }
+        return samples;
+    }
+};
+
+TEST_F(ProjectScene_SpectrogramTileCacheTests, SineLightsItsRow)
+{
+    //! [GIVEN] A full scale sine of 5512.5 Hz, an eighth of the sample rate
+    const int height = 400;
+    const SpectrogramTileRecipe recipe(linearParameters(height));
+    std::vector<size_t> offsets;
+    const auto samples = sine(SampleRate / 8, recipe.parameters.windowSize, offsets);
+
+    //! [WHEN] Computing its tile
+    const std::atomic<bool> cancelled { false };
+    const QImage image = SpectrogramTileCache::ComputeTile(recipe, samples.data(), offsets, cancelled);
+
+    //! [THEN] Every column is brightest a quarter of the way up
+    ASSERT_EQ(image.width(), static_cast<int>(Columns));
+    ASSERT_EQ(image.height(), height);
+    const int expectedRow = height - 1 - height / 4;
+    for (int column = 0; column < image.width(); ++column) {
+        int brightestRow = 0;
+        for (int row = 0; row < height; ++row) {
+            if (qRed(image.pixel(column, row)) > qRed(image.pixel(column, brightestRow))) {
+                brightestRow = row;
+            }
+        }
+        EXPECT_NEAR(brightestRow, expectedRow, 1);
+        EXPECT_GT(qRed(image.pixel(column, brightestRow)), 192);
+        //! [THEN] And dark far from it
+        EXPECT_LT(qRed(image.pixel(column, height / 8)), 64);
+    }
+}
+
+TEST_F(ProjectScene_SpectrogramTileCacheTests, SilenceIsBackground)
+{
+    //! [GIVEN] Silence
+    const SpectrogramTileRecipe recipe(linearParameters(100));
+    std::vector<float> samples(recipe.parameters.windowSize * Columns, 0.0f);
+    std::vector<size_t> offsets;
+    for (size_t column = 0; column < Columns; ++column) {
+        offsets.push_back(column * recipe.parameters.windowSize);
+    }
+
+    //! [WHEN] Computing its tile
+    const std::atomic<bool> cancelled { false };
+    const QImage image = SpectrogramTileCache::ComputeTile(recipe, samples.data(), offsets, cancelled);
+
+    //! [THEN] Every pixel has the color of the lowest value
+    for (int column = 0; column < image.width(); ++column) {
+        for (int row = 0; row < image.height(); ++row) {
+            ASSERT_EQ(qRed(image.pixel(column, row)), 0);
+        }
+    }
+}
+
+TEST_F(ProjectScene_SpectrogramTileCacheTests, CancelledTileIsNull)
+{
+    //! [GIVEN] A job cancelled before it starts
+    const SpectrogramTileRecipe recipe(linearParameters(100));
+    std::vector<size_t> offsets;
+    const auto samples = sine(1000, recipe.parameters.windowSize, offsets);
+    const std::atomic<bool> cancelled { true };
+
+    //! [WHEN] Computing the tile
+    const QImage image = SpectrogramTileCache::ComputeTile(recipe, samples.data(), offsets, cancelled);
+
+    //! [THEN] Nothing is computed
+    EXPECT_TRUE(image.isNull());
+}
@@ -0,0 +1,103 @@
+#include "SpectrogramPainter.h"
+
+#include <QPainter>
+
+#include "ZoomInfo.h"
+
+namespace au::projectscene {
+static au::au3::Au3WaveClip::Attachments::RegisteredFactory sKeyS{ [](au::au3::Au3WaveClip&) {
+        return std::make_unique<SpectrogramPainter>();
+    } };
+
+SpectrogramPainter& SpectrogramPainter::Get(const au::au3::Au3WaveClip& clip)
+{
+    return const_cast< au::au3::Au3WaveClip& >(clip)   // Consider it mutable data
+           .Attachments::Get<SpectrogramPainter>(sKeyS).EnsureClip(clip);
+}
+
+SpectrogramPainter& SpectrogramPainter::EnsureClip(const au::au3::Au3WaveClip& clip)
+{
+    const auto changed = mChanged.exchange(false);
+    if (&clip != mWaveClip || changed) {
+        mChannelCaches.clear();
+    }
+
+    const auto nChannels = clip.NChannels();
+
+    if (mChannelCaches.size() == nChannels) {
+        return *this;
+    }
+
+    mWaveClip = &clip;
+
+    mChannelCaches.reserve(nChannels);
+
+    for (size_t channelIndex = 0; channelIndex < nChannels; ++channelIndex) {
+        mChannelCaches.push_back(std::make_unique<SpectrogramTileCache>(clip, channelIndex));
+    }
+
+    return *this;
+}
+
+void SpectrogramPainter::Draw(size_t channelIndex,
+                              QPainter& painter,
+                              const SpectrogramTileParameters& params,
+                              const au::projectscene::WaveMetrics& metrics,
+                              SpectrogramTileCache::TileReadyCallback onTileReady)
+{
+    assert(channelIndex < mChannelCaches.size());
+    if (channelIndex >= mChannelCaches.size()) {
+        return;
+    }
+
+    auto& tileCache = *mChannelCaches[channelIndex];
+    tileCache.SetParameters(params);
+    tileCache.SetTileReadyCallback(std::move(onTileReady));
+
+    const ZoomInfo zoomInfo(0.0, metrics.zoom);
+    auto range = tileCache.PerformLookup(zoomInfo, metrics.fromTime, metrics.toTime);
+
+    const auto background = tileCache.BackgroundColor();
+
+    double left = metrics.left;
+    int height = metrics.height;
+
+    for (auto it = range.begin(); it != range.end(); ++it) {
+        const auto elementLeftOffset = it.GetLeftOffset();
+        const auto elementRightOffset = it.GetRightOffset();
+
+        const auto width = SpectrogramTileCache::CacheElementWidth - elementLeftOffset - elementRightOffset;
+
+        const QRectF target(left, metrics.top, width, height);
+        const auto& image = it->Image;
+        if (image.isNull()) {
+            // Not computed yet
+            painter.fillRect(target, background);
+        } else {
+            painter.drawImage(
+                target,
+                image,
+                QRectF(elementLeftOffset, 0, width, image.height()));
+        }
+
+        left += width;
+    }
+}
+
+void SpectrogramPainter::MarkChanged() noexcept
+{
+    mChanged.store(true);
+}
+
+void SpectrogramPainter::Invalidate()
+{
+    for (auto& channelCache : mChannelCaches) {
+        channelCache->Invalidate();
+    }
+}
+
+std::unique_ptr<WaveClipListener> SpectrogramPainter::Clone() const
+{
+    return std::make_unique<SpectrogramPainter>();
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "au3wrap/au3types.h"
+#include "WaveClip.h"
+#include "WaveMetrics.h"
+#include "SpectrogramTileCache.h"
+
+class QPainter;
+
+namespace au::projectscene {
+class SpectrogramPainter final : public WaveClipListener
+{
+public:
+
+    static SpectrogramPainter& Get(const au::au3::Au3WaveClip& clip);
+
+    SpectrogramPainter& EnsureClip(const au::au3::Au3WaveClip& clip);
+    //! Draw the tiles that are ready, and start computing the others
+    /*!
+     @param onTileReady called in the main thread whenever another tile is ready to draw
+     */
+    void Draw(size_t channelIndex, QPainter& painter, const SpectrogramTileParameters& params,
+              const au::projectscene::WaveMetrics& metrics, SpectrogramTileCache::TileReadyCallback onTileReady);
+    void MarkChanged() noexcept override;
+    void Invalidate() override;
+    std::unique_ptr<WaveClipListener> Clone() const override;
+
+private:
+    const au::au3::Au3WaveClip* mWaveClip {};
+
+    std::vector<std::unique_ptr<SpectrogramTileCache> > mChannelCaches;
+    std::atomic<bool> mChanged = false;
+};
+}
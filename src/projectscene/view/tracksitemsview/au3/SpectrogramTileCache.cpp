@@ -0,0 +1,397 @@
+/*
+* Audacity: A Digital Audio Editor
+*/
+#include "SpectrogramTileCache.h"
+
+#include <QCoreApplication>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "FFT.h"
+#include "RealFFTf.h"
+#include "Sequence.h"
+#include "WaveClip.h"
+
+#include "libraries/lib-theme/AColorResources.h" // specColormap
+
+namespace au::projectscene {
+struct SpectrogramTileJob
+{
+    std::atomic<bool> cancelled { false };
+    //! Set, with release semantics, after image
+    std::atomic<bool> done { false };
+    QImage image;
+    //! Whether all the samples of the tile were in the sequence
+    bool complete = false;
+};
+
+namespace {
+constexpr size_t GradientSteps = 256;
+using Colormap = std::array<std::array<unsigned char, 3>, GradientSteps>;
+
+//! As AColor::PreComputeGradient, for unselected samples only
+const Colormap& GetColormap(int colorScheme)
+{
+    static const auto colormaps = [] {
+        std::array<Colormap, 4> result;
+
+        // Color (Roseus)
+        for (size_t ii = 0; ii < GradientSteps; ++ii) {
+            std::copy_n(specColormap[ii], 3, result[0][ii].begin());
+        }
+
+        // Color (classic), from the Spectro colors of the light theme
+        constexpr size_t gsteps = 4;
+        constexpr unsigned char gradient[gsteps + 1][3] = {
+            { 0xf0, 0xf3, 0xff }, { 0x4c, 0x99, 0xff }, { 0xe5, 0x19, 0xe5 }, { 0xff, 0x00, 0x00 }, { 0xff, 0xff, 0xff },
+        };
+        for (size_t ii = 0; ii < GradientSteps; ++ii) {
+            const float value = float(ii) / GradientSteps;
+            const size_t left = value * gsteps;
+            const size_t right = left == gsteps ? gsteps : left + 1;
+            const float rweight = value * gsteps - left;
+            const float lweight = 1.0f - rweight;
+            for (size_t cc = 0; cc < 3; ++cc) {
+                result[1][ii][cc] = gradient[left][cc] * lweight + gradient[right][cc] * rweight;
+            }
+        }
+
+        // Grayscale, and inverse grayscale
+        for (size_t ii = 0; ii < GradientSteps; ++ii) {
+            const float value = float(ii) / GradientSteps;
+            result[2][ii].fill(static_cast<unsigned char>(255 * (0.84f - 0.84f * value)));
+            result[3][ii].fill(static_cast<unsigned char>(255 * value));
+        }
+
+        return result;
+    }();
+
+    return colormaps[std::clamp(colorScheme, 0, static_cast<int>(colormaps.size()) - 1)];
+}
+
+//! As RecreateWindow in SpectrogramSettings.cpp, for the plain window
+std::vector<float> MakeWindow(int windowType, size_t windowSize, size_t fftLength)
+{
+    std::vector<float> window(fftLength, 0.0f);
+    const size_t padding = (fftLength - windowSize) / 2;
+
+    const bool extra = padding > 0;
+    if (extra) {
+        // For windows that do not go to 0 at the edges, this improves symmetry
+        ++windowSize;
+    }
+    const size_t endOfWindow = padding + windowSize;
+
+    std::fill(window.begin() + padding, window.begin() + endOfWindow, 1.0f);
+    NewWindowFunc(windowType, windowSize, extra, window.data() + padding);
+
+    // Scale the window function to give 0dB spectrum for 0dB sine tone
+    double scale = 0.0;
+    for (size_t ii = padding; ii < endOfWindow; ++ii) {
+        scale += window[ii];
+    }
+    if (scale > 0) {
+        scale = 2.0 / scale;
+    }
+    for (size_t ii = padding; ii < endOfWindow; ++ii) {
+        window[ii] *= scale;
+    }
+
+    return window;
+}
+
+//! As ComputeSpectrogramGainFactors in SpectrumCache.cpp
+std::vector<float> MakeGainFactors(size_t fftLength, double rate, int frequencyGain)
+{
+    std::vector<float> gainFactors;
+    if (frequencyGain > 0) {
+        // Scaled such that 1000 Hz gets a gain of 0dB
+        const double factor = (rate / fftLength) / 1000.0;
+
+        const auto half = fftLength / 2;
+        gainFactors.reserve(half);
+        // Don't take logarithm of zero!  Let bin 0 replicate the gain factor for bin 1.
+        gainFactors.push_back(frequencyGain * std::log10(factor));
+        for (size_t x = 1; x < half; ++x) {
+            gainFactors.push_back(frequencyGain * std::log10(factor * x));
+        }
+    }
+    return gainFactors;
+}
+
+//! Power, in dB, of the first fftLength / 2 bins, as ComputeSpectrumUsingRealFFTf in SpectrumCache.cpp
+void ComputeSpectrum(float* buffer, const FFTParam* hFFT, const float* window, float* out)
+{
+    const auto fftLength = hFFT->Points * 2;
+    for (size_t ii = 0; ii < fftLength; ++ii) {
+        buffer[ii] *= window[ii];
+    }
+
+    RealFFTf(buffer, hFFT);
+
+    const auto toDB = [](float power) {
+        return power <= 0 ? -160.0f : 10.0f * std::log10(power);
+    };
+
+    // Handle the (real-only) DC
+    out[0] = toDB(buffer[0] * buffer[0]);
+    for (size_t ii = 1; ii < hFFT->Points; ++ii) {
+        const int index = hFFT->BitReversed[ii];
+        const float re = buffer[index], im = buffer[index + 1];
+        out[ii] = toDB(re * re + im * im);
+    }
+}
+
+//! The maximum of the bins of one pixel row, mapped to [0, 1], as findValue in SpectrumView.cpp
+float FindValue(const float* spectrum, float bin0, float bin1, size_t nBins, int gain, int range)
+{
+    int index = std::min<int>(nBins - 1, static_cast<int>(std::floor(0.5 + bin0)));
+    const int limitIndex = std::min<int>(nBins, static_cast<int>(std::floor(0.5 + bin1)));
+
+    float value = spectrum[index];
+    while (++index < limitIndex) {
+        value = std::max(value, spectrum[index]);
+    }
+
+    value = (value + range + gain) / static_cast<float>(range);
+    return std::clamp(value, 0.0f, 1.0f);
+}
+
+//! Zeroes stand for samples outside of the sequence
+void ReadSamples(const Sequence& sequence, int64_t start, size_t len, float* dest)
+{
+    std::fill_n(dest, len, 0.0f);
+
+    const auto numSamples = sequence.GetNumSamples().as_long_long();
+    const auto from = std::clamp<int64_t>(start, 0, numSamples);
+    const auto to = std::clamp<int64_t>(start + static_cast<int64_t>(len), 0, numSamples);
+    if (from >= to) {
+        return;
+    }
+
+    if (!sequence.Get(reinterpret_cast<samplePtr>(dest + (from - start)), floatSample, from, to - from, false)) {
+        std::fill_n(dest, len, 0.0f);
+    }
+}
+}
+
+bool SpectrogramTileParameters::operator==(const SpectrogramTileParameters& other) const
+{
+    return height == other.height
+           && sampleRate == other.sampleRate
+           && windowSize == other.windowSize
+           && zeroPaddingFactor == other.zeroPaddingFactor
+           && windowType == other.windowType
+           && gain == other.gain
+           && range == other.range
+           && frequencyGain == other.frequencyGain
+           && colorScheme == other.colorScheme
+           && scale == other.scale;
+}
+
+bool SpectrogramTileParameters::operator!=(const SpectrogramTileParameters& other) const
+{
+    return !(*this == other);
+}
+
+SpectrogramTileRecipe::SpectrogramTileRecipe(const SpectrogramTileParameters& params)
+    : parameters{params}
+    , fftLength{params.windowSize * std::max<size_t>(1, params.zeroPaddingFactor)}
+    , window{MakeWindow(params.windowType, params.windowSize, fftLength)}
+    , gainFactors{MakeGainFactors(fftLength, params.sampleRate, params.frequencyGain)}
+{
+    // Nearest bin to each pixel row boundary, as in SpectrumView::DrawClipSpectrum
+    const size_t nBins = fftLength / 2;
+    const float binUnit = params.sampleRate / fftLength;
+    const auto findBin = [&](float frequency) {
+        return std::clamp(frequency / binUnit, 0.0f, float(nBins - 1));
+    };
+
+    rowBins.reserve(params.height + 1);
+    auto it = params.scale.begin(params.height);
+    rowBins.push_back(findBin(*it));
+    for (int row = 0; row < params.height; ++row) {
+        rowBins.push_back(findBin(*++it));
+    }
+}
+
+void SpectrogramTileElement::Dispose()
+{
+    if (Job) {
+        Job->cancelled.store(true, std::memory_order_relaxed);
+        Job.reset();
+    }
+    Image = QImage();
+    SequenceLength = 0;
+}
+
+SpectrogramTileCache::SpectrogramTileCache(const WaveClip& waveClip, size_t channelIndex)
+    : GraphicsDataCache<SpectrogramTileElement>(
+        waveClip.GetRate() / waveClip.GetStretchRatio(),
+        [] { return std::make_unique<SpectrogramTileElement>(); })
+    , mWaveClip{waveClip}
+    , mChannelIndex{channelIndex}
+    , mTileReadyCallback{std::make_shared<TileReadyCallback>()}
+{
+}
+
+SpectrogramTileCache::~SpectrogramTileCache()
+{
+    // Cancel the pending jobs while the elements still exist
+    Invalidate();
+}
+
+SpectrogramTileCache& SpectrogramTileCache::SetParameters(const SpectrogramTileParameters& params)
+{
+    SetScaledSampleRate(mWaveClip.GetRate() / mWaveClip.GetStretchRatio());
+
+    if (!mRecipe || mParameters != params) {
+        mParameters = params;
+        const bool valid = params.height > 0 && params.windowSize > 0 && params.sampleRate > 0 && params.range > 0;
+        mRecipe = valid ? std::make_shared<const SpectrogramTileRecipe>(params) : nullptr;
+        Invalidate();
+    }
+
+    return *this;
+}
+
+SpectrogramTileCache& SpectrogramTileCache::SetTileReadyCallback(TileReadyCallback callback)
+{
+    *mTileReadyCallback = std::move(callback);
+    return *this;
+}
+
+QColor SpectrogramTileCache::BackgroundColor() const
+{
+    const auto& rgb = GetColormap(mParameters.colorScheme)[0];
+    return QColor(rgb[0], rgb[1], rgb[2]);
+}
+
+QImage SpectrogramTileCache::ComputeTile(const SpectrogramTileRecipe& recipe, const float* samples,
+                                         const std::vector<size_t>& offsets, const std::atomic<bool>& cancelled)
+{
+    const auto& params = recipe.parameters;
+    const auto fftLength = recipe.fftLength;
+    const auto nBins = fftLength / 2;
+    const auto padding = (fftLength - params.windowSize) / 2;
+    const auto height = params.height;
+    const auto& colormap = GetColormap(params.colorScheme);
+
+    const auto hFFT = GetFFT(fftLength);
+    std::vector<float> buffer(fftLength);
+    std::vector<float> spectrum(nBins);
+
+    QImage image(static_cast<int>(offsets.size()), height, QImage::Format_RGB32);
+
+    for (size_t column = 0; column < offsets.size(); ++column) {
+        if (cancelled.load(std::memory_order_relaxed)) {
+            return {};
+        }
+
+        std::fill(buffer.begin(), buffer.end(), 0.0f);
+        std::copy_n(samples + offsets[column], params.windowSize, buffer.begin() + padding);
+        ComputeSpectrum(buffer.data(), hFFT.get(), recipe.window.data(), spectrum.data());
+
+        for (size_t bin = 0; bin < recipe.gainFactors.size(); ++bin) {
+            spectrum[bin] += recipe.gainFactors[bin];
+        }
+
+        for (int row = 0; row < height; ++row) {
+            const float value = FindValue(spectrum.data(), recipe.rowBins[row], recipe.rowBins[row + 1], nBins,
+                                          params.gain, params.range);
+            const auto& rgb = colormap[static_cast<size_t>(value * (GradientSteps - 1))];
+            auto line = reinterpret_cast<QRgb*>(image.scanLine(height - 1 - row));
+            line[column] = qRgb(rgb[0], rgb[1], rgb[2]);
+        }
+    }
+
+    return image;
+}
+
+bool SpectrogramTileCache::InitializeElement(const GraphicsDataCacheKey& key, SpectrogramTileElement& element)
+{
+    if (!mRecipe) {
+        return false;
+    }
+
+    if (element.Job) {
+        if (!element.Job->done.load(std::memory_order_acquire)) {
+            // Still computing; keep whatever image the element has
+            return true;
+        }
+
+        element.Image = std::move(element.Job->image);
+        element.IsComplete = element.Job->complete;
+        element.Job.reset();
+        return true;
+    }
+
+    // A new element, or one that was missing samples, if more were appended since
+    const auto sequenceLength = mWaveClip.GetSequence(mChannelIndex)->GetNumSamples().as_long_long();
+    if (element.Image.isNull() || element.SequenceLength != sequenceLength) {
+        StartJob(key, element);
+    }
+
+    return true;
+}
+
+void SpectrogramTileCache::StartJob(const GraphicsDataCacheKey& key, SpectrogramTileElement& element)
+{
+    const auto& sequence = *mWaveClip.GetSequence(mChannelIndex);
+    const auto windowSize = mRecipe->parameters.windowSize;
+    const double samplesPerColumn = GetScaledSampleRate() / key.PixelsPerSecond;
+
+    // Windows centered on the columns
+    std::vector<int64_t> starts(CacheElementWidth);
+    for (size_t column = 0; column < CacheElementWidth; ++column) {
+        starts[column] = key.FirstSample + static_cast<int64_t>(std::floor((column + 0.5) * samplesPerColumn))
+                         - static_cast<int64_t>(windowSize / 2);
+    }
+
+    std::vector<float> samples;
+    std::vector<size_t> offsets(CacheElementWidth);
+    if (samplesPerColumn <= windowSize) {
+        // The windows overlap or adjoin: read them all at once
+        samples.resize(starts.back() + windowSize - starts.front());
+        ReadSamples(sequence, starts.front(), samples.size(), samples.data());
+        for (size_t column = 0; column < CacheElementWidth; ++column) {
+            offsets[column] = starts[column] - starts.front();
+        }
+    } else {
+        samples.resize(CacheElementWidth * windowSize);
+        for (size_t column = 0; column < CacheElementWidth; ++column) {
+            offsets[column] = column * windowSize;
+            ReadSamples(sequence, starts[column], windowSize, samples.data() + offsets[column]);
+        }
+    }
+
+    const auto sequenceLength = sequence.GetNumSamples().as_long_long();
+
+    auto job = std::make_shared<SpectrogramTileJob>();
+    job->complete = starts.back() + static_cast<int64_t>(windowSize) <= sequenceLength;
+
+    element.Job = job;
+    element.SequenceLength = sequenceLength;
+
+    std::weak_ptr<TileReadyCallback> callback = mTileReadyCallback;
+    QThreadPool::globalInstance()->start(
+        [job, recipe = mRecipe, samples = std::move(samples), offsets = std::move(offsets), callback] {
+        auto image = ComputeTile(*recipe, samples.data(), offsets, job->cancelled);
+        if (image.isNull()) {
+            return;
+        }
+
+        job->image = std::move(image);
+        job->done.store(true, std::memory_order_release);
+
+        QMetaObject::invokeMethod(qApp, [callback] {
+            if (const auto pCallback = callback.lock(); pCallback && *pCallback) {
+                (*pCallback)();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+}
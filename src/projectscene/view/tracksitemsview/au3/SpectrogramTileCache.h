@@ -0,0 +1,120 @@
+/*
+* Audacity: A Digital Audio Editor
+*/
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QImage>
+
+#include "GraphicsDataCache.h"
+#include "NumberScale.h"
+
+class WaveClip;
+
+namespace au::projectscene {
+//! Everything, besides the samples, that the pixels of a tile depend on
+struct SpectrogramTileParameters
+{
+    int height = 0;
+    //! Rate of the clip, not scaled by its stretching; for the frequencies of the bins
+    double sampleRate = 0.0;
+
+    size_t windowSize = 0;
+    size_t zeroPaddingFactor = 1;
+    int windowType = 0;
+
+    int gain = 0;
+    int range = 0;
+    int frequencyGain = 0;
+    //! SpectrogramSettings::ColorScheme
+    int colorScheme = 0;
+
+    //! Maps pixel rows, from the bottom, to frequencies
+    NumberScale scale;
+
+    bool operator==(const SpectrogramTileParameters& other) const;
+    bool operator!=(const SpectrogramTileParameters& other) const;
+};
+
+//! What the worker threads need, derived once from the parameters
+struct SpectrogramTileRecipe
+{
+    explicit SpectrogramTileRecipe(const SpectrogramTileParameters& params);
+
+    SpectrogramTileParameters parameters;
+    size_t fftLength = 0;
+    //! fftLength values, zero in the padding
+    std::vector<float> window;
+    //! Decibels to add to each bin; empty unless frequencyGain is positive
+    std::vector<float> gainFactors;
+    //! height + 1 boundaries of the pixel rows, from the bottom, in bins
+    std::vector<float> rowBins;
+};
+
+struct SpectrogramTileJob;
+
+//! A tile of CacheElementWidth columns; its image is filled by a worker thread
+struct SpectrogramTileElement final : public GraphicsDataCacheElementBase
+{
+    void Dispose() override;
+
+    //! Null until the first computation finishes
+    QImage Image;
+    //! Non-null while a computation is pending
+    std::shared_ptr<SpectrogramTileJob> Job;
+    //! Length of the sequence when the samples were read
+    int64_t SequenceLength { 0 };
+};
+
+//! Cache of rendered spectrogram tiles of one channel of a clip
+/*!
+ Tiles are keyed by zoom level and first sample, as in the other graphics
+ caches, so that scrolling reuses the tiles already computed.
+
+ A lookup reads the samples of each missing tile in the calling thread, which
+ is cheap, and leaves the FFTs to the global QThreadPool. Until a tile is
+ computed, the lookup yields it without an image; the cache then calls back in
+ the main thread, and the next lookup completes the tile.
+ */
+class SpectrogramTileCache final : public GraphicsDataCache<SpectrogramTileElement>
+{
+public:
+    //! Called in the main thread when a tile started by a lookup is ready
+    using TileReadyCallback = std::function<void ()>;
+
+    SpectrogramTileCache(const WaveClip& waveClip, size_t channelIndex);
+    ~SpectrogramTileCache() override;
+
+    //! Invalidates the cache when the parameters change
+    SpectrogramTileCache& SetParameters(const SpectrogramTileParameters& params);
+    SpectrogramTileCache& SetTileReadyCallback(TileReadyCallback callback);
+
+    //! The color of silence, to fill tiles that are not computed yet
+    QColor BackgroundColor() const;
+
+    //! Compute the image of a tile; the window of column `c` starts at `samples + offsets[c]`
+    /*!
+     @return a null image if `cancelled` became true meanwhile
+     */
+    static QImage ComputeTile(const SpectrogramTileRecipe& recipe, const float* samples, const std::vector<size_t>& offsets,
+                              const std::atomic<bool>& cancelled);
+
+private:
+    bool InitializeElement(const GraphicsDataCacheKey& key, SpectrogramTileElement& element) override;
+
+    void StartJob(const GraphicsDataCacheKey& key, SpectrogramTileElement& element);
+
+    const WaveClip& mWaveClip;
+    const size_t mChannelIndex;
+
+    SpectrogramTileParameters mParameters;
+    std::shared_ptr<const SpectrogramTileRecipe> mRecipe;
+
+    //! Jobs hold weak pointers, so that they outlive the cache safely
+    std::shared_ptr<TileReadyCallback> mTileReadyCallback;
+};
+}
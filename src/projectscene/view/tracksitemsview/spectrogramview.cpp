@@ -3,6 +3,16 @@
  */
 #include "spectrogramview.h"
 
+#include <QPainter>
+#include <QPointer>
+
+#include "au3wrap/internal/domaccessor.h"
+#include "libraries/lib-wave-track-settings/SpectrogramSettings.h"
+#include "NumberScale.h"
+#include "WaveTrack.h"
+
+#include "au3/SpectrogramPainter.h"
+
 namespace au::projectscene {
 SpectrogramView::SpectrogramView(QQuickItem* parent)
     : QQuickPaintedItem(parent)
@@ -13,6 +23,129 @@ SpectrogramView::~SpectrogramView() = default;
 
 void SpectrogramView::paint(QPainter* painter)
 {
-    painter->fillRect(boundingRect(), Qt::gray);
+    const auto project = globalContext()->currentProject();
+    if (!project || !m_context) {
+        return;
+    }
+
+    au::au3::Au3Project* au3Project = reinterpret_cast<au::au3::Au3Project*>(project->au3ProjectPtr());
+    WaveTrack* track = au::au3::DomAccessor::findWaveTrack(*au3Project, TrackId(m_clipKey.key.trackId));
+    if (!track) {
+        return;
+    }
+
+    std::shared_ptr<WaveClip> waveClip = au::au3::DomAccessor::findWaveClip(track, m_clipKey.key.itemId);
+    if (!waveClip) {
+        return;
+    }
+
+    auto& settings = SpectrogramSettings::Get(*track);
+
+    const std::vector<double> channelHeight {
+        height() * m_channelHeightRatio,
+        height() * (1 - m_channelHeightRatio),
+    };
+
+    WaveMetrics metrics;
+    metrics.zoom = m_context->zoom();
+    metrics.width = width();
+    metrics.fromTime = (m_clipTime.itemStartTime - m_clipTime.startTime) + waveClip->GetTrimLeft();
+    metrics.toTime = metrics.fromTime + (m_clipTime.itemEndTime - m_clipTime.startTime);
+
+    auto& spectrogramPainter = SpectrogramPainter::Get(*waveClip);
+    auto onTileReady = [self = QPointer<SpectrogramView>(this)] {
+        if (self) {
+            self->update();
+        }
+    };
+
+    for (size_t index = 0; index < waveClip->NChannels() && index < channelHeight.size(); ++index) {
+        metrics.height = channelHeight[index];
+
+        float minFreq, maxFreq;
+        SpectrogramBounds::Get(*track).GetBounds(*track->GetChannel(index), minFreq, maxFreq);
+
+        SpectrogramTileParameters params;
+        params.height = static_cast<int>(metrics.height);
+        params.sampleRate = waveClip->GetRate();
+        params.windowSize = settings.WindowSize();
+        params.zeroPaddingFactor = settings.ZeroPaddingFactor();
+        params.windowType = settings.windowType;
+        params.gain = settings.gain;
+        params.range = settings.range;
+        params.frequencyGain = settings.frequencyGain;
+        params.colorScheme = settings.colorScheme;
+        params.scale = settings.GetScale(minFreq, maxFreq);
+
+        spectrogramPainter.Draw(index, *painter, params, metrics, onTileReady);
+
+        metrics.top += static_cast<int>(metrics.height);
+    }
+}
+
+TimelineContext* SpectrogramView::timelineContext() const
+{
+    return m_context;
+}
+
+void SpectrogramView::setTimelineContext(TimelineContext* newContext)
+{
+    if (m_context == newContext) {
+        return;
+    }
+
+    if (m_context) {
+        disconnect(m_context, nullptr, this, nullptr);
+    }
+
+    m_context = newContext;
+
+    if (m_context) {
+        connect(m_context, &TimelineContext::frameTimeChanged, this, [this]() { update(); });
+        connect(m_context, &TimelineContext::zoomChanged, this, [this]() { update(); });
+    }
+
+    emit timelineContextChanged();
+}
+
+ClipKey SpectrogramView::clipKey() const
+{
+    return m_clipKey;
+}
+
+void SpectrogramView::setClipKey(const ClipKey& newClipKey)
+{
+    m_clipKey = newClipKey;
+    emit clipKeyChanged();
+
+    update();
+}
+
+ClipTime SpectrogramView::clipTime() const
+{
+    return m_clipTime;
+}
+
+void SpectrogramView::setClipTime(const ClipTime& newClipTime)
+{
+    if (m_clipTime == newClipTime) {
+        return;
+    }
+    m_clipTime = newClipTime;
+    emit clipTimeChanged();
+
+    update();
+}
+
+double SpectrogramView::channelHeightRatio() const
+{
+    return m_channelHeightRatio;
+}
+
+void SpectrogramView::setChannelHeightRatio(double channelHeightRatio)
+{
+    m_channelHeightRatio = channelHeightRatio;
+    emit channelHeightRatioChanged();
+    update();
 }
 }
@@ -5,14 +5,48 @@
 
 #include <QQuickPaintedItem>
 
+#include "modularity/ioc.h"
+#include "context/iglobalcontext.h"
+
+#include "../timeline/timelinecontext.h"
+#include "types/projectscenetypes.h"
+
 namespace au::projectscene {
 class SpectrogramView : public QQuickPaintedItem
 {
     Q_OBJECT
+    Q_PROPERTY(TimelineContext * context READ timelineContext WRITE setTimelineContext NOTIFY timelineContextChanged FINAL)
+    Q_PROPERTY(ClipKey clipKey READ clipKey WRITE setClipKey NOTIFY clipKeyChanged FINAL)
+    Q_PROPERTY(ClipTime clipTime READ clipTime WRITE setClipTime NOTIFY clipTimeChanged FINAL)
+    Q_PROPERTY(double channelHeightRatio READ channelHeightRatio WRITE setChannelHeightRatio NOTIFY channelHeightRatioChanged FINAL)
+
+    muse::Inject<au::context::IGlobalContext> globalContext;
+
 public:
     SpectrogramView(QQuickItem* parent = nullptr);
     ~SpectrogramView() override;
 
+    TimelineContext* timelineContext() const;
+    void setTimelineContext(TimelineContext* newContext);
+    ClipKey clipKey() const;
+    void setClipKey(const ClipKey& newClipKey);
+    ClipTime clipTime() const;
+    void setClipTime(const ClipTime& newClipTime);
+    double channelHeightRatio() const;
+    void setChannelHeightRatio(double channelHeightRatio);
+
     void paint(QPainter* painter) override;
+
+signals:
+    void timelineContextChanged();
+    void clipKeyChanged();
+    void clipTimeChanged();
+    void channelHeightRatioChanged();
+
+private:
+    TimelineContext* m_context = nullptr;
+    ClipKey m_clipKey;
+    ClipTime m_clipTime;
+    double m_channelHeightRatio = 0.5;
 };
 }
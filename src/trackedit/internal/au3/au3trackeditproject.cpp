@@ -1,6 +1,7 @@
 #include "au3trackeditproject.h"
 
 #include "libraries/lib-track/Track.h"
+#include "libraries/lib-track/UndoTracks.h"
 #include "libraries/lib-numeric-formats/ProjectTimeSignature.h"
 
 #include "libraries/lib-stretching-sequence/TempoChange.h"
@@ -462,6 +463,62 @@ TracksAndItems Au3TrackeditProject::buildTracksAndItems() const
     return newCache;
 }
 
+TracksAndItems Au3TrackeditProject::buildTracksAndItems(const TrackIdList& trackIds) const
+{
+    TracksAndItems newCache;
+
+    for (const Track& track : trackList()) {
+        if (!muse::contains(trackIds, track.id)) {
+            continue;
+        }
+        newCache.tracks.push_back(track);
+        newCache.clips.push_back(getClips(track.id));
+        newCache.labels.push_back(getLabels(track.id));
+    }
+
+    return newCache;
+}
+
+std::optional<TracksDiff> Au3TrackeditProject::tracksDiff(size_t stateIndex) const
+{
+    auto& undoManager = UndoManager::Get(*m_impl->prj);
+    if (stateIndex >= undoManager.GetNumStates()) {
+        return std::nullopt;
+    }
+
+    //! The same tracks as trackList()
+    const bool devMode = globalConfiguration()->devModeEnabled();
+    auto trackIds = [devMode](const Au3TrackList& tracks) {
+        TrackIdList ids;
+        for (const Au3Track* t : tracks) {
+            // Pending added tracks are not in the history
+            if (t->GetId() == Au3TrackId {}
+                || (!devMode && DomConverter::track(t).type == TrackType::Label)) {
+                continue;
+            }
+            ids.push_back(t->GetId());
+        }
+        return ids;
+    };
+
+    std::optional<TracksDiff> diff;
+    undoManager.VisitStates([&](const UndoStackElem& elem) {
+        const Au3TrackList* stateTracks = UndoTracks::Find(elem);
+        const auto changedTracks = UndoTracks::FindChangedTracks(*m_impl->trackList, elem);
+        if (!stateTracks || !changedTracks) {
+            return;
+        }
+        diff.emplace();
+        diff->tracksBefore = trackIds(*m_impl->trackList);
+        diff->tracksAfter = trackIds(*stateTracks);
+        for (const Au3TrackId& trackId : *changedTracks) {
+            diff->changedTracks.push_back(trackId);
+        }
+    }, stateIndex, stateIndex + 1);
+
+    return diff;
+}
+
 ITrackeditProjectPtr Au3TrackeditProjectCreator::create(const std::shared_ptr<IAu3Project>& au3project) const
 {
     return std::make_shared<Au3TrackeditProject>(au3project);
@@ -62,6 +62,8 @@ public:
     secs_t totalTime() const override;
 
     TracksAndItems buildTracksAndItems() const override;
+    TracksAndItems buildTracksAndItems(const TrackIdList& trackIds) const override;
+    std::optional<TracksDiff> tracksDiff(size_t stateIndex) const override;
 
     int64_t createNewGroupID(int64_t startingId = 0) const override;
 
@@ -1,7 +1,10 @@
 #include "changedetection.h"
 
+#include "global/containers.h"
 #include "log.h"
 
+#include <algorithm>
+
 using namespace au::trackedit;
 
 namespace {
@@ -193,12 +196,47 @@ bool labelsPair(ITrackeditProjectPtr trackeditProjectPtr,
 
     return changed;
 }
-}  // namespace
 
-namespace au::trackedit::changeDetection {
-void notifyOfUndoRedo(const TracksAndItems& before,
-                      const TracksAndItems& after,
-                      ITrackeditProjectPtr trackeditProject)
+/**
+ * True if the lists differ at any position that both have
+ */
+bool reordered(const TrackIdList& before, const TrackIdList& after)
+{
+    auto trackBefore = before.begin();
+    auto trackAfter = after.begin();
+
+    //! Not assuming they are of equal length,
+    //  since a reorder could have happened as part of a compound action.
+    while (trackBefore != before.end()
+           && trackAfter != after.end()) {
+        if (*trackBefore != *trackAfter) {
+            return true;
+        }
+        ++trackBefore;
+        ++trackAfter;
+    }
+    return false;
+}
+
+TrackIdList trackIds(const TrackList& tracks)
+{
+    TrackIdList ids;
+    ids.reserve(tracks.size());
+    for (const Track& track : tracks) {
+        ids.push_back(track.id);
+    }
+    return ids;
+}
+
+/**
+ * Detect and notifies of changes between the tracks of two structures
+ * @param insertionIndex the index in the project of an added track, given its index in `after`
+ * @return whether any change was found
+ */
+bool tracksPair(const TracksAndItems& before,
+                const TracksAndItems& after,
+                const std::function<int(int)>& insertionIndex,
+                ITrackeditProjectPtr trackeditProject)
 {
     bool changed = false;
 
@@ -206,33 +244,13 @@ void notifyOfUndoRedo(const TracksAndItems& before,
         return first.id == second.id;
     };
 
-    //! Checking for Track reorder. If detected, reload and return.
-    {
-        auto trackBefore = before.tracks.begin();
-        auto trackAfter = after.tracks.begin();
-
-        //! Not assuming they are of equal length,
-        //  since a reorder could have happened as part of a compound action.
-        while (trackBefore != before.tracks.end()
-               && trackAfter != after.tracks.end()) {
-            if (trackBefore->id != trackAfter->id) {
-                //! Reorder found.
-                //  Reload and return.
-                trackeditProject->reload();
-                return;
-            }
-            ++trackBefore;
-            ++trackAfter;
-        }
-    }
-
     //! Checking for Track addition:
     notifier<Track>(
         before.tracks,
         after.tracks,
         [&](Track track, int index) {
         changed = true;
-        trackeditProject->trackInserted().send(track, index);
+        trackeditProject->trackInserted().send(track, insertionIndex(index));
     },
         trackIdCheck
         );
@@ -293,6 +311,11 @@ void notifyOfUndoRedo(const TracksAndItems& before,
     }
                  );
 
+    return changed;
+}
+
+void reloadIfUnchanged(bool changed, ITrackeditProjectPtr trackeditProject)
+{
     //! Despite Undo-Redo being called, if this fails no change was detected.
     //  Reload everything to be sure - slow,
     //  but better than leaving the UI in an invalid state.
@@ -304,4 +327,67 @@ void notifyOfUndoRedo(const TracksAndItems& before,
         LOGE() << "Undo-Redo changes were not detected - reloading UI.";
     }
 }
+}  // namespace
+
+namespace au::trackedit::changeDetection {
+void notifyOfUndoRedo(const TracksAndItems& before,
+                      const TracksAndItems& after,
+                      ITrackeditProjectPtr trackeditProject)
+{
+    //! Checking for Track reorder. If detected, reload and return.
+    if (reordered(trackIds(before.tracks), trackIds(after.tracks))) {
+        trackeditProject->reload();
+        return;
+    }
+
+    const bool changed = tracksPair(before, after, [](int index) { return index; }, trackeditProject);
+
+    reloadIfUnchanged(changed, trackeditProject);
+}
+
+void notifyOfUndoRedo(const TracksDiff& diff,
+                      const TracksAndItems& before,
+                      const TracksAndItems& after,
+                      ITrackeditProjectPtr trackeditProject)
+{
+    //! Checking for Track reorder. If detected, reload and return.
+    if (reordered(diff.tracksBefore, diff.tracksAfter)) {
+        trackeditProject->reload();
+        return;
+    }
+
+    //! `after` has only some of the tracks
+    auto insertionIndex = [&](int index) {
+        const auto it = std::find(diff.tracksAfter.begin(), diff.tracksAfter.end(), after.tracks[index].id);
+        return static_cast<int>(std::distance(diff.tracksAfter.begin(), it));
+    };
+
+    const bool changed = tracksPair(before, after, insertionIndex, trackeditProject);
+
+    reloadIfUnchanged(changed, trackeditProject);
+}
+
+TrackIdList tracksToBuildBefore(const TracksDiff& diff)
+{
+    //! The changed and the removed tracks
+    TrackIdList result = diff.changedTracks;
+    for (const TrackId& trackId : diff.tracksBefore) {
+        if (!muse::contains(diff.tracksAfter, trackId)) {
+            result.push_back(trackId);
+        }
+    }
+    return result;
+}
+
+TrackIdList tracksToBuildAfter(const TracksDiff& diff)
+{
+    //! The changed and the added tracks
+    TrackIdList result = diff.changedTracks;
+    for (const TrackId& trackId : diff.tracksAfter) {
+        if (!muse::contains(diff.tracksBefore, trackId)) {
+            result.push_back(trackId);
+        }
+    }
+    return result;
+}
 }
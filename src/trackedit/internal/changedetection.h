@@ -22,4 +22,20 @@ namespace au::trackedit::changeDetection {
  * @param trackeditProject a TrackEditProjectPtr expected to be valid
  */
 void notifyOfUndoRedo(const TracksAndItems& before, const TracksAndItems& after, ITrackeditProjectPtr trackeditProject);
+
+/**
+ * Same, but the structures need only have the tracks that the diff tells may differ.
+ * The other tracks are known to be the same before and after, so they are not compared.
+ * @param diff The tracks of the states before and after the change, as told by the undo history
+ * @param before The TracksAndClips structure before the change, of tracksToBuildBefore(diff)
+ * @param after The TracksAndClips structure after the change, of tracksToBuildAfter(diff)
+ * @param trackeditProject a TrackEditProjectPtr expected to be valid
+ */
+void notifyOfUndoRedo(const TracksDiff& diff, const TracksAndItems& before, const TracksAndItems& after,
+                      ITrackeditProjectPtr trackeditProject);
+
+//! The changed and the removed tracks
+TrackIdList tracksToBuildBefore(const TracksDiff& diff);
+//! The changed and the added tracks
+TrackIdList tracksToBuildAfter(const TracksDiff& diff);
 }
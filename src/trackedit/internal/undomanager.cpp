@@ -11,15 +11,9 @@ bool UndoManager::undo()
         return false;
     }
 
-    auto trackeditProject = globalContext()->currentProject()->trackeditProject();
-
-    const TracksAndItems before = trackeditProject->buildTracksAndItems();
-
-    projectHistory()->undo();
-
-    const TracksAndItems after = trackeditProject->buildTracksAndItems();
-
-    changeDetection::notifyOfUndoRedo(before, after, trackeditProject);
+    restoreState(projectHistory()->currentStateIndex() - 1, [this] {
+        projectHistory()->undo();
+    });
 
     return true;
 }
@@ -35,15 +29,9 @@ bool UndoManager::redo()
         return false;
     }
 
-    auto trackeditProject = globalContext()->currentProject()->trackeditProject();
-
-    TracksAndItems before = trackeditProject->buildTracksAndItems();
-
-    projectHistory()->redo();
-
-    TracksAndItems after = trackeditProject->buildTracksAndItems();
-
-    changeDetection::notifyOfUndoRedo(before, after, trackeditProject);
+    restoreState(projectHistory()->currentStateIndex() + 1, [this] {
+        projectHistory()->redo();
+    });
 
     return true;
 }
@@ -59,16 +47,36 @@ bool UndoManager::undoRedoToIndex(size_t index)
         return false;
     }
 
+    restoreState(index, [this, index] {
+        projectHistory()->undoRedoToIndex(index);
+    });
+
+    return true;
+}
+
+void UndoManager::restoreState(size_t index, const std::function<void()>& restore)
+{
     auto trackeditProject = globalContext()->currentProject()->trackeditProject();
 
+    //! Only the tracks that the history tells may change are compared
+    const std::optional<TracksDiff> diff = trackeditProject->tracksDiff(index);
+    if (diff) {
+        const TracksAndItems before = trackeditProject->buildTracksAndItems(changeDetection::tracksToBuildBefore(*diff));
+
+        restore();
+
+        const TracksAndItems after = trackeditProject->buildTracksAndItems(changeDetection::tracksToBuildAfter(*diff));
+
+        changeDetection::notifyOfUndoRedo(*diff, before, after, trackeditProject);
+        return;
+    }
+
     const TracksAndItems before = trackeditProject->buildTracksAndItems();
 
-    projectHistory()->undoRedoToIndex(index);
+    restore();
 
     const TracksAndItems after = trackeditProject->buildTracksAndItems();
 
     changeDetection::notifyOfUndoRedo(before, after, trackeditProject);
-
-    return true;
 }
 }
@@ -3,6 +3,8 @@
  */
 #pragma once
 
+#include <functional>
+
 #include "iundomanager.h"
 
 #include "iprojecthistory.h"
@@ -23,5 +25,9 @@ public:
     bool redo() override;
     bool canRedo() override;
     bool undoRedoToIndex(size_t index) override;
+
+private:
+    //! Restores the state at the index and notifies of the changes it made
+    void restoreState(size_t index, const std::function<void()>& restore);
 };
 }
@@ -74,6 +74,13 @@ public:
     virtual int64_t createNewGroupID(int64_t startingId = 0) const = 0;
 
     virtual TracksAndItems buildTracksAndItems() const = 0;
+    //! Only for the given tracks, in project order
+    virtual TracksAndItems buildTracksAndItems(const TrackIdList& trackIds) const = 0;
+
+    //! Which tracks restoring the undo history state at the index would change;
+    //! much cheaper than comparing everything before and after
+    //! @return std::nullopt if unknown
+    virtual std::optional<TracksDiff> tracksDiff(size_t stateIndex) const = 0;
 };
 
 using ITrackeditProjectPtr = std::shared_ptr<ITrackeditProject>;
@@ -3,6 +3,8 @@
  */
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "../internal/changedetection.h"
 
 #include "mocks/trackeditprojectmock.h"
@@ -115,6 +117,29 @@ protected:
         newLabel.color = muse::draw::Color(std::rand() % 256, std::rand() % 256, std::rand() % 256);
     }
 
+    //! Only the given tracks, as built for a TracksDiff
+    static TracksAndItems tracksSubset(const TracksAndItems& structure, const TrackIdList& trackIds)
+    {
+        TracksAndItems subset;
+        for (size_t i = 0; i < structure.tracks.size(); ++i) {
+            if (std::find(trackIds.begin(), trackIds.end(), structure.tracks[i].id) != trackIds.end()) {
+                subset.tracks.push_back(structure.tracks[i]);
+                subset.clips.push_back(structure.clips[i]);
+                subset.labels.push_back(structure.labels[i]);
+            }
+        }
+        return subset;
+    }
+
+    static TrackIdList allTrackIds(const TracksAndItems& structure)
+    {
+        TrackIdList trackIds;
+        for (const Track& track : structure.tracks) {
+            trackIds.push_back(track.id);
+        }
+        return trackIds;
+    }
+
     std::shared_ptr<TrackeditProjectMock> m_trackEditProject;
 };
 
@@ -870,4 +895,132 @@ TEST_F(ChangeDetectionTests, TestLabelNotificationAddingTwoAndRemovingTwo)
 
     changeDetection::notifyOfUndoRedo(before, after, m_trackEditProject);
 }
+
+TEST_F(ChangeDetectionTests, TestDiffTracksToBuild)
+{
+    TracksDiff diff;
+    diff.tracksBefore = { 0, 1, 2, 3 };
+    diff.tracksAfter = { 0, 1, 3, 4 };
+    diff.changedTracks = { 1 };
+
+    EXPECT_EQ(changeDetection::tracksToBuildBefore(diff), TrackIdList({ 1, 2 }));
+    EXPECT_EQ(changeDetection::tracksToBuildAfter(diff), TrackIdList({ 1, 4 }));
+}
+
+TEST_F(ChangeDetectionTests, TestDiffClipNotificationChangeStartTime)
+{
+    TracksAndItems before = buildTracksAndClips();
+    TracksAndItems after = buildTracksAndClips();
+
+    after.clips[3].back().startTime += 200;
+    //! Tracks that the diff does not tell changed are not compared
+    after.clips[4].back().startTime += 200;
+
+    TracksDiff diff;
+    diff.tracksBefore = allTrackIds(before);
+    diff.tracksAfter = allTrackIds(after);
+    diff.changedTracks = { 3 };
+
+    EXPECT_CALL(*m_trackEditProject, trackInserted()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, trackRemoved()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, trackChanged()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, reload()).Times(0);
+
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipAdded(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipRemoved(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipChanged(_)).Times(1);
+
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelAdded(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelRemoved(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelChanged(_)).Times(0);
+
+    changeDetection::notifyOfUndoRedo(diff,
+                                      tracksSubset(before, changeDetection::tracksToBuildBefore(diff)),
+                                      tracksSubset(after, changeDetection::tracksToBuildAfter(diff)),
+                                      m_trackEditProject);
+}
+
+TEST_F(ChangeDetectionTests, TestDiffNotificationsForAddingTwoTracks)
+{
+    TracksAndItems before = buildTracksAndClips();
+    TracksAndItems after = buildTracksAndClips();
+
+    addOneTrack(after, 5);
+    addOneTrack(after, 6);
+
+    TracksDiff diff;
+    diff.tracksBefore = allTrackIds(before);
+    diff.tracksAfter = allTrackIds(after);
+
+    EXPECT_CALL(*m_trackEditProject, trackInserted()).Times(2);
+    EXPECT_CALL(*m_trackEditProject, trackRemoved()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, trackChanged()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, reload()).Times(0);
+
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipAdded(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipRemoved(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipChanged(_)).Times(0);
+
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelAdded(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelRemoved(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelChanged(_)).Times(0);
+
+    changeDetection::notifyOfUndoRedo(diff,
+                                      tracksSubset(before, changeDetection::tracksToBuildBefore(diff)),
+                                      tracksSubset(after, changeDetection::tracksToBuildAfter(diff)),
+                                      m_trackEditProject);
+}
+
+TEST_F(ChangeDetectionTests, TestDiffNotificationsForRemovingOneTrack)
+{
+    TracksAndItems before = buildTracksAndClips();
+    TracksAndItems after = buildTracksAndClips();
+
+    after.tracks.pop_back();
+    after.clips.pop_back();
+    after.labels.pop_back();
+
+    TracksDiff diff;
+    diff.tracksBefore = allTrackIds(before);
+    diff.tracksAfter = allTrackIds(after);
+
+    EXPECT_CALL(*m_trackEditProject, trackInserted()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, trackRemoved()).Times(1);
+    EXPECT_CALL(*m_trackEditProject, trackChanged()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, reload()).Times(0);
+
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipAdded(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipRemoved(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutClipChanged(_)).Times(0);
+
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelAdded(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelRemoved(_)).Times(0);
+    EXPECT_CALL(*m_trackEditProject, notifyAboutLabelChanged(_)).Times(0);
+
+    changeDetection::notifyOfUndoRedo(diff,
+                                      tracksSubset(before, changeDetection::tracksToBuildBefore(diff)),
+                                      tracksSubset(after, changeDetection::tracksToBuildAfter(diff)),
+                                      m_trackEditProject);
+}
+
+TEST_F(ChangeDetectionTests, TestDiffTrackNotificationsForReordering)
+{
+    TracksAndItems before = buildTracksAndClips();
+    TracksAndItems after = buildTracksAndClips();
+
+    TracksDiff diff;
+    diff.tracksBefore = allTrackIds(before);
+    diff.tracksAfter = allTrackIds(after);
+    std::swap(diff.tracksAfter.front(), diff.tracksAfter.back());
+
+    EXPECT_CALL(*m_trackEditProject, trackInserted()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, trackRemoved()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, trackChanged()).Times(0);
+    EXPECT_CALL(*m_trackEditProject, reload()).Times(1);
+
+    changeDetection::notifyOfUndoRedo(diff,
+                                      tracksSubset(before, changeDetection::tracksToBuildBefore(diff)),
+                                      tracksSubset(after, changeDetection::tracksToBuildAfter(diff)),
+                                      m_trackEditProject);
+}
 }
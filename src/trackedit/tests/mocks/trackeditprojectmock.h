@@ -54,5 +54,7 @@ public:
     MOCK_METHOD(int64_t, createNewGroupID, (int64_t startingId), (const, override));
 
     MOCK_METHOD(TracksAndItems, buildTracksAndItems, (), (const, override));
+    MOCK_METHOD(TracksAndItems, buildTracksAndItems, (const TrackIdList& trackIds), (const, override));
+    MOCK_METHOD(std::optional<TracksDiff>, tracksDiff, (size_t stateIndex), (const, override));
 };
 }
@@ -65,6 +65,17 @@ enum class UndoPushType : unsigned char {
     NOAUTOSAVE = 1 << 1
 };
 
+//! Which tracks differ between two states of the project
+struct TracksDiff
+{
+    //! All tracks of each state, in order
+    TrackIdList tracksBefore;
+    TrackIdList tracksAfter;
+    //! Tracks of both states whose contents may differ; the other tracks of
+    //! both are the same
+    TrackIdList changedTracks;
+};
+
 enum class TrackMoveDirection {
     Up,
     Down,